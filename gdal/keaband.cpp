@@ -35,6 +35,7 @@
 #include "gdal_rat.h"
 #include "libkea/KEAAttributeTable.h"
 
+#include <algorithm>
 #include <map>
 #include <vector>
 
@@ -334,10 +335,54 @@ CPLErr KEARasterBand::IReadBlock( int nBlockXOff, int nBlockYOff, void * pImage
         {
             nysize -= (nytotalsize - this->nRasterYSize);
         }
-        this->m_pImageIO->readImageBlock2Band( this->nBand, pImage, this->nBlockXSize * nBlockXOff,
+
+        // if a derived mask has been requested (and doesn't have this block
+        // cached) fill its block from the same read of the data
+        GDALRasterBlock *pMaskBlock = NULL;
+        {
+            CPLMutexHolderD( &m_hMutex );
+            if( m_bMaskBandOwned && (m_pMaskBand != NULL) && ((KEAMaskBand*)m_pMaskBand)->IsDerived() )
+            {
+                pMaskBlock = m_pMaskBand->TryGetLockedBlockRef(nBlockXOff, nBlockYOff);
+                if( pMaskBlock != NULL )
+                {
+                    pMaskBlock->DropLock();
+                    pMaskBlock = NULL;
+                }
+                else
+                {
+                    pMaskBlock = m_pMaskBand->GetLockedBlockRef(nBlockXOff, nBlockYOff, TRUE);
+                }
+            }
+        }
+
+        if( pMaskBlock != NULL )
+        {
+            try
+            {
+                this->m_pImageIO->readImageBlockWithMask( this->nBand, pImage, 
+                                            (uint8_t*)pMaskBlock->GetDataRef(), 
+                                            this->nBlockXSize * nBlockXOff,
                                             this->nBlockYSize * nBlockYOff,
                                             nxsize, nysize, this->nBlockXSize, this->nBlockYSize, 
                                             this->m_eKEADataType );
+            }
+            catch (kealib::KEAIOException &e)
+            {
+                // don't leave an unread block in the mask's cache
+                pMaskBlock->DropLock();
+                m_pMaskBand->FlushBlock(nBlockXOff, nBlockYOff, FALSE);
+                throw;
+            }
+            pMaskBlock->DropLock();
+        }
+        else
+        {
+            this->m_pImageIO->readImageBlock2Band( this->nBand, pImage, this->nBlockXSize * nBlockXOff,
+                                            this->nBlockYSize * nBlockYOff,
+                                            nxsize, nysize, this->nBlockXSize, this->nBlockYSize, 
+                                            this->m_eKEADataType );
+        }
         return CE_None;
     }
     catch (kealib::KEAIOException &e)
@@ -348,6 +393,65 @@ CPLErr KEARasterBand::IReadBlock( int nBlockXOff, int nBlockYOff, void * pImage
     }
 }
 
+#ifdef HAVE_DATA_COVERAGE
+// virtual method to report which parts of a window contain data
+int KEARasterBand::IGetDataCoverageStatus( int nXOff, int nYOff,
+                                           int nXSize, int nYSize,
+                                           int nMaskFlagStop,
+                                           double* pdfDataPct)
+{
+    int nStatus = 0;
+    GIntBig nPixelsWithData = 0;
+    try
+    {
+        int nXStartBlock = nXOff / this->nBlockXSize;
+        int nXEndBlock = (nXOff + nXSize - 1) / this->nBlockXSize;
+        int nYStartBlock = nYOff / this->nBlockYSize;
+        int nYEndBlock = (nYOff + nYSize - 1) / this->nBlockYSize;
+        int nXNumBlocks = nXEndBlock - nXStartBlock + 1;
+        // read which blocks are empty once for the whole window
+        std::vector<bool> abEmpty;
+        this->m_pImageIO->getEmptyBlocks(this->nBand, nXStartBlock, nYStartBlock,
+                                         nXNumBlocks, nYEndBlock - nYStartBlock + 1, &abEmpty);
+        for( int nYBlock = nYStartBlock; nYBlock <= nYEndBlock; nYBlock++ )
+        {
+            for( int nXBlock = nXStartBlock; nXBlock <= nXEndBlock; nXBlock++ )
+            {
+                if( abEmpty[((nYBlock - nYStartBlock) * nXNumBlocks) + (nXBlock - nXStartBlock)] )
+                {
+                    nStatus |= GDAL_DATA_COVERAGE_STATUS_EMPTY;
+                }
+                else
+                {
+                    nStatus |= GDAL_DATA_COVERAGE_STATUS_DATA;
+                    // count the pixels of this block within the window
+                    int nBlkXStart = std::max(nXOff, nXBlock * this->nBlockXSize);
+                    int nBlkXEnd = std::min(nXOff + nXSize, (nXBlock + 1) * this->nBlockXSize);
+                    int nBlkYStart = std::max(nYOff, nYBlock * this->nBlockYSize);
+                    int nBlkYEnd = std::min(nYOff + nYSize, (nYBlock + 1) * this->nBlockYSize);
+                    nPixelsWithData += (GIntBig)(nBlkXEnd - nBlkXStart) * (nBlkYEnd - nBlkYStart);
+                }
+                if( (nStatus & nMaskFlagStop) != 0 )
+                {
+                    nYBlock = nYEndBlock;
+                    break;
+                }
+            }
+        }
+    }
+    catch (kealib::KEAIOException &e)
+    {
+        if( pdfDataPct != NULL )
+            *pdfDataPct = -1.0;
+        return GDAL_DATA_COVERAGE_STATUS_UNIMPLEMENTED | GDAL_DATA_COVERAGE_STATUS_DATA;
+    }
+
+    if( pdfDataPct != NULL )
+        *pdfDataPct = 100.0 * nPixelsWithData / ((double)nXSize * nYSize);
+    return nStatus;
+}
+#endif
+
 // virtual method to write a block
 CPLErr KEARasterBand::IWriteBlock( int nBlockXOff, int nBlockYOff, void * pImage )
 {
@@ -604,6 +708,7 @@ CPLErr KEARasterBand::SetNoDataValue(double dfNoData)
         {
             this->m_pImageIO->undefineNoDataValue(this->nBand);
         }
+        this->ResetMaskBand();
         return CE_None;
     }
     catch (kealib::KEAIOException &e)
@@ -617,6 +722,7 @@ CPLErr KEARasterBand::DeleteNoDataValue()
     try
     {
         m_pImageIO->undefineNoDataValue(this->nBand);
+        this->ResetMaskBand();
         return CE_None;
     }
     catch (const kealib::KEAIOException &)
@@ -1712,12 +1818,19 @@ GDALRasterBand* KEARasterBand::GetOverview(int nOverview)
     }
 }
 
-CPLErr KEARasterBand::CreateMaskBand(int nFlags)
+void KEARasterBand::ResetMaskBand()
 {
     CPLMutexHolderD( &m_hMutex );
     if( m_bMaskBandOwned )
         delete m_pMaskBand;
     m_pMaskBand = NULL;
+    m_bMaskBandOwned = false;
+}
+
+CPLErr KEARasterBand::CreateMaskBand(int nFlags)
+{
+    CPLMutexHolderD( &m_hMutex );
+    this->ResetMaskBand();
     try
     {
         this->m_pImageIO->createMask(this->nBand);
@@ -1737,8 +1850,12 @@ GDALRasterBand* KEARasterBand::GetMaskBand()
     {
         try
         {
-            if( this->m_pImageIO->maskCreated(this->nBand) )
+            int bHasNoData = FALSE;
+            this->GetNoDataValue(&bHasNoData);
+            if( this->m_pImageIO->maskCreated(this->nBand) || bHasNoData )
             {
+                // if there is no mask dataset libkea derives the mask
+                // from the no data value while reading (and it is read only)
                 m_pMaskBand = new KEAMaskBand(this, this->m_pImageIO, this->m_pRefCount);
                 m_bMaskBandOwned = true;
             }
@@ -1751,6 +1868,7 @@ GDALRasterBand* KEARasterBand::GetMaskBand()
 #else
                 m_pMaskBand = NULL;
 #endif
+                m_bMaskBandOwned = false;
             }
         }
         catch(kealib::KEAException &e)
@@ -1767,6 +1885,13 @@ int KEARasterBand::GetMaskFlags()
     {
         if( ! this->m_pImageIO->maskCreated(this->nBand) )
         {
+            int bHasNoData = FALSE;
+            this->GetNoDataValue(&bHasNoData);
+            if( bHasNoData )
+            {
+                // mask is derived from the no data value by libkea
+                return GMF_NODATA;
+            }
             // need to return the base class one since we are using
             // the base class implementation of GetMaskBand()
             //fprintf( stderr, "returning base GetMaskFlags()\n" );
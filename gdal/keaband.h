@@ -40,6 +40,11 @@
     #pragma message ("HAVE_RFC40 not present")
 #endif
 
+// IGetDataCoverageStatus introduced in GDAL 2.2
+#if (GDAL_VERSION_MAJOR >= 3) || ((GDAL_VERSION_MAJOR == 2) && (GDAL_VERSION_MINOR >= 2))
+    #define HAVE_DATA_COVERAGE
+#endif
+
 class KEAOverview;
 class KEAMaskBand;
 
@@ -128,9 +133,20 @@ protected:
     virtual CPLErr IReadBlock( int, int, void * );
     virtual CPLErr IWriteBlock( int, int, void * );
 
+#ifdef HAVE_DATA_COVERAGE
+    // reports blocks that have never been written (or hold no valid pixels)
+    virtual int IGetDataCoverageStatus( int nXOff, int nYOff,
+                                        int nXSize, int nYSize,
+                                        int nMaskFlagStop,
+                                        double* pdfDataPct);
+#endif
+
     // updates m_papszMetadataList
     void UpdateMetadataList();
 
+    // drops the cached mask band (eg after the no data value changes)
+    void ResetMaskBand();
+
     // sets the histogram column from a string (for metadata)
     CPLErr SetHistogramFromString(const char *pszString);
     char *GetHistogramAsString();
@@ -44,6 +44,19 @@ KEAMaskBand::KEAMaskBand(GDALRasterBand *pParent,
     pParent->GetBlockSize( &nBlockXSize, &nBlockYSize );
     eAccess = pParent->GetAccess();
 
+    // without a mask dataset libkea derives the mask from the no data
+    // value so there is nothing to write to
+    try
+    {
+        m_bDerived = !pImageIO->maskCreated(m_nSrcBand);
+    }
+    catch (kealib::KEAIOException &e)
+    {
+        m_bDerived = true;
+    }
+    if( m_bDerived )
+        eAccess = GA_ReadOnly;
+
     // grab the imageio class and its refcount
     this->m_pImageIO = pImageIO;
     this->m_pRefCount = pRefCount;
@@ -108,6 +121,12 @@ CPLErr KEAMaskBand::IReadBlock( int nBlockXOff, int nBlockYOff, void * pImage )
 // overridden implementation - calls writeImageBlock2BandMask instead
 CPLErr KEAMaskBand::IWriteBlock( int nBlockXOff, int nBlockYOff, void * pImage )
 {
+    if( m_bDerived )
+    {
+        CPLError( CE_Failure, CPLE_NoWriteAccess,
+                "The mask is derived from the no data value and cannot be written" );
+        return CE_Failure;
+    }
     try
     {
         // GDAL deals in blocks - if we are at the end of a row
@@ -39,10 +39,14 @@ class KEAMaskBand : public GDALRasterBand
     int m_nSrcBand;
     kealib::KEAImageIO  *m_pImageIO; // our image access pointer - refcounted
     LockedRefCount      *m_pRefCount; // reference count of m_pImageIO
+    bool                 m_bDerived; // no mask dataset - derived from the no data value
 public:
     KEAMaskBand(GDALRasterBand *pParent, kealib::KEAImageIO *pImageIO, LockedRefCount *pRefCount );
     ~KEAMaskBand();
 
+    // the mask is read only when libkea derives it from the no data value
+    bool IsDerived() const { return m_bDerived; }
+
 protected:
     // we just override these functions from GDALRasterBand
     virtual CPLErr IReadBlock( int, int, void * );
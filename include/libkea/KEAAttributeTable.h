@@ -41,6 +41,7 @@
 
 #include "libkea/KEACommon.h"
 #include "libkea/KEAException.h"
+#include "libkea/KEAArrowInterface.h"
 
 namespace kealib{
     
@@ -79,6 +80,99 @@ namespace kealib{
         size_t colNum;
     };
     
+    enum KEAATTCompareOp
+    {
+        kea_att_eq = 0,
+        kea_att_ne = 1,
+        kea_att_lt = 2,
+        kea_att_le = 3,
+        kea_att_gt = 4,
+        kea_att_ge = 5
+    };
+    
+    /**
+     * A comparison of an int, float or bool column against a constant,
+     * i.e. (column op value). Bool columns compare as 0 or 1.
+     */
+    struct KEAATTPredicate
+    {
+        std::string name;
+        KEAATTCompareOp op;
+        double value;
+    };
+    
+    enum KEAATTIndexType
+    {
+        kea_att_index_hash = 1,
+        kea_att_index_sorted = 2
+    };
+    
+    /**
+     * How the neighbours are stored: a variable length list per row in
+     * /ATT/NEIGHBOURS/NEIGHBOURS or compressed sparse row form, numRows+1
+     * offsets in /ATT/NEIGHBOURS/OFFSETS into the flat /ATT/NEIGHBOURS/INDICES.
+     */
+    enum KEAATTNeighboursLayout
+    {
+        kea_att_neighbours_varlen = 0,
+        kea_att_neighbours_csr = 1
+    };
+    
+    enum KEAATTAggregateOp
+    {
+        kea_att_agg_count = 0,
+        kea_att_agg_sum = 1,
+        kea_att_agg_mean = 2,
+        kea_att_agg_min = 3,
+        kea_att_agg_max = 4,
+        kea_att_agg_stddev = 5
+    };
+    
+    /**
+     * An aggregate of an int or float column within each group. NaN values
+     * are skipped; a count without a column name counts the rows.
+     */
+    struct KEAATTAggregate
+    {
+        std::string name;
+        KEAATTAggregateOp op;
+    };
+    
+    /**
+     * A secondary index on an int, float or string column. A sorted index holds
+     * the row ids ordered by value, a hash index holds them grouped into buckets
+     * (rows[buckets[b]] to rows[buckets[b+1]]) by the hash of their value. The
+     * keys are held in memory in the same order as the rows.
+     */
+    struct KEAATTIndex
+    {
+        KEAATTIndexType type;
+        KEAFieldDataType dataType;
+        size_t colIdx;
+        bool stale;
+        bool loaded;
+        std::vector<uint64_t> rows;
+        std::vector<uint64_t> buckets;
+        std::vector<int64_t> intKeys;
+        std::vector<double> floatKeys;
+        std::vector<std::string> strKeys;
+    };
+    
+    /**
+     * The cost of merging two adjacent regions for KEAAttributeTable::mergeRegions(),
+     * each region being named by its lowest row. cost() is called from several
+     * threads at once, merge() (region2 into region1) only from the calling thread.
+     * A cost is only recalculated once one of its regions has been merged, so it
+     * must only depend on the two regions.
+     */
+    class DllExport KEAATTMergeCriterion
+    {
+    public:
+        virtual double cost(size_t region1, size_t region2) const=0;
+        virtual void merge(size_t region1, size_t region2)=0;
+        virtual ~KEAATTMergeCriterion(){};
+    };
+    
     struct KEAAttributeIdx
     {
         char *name;
@@ -130,6 +224,87 @@ namespace kealib{
         virtual void getFloatFields(size_t startfid, size_t len, size_t colIdx, double *pfBuffer) const=0;
         virtual void getStringFields(size_t startfid, size_t len, size_t colIdx, std::vector<std::string> *psBuffer) const=0;
         virtual void getNeighbours(size_t startfid, size_t len, std::vector<std::vector<size_t>* > *neighbours) const=0;
+        /**
+         * The neighbours of len rows as two flat arrays, the neighbours of row
+         * startfid+i being indices[offsets[i]] to indices[offsets[i+1]-1].
+         * offsets has len+1 values and starts at 0.
+         */
+        virtual void getNeighboursCSR(size_t startfid, size_t len, std::vector<size_t> *offsets, std::vector<size_t> *indices) const;
+        
+        // Multi-column reads - buffer i receives len values of column colIdxs[i]
+        virtual void getBoolColumns(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, bool **pbBuffers) const;
+        virtual void getIntColumns(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, int64_t **pnBuffers) const;
+        virtual void getFloatColumns(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, double **pfBuffers) const;
+        virtual void getStringColumns(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, std::vector<std::string> **psBuffers) const;
+        
+        // Multi-column reads into a single row major buffer of len x colIdxs.size() values
+        virtual void getBoolBlock(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, bool *pbBuffer) const;
+        virtual void getIntBlock(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, int64_t *pnBuffer) const;
+        virtual void getFloatBlock(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, double *pfBuffer) const;
+        virtual void getStringBlock(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, std::vector<std::string> *psBuffer) const;
+        
+        /**
+         * Export len rows of the named columns as an Arrow C Data Interface struct
+         * array (one child per column: int64, float64, bit-packed bool or large utf8).
+         * The caller owns the result and must call the release callbacks.
+         */
+        virtual void exportColumnsArrow(size_t startfid, size_t len, const std::vector<std::string> &columns, ArrowArray *array, ArrowSchema *schema) const;
+        /**
+         * Write an Arrow struct array (or a single named column) into the table from
+         * row startfid. Children are matched to columns by name, missing columns are
+         * added and nulls are written as 0, false or "". The input is not released.
+         */
+        virtual void importColumnsArrow(size_t startfid, const ArrowArray *array, const ArrowSchema *schema);
+        
+        // Row selection - the rows for which all of the predicates are true
+        virtual void selectRows(const std::vector<KEAATTPredicate> &predicates, std::vector<bool> *selection) const;
+        virtual void selectRowIds(const std::vector<KEAATTPredicate> &predicates, std::vector<size_t> *fids) const;
+        
+        /**
+         * Secondary indexes. Writes to an indexed column mark its index stale and
+         * lookups scan the column until rebuildIndex() rebuilds it; lookups never
+         * change the table. Lookups on a column without an index (or range lookups
+         * with a hash index) also scan the column. Writes made directly to the
+         * KEAATTFeature returned by getFeature() are not tracked.
+         */
+        virtual void createIndex(const std::string &name, KEAATTIndexType type);
+        virtual void rebuildIndex(const std::string &name);
+        virtual void dropIndex(const std::string &name);
+        virtual bool hasIndex(const std::string &name) const;
+        virtual bool isIndexStale(const std::string &name) const;
+        virtual void findIntRows(const std::string &name, int64_t value, std::vector<size_t> *fids) const;
+        virtual void findFloatRows(const std::string &name, double value, std::vector<size_t> *fids) const;
+        virtual void findStringRows(const std::string &name, const std::string &value, std::vector<size_t> *fids) const;
+        virtual void findIntRowsInRange(const std::string &name, int64_t lower, int64_t upper, std::vector<size_t> *fids) const;
+        virtual void findFloatRowsInRange(const std::string &name, double lower, double upper, std::vector<size_t> *fids) const;
+        
+        /**
+         * Group the rows on an int, bool or string column and compute the aggregates
+         * for each group. The table is streamed in batches which are aggregated in
+         * parallel. Returns a new in-memory table with a row per group, in group
+         * order, which the caller must destroy.
+         */
+        virtual KEAAttributeTable* aggregate(const std::string &groupName, const std::vector<KEAATTAggregate> &aggregates) const;
+        
+        /**
+         * Graph algorithms over the neighbours, which are streamed through in batches
+         * of rows so file tables are not loaded. Rows left unlabelled are set to
+         * KEA_ATT_NO_LABEL and neighbours outside the table are ignored.
+         *
+         * findComponents() labels the connected components of the rows for which all
+         * of the predicates are true, numbered in order of their first row, and returns
+         * the number of components. growRegions() grows breadth first from each seed
+         * into rows matching the predicates, at most maxSteps neighbours away (0 for
+         * no limit), labelling rows with the index of the seed reaching them first
+         * (the lowest on a tie), and returns the number of rows reached. mergeRegions()
+         * starts from a region per row and, while merges cost no more than maxCost,
+         * merges each pair of adjacent regions which are one another's cheapest
+         * merge. The regions are labelled as the components and their number returned;
+         * the region adjacency is held in memory while merging.
+         */
+        virtual size_t findComponents(const std::vector<KEAATTPredicate> &predicates, std::vector<size_t> *labels) const;
+        virtual size_t growRegions(const std::vector<size_t> &seeds, const std::vector<KEAATTPredicate> &predicates, size_t maxSteps, std::vector<size_t> *labels) const;
+        virtual size_t mergeRegions(KEAATTMergeCriterion *criterion, double maxCost, std::vector<size_t> *labels) const;
         
         virtual void setBoolField(size_t fid, size_t colIdx, bool value)=0;
         virtual void setIntField(size_t fid, size_t colIdx, int64_t value)=0;
@@ -142,6 +317,13 @@ namespace kealib{
         virtual void setFloatFields(size_t startfid, size_t len, size_t colIdx, double *pfBuffer)=0;
         virtual void setStringFields(size_t startfid, size_t len, size_t colIdx, std::vector<std::string> *papszStrList)=0;
         virtual void setNeighbours(size_t startfid, size_t len, std::vector<std::vector<size_t>* > *neighbours)=0;
+        /**
+         * Sets the neighbours of len rows from two flat arrays laid out as by
+         * getNeighboursCSR(), the neighbours of row startfid+i being
+         * indices[offsets[i]] to indices[offsets[i+1]-1]. offsets has len+1
+         * values and need not start at 0.
+         */
+        virtual void setNeighboursCSR(size_t startfid, size_t len, const size_t *offsets, const size_t *indices);
         
         virtual void setBoolValue(size_t colIdx, bool value);
         virtual void setIntValue(size_t colIdx, int64_t value);
@@ -187,6 +369,49 @@ namespace kealib{
         static H5::CompType* createAttibuteIdxCompTypeMem();
         static H5::CompType* createKeaStringCompTypeDisk();
         static H5::CompType* createKeaStringCompTypeMem();
+        static size_t readATTHeaderColumn(H5::H5File *keaImg, const std::string &path, const H5::DataType &memType, size_t n, void *vals, H5::DSetMemXferPropList *xfer=NULL);
+        /**
+         * Rows are scanned in blocks of getScanBlockSize() and a block is only
+         * read for a predicate if predicateMayMatch() returns true for it.
+         */
+        virtual size_t getScanBlockSize() const;
+        virtual bool predicateMayMatch(const KEAATTPredicate &predicate, const KEAATTField &field, size_t startfid, size_t len) const;
+        void scanRows(const std::vector<KEAATTPredicate> &predicates, std::vector<bool> *selection, std::vector<size_t> *fids) const;
+        void selectGraphRows(const std::vector<KEAATTPredicate> &predicates, std::vector<bool> *selection) const;
+        static bool evaluatePredicate(KEAATTCompareOp op, double lhs, double value);
+        /**
+         * Re-express a comparison against a real value as an exact integer comparison.
+         * Returns 0 if no integer can match, 1 if every integer matches, otherwise -1.
+         */
+        static int rewriteIntPredicate(KEAATTCompareOp op, double value, KEAATTCompareOp *intOp, int64_t *intValue);
+        
+        mutable std::map<std::string, KEAATTIndex> indexes;
+        KEAATTField getIndexableField(const std::string &name, KEAFieldDataType dataType) const;
+        KEAATTIndex* getUsableIndex(const KEAATTField &field) const;
+        void buildIndex(KEAATTIndex *index) const;
+        void loadIndexKeys(KEAATTIndex *index) const;
+        void markIndexStale(KEAFieldDataType dataType, size_t colIdx);
+        void markIndexesStale();
+        // persistence of indexes, indexes are only held in memory by default
+        virtual void loadIndex(const std::string &name, KEAATTIndex *index) const;
+        virtual void saveIndex(const std::string &name, const KEAATTIndex &index);
+        virtual void saveIndexState(const std::string &name, const KEAATTIndex &index);
+        virtual void removeIndex(const std::string &name, const KEAATTIndex &index);
+        static void writeATTHeaderColumn(H5::H5File *keaImg, const std::string &path, const H5::DataType &diskType, const H5::DataType &memType, size_t n, const void *vals, unsigned int chunkSize, unsigned int deflate);
+        /**
+         * Neighbours in the file, in either layout. readNeighboursCSR() reads rows
+         * stored in the given layout as getNeighboursCSR(). createNeighboursCSR() replaces any CSR datasets
+         * with ones for numRows rows without neighbours and writeNeighboursCSR()
+         * writes the rows [startfid, startfid+len) of a CSR graph, their indices
+         * going in from firstIndex, which must be the offset of startfid.
+         * createVarLenNeighbours() replaces the variable length dataset with one
+         * of numRows empty lists.
+         */
+        static KEAATTNeighboursLayout readNeighboursLayout(H5::H5File *keaImg, const std::string &bandPathBase);
+        static void readNeighboursCSR(H5::H5File *keaImg, const std::string &bandPathBase, KEAATTNeighboursLayout layout, size_t startfid, size_t len, std::vector<size_t> *offsets, std::vector<size_t> *indices);
+        static void createNeighboursCSR(H5::H5File *keaImg, const std::string &bandPathBase, size_t numRows, unsigned int chunkSize, unsigned int deflate);
+        static void writeNeighboursCSR(H5::H5File *keaImg, const std::string &bandPathBase, size_t startfid, size_t len, const size_t *offsets, const size_t *indices, size_t firstIndex);
+        static void createVarLenNeighbours(H5::H5File *keaImg, const std::string &bandPathBase, size_t numRows, unsigned int chunkSize, unsigned int deflate);
         virtual void addAttBoolField(KEAATTField field, bool val)=0;
         virtual void addAttIntField(KEAATTField field, int64_t val)=0;
         virtual void addAttFloatField(KEAATTField field, float val)=0;
@@ -0,0 +1,98 @@
+/*
+ *  KEAAttributeTableAppender.h
+ *  LibKEA
+ *
+ *  Copyright 2026 LibKEA. All rights reserved.
+ *
+ *  This file is part of LibKEA.
+ *
+ *  Permission is hereby granted, free of charge, to any person 
+ *  obtaining a copy of this software and associated documentation 
+ *  files (the "Software"), to deal in the Software without restriction, 
+ *  including without limitation the rights to use, copy, modify, 
+ *  merge, publish, distribute, sublicense, and/or sell copies of the 
+ *  Software, and to permit persons to whom the Software is furnished 
+ *  to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be 
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR 
+ *  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+ *  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef KEAAttributeTableAppender_H
+#define KEAAttributeTableAppender_H
+
+#include <string>
+#include <vector>
+
+#include "libkea/KEACommon.h"
+#include "libkea/KEAException.h"
+#include "libkea/KEAAttributeTable.h"
+#include "libkea/KEAAttributeTableFile.h"
+
+namespace kealib{
+    
+    /**
+     * Appends rows to the end of a file attribute table. Rows are held in
+     * memory and written a whole number of chunks at a time with one write per
+     * column, so the new rows are never filled with the defaults first and
+     * the zone maps come from the values written. flush() writes any rows
+     * left over and reports errors, which the destructor has to ignore.
+     */
+    class DllExport KEAAttributeTableAppender
+    {
+    public:
+        KEAAttributeTableAppender(KEAAttributeTableFile *table);
+        
+        /**
+         * Starts a row holding the column defaults and no neighbours and
+         * returns its fid. The set methods change the row started last.
+         */
+        size_t appendRow();
+        void setBoolField(size_t colIdx, bool value);
+        void setIntField(size_t colIdx, int64_t value);
+        void setFloatField(size_t colIdx, double value);
+        void setStringField(size_t colIdx, const std::string &value);
+        void setNeighbours(const std::vector<size_t> &neighbours);
+        void flush();
+        
+        size_t getSize() const;
+        size_t getNumBuffered() const;
+        
+        ~KEAAttributeTableAppender();
+    protected:
+        void writeRows(size_t len);
+        void resizeColumns();
+        void checkRow(size_t colIdx, size_t numCols) const;
+        
+        KEAAttributeTableFile *table;
+        size_t chunkSize;
+        size_t numBuffered;
+        // the buffered rows, a vector per column and the neighbours as CSR
+        std::vector<std::vector<uint8_t> > boolColumns;
+        std::vector<std::vector<int64_t> > intColumns;
+        std::vector<std::vector<double> > floatColumns;
+        std::vector<std::vector<std::string> > strColumns;
+        std::vector<size_t> neighbourOffsets;
+        std::vector<size_t> neighbourIndices;
+        // the values of a new row
+        std::vector<uint8_t> boolDefaults;
+        std::vector<int64_t> intDefaults;
+        std::vector<double> floatDefaults;
+        std::vector<std::string> stringDefaults;
+    private:
+        KEAAttributeTableAppender(const KEAAttributeTableAppender&);
+        KEAAttributeTableAppender& operator=(const KEAAttributeTableAppender&);
+    };
+    
+}
+
+#endif
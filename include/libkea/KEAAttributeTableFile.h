@@ -34,6 +34,7 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <map>
 
 #include "H5Cpp.h"
 
@@ -42,7 +43,37 @@
 #include "libkea/KEAAttributeTable.h"
 
 namespace kealib{
-       
+    
+    enum KEAATTStringEncoding
+    {
+        kea_att_str_plain = 0,
+        kea_att_str_dictionary = 1
+    };
+    
+    struct KEAATTStringDictionary
+    {
+        std::vector<std::string> values;
+        std::map<std::string, int32_t> codes;
+    };
+    
+    /**
+     * Attribute table accessed directly from the file. Each data dataset
+     * (/ATT/DATA/BOOL, INT, FLOAT and STRING) is rows x columns but chunked
+     * chunkSize rows x 1 column, so every column is stored (and compressed)
+     * in its own chunks. Reading a column only decompresses that column and
+     * adding a column only extends the dataset extent; existing chunks are
+     * never rewritten.
+     *
+     * A column whose default differs from the dataset fill value is lazy: the
+     * default is recorded in /ATT/HEADER/<TYPE>_DEFAULTS and returned by reads
+     * until the column is first written, at which point it is materialised.
+     *
+     * String columns can be dictionary encoded, in which case the values are
+     * stored as int32 codes in /ATT/DATA/STRING_CODES<idx> indexing the
+     * distinct strings in /ATT/DATA/STRING_DICT<idx>. A code of -1 is the
+     * column default. getStringFields/setStringFields decode and encode
+     * transparently.
+     */
     class DllExport KEAAttributeTableFile : public KEAAttributeTable
     {
     public:
@@ -68,6 +99,17 @@ namespace kealib{
         void getFloatFields(size_t startfid, size_t len, size_t colIdx, double *pfBuffer) const;
         void getStringFields(size_t startfid, size_t len, size_t colIdx, std::vector<std::string> *psBuffer) const;
         void getNeighbours(size_t startfid, size_t len, std::vector<std::vector<size_t>* > *neighbours) const;
+        void getNeighboursCSR(size_t startfid, size_t len, std::vector<size_t> *offsets, std::vector<size_t> *indices) const;
+        
+        void getBoolColumns(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, bool **pbBuffers) const;
+        void getIntColumns(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, int64_t **pnBuffers) const;
+        void getFloatColumns(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, double **pfBuffers) const;
+        void getStringColumns(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, std::vector<std::string> **psBuffers) const;
+        
+        void getBoolBlock(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, bool *pbBuffer) const;
+        void getIntBlock(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, int64_t *pnBuffer) const;
+        void getFloatBlock(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, double *pfBuffer) const;
+        void getStringBlock(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, std::vector<std::string> *psBuffer) const;
         
         void setBoolField(size_t fid, size_t colIdx, bool value);
         void setIntField(size_t fid, size_t colIdx, int64_t value);
@@ -78,7 +120,18 @@ namespace kealib{
         void setIntFields(size_t startfid, size_t len, size_t colIdx, int64_t *pnBuffer);
         void setFloatFields(size_t startfid, size_t len, size_t colIdx, double *pfBuffer);
         void setStringFields(size_t startfid, size_t len, size_t colIdx, std::vector<std::string> *papszStrList);
+        /**
+         * With the CSR layout, rows keeping the number of neighbours they had
+         * (or at the end of the table) are written in place. Other rows are
+         * held in memory, and read back from there, until flushNeighbourEdits()
+         * merges them all with one rewrite of the rows from the first changed.
+         * That happens when the layout is changed, the table is destroyed or
+         * chunkSize * 64 rows are held, so writing rows one at a time costs
+         * one rewrite per batch rather than one per row.
+         */
         void setNeighbours(size_t startfid, size_t len, std::vector<std::vector<size_t>* > *neighbours);
+        void setNeighboursCSR(size_t startfid, size_t len, const size_t *offsets, const size_t *indices);
+        void flushNeighbourEdits();
 
         KEAATTFeature* getFeature(size_t fid) const;
         
@@ -91,16 +144,158 @@ namespace kealib{
         
         void addRows(size_t numRows);
         
+        /**
+         * Extends the datasets to hold numRows rows without adding them to the
+         * table, so addRows() doesn't extend them again until the table is
+         * larger. The header keeps the number of rows in the table and the
+         * reserved rows take no space in the file until they are added.
+         */
+        void reserveRows(size_t numRows);
+        size_t getReservedRows() const;
+        size_t getChunkSize() const;
+        
+        // the default each column was added with
+        bool getBoolDefault(size_t colIdx) const;
+        int64_t getIntDefault(size_t colIdx) const;
+        double getFloatDefault(size_t colIdx) const;
+        std::string getStringDefault(size_t colIdx) const;
+        
+        void dictionaryEncodeStringField(size_t colIdx);
+        bool isStringFieldDictionaryEncoded(size_t colIdx) const;
+        void getStringFieldCodes(size_t startfid, size_t len, size_t colIdx, int32_t *pnCodes) const;
+        void getStringFieldDictionary(size_t colIdx, std::vector<std::string> *psDictionary) const;
+        
+        /**
+         * The neighbours are stored as a variable length list per row unless
+         * converted to the CSR layout, which reads any number of rows with two
+         * allocations. Changing the layout rewrites the whole graph.
+         */
+        KEAATTNeighboursLayout getNeighboursLayout() const;
+        void setNeighboursLayout(KEAATTNeighboursLayout layout);
+        
+        /**
+         * Per chunk zone maps for int and float columns. Built on demand and then
+         * kept up to date (widened) by every write to the column. Each chunk of
+         * chunkSize rows has a min and max and, for floats, a count of NaN values
+         * which is exact after a build and an upper bound after writes. Writes
+         * only widen the zones in memory; the chunks changed are written back by
+         * flushZoneMaps(), which addRows, buildZoneMap and the destructor call.
+         */
+        void buildZoneMap(const std::string &name);
+        bool hasZoneMap(const std::string &name) const;
+        void dropZoneMap(const std::string &name);
+        void getIntZoneMap(size_t colIdx, std::vector<int64_t> *mins, std::vector<int64_t> *maxs) const;
+        void getFloatZoneMap(size_t colIdx, std::vector<double> *mins, std::vector<double> *maxs, std::vector<uint64_t> *nanCounts) const;
+        void flushZoneMaps();
+        
         static KEAAttributeTable* createKeaAtt(H5::H5File *keaImg, unsigned int band, unsigned int chunkSize=KEA_ATT_CHUNK_SIZE, unsigned int deflate=KEA_DEFLATE);
         void exportToKeaFile(H5::H5File *keaImg, unsigned int band, unsigned int chunkSize=KEA_ATT_CHUNK_SIZE, unsigned int deflate=KEA_DEFLATE);
         
         ~KEAAttributeTableFile();
     protected:
         size_t numRows;
+        size_t reservedRows;
         size_t chunkSize;
         unsigned int deflate;
         H5::H5File *keaImg;
         std::string bandPathBase;
+        
+        // data datasets and memory types opened once and reused for every access
+        mutable H5::DataSet *cachedBoolDataset;
+        mutable H5::DataSet *cachedIntDataset;
+        mutable H5::DataSet *cachedFloatDataset;
+        mutable H5::DataSet *cachedStringDataset;
+        mutable H5::DataSet *cachedNeighboursDataset;
+        H5::CompType *strTypeMem;
+        H5::DataType *neighboursTypeMem;
+        
+        H5::DataSet* getCachedDataset(const std::string &datasetName, H5::DataSet **cachedDataset) const;
+        void closeCachedDataset(H5::DataSet **cachedDataset) const;
+        
+        void checkColumnsRequest(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, size_t numFields, const std::string &typeName) const;
+        void readColumnSelection(H5::DataSet *dataset, const H5::DataType &memType, size_t startfid, size_t len, const std::vector<size_t> &uniqueCols, size_t numFields, void *pBuffer, H5::DSetMemXferPropList *xfer=NULL) const;
+        void readColumnValues(size_t startfid, size_t len, const std::vector<size_t> &uniqueCols, std::vector<int> *pbVals) const;
+        void readColumnValues(size_t startfid, size_t len, const std::vector<size_t> &uniqueCols, std::vector<int64_t> *pnVals) const;
+        void readColumnValues(size_t startfid, size_t len, const std::vector<size_t> &uniqueCols, std::vector<double> *pfVals) const;
+        void readColumnValues(size_t startfid, size_t len, const std::vector<size_t> &uniqueCols, std::vector<std::string> *psVals) const;
+        template <typename T, typename U>
+        void getColumnValues(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, size_t numFields, const std::string &typeName, T **buffers, T *block) const;
+        
+        // column defaults and whether each column is still lazy (not yet materialised)
+        std::vector<uint8_t> boolDefaults;
+        std::vector<int64_t> intDefaults;
+        std::vector<double> floatDefaults;
+        std::vector<std::string> stringDefaults;
+        std::vector<uint8_t> boolLazy;
+        std::vector<uint8_t> intLazy;
+        std::vector<uint8_t> floatLazy;
+        std::vector<uint8_t> stringLazy;
+        
+        void readColumnFills(int *boolFill, int64_t *intFill, double *floatFill, std::string *stringFill) const;
+        void loadColumnDefaults();
+        void writeColumnDefaults(KEAFieldDataType dataType);
+        void writeDefaultsToRows(size_t startfid, size_t len);
+        void loadReservedRows();
+        void extendRows(size_t numRowsIn);
+        
+        /**
+         * Adds rows whose every column the caller (KEAAttributeTableAppender)
+         * writes straight afterwards, so the defaults are not written first and
+         * the zones of the new chunks come from the values written.
+         */
+        void appendRows(size_t numRowsIn);
+        friend class KEAAttributeTableAppender;
+        void materialiseBoolField(size_t colIdx, size_t skipStart, size_t skipLen);
+        void materialiseIntField(size_t colIdx, size_t skipStart, size_t skipLen);
+        void materialiseFloatField(size_t colIdx, size_t skipStart, size_t skipLen);
+        void materialiseStringField(size_t colIdx, size_t skipStart, size_t skipLen);
+        
+        size_t getScanBlockSize() const;
+        void extendRowDataset(H5::DataSet *dataset, hsize_t numCols);
+        bool predicateMayMatch(const KEAATTPredicate &predicate, const KEAATTField &field, size_t startfid, size_t len) const;
+        
+        // encoding of each string column and the dictionaries read so far
+        std::vector<uint8_t> stringEncoding;
+        mutable std::map<size_t, KEAATTStringDictionary> stringDictionaries;
+        mutable std::map<size_t, H5::DataSet*> cachedCodesDatasets;
+        
+        void loadStringEncodings();
+        
+        KEAATTNeighboursLayout neighboursLayout;
+        // CSR rows written with a different number of neighbours, which are
+        // merged into the datasets by flushNeighbourEdits()
+        std::map<size_t, std::vector<size_t> > neighbourEdits;
+        size_t readNeighbourOffset(size_t fid) const;
+        void readNeighbourRows(size_t startfid, size_t len, std::vector<size_t> *offsets, std::vector<size_t> *indices) const;
+        void trimNeighbourIndices();
+        KEAATTStringDictionary* getStringDictionary(size_t colIdx) const;
+        void appendStringDictionary(size_t colIdx, size_t firstNew);
+        void readStringCodes(size_t startfid, size_t len, size_t colIdx, int32_t *pnCodes) const;
+        void writeStringCodes(size_t startfid, size_t len, size_t colIdx, const int32_t *pnCodes);
+        void decodeStringCodes(size_t colIdx, const int32_t *pnCodes, size_t len, std::string *psVals, size_t stride) const;
+        
+        // zone maps, per chunk {min, max} for ints and {min, max, NaN count} for floats
+        std::map<size_t, std::vector<int64_t> > intZoneMaps;
+        std::map<size_t, std::vector<double> > floatZoneMaps;
+        // the range of chunks [first, end) changed in memory since the last flush
+        std::map<size_t, std::pair<size_t, size_t> > intZonesDirty;
+        std::map<size_t, std::pair<size_t, size_t> > floatZonesDirty;
+        
+        void loadZoneMaps();
+        void computeIntZones(size_t colIdx, size_t firstChunk, size_t endChunk);
+        void computeFloatZones(size_t colIdx, size_t firstChunk, size_t endChunk);
+        void widenIntZones(size_t colIdx, size_t startfid, size_t len, const int64_t *pnBuffer);
+        void widenFloatZones(size_t colIdx, size_t startfid, size_t len, const double *pfBuffer);
+        void markZonesDirty(KEAFieldDataType dataType, size_t colIdx, size_t firstChunk, size_t endChunk);
+        void writeZoneMap(KEAFieldDataType dataType, size_t colIdx, size_t firstChunk, size_t endChunk);
+        
+        // indexes are saved as {<TYPE><idx>_HEADER, _ROWS, _BUCKETS} in the /ATT/INDEX group
+        std::string getIndexPath(const KEAATTIndex &index) const;
+        void loadIndexes();
+        void loadIndex(const std::string &name, KEAATTIndex *index) const;
+        void saveIndex(const std::string &name, const KEAATTIndex &index);
+        void saveIndexState(const std::string &name, const KEAATTIndex &index);
+        void removeIndex(const std::string &name, const KEAATTIndex &index);
 
         void updateSizeHeader(hsize_t nbools, hsize_t nints, hsize_t nfloats, hsize_t nstrings);
 };
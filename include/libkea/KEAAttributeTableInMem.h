@@ -34,12 +34,15 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <map>
+#include <deque>
 
 #include "H5Cpp.h"
 
 #include "libkea/KEACommon.h"
 #include "libkea/KEAException.h"
 #include "libkea/KEAAttributeTable.h"
+#include "libkea/KEAStringArena.h"
 
 namespace kealib{
        
@@ -68,6 +71,7 @@ namespace kealib{
         void getFloatFields(size_t startfid, size_t len, size_t colIdx, double *pfBuffer) const;
         void getStringFields(size_t startfid, size_t len, size_t colIdx, std::vector<std::string> *psBuffer) const;
         void getNeighbours(size_t startfid, size_t len, std::vector<std::vector<size_t>* > *neighbours) const;
+        void getNeighboursCSR(size_t startfid, size_t len, std::vector<size_t> *offsets, std::vector<size_t> *indices) const;
         
         void setBoolField(size_t fid, size_t colIdx, bool value);
         void setIntField(size_t fid, size_t colIdx, int64_t value);
@@ -79,7 +83,29 @@ namespace kealib{
         void setFloatFields(size_t startfid, size_t len, size_t colIdx, double *pfBuffer);
         void setStringFields(size_t startfid, size_t len, size_t colIdx, std::vector<std::string> *papszStrList);
         void setNeighbours(size_t startfid, size_t len, std::vector<std::vector<size_t>* > *neighbours);
+        void setNeighboursCSR(size_t startfid, size_t len, const size_t *offsets, const size_t *indices);
+        
+        /**
+         * The neighbours of a single row without copying them. The pointer is
+         * valid until the neighbours are next changed or read by getNeighboursCSR().
+         */
+        const size_t* getRowNeighbours(size_t fid, size_t *numNeighbours) const;
+        void setRowNeighbours(size_t fid, const size_t *neighbourIds, size_t numNeighbours);
+        
+        /**
+         * The layout exportToKeaFile() stores the neighbours in, that of the file
+         * for a table read by createKeaAtt().
+         */
+        KEAATTNeighboursLayout getNeighboursLayout() const;
+        void setNeighboursLayout(KEAATTNeighboursLayout layout);
 
+        /**
+         * Returns a view of the row, owned by the table, whose changes are
+         * copied into the columns. Only the views of the last 1024 rows fetched
+         * are kept, so a view can be used until that many other rows have been
+         * fetched. As reads of a row copy its view back first, const reads
+         * (getIntFields() etc.) can change the table.
+         */
         KEAATTFeature* getFeature(size_t fid) const;
         
         size_t getSize() const;
@@ -97,7 +123,57 @@ namespace kealib{
         
         ~KEAAttributeTableInMem();
     protected:
-        std::vector<KEAATTFeature*> *attRows;
+        void loadLazyColumnDefaults(H5::H5File *keaImg, const std::string &bandPathBase);
+        void loadColumnData(H5::H5File *keaImg, const std::string &bandPathBase, size_t chunkSize);
+        void loadDictionaryEncodedColumns(H5::H5File *keaImg, const std::string &bandPathBase);
+        void exportColumnData(H5::DataSet *boolDataset, H5::DataSet *intDataset, H5::DataSet *floatDataset, H5::DataSet *strDataset, const H5::CompType &strTypeMem, size_t chunkSize) const;
+        void exportNeighbours(H5::H5File *keaImg, const std::string &bandPathBase, H5::DataSet *neighboursDataset, size_t chunkSize, unsigned int deflate) const;
+        
+        /**
+         * Rows returned by getFeature() are materialised on demand and kept until
+         * more than 1024 rows have views (the oldest is then written back and
+         * dropped) or the table is destroyed. Changes made through them are
+         * copied back into the columns before those rows are next accessed and
+         * writes to the columns are copied into them.
+         */
+        void syncFeatureViews(size_t startfid, size_t len) const;
+        void refreshFeatureViews(size_t startfid, size_t len, KEAFieldDataType dataType, size_t colIdx);
+        void refreshNeighbourViews(size_t startfid, size_t len);
+        
+        const size_t* findRowNeighbours(size_t fid, size_t *numNeighbours) const;
+        void storeRowNeighbours(size_t fid, const size_t *neighbourIds, size_t numNeighbours);
+        void compactNeighbours() const;
+        
+        void replaceString(std::vector<const char*> &column, size_t fid, const std::string &value);
+        void compactStrings(bool force);
+        
+        // The table is held as a contiguous array per column, the bool columns
+        // as bitmaps of 64 bit words and the strings as pointers into strArena.
+        size_t numRows;
+        std::vector<std::vector<uint64_t> > boolColumns;
+        std::vector<std::vector<int64_t> > intColumns;
+        std::vector<std::vector<double> > floatColumns;
+        std::vector<std::vector<const char*> > strColumns;
+        // The value each column gives the rows added by addRows().
+        std::vector<uint8_t> boolDefaults;
+        std::vector<int64_t> intDefaults;
+        std::vector<double> floatDefaults;
+        std::vector<const char*> strDefaults;
+        // The neighbours are held as CSR arrays covering the first
+        // neighbourOffsets.size()-1 rows, the rows after have none. A row
+        // rewritten with a different number of neighbours (other than the last)
+        // is held in neighbourEdits until compactNeighbours() merges it in.
+        std::vector<size_t> neighbourOffsets;
+        std::vector<size_t> neighbourIndices;
+        std::map<size_t, std::vector<size_t> > neighbourEdits;
+        KEAATTNeighboursLayout neighboursLayout;
+        mutable std::map<size_t, KEAATTFeature*> featureViews;
+        // the rows with views in the order they were fetched
+        mutable std::deque<size_t> featureViewOrder;
+        KEAStringArena strArena;
+        // Bytes of the strings in strArena which have been replaced (an upper
+        // bound as interned strings may still be used by other rows).
+        size_t strDeadBytes;
     };
     
 }
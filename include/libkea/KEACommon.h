@@ -102,6 +102,8 @@ namespace kealib{
     static const std::string KEA_BANDNAME_METADATA_HISTONUMBINS( "/METADATA/STATISTICS_HISTONUMBINS" );
     static const std::string KEA_BANDNAME_METADATA_HISTOBINVALUES( "/METADATA/STATISTICS_HISTOBINVALUES" );
     static const std::string KEA_BANDNAME_METADATA_HISTOBINFUNCTION( "/METADATA/STATISTICS_HISTOBINFUNCTION" );
+    static const std::string KEA_BANDNAME_METADATA_APPROXIMATE( "/METADATA/STATISTICS_APPROXIMATE" );
+    static const std::string KEA_BANDNAME_CHUNK_STATS( "/CHUNK_STATS" );
     static const std::string KEA_BANDNAME_METADATA_WAVELENGTH( "/METADATA/WAVELENGTH" );
     static const std::string KEA_BANDNAME_METADATA_FWHM( "/METADATA/FWHM" );
     
@@ -114,12 +116,28 @@ namespace kealib{
     static const std::string KEA_ATT_FLOAT_DATA( "/ATT/DATA/FLOAT" );
     static const std::string KEA_ATT_STRING_DATA( "/ATT/DATA/STRING" );
     static const std::string KEA_ATT_NEIGHBOURS_DATA( "/ATT/NEIGHBOURS/NEIGHBOURS" );
+    static const std::string KEA_ATT_NEIGHBOURS_OFFSETS_DATA( "/ATT/NEIGHBOURS/OFFSETS" );
+    static const std::string KEA_ATT_NEIGHBOURS_INDICES_DATA( "/ATT/NEIGHBOURS/INDICES" );
+    static const std::string KEA_ATT_STRING_CODES_DATA( "/ATT/DATA/STRING_CODES" );
+    static const std::string KEA_ATT_STRING_DICT_DATA( "/ATT/DATA/STRING_DICT" );
     static const std::string KEA_ATT_BOOL_FIELDS_HEADER( "/ATT/HEADER/BOOL_FIELDS" );
     static const std::string KEA_ATT_INT_FIELDS_HEADER( "/ATT/HEADER/INT_FIELDS" );
     static const std::string KEA_ATT_FLOAT_FIELDS_HEADER( "/ATT/HEADER/FLOAT_FIELDS" );
     static const std::string KEA_ATT_STRING_FIELDS_HEADER( "/ATT/HEADER/STRING_FIELDS" );
     static const std::string KEA_ATT_SIZE_HEADER( "/ATT/HEADER/SIZE" );
     static const std::string KEA_ATT_CHUNKSIZE_HEADER( "/ATT/HEADER/CHUNKSIZE" );
+    static const std::string KEA_ATT_BOOL_DEFAULTS_HEADER( "/ATT/HEADER/BOOL_DEFAULTS" );
+    static const std::string KEA_ATT_INT_DEFAULTS_HEADER( "/ATT/HEADER/INT_DEFAULTS" );
+    static const std::string KEA_ATT_FLOAT_DEFAULTS_HEADER( "/ATT/HEADER/FLOAT_DEFAULTS" );
+    static const std::string KEA_ATT_STRING_DEFAULTS_HEADER( "/ATT/HEADER/STRING_DEFAULTS" );
+    static const std::string KEA_ATT_BOOL_LAZY_HEADER( "/ATT/HEADER/BOOL_LAZY" );
+    static const std::string KEA_ATT_INT_LAZY_HEADER( "/ATT/HEADER/INT_LAZY" );
+    static const std::string KEA_ATT_FLOAT_LAZY_HEADER( "/ATT/HEADER/FLOAT_LAZY" );
+    static const std::string KEA_ATT_STRING_LAZY_HEADER( "/ATT/HEADER/STRING_LAZY" );
+    static const std::string KEA_ATT_STRING_ENCODING_HEADER( "/ATT/HEADER/STRING_ENCODING" );
+    static const std::string KEA_ATT_INT_ZONEMAP_HEADER( "/ATT/HEADER/INT_ZONEMAP" );
+    static const std::string KEA_ATT_FLOAT_ZONEMAP_HEADER( "/ATT/HEADER/FLOAT_ZONEMAP" );
+    static const std::string KEA_ATT_INDEX_GROUP( "/ATT/INDEX" );
     
     static const std::string KEA_ATT_NAME_FIELD( "NAME" );
     static const std::string KEA_ATT_INDEX_FIELD( "INDEX" );
@@ -128,6 +146,9 @@ namespace kealib{
     
     static const std::string KEA_ATT_STRING_FIELD( "STRING" );
     
+    static const std::string KEA_ATT_HISTOGRAM_FIELD( "Histogram" );
+    static const std::string KEA_ATT_HISTOGRAM_USAGE( "PixelCount" );
+    
     static const std::string KEA_BANDNAME_OVERVIEWS( "/OVERVIEWS" );
     static const std::string KEA_OVERVIEWSNAME_OVERVIEW( "/OVERVIEWS/OVERVIEW" );
     
@@ -149,6 +170,7 @@ namespace kealib{
     static const std::string KEA_ATTRIBUTENAME_BLOCK_SIZE( "BLOCK_SIZE" );
     
     static const std::string KEA_NODATA_DEFINED( "NO_DATA_DEFINED" );
+    static const std::string KEA_CHUNK_STATS_STALE( "STALE" );
     
     static const int KEA_MDC_NELMTS( 0 ); // 0
     static const hsize_t  KEA_RDCC_NELMTS( 512 ); // 512
@@ -159,6 +181,8 @@ namespace kealib{
     static const unsigned int KEA_DEFLATE( 1 ); // 1
     static const hsize_t KEA_IMAGE_CHUNK_SIZE( 256 ); // 256
     static const hsize_t KEA_ATT_CHUNK_SIZE( 1000 ); // 1000
+    static const hsize_t KEA_ATT_NEIGHBOURS_INDICES_CHUNK( 65536 ); // 65536
+    static const size_t KEA_ATT_NO_LABEL( static_cast<size_t>(-1) ); // rows left out of a graph labelling
     
     enum KEADataType
     {
@@ -237,11 +261,39 @@ namespace kealib{
         double dfGCPZ;
     };
     
+    struct KEAChunkStats
+    {
+        uint64_t xBlock;
+        uint64_t yBlock;
+        double min;
+        double max;
+        double mean;
+        double m2; // SUM OF SQUARED DIFFERENCES FROM THE MEAN
+        uint64_t count;
+    };
+    
     struct KEAString
     {
         char *str;
     };
     
+    struct KEABandStats
+    {
+        double min;
+        double max;
+        double mean;
+        double stdDev;
+        double mode;
+        uint64_t numValidPxls;
+        double histoMin;
+        double histoMax;
+        std::string histoBinFunction;
+        std::vector<uint64_t> histogram;
+        bool approximate;
+        double sampleFraction;
+        double meanStdError;
+    };
+    
     inline std::string int2Str(int32_t num)
     {
         std::ostringstream convert;
@@ -277,6 +329,14 @@ namespace kealib{
         return convert.str();
     }
     
+    inline std::string double2Str(double num)
+    {
+        std::ostringstream convert;
+        convert.precision(15);
+        convert << num;
+        return convert.str();
+    }
+    
     inline std::string getDataTypeAsStr(KEADataType dataType)
     {
         std::string strDT = "Unknown";
@@ -60,6 +60,13 @@ namespace kealib{
         void readImageBlock2BandMask(uint32_t band, void *data, uint64_t xPxlOff, uint64_t yPxlOff, uint64_t xSizeIn, uint64_t ySizeIn, uint64_t xSizeBuf, uint64_t ySizeBuf, KEADataType inDataType);
         bool maskCreated(uint32_t band);
         
+        /**
+         * Reads a block of image data together with its mask in one pass. The mask
+         * (0 = no data, 255 = valid) uses the same buffer layout as the data. If the
+         * band has no mask dataset the mask is derived from the no data value.
+         */
+        void readImageBlockWithMask(uint32_t band, void *data, uint8_t *mask, uint64_t xPxlOff, uint64_t yPxlOff, uint64_t xSizeIn, uint64_t ySizeIn, uint64_t xSizeBuf, uint64_t ySizeBuf, KEADataType inDataType);
+        
         void setImageMetaData(std::string name, std::string value);
         std::string getImageMetaData(std::string name);
         std::vector<std::string> getImageMetaDataNames();
@@ -110,6 +117,60 @@ namespace kealib{
         void readFromOverview(uint32_t band, uint32_t overview, void *data, uint64_t xPxlOff, uint64_t yPxlOff, uint64_t xSizeIn, uint64_t ySizeIn, uint64_t xSizeBuf, uint64_t ySizeBuf, KEADataType inDataType);
         uint32_t getNumOfOverviews(uint32_t band);
         void getOverviewSize(uint32_t band, uint32_t overview, uint64_t *xSize, uint64_t *ySize);
+        
+        /**
+         * Calculates the statistics and histogram for a band. If writeStats is set
+         * they are also written to the band metadata (STATISTICS_*) and the histogram
+         * column of the attribute table.
+         * If approxOK is set, large bands are summarised from the coarsest overview with
+         * enough pixels or, failing that, a stratified sample of blocks; the returned
+         * stats then give the fraction sampled and, for sampled blocks, the standard
+         * error of the mean (NaN when an overview was used). The histogram of an
+         * approximate result counts the pixels read and it is never written to the file.
+         */
+        KEABandStats computeBandStatistics(uint32_t band, bool approxOK=false, bool ignoreNoData=true, bool writeStats=true);
+        
+        /**
+         * Creates (or rebuilds) a per band dataset holding the min, max, mean, sum of
+         * squared differences from the mean and count of the valid pixels in each
+         * image block. Once created it is kept up to date by writeImageBlock2Band.
+         * Changing the no data value marks it stale instead of re-reading the band:
+         * stale statistics are not used by computeBandStatistics or isBlockEmpty,
+         * getChunkStatistics throws, and updating the whole band (or recreating
+         * them) brings them back up to date.
+         */
+        void createChunkStatistics(uint32_t band, uint32_t deflate=KEA_DEFLATE);
+        bool chunkStatisticsCreated(uint32_t band);
+        bool chunkStatisticsStale(uint32_t band);
+        void updateChunkStatistics(uint32_t band, uint64_t xPxlOff, uint64_t yPxlOff, uint64_t xSize, uint64_t ySize);
+        void getChunkStatistics(uint32_t band, uint64_t xPxlOff, uint64_t yPxlOff, uint64_t xSize, uint64_t ySize, std::vector<KEAChunkStats> *chunkStats);
+        
+        /**
+         * Merges the chunk statistics into band min/max/mean/stddev (no histogram).
+         */
+        KEABandStats getBandStatisticsFromChunks(uint32_t band);
+        
+        /**
+         * A block is empty if it has never been written (so reads return the fill
+         * value) or, when chunk statistics exist, it has no valid pixels.
+         */
+        bool isBlockEmpty(uint32_t band, uint64_t xBlock, uint64_t yBlock);
+        
+        /**
+         * Gets whether each block (row major) has been allocated in the file.
+         */
+        void getBlockAllocationMap(uint32_t band, std::vector<bool> *allocated);
+        
+        /**
+         * Gets whether each block of a window of blocks (row major) is empty, as
+         * isBlockEmpty, reading the allocation map and chunk statistics once.
+         */
+        void getEmptyBlocks(uint32_t band, uint64_t xBlockOff, uint64_t yBlockOff, uint64_t xNumBlocks, uint64_t yNumBlocks, std::vector<bool> *empty);
+        
+        /**
+         * Estimates a percentile (0-100) from the histogram of a set of band statistics.
+         */
+        static double getStatsPercentile(const KEABandStats &stats, double percentile);
                 
         KEAAttributeTable* getAttributeTable(KEAATTType type, uint32_t band);
         void setAttributeTable(KEAAttributeTable* att, uint32_t band, uint32_t chunkSize=KEA_ATT_CHUNK_SIZE, uint32_t deflate=KEA_DEFLATE);
@@ -155,6 +216,30 @@ namespace kealib{
          */
         static void setNumImgBandsInFileMetadata(H5::H5File *keaImgH5File, const uint32_t numImgBands);
 
+        /**
+         * Sets mask pixels to 0 where data equals noDataVal (both of dataType) and to 255 otherwise.
+         */
+        static void createNoDataMask(const void *data, const void *noDataVal, KEADataType dataType, uint8_t *mask, uint64_t xSize, uint64_t ySize, uint64_t xSizeData, uint64_t xSizeMask);
+        
+        /**
+         * Builds a virtual mask for a band without a mask dataset from its no data value.
+         */
+        void readNoDataMask(uint32_t band, uint8_t *mask, uint64_t xPxlOff, uint64_t yPxlOff, uint64_t xSizeIn, uint64_t ySizeIn, uint64_t xSizeMask);
+        
+        /**
+         * Writes the chunk statistics of the blocks touched by a region without flushing.
+         * Blocks the region covers are summarised from data (if given, with a row length
+         * of xSizeData) and the others are re-read from the band.
+         */
+        void writeChunkStatistics(uint32_t band, const void *data, KEADataType dataType, uint64_t xPxlOff, uint64_t yPxlOff, uint64_t xSize, uint64_t ySize, uint64_t xSizeData);
+        
+        /**
+         * Sets whether the chunk statistics of a band (if it has them) are stale.
+         */
+        void setChunkStatisticsStale(uint32_t band, bool stale);
+        
+        void writeHistogramToAttributeTable(uint32_t band, const std::vector<uint64_t> &histogram);
+        
         static H5::CompType* createGCPCompTypeDisk();
         static H5::CompType* createGCPCompTypeMem();
         
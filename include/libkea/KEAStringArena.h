@@ -0,0 +1,90 @@
+/*
+ *  KEAStringArena.h
+ *  LibKEA
+ *
+ *  Copyright 2026 LibKEA. All rights reserved.
+ *
+ *  This file is part of LibKEA.
+ *
+ *  Permission is hereby granted, free of charge, to any person 
+ *  obtaining a copy of this software and associated documentation 
+ *  files (the "Software"), to deal in the Software without restriction, 
+ *  including without limitation the rights to use, copy, modify, 
+ *  merge, publish, distribute, sublicense, and/or sell copies of the 
+ *  Software, and to permit persons to whom the Software is furnished 
+ *  to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be 
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR 
+ *  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+ *  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef KEAStringArena_H
+#define KEAStringArena_H
+
+#include <string>
+#include <vector>
+
+#include "libkea/KEACommon.h"
+
+namespace kealib{
+    
+    static const size_t KEA_STRING_ARENA_BLOCK_SIZE( 1048576 ); // 1 MB
+    static const size_t KEA_STRING_ARENA_INTERN_MAX( 64 ); // strings up to 64 chars are interned
+    
+    /**
+     * Table owned storage for strings. Strings are copied into large blocks
+     * which are only freed with the arena, so loading and destroying a table
+     * costs a handful of allocations. Short strings are interned so repeated
+     * values share a single copy. The returned pointers stay valid until the
+     * arena is cleared, swapped or destroyed. Nothing is freed when a string
+     * is replaced, so owners track what they drop and copy the strings still
+     * in use into a new arena once it is worth it (see swap()).
+     */
+    class DllExport KEAStringArena
+    {
+    public:
+        KEAStringArena(size_t blockSize=KEA_STRING_ARENA_BLOCK_SIZE);
+        
+        const char* add(const char *str, size_t len);
+        const char* add(const char *str);
+        const char* add(const std::string &str);
+        static const char* empty();
+        
+        size_t getNumBlocks() const;
+        size_t getAllocatedBytes() const;
+        size_t getUsedBytes() const;
+        size_t getNumInterned() const;
+        void clear();
+        void swap(KEAStringArena &other);
+        
+        ~KEAStringArena();
+    protected:
+        char* allocate(size_t size);
+        void growInternTable();
+        
+        size_t blockSize;
+        std::vector<char*> blocks;
+        char *blockPos;
+        size_t blockRemaining;
+        size_t allocatedBytes;
+        size_t usedBytes;
+        std::vector<const char*> internTable;
+        std::vector<uint64_t> internHashes;
+        size_t numInterned;
+    private:
+        KEAStringArena(const KEAStringArena&);
+        KEAStringArena& operator=(const KEAStringArena&);
+    };
+    
+}
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ *  KEAWorkerPool.h
+ *  LibKEA
+ *
+ *  Copyright 2026 LibKEA. All rights reserved.
+ *
+ *  This file is part of LibKEA.
+ *
+ *  Permission is hereby granted, free of charge, to any person 
+ *  obtaining a copy of this software and associated documentation 
+ *  files (the "Software"), to deal in the Software without restriction, 
+ *  including without limitation the rights to use, copy, modify, 
+ *  merge, publish, distribute, sublicense, and/or sell copies of the 
+ *  Software, and to permit persons to whom the Software is furnished 
+ *  to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be 
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR 
+ *  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+ *  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef KEAWorkerPool_H
+#define KEAWorkerPool_H
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "libkea/KEACommon.h"
+
+namespace kealib{
+    
+    typedef void (*KEAWorkerJob)(void *arg);
+    
+    /**
+     * A fixed set of worker threads, started once, which run the jobs queued
+     * with submit() in the order they were queued. wait() blocks until every
+     * job queued so far has finished and rethrows the first exception thrown
+     * by any of them. Destroying the pool drops the jobs not yet started and
+     * joins the workers once the running ones finish, so declare it after the
+     * data its jobs use.
+     */
+    class DllExport KEAWorkerPool
+    {
+    public:
+        KEAWorkerPool(size_t numThreads=0);
+        
+        size_t getNumThreads() const;
+        void submit(KEAWorkerJob job, void *arg);
+        void wait();
+        
+        ~KEAWorkerPool();
+    protected:
+        static void runWorker(KEAWorkerPool *pool);
+        
+        std::mutex mutex;
+        std::condition_variable jobReady;
+        std::condition_variable jobsDone;
+        std::deque<std::pair<KEAWorkerJob, void*> > jobs;
+        size_t numRunning;
+        std::exception_ptr error;
+        bool stop;
+        std::vector<std::thread> workers;
+    private:
+        KEAWorkerPool(const KEAWorkerPool&);
+        KEAWorkerPool& operator=(const KEAWorkerPool&);
+    };
+    
+}
+
+#endif
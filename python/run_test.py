@@ -27,8 +27,10 @@ import os
 import numpy
 from osgeo import gdal
 from kealib import neighbours
+from kealib import keaio
 
 TESTFILE = 'test.kea'
+IOTESTFILE = 'testio.kea'
 N_VALUES = 8
 
 def setupFile():
@@ -86,6 +88,53 @@ def testArray(ds):
     if not (numpyNeighbours == numpyNeighboursOut).all():
         raise SystemExit("Array Data doesn't match")
 
+def testCSR(ds):
+    """
+    Tests the ability to read and write neighbours as CSR offsets and indices
+    """
+    offsets = numpy.array([0, 2, 2, 5])
+    indices = numpy.array([4, 1, 7, 0, 3])
+    neighbours.setNeighboursCSR(ds, 1, 2, offsets, indices)
+
+    readOffsets, readIndices = neighbours.getNeighbours(ds, 1, 2, 3, 
+                    neighbours.NEIGHBOURS_CSR)
+    if not ((readOffsets == offsets).all() and (readIndices == indices).all()):
+        raise SystemExit("CSR Data doesn't match")
+
+    readData = neighbours.getNeighbours(ds, 1, 2, 3)
+    if readData != [[4, 1], [], [7, 0, 3]]:
+        raise SystemExit("CSR Data doesn't match lists")
+
+def testKEAIO():
+    """
+    Tests reading and writing blocks and columns without GDAL
+    """
+    if os.path.exists(IOTESTFILE):
+        os.remove(IOTESTFILE)
+
+    img = keaio.create(IOTESTFILE, keaio.KEA_16UINT, 100, 100)
+    block = numpy.arange(20 * 30, dtype=numpy.uint16).reshape((20, 30))
+    img.writeBlock(1, 5, 10, block)
+
+    # read back as another type, converted by libkea
+    readBlock = numpy.empty((20, 30), dtype=numpy.float32)
+    img.readBlock(1, 5, 10, readBlock)
+    if not (readBlock == block).all():
+        raise SystemExit("Block Data doesn't match")
+
+    rat = img.getAttributeTable(1)
+    rat.addRows(N_VALUES)
+    rat.addField('Values', keaio.FIELD_INT)
+    values = numpy.arange(N_VALUES, dtype=numpy.int64) * 3
+    rat.writeColumn('Values', 0, values)
+    readValues = numpy.zeros(N_VALUES, dtype=numpy.int64)
+    rat.readColumn('Values', 0, readValues)
+    if not (readValues == values).all():
+        raise SystemExit("Column Data doesn't match")
+
+    del rat
+    img.close()
+
 def doTests():
     """
     Main function
@@ -93,3 +142,5 @@ def doTests():
     ds = setupFile()
     testList(ds)
     testArray(ds)
+    testCSR(ds)
+    testKEAIO()
@@ -118,11 +118,17 @@ extkwargs = {'name':'neighbours', 'sources':['src/neighbours.cpp']}
 extkwargs.update(args)
 
 cmodule = Extension(**extkwargs)
-ext_modules = [cmodule]
+
+# keaio only needs libkea
+iokwargs = {'name':'keaio', 'sources':['src/keaio.cpp']}
+iokwargs.update(getKEAFlags())
+iomodule = Extension(**iokwargs)
+
+ext_modules = [cmodule, iomodule]
 
 setup(name='kealib', 
     version='0.1', 
-    description='Access to parts of kealib not exposed by GDAL',
+    description='Access to kealib directly and to the parts not exposed by GDAL',
     author='Sam Gillingham',
     author_email='gillingham.sam@gmail.com',
     ext_package = 'kealib',
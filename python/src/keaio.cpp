@@ -0,0 +1,967 @@
+/*
+ *  keaio.cpp
+ *  LibKEA
+ *
+ *  Copyright 2012 LibKEA. All rights reserved.
+ *
+ *  This file is part of LibKEA.
+ *
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without restriction,
+ *  including without limitation the rights to use, copy, modify,
+ *  merge, publish, distribute, sublicense, and/or sell copies of the
+ *  Software, and to permit persons to whom the Software is furnished
+ *  to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ *  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ *  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/*
+ Direct access to KEA images and their attribute tables without GDAL.
+ Pixels and columns are read into and written from any object supporting
+ the buffer protocol (numpy arrays, array.array etc) without copying, and
+ the GIL is released while libkea is working.
+*/
+
+#include <string>
+#include <vector>
+#include <Python.h>
+#include <pythread.h>
+#include "libkea/KEAImageIO.h"
+#include "libkea/KEAAttributeTable.h"
+
+/* An exception object for this module */
+/* created in the init function */
+struct KEAIOState
+{
+    PyObject *error;
+};
+
+#if PY_MAJOR_VERSION >= 3
+#define GETSTATE(m) ((struct KEAIOState*)PyModule_GetState(m))
+#define KEAIO_STRING_FROM_STRING PyUnicode_FromString
+#define KEAIO_STRING_AS_STRING PyUnicode_AsUTF8
+#define KEAIO_STRING_CHECK PyUnicode_Check
+#else
+#define GETSTATE(m) (&_state)
+static struct KEAIOState _state;
+#define KEAIO_STRING_FROM_STRING PyString_FromString
+#define KEAIO_STRING_AS_STRING PyString_AsString
+#define KEAIO_STRING_CHECK PyString_Check
+#endif
+
+/* the exception raised by the methods of the types, set by the init function */
+static PyObject *g_pKEAIOError = NULL;
+
+/* libkea objects and HDF5 builds without thread safety cannot be used from
+ more than one thread at a time so every call into libkea holds this lock.
+ It is only taken with the GIL released so other python threads carry on
+ with their own work while one is reading or writing. */
+static PyThread_type_lock g_keaLock = NULL;
+
+/* Runs the statements between them without the GIL and holding g_keaLock.
+ On failure bFailed is set and sError holds the message. Nothing may escape
+ as the lock must be released and the GIL taken back whatever happens */
+#define KEAIO_BEGIN_CALL \
+    std::string sError; \
+    bool bFailed = false; \
+    Py_BEGIN_ALLOW_THREADS \
+    PyThread_acquire_lock(g_keaLock, WAIT_LOCK); \
+    try \
+    {
+
+#define KEAIO_END_CALL \
+    } \
+    catch(std::exception &e) \
+    { \
+        sError = e.what(); \
+        bFailed = true; \
+    } \
+    catch(H5::Exception &e) \
+    { \
+        sError = e.getDetailMsg(); \
+        bFailed = true; \
+    } \
+    catch(...) \
+    { \
+        sError = "unknown exception"; \
+        bFailed = true; \
+    } \
+    PyThread_release_lock(g_keaLock); \
+    Py_END_ALLOW_THREADS
+
+#define KEAIO_RAISE_IF_FAILED(retval) \
+    if( bFailed ) \
+    { \
+        PyErr_Format(g_pKEAIOError, "Error from libkea: %s", sError.c_str()); \
+        return retval; \
+    }
+
+/* for the dealloc functions which have nowhere to report an error */
+static void acquireKEALock()
+{
+    if( !PyThread_acquire_lock(g_keaLock, NOWAIT_LOCK) )
+    {
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(g_keaLock, WAIT_LOCK);
+        Py_END_ALLOW_THREADS
+    }
+}
+
+/* Works out the KEA data type of the items in a buffer from its
+ struct module style format. Returns false if there isn't one. */
+static bool getKEADataType(const Py_buffer *pView, kealib::KEADataType *peType)
+{
+    const char *pszFormat = (pView->format == NULL) ? "B" : pView->format;
+    /* only native byte order can be passed to libkea */
+    const int nOne = 1;
+    bool bLittleEndian = (*(const char*)&nOne) == 1;
+    if( (pszFormat[0] == '@') || (pszFormat[0] == '=') ||
+            ((pszFormat[0] == '<') && bLittleEndian) ||
+            (((pszFormat[0] == '>') || (pszFormat[0] == '!')) && !bLittleEndian) )
+    {
+        pszFormat++;
+    }
+    if( (pszFormat[0] == '\0') || (pszFormat[1] != '\0') )
+    {
+        return false;
+    }
+
+    switch( pszFormat[0] )
+    {
+    case 'b': case 'h': case 'i': case 'l': case 'q': case 'n':
+        switch( pView->itemsize )
+        {
+        case 1: *peType = kealib::kea_8int; return true;
+        case 2: *peType = kealib::kea_16int; return true;
+        case 4: *peType = kealib::kea_32int; return true;
+        case 8: *peType = kealib::kea_64int; return true;
+        }
+        break;
+    case 'B': case 'H': case 'I': case 'L': case 'Q': case 'N':
+        switch( pView->itemsize )
+        {
+        case 1: *peType = kealib::kea_8uint; return true;
+        case 2: *peType = kealib::kea_16uint; return true;
+        case 4: *peType = kealib::kea_32uint; return true;
+        case 8: *peType = kealib::kea_64uint; return true;
+        }
+        break;
+    case 'f': case 'd':
+        switch( pView->itemsize )
+        {
+        case 4: *peType = kealib::kea_32float; return true;
+        case 8: *peType = kealib::kea_64float; return true;
+        }
+        break;
+    }
+    return false;
+}
+
+/* The buffer types that the columns of each field type are read into */
+static bool bufferMatchesField(const Py_buffer *pView, kealib::KEAFieldDataType eFieldType)
+{
+    kealib::KEADataType eType;
+    if( eFieldType == kealib::kea_att_bool )
+    {
+        const char *pszFormat = (pView->format == NULL) ? "B" : pView->format;
+        return (pView->itemsize == sizeof(bool)) && ((strcmp(pszFormat, "?") == 0) || (strcmp(pszFormat, "=?") == 0));
+    }
+    else if( !getKEADataType(pView, &eType) )
+    {
+        return false;
+    }
+    else if( eFieldType == kealib::kea_att_int )
+    {
+        return eType == kealib::kea_64int;
+    }
+    else if( eFieldType == kealib::kea_att_float )
+    {
+        return eType == kealib::kea_64float;
+    }
+    return false;
+}
+
+/* KEAImage type */
+typedef struct
+{
+    PyObject_HEAD
+    kealib::KEAImageIO *pImageIO;
+    int nTables; /* number of AttributeTable objects using the file */
+} KEAImageObject;
+
+/* AttributeTable type */
+typedef struct
+{
+    PyObject_HEAD
+    KEAImageObject *pImage; /* kept alive while the table is */
+    kealib::KEAAttributeTable *pRAT;
+} AttributeTableObject;
+
+/* the rest of the fields are filled in by the init function */
+static PyTypeObject KEAImageType = { PyVarObject_HEAD_INIT(NULL, 0) };
+static PyTypeObject AttributeTableType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+/* returns false and sets an exception if the image has been closed */
+static bool checkImageOpen(KEAImageObject *self)
+{
+    if( self->pImageIO == NULL )
+    {
+        PyErr_SetString(g_pKEAIOError, "The image has been closed");
+        return false;
+    }
+    return true;
+}
+
+static void closeKEAImage(KEAImageObject *self)
+{
+    if( self->pImageIO != NULL )
+    {
+        acquireKEALock();
+        try
+        {
+            self->pImageIO->close();
+        }
+        catch(...)
+        {
+        }
+        delete self->pImageIO;
+        self->pImageIO = NULL;
+        PyThread_release_lock(g_keaLock);
+    }
+}
+
+static void KEAImage_dealloc(KEAImageObject *self)
+{
+    closeKEAImage(self);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static PyObject *KEAImage_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    KEAImageObject *self = (KEAImageObject*)type->tp_alloc(type, 0);
+    if( self != NULL )
+    {
+        self->pImageIO = NULL;
+        self->nTables = 0;
+    }
+    return (PyObject*)self;
+}
+
+static int KEAImage_init(KEAImageObject *self, PyObject *args, PyObject *kwds)
+{
+    const char *pszFileName;
+    int bUpdate = 0;
+    const char *kwlist[] = {"filename", "update", NULL};
+
+    if( !PyArg_ParseTupleAndKeywords(args, kwds, "s|i:KEAImage", (char**)kwlist, &pszFileName, &bUpdate) )
+        return -1;
+    if( self->nTables > 0 )
+    {
+        PyErr_SetString(g_pKEAIOError, "The attribute tables of the image must be deleted before it is reopened");
+        return -1;
+    }
+
+    closeKEAImage(self);
+
+    std::string sFileName(pszFileName);
+    kealib::KEAImageIO *pImageIO = new kealib::KEAImageIO();
+    KEAIO_BEGIN_CALL
+        H5::H5File *pH5File = bUpdate ? kealib::KEAImageIO::openKeaH5RW(sFileName) : kealib::KEAImageIO::openKeaH5RDOnly(sFileName);
+        pImageIO->openKEAImageHeader(pH5File);
+    KEAIO_END_CALL
+    if( bFailed )
+    {
+        delete pImageIO;
+    }
+    KEAIO_RAISE_IF_FAILED(-1)
+
+    self->pImageIO = pImageIO;
+    return 0;
+}
+
+static PyObject *KEAImage_close(KEAImageObject *self, PyObject *args)
+{
+    if( self->nTables > 0 )
+    {
+        PyErr_SetString(g_pKEAIOError, "The attribute tables of the image must be deleted before it is closed");
+        return NULL;
+    }
+    closeKEAImage(self);
+    Py_RETURN_NONE;
+}
+
+static PyObject *KEAImage_getSize(KEAImageObject *self, PyObject *args)
+{
+    if( !checkImageOpen(self) )
+        return NULL;
+
+    uint64_t nXSize = 0, nYSize = 0;
+    KEAIO_BEGIN_CALL
+        kealib::KEAImageSpatialInfo *pSpatialInfo = self->pImageIO->getSpatialInfo();
+        nXSize = pSpatialInfo->xSize;
+        nYSize = pSpatialInfo->ySize;
+    KEAIO_END_CALL
+    KEAIO_RAISE_IF_FAILED(NULL)
+
+    return Py_BuildValue("KK", (unsigned PY_LONG_LONG)nXSize, (unsigned PY_LONG_LONG)nYSize);
+}
+
+static PyObject *KEAImage_getNumBands(KEAImageObject *self, PyObject *args)
+{
+    if( !checkImageOpen(self) )
+        return NULL;
+
+    uint32_t nBands = 0;
+    KEAIO_BEGIN_CALL
+        nBands = self->pImageIO->getNumOfImageBands();
+    KEAIO_END_CALL
+    KEAIO_RAISE_IF_FAILED(NULL)
+
+    return PyLong_FromUnsignedLong(nBands);
+}
+
+static PyObject *KEAImage_getBandDataType(KEAImageObject *self, PyObject *args)
+{
+    unsigned int nBand;
+    if( !PyArg_ParseTuple(args, "I:getBandDataType", &nBand) )
+        return NULL;
+    if( !checkImageOpen(self) )
+        return NULL;
+
+    kealib::KEADataType eType = kealib::kea_undefined;
+    KEAIO_BEGIN_CALL
+        eType = self->pImageIO->getImageBandDataType(nBand);
+    KEAIO_END_CALL
+    KEAIO_RAISE_IF_FAILED(NULL)
+
+    return PyLong_FromLong(eType);
+}
+
+static PyObject *KEAImage_getBlockSize(KEAImageObject *self, PyObject *args)
+{
+    unsigned int nBand;
+    if( !PyArg_ParseTuple(args, "I:getBlockSize", &nBand) )
+        return NULL;
+    if( !checkImageOpen(self) )
+        return NULL;
+
+    uint32_t nBlockSize = 0;
+    KEAIO_BEGIN_CALL
+        nBlockSize = self->pImageIO->getImageBlockSize(nBand);
+    KEAIO_END_CALL
+    KEAIO_RAISE_IF_FAILED(NULL)
+
+    return PyLong_FromUnsignedLong(nBlockSize);
+}
+
+/* gets a 2d C contiguous view of pObj with a KEA data type */
+static bool getBlockBuffer(PyObject *pObj, int nFlags, Py_buffer *pView, kealib::KEADataType *peType)
+{
+    if( PyObject_GetBuffer(pObj, pView, nFlags | PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0 )
+        return false;
+
+    if( pView->ndim != 2 )
+    {
+        PyBuffer_Release(pView);
+        PyErr_SetString(g_pKEAIOError, "The block must be a 2d array");
+        return false;
+    }
+    if( !getKEADataType(pView, peType) )
+    {
+        PyBuffer_Release(pView);
+        PyErr_SetString(g_pKEAIOError, "The block must be an array of integers or floats");
+        return false;
+    }
+    return true;
+}
+
+static PyObject *KEAImage_readBlock(KEAImageObject *self, PyObject *args)
+{
+    unsigned int nBand;
+    unsigned PY_LONG_LONG nXOff, nYOff;
+    PyObject *pOut;
+    if( !PyArg_ParseTuple(args, "IKKO:readBlock", &nBand, &nXOff, &nYOff, &pOut) )
+        return NULL;
+    if( !checkImageOpen(self) )
+        return NULL;
+
+    Py_buffer view;
+    kealib::KEADataType eType;
+    if( !getBlockBuffer(pOut, PyBUF_WRITABLE, &view, &eType) )
+        return NULL;
+
+    uint64_t nYSize = view.shape[0];
+    uint64_t nXSize = view.shape[1];
+    KEAIO_BEGIN_CALL
+        self->pImageIO->readImageBlock2Band(nBand, view.buf, nXOff, nYOff, nXSize, nYSize, nXSize, nYSize, eType);
+    KEAIO_END_CALL
+    PyBuffer_Release(&view);
+    KEAIO_RAISE_IF_FAILED(NULL)
+
+    Py_INCREF(pOut);
+    return pOut;
+}
+
+static PyObject *KEAImage_writeBlock(KEAImageObject *self, PyObject *args)
+{
+    unsigned int nBand;
+    unsigned PY_LONG_LONG nXOff, nYOff;
+    PyObject *pData;
+    if( !PyArg_ParseTuple(args, "IKKO:writeBlock", &nBand, &nXOff, &nYOff, &pData) )
+        return NULL;
+    if( !checkImageOpen(self) )
+        return NULL;
+
+    Py_buffer view;
+    kealib::KEADataType eType;
+    if( !getBlockBuffer(pData, PyBUF_SIMPLE, &view, &eType) )
+        return NULL;
+
+    uint64_t nYSize = view.shape[0];
+    uint64_t nXSize = view.shape[1];
+    KEAIO_BEGIN_CALL
+        self->pImageIO->writeImageBlock2Band(nBand, view.buf, nXOff, nYOff, nXSize, nYSize, nXSize, nYSize, eType);
+    KEAIO_END_CALL
+    PyBuffer_Release(&view);
+    KEAIO_RAISE_IF_FAILED(NULL)
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *KEAImage_getAttributeTable(KEAImageObject *self, PyObject *args)
+{
+    unsigned int nBand;
+    if( !PyArg_ParseTuple(args, "I:getAttributeTable", &nBand) )
+        return NULL;
+    if( !checkImageOpen(self) )
+        return NULL;
+
+    kealib::KEAAttributeTable *pRAT = NULL;
+    KEAIO_BEGIN_CALL
+        pRAT = self->pImageIO->getAttributeTable(kealib::kea_att_file, nBand);
+    KEAIO_END_CALL
+    KEAIO_RAISE_IF_FAILED(NULL)
+
+    AttributeTableObject *pTable = PyObject_New(AttributeTableObject, &AttributeTableType);
+    if( pTable == NULL )
+    {
+        kealib::KEAAttributeTable::destroyAttributeTable(pRAT);
+        return NULL;
+    }
+    Py_INCREF(self);
+    pTable->pImage = self;
+    pTable->pRAT = pRAT;
+    self->nTables++;
+    return (PyObject*)pTable;
+}
+
+static PyMethodDef KEAImage_methods[] = {
+    {"close", (PyCFunction)KEAImage_close, METH_NOARGS,
+"close the image. Any attribute tables from it must have been deleted first\n"},
+    {"getSize", (PyCFunction)KEAImage_getSize, METH_NOARGS,
+"returns a tuple of the (xsize, ysize) of the image in pixels\n"},
+    {"getNumBands", (PyCFunction)KEAImage_getNumBands, METH_NOARGS,
+"returns the number of bands in the image\n"},
+    {"getBandDataType", (PyCFunction)KEAImage_getBandDataType, METH_VARARGS,
+"returns the data type (one of the KEA_ constants) of a band (1-based)\n"},
+    {"getBlockSize", (PyCFunction)KEAImage_getBlockSize, METH_VARARGS,
+"returns the size of the blocks the band (1-based) is stored in\n"},
+    {"readBlock", (PyCFunction)KEAImage_readBlock, METH_VARARGS,
+"read a block of pixels into an existing array, which is returned.\n"
+"call signature: readBlock(band, xoff, yoff, out)\n"
+"where:\n"
+"  band is the band number (1-based)\n"
+"  xoff and yoff are the pixel offsets of the top left of the block\n"
+"  out is a writable C contiguous 2d array (ysize, xsize) of any integer or float type\n"
+"    supporting the buffer protocol (eg a numpy array). The pixels are converted to its type\n"},
+    {"writeBlock", (PyCFunction)KEAImage_writeBlock, METH_VARARGS,
+"write a block of pixels from an array.\n"
+"call signature: writeBlock(band, xoff, yoff, data)\n"
+"where:\n"
+"  band is the band number (1-based)\n"
+"  xoff and yoff are the pixel offsets of the top left of the block\n"
+"  data is a C contiguous 2d array (ysize, xsize) of any integer or float type\n"},
+    {"getAttributeTable", (PyCFunction)KEAImage_getAttributeTable, METH_VARARGS,
+"returns the AttributeTable of a band (1-based), read from and written to the file as it is used\n"},
+    {NULL}  /* Sentinel */
+};
+
+static void AttributeTable_dealloc(AttributeTableObject *self)
+{
+    if( self->pRAT != NULL )
+    {
+        acquireKEALock();
+        kealib::KEAAttributeTable::destroyAttributeTable(self->pRAT);
+        PyThread_release_lock(g_keaLock);
+    }
+    if( self->pImage != NULL )
+    {
+        self->pImage->nTables--;
+        Py_DECREF(self->pImage);
+    }
+    PyObject_Del(self);
+}
+
+static PyObject *AttributeTable_getSize(AttributeTableObject *self, PyObject *args)
+{
+    size_t nRows = 0;
+    KEAIO_BEGIN_CALL
+        nRows = self->pRAT->getSize();
+    KEAIO_END_CALL
+    KEAIO_RAISE_IF_FAILED(NULL)
+
+    return PyLong_FromSize_t(nRows);
+}
+
+static PyObject *AttributeTable_addRows(AttributeTableObject *self, PyObject *args)
+{
+    Py_ssize_t nRows;
+    if( !PyArg_ParseTuple(args, "n:addRows", &nRows) )
+        return NULL;
+
+    KEAIO_BEGIN_CALL
+        self->pRAT->addRows(nRows);
+    KEAIO_END_CALL
+    KEAIO_RAISE_IF_FAILED(NULL)
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *AttributeTable_getFieldNames(AttributeTableObject *self, PyObject *args)
+{
+    std::vector<std::string> names;
+    KEAIO_BEGIN_CALL
+        names = self->pRAT->getFieldNames();
+    KEAIO_END_CALL
+    KEAIO_RAISE_IF_FAILED(NULL)
+
+    PyObject *pList = PyList_New(names.size());
+    if( pList == NULL )
+        return NULL;
+    for( size_t n = 0; n < names.size(); n++ )
+    {
+        PyObject *pName = KEAIO_STRING_FROM_STRING(names[n].c_str());
+        if( pName == NULL )
+        {
+            Py_DECREF(pList);
+            return NULL;
+        }
+        PyList_SET_ITEM(pList, n, pName);
+    }
+    return pList;
+}
+
+static PyObject *AttributeTable_getFieldType(AttributeTableObject *self, PyObject *args)
+{
+    const char *pszName;
+    if( !PyArg_ParseTuple(args, "s:getFieldType", &pszName) )
+        return NULL;
+
+    std::string sName(pszName);
+    kealib::KEAATTField field;
+    KEAIO_BEGIN_CALL
+        field = self->pRAT->getField(sName);
+    KEAIO_END_CALL
+    KEAIO_RAISE_IF_FAILED(NULL)
+
+    return PyLong_FromLong(field.dataType);
+}
+
+static PyObject *AttributeTable_addField(AttributeTableObject *self, PyObject *args)
+{
+    const char *pszName;
+    int nType;
+    if( !PyArg_ParseTuple(args, "si:addField", &pszName, &nType) )
+        return NULL;
+
+    if( (nType != kealib::kea_att_bool) && (nType != kealib::kea_att_int) &&
+            (nType != kealib::kea_att_float) && (nType != kealib::kea_att_string) )
+    {
+        PyErr_SetString(g_pKEAIOError, "Unknown field type");
+        return NULL;
+    }
+
+    std::string sName(pszName);
+    KEAIO_BEGIN_CALL
+        switch( nType )
+        {
+        case kealib::kea_att_bool: self->pRAT->addAttBoolField(sName, false); break;
+        case kealib::kea_att_int: self->pRAT->addAttIntField(sName, 0); break;
+        case kealib::kea_att_float: self->pRAT->addAttFloatField(sName, 0); break;
+        case kealib::kea_att_string: self->pRAT->addAttStringField(sName, ""); break;
+        }
+    KEAIO_END_CALL
+    KEAIO_RAISE_IF_FAILED(NULL)
+
+    Py_RETURN_NONE;
+}
+
+/* finds the field and gets a 1d C contiguous view of pObj matching its type */
+static bool getColumnBuffer(AttributeTableObject *self, const char *pszName, PyObject *pObj, int nFlags, Py_buffer *pView, kealib::KEAATTField *pField)
+{
+    std::string sName(pszName);
+    KEAIO_BEGIN_CALL
+        *pField = self->pRAT->getField(sName);
+    KEAIO_END_CALL
+    KEAIO_RAISE_IF_FAILED(false)
+
+    if( pField->dataType == kealib::kea_att_string )
+    {
+        PyErr_SetString(g_pKEAIOError, "String columns are read and written with readStringColumn and writeStringColumn");
+        return false;
+    }
+
+    if( PyObject_GetBuffer(pObj, pView, nFlags | PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0 )
+        return false;
+
+    if( (pView->ndim != 1) || !bufferMatchesField(pView, pField->dataType) )
+    {
+        PyBuffer_Release(pView);
+        PyErr_SetString(g_pKEAIOError, "The column must be a 1d array of bool, int64 or float64 matching the field type");
+        return false;
+    }
+    return true;
+}
+
+static PyObject *AttributeTable_readColumn(AttributeTableObject *self, PyObject *args)
+{
+    const char *pszName;
+    Py_ssize_t startfid;
+    PyObject *pOut;
+    if( !PyArg_ParseTuple(args, "snO:readColumn", &pszName, &startfid, &pOut) )
+        return NULL;
+
+    Py_buffer view;
+    kealib::KEAATTField field;
+    if( !getColumnBuffer(self, pszName, pOut, PyBUF_WRITABLE, &view, &field) )
+        return NULL;
+
+    size_t nLength = view.shape[0];
+    KEAIO_BEGIN_CALL
+        switch( field.dataType )
+        {
+        case kealib::kea_att_bool: self->pRAT->getBoolFields(startfid, nLength, field.idx, (bool*)view.buf); break;
+        case kealib::kea_att_int: self->pRAT->getIntFields(startfid, nLength, field.idx, (int64_t*)view.buf); break;
+        case kealib::kea_att_float: self->pRAT->getFloatFields(startfid, nLength, field.idx, (double*)view.buf); break;
+        default: break;
+        }
+    KEAIO_END_CALL
+    PyBuffer_Release(&view);
+    KEAIO_RAISE_IF_FAILED(NULL)
+
+    Py_INCREF(pOut);
+    return pOut;
+}
+
+static PyObject *AttributeTable_writeColumn(AttributeTableObject *self, PyObject *args)
+{
+    const char *pszName;
+    Py_ssize_t startfid;
+    PyObject *pData;
+    if( !PyArg_ParseTuple(args, "snO:writeColumn", &pszName, &startfid, &pData) )
+        return NULL;
+
+    Py_buffer view;
+    kealib::KEAATTField field;
+    if( !getColumnBuffer(self, pszName, pData, PyBUF_SIMPLE, &view, &field) )
+        return NULL;
+
+    size_t nLength = view.shape[0];
+    KEAIO_BEGIN_CALL
+        switch( field.dataType )
+        {
+        case kealib::kea_att_bool: self->pRAT->setBoolFields(startfid, nLength, field.idx, (bool*)view.buf); break;
+        case kealib::kea_att_int: self->pRAT->setIntFields(startfid, nLength, field.idx, (int64_t*)view.buf); break;
+        case kealib::kea_att_float: self->pRAT->setFloatFields(startfid, nLength, field.idx, (double*)view.buf); break;
+        default: break;
+        }
+    KEAIO_END_CALL
+    PyBuffer_Release(&view);
+    KEAIO_RAISE_IF_FAILED(NULL)
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *AttributeTable_readStringColumn(AttributeTableObject *self, PyObject *args)
+{
+    const char *pszName;
+    Py_ssize_t startfid, length;
+    if( !PyArg_ParseTuple(args, "snn:readStringColumn", &pszName, &startfid, &length) )
+        return NULL;
+
+    std::string sName(pszName);
+    std::vector<std::string> values;
+    KEAIO_BEGIN_CALL
+        kealib::KEAATTField field = self->pRAT->getField(sName);
+        if( field.dataType != kealib::kea_att_string )
+        {
+            throw kealib::KEAATTException("The field is not a string field");
+        }
+        self->pRAT->getStringFields(startfid, length, field.idx, &values);
+    KEAIO_END_CALL
+    KEAIO_RAISE_IF_FAILED(NULL)
+
+    PyObject *pList = PyList_New(values.size());
+    if( pList == NULL )
+        return NULL;
+    for( size_t n = 0; n < values.size(); n++ )
+    {
+        PyObject *pValue = KEAIO_STRING_FROM_STRING(values[n].c_str());
+        if( pValue == NULL )
+        {
+            Py_DECREF(pList);
+            return NULL;
+        }
+        PyList_SET_ITEM(pList, n, pValue);
+    }
+    return pList;
+}
+
+static PyObject *AttributeTable_writeStringColumn(AttributeTableObject *self, PyObject *args)
+{
+    const char *pszName;
+    Py_ssize_t startfid;
+    PyObject *pSequence;
+    if( !PyArg_ParseTuple(args, "snO:writeStringColumn", &pszName, &startfid, &pSequence) )
+        return NULL;
+
+    PyObject *pFast = PySequence_Fast(pSequence, "3rd argument must be a sequence of strings");
+    if( pFast == NULL )
+        return NULL;
+
+    /* the strings are copied while we still hold the GIL */
+    Py_ssize_t nLength = PySequence_Fast_GET_SIZE(pFast);
+    std::vector<std::string> values(nLength);
+    for( Py_ssize_t n = 0; n < nLength; n++ )
+    {
+        PyObject *pItem = PySequence_Fast_GET_ITEM(pFast, n);
+        const char *pszValue = KEAIO_STRING_CHECK(pItem) ? KEAIO_STRING_AS_STRING(pItem) : NULL;
+        if( pszValue == NULL )
+        {
+            Py_DECREF(pFast);
+            if( !PyErr_Occurred() )
+                PyErr_SetString(g_pKEAIOError, "All elements in the sequence must be strings");
+            return NULL;
+        }
+        values[n] = pszValue;
+    }
+    Py_DECREF(pFast);
+
+    std::string sName(pszName);
+    KEAIO_BEGIN_CALL
+        kealib::KEAATTField field = self->pRAT->getField(sName);
+        if( field.dataType != kealib::kea_att_string )
+        {
+            throw kealib::KEAATTException("The field is not a string field");
+        }
+        self->pRAT->setStringFields(startfid, values.size(), field.idx, &values);
+    KEAIO_END_CALL
+    KEAIO_RAISE_IF_FAILED(NULL)
+
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef AttributeTable_methods[] = {
+    {"getSize", (PyCFunction)AttributeTable_getSize, METH_NOARGS,
+"returns the number of rows in the table\n"},
+    {"addRows", (PyCFunction)AttributeTable_addRows, METH_VARARGS,
+"add the given number of rows to the end of the table\n"},
+    {"getFieldNames", (PyCFunction)AttributeTable_getFieldNames, METH_NOARGS,
+"returns a list of the names of the fields in the table\n"},
+    {"getFieldType", (PyCFunction)AttributeTable_getFieldType, METH_VARARGS,
+"returns the type (one of the FIELD_ constants) of the named field\n"},
+    {"addField", (PyCFunction)AttributeTable_addField, METH_VARARGS,
+"add a field to the table.\n"
+"call signature: addField(name, type)\n"
+"where type is one of the FIELD_ constants\n"},
+    {"readColumn", (PyCFunction)AttributeTable_readColumn, METH_VARARGS,
+"read the values of a field into an existing array, which is returned.\n"
+"call signature: readColumn(name, startfid, out)\n"
+"where:\n"
+"  name is the name of the field\n"
+"  startfid is the row to start with\n"
+"  out is a writable C contiguous 1d array which gets a value for each of its elements.\n"
+"    It must be bool, int64 or float64 for FIELD_BOOL, FIELD_INT and FIELD_FLOAT fields\n"},
+    {"writeColumn", (PyCFunction)AttributeTable_writeColumn, METH_VARARGS,
+"write the values of a field from an array.\n"
+"call signature: writeColumn(name, startfid, data)\n"
+"where data is a C contiguous 1d array of the type needed by readColumn\n"},
+    {"readStringColumn", (PyCFunction)AttributeTable_readStringColumn, METH_VARARGS,
+"read the values of a FIELD_STRING field as a list.\n"
+"call signature: readStringColumn(name, startfid, len)\n"},
+    {"writeStringColumn", (PyCFunction)AttributeTable_writeStringColumn, METH_VARARGS,
+"write the values of a FIELD_STRING field from a sequence of strings.\n"
+"call signature: writeStringColumn(name, startfid, seq)\n"},
+    {NULL}  /* Sentinel */
+};
+
+static PyObject *keaio_create(PyObject *self, PyObject *args)
+{
+    const char *pszFileName;
+    int nDataType;
+    unsigned int nXSize, nYSize, nBands = 1;
+    if( !PyArg_ParseTuple(args, "siII|I:create", &pszFileName, &nDataType, &nXSize, &nYSize, &nBands) )
+        return NULL;
+
+    std::string sFileName(pszFileName);
+    kealib::KEAImageIO *pImageIO = new kealib::KEAImageIO();
+    KEAIO_BEGIN_CALL
+        H5::H5File *pH5File = kealib::KEAImageIO::createKEAImage(sFileName, (kealib::KEADataType)nDataType, nXSize, nYSize, nBands);
+        pImageIO->openKEAImageHeader(pH5File);
+    KEAIO_END_CALL
+    if( bFailed )
+    {
+        delete pImageIO;
+    }
+    KEAIO_RAISE_IF_FAILED(NULL)
+
+    KEAImageObject *pImage = (KEAImageObject*)KEAImage_new(&KEAImageType, NULL, NULL);
+    if( pImage == NULL )
+    {
+        try
+        {
+            pImageIO->close();
+        }
+        catch(...)
+        {
+        }
+        delete pImageIO;
+        return NULL;
+    }
+    pImage->pImageIO = pImageIO;
+    return (PyObject*)pImage;
+}
+
+/* Our list of functions in this module*/
+static PyMethodDef KEAIOMethods[] = {
+    {"create", keaio_create, METH_VARARGS,
+"create a new KEA image, returning it as a KEAImage open for update.\n"
+"call signature: create(filename, datatype, xsize, ysize, nbands=1)\n"
+"where datatype is one of the KEA_ constants\n"},
+    {NULL}        /* Sentinel */
+};
+
+#if PY_MAJOR_VERSION >= 3
+
+static int keaio_traverse(PyObject *m, visitproc visit, void *arg)
+{
+    Py_VISIT(GETSTATE(m)->error);
+    return 0;
+}
+
+static int keaio_clear(PyObject *m)
+{
+    Py_CLEAR(GETSTATE(m)->error);
+    return 0;
+}
+
+static struct PyModuleDef moduledef = {
+        PyModuleDef_HEAD_INIT,
+        "keaio",
+        NULL,
+        sizeof(struct KEAIOState),
+        KEAIOMethods,
+        NULL,
+        keaio_traverse,
+        keaio_clear,
+        NULL
+};
+
+#define INITERROR return NULL
+
+PyMODINIT_FUNC
+PyInit_keaio(void)
+
+#else
+#define INITERROR return
+
+PyMODINIT_FUNC
+initkeaio(void)
+#endif
+{
+    PyObject *pModule;
+    struct KEAIOState *state;
+
+    KEAImageType.tp_name = "keaio.KEAImage";
+    KEAImageType.tp_basicsize = sizeof(KEAImageObject);
+    KEAImageType.tp_dealloc = (destructor)KEAImage_dealloc;
+    KEAImageType.tp_flags = Py_TPFLAGS_DEFAULT;
+    KEAImageType.tp_doc = "A KEA image opened with KEAImage(filename, update=False)";
+    KEAImageType.tp_methods = KEAImage_methods;
+    KEAImageType.tp_init = (initproc)KEAImage_init;
+    KEAImageType.tp_new = KEAImage_new;
+    if( PyType_Ready(&KEAImageType) < 0 )
+        INITERROR;
+
+    AttributeTableType.tp_name = "keaio.AttributeTable";
+    AttributeTableType.tp_basicsize = sizeof(AttributeTableObject);
+    AttributeTableType.tp_dealloc = (destructor)AttributeTable_dealloc;
+    AttributeTableType.tp_flags = Py_TPFLAGS_DEFAULT;
+    AttributeTableType.tp_doc = "The attribute table of a band, from KEAImage.getAttributeTable()";
+    AttributeTableType.tp_methods = AttributeTable_methods;
+    if( PyType_Ready(&AttributeTableType) < 0 )
+        INITERROR;
+
+    if( g_keaLock == NULL )
+    {
+        g_keaLock = PyThread_allocate_lock();
+        if( g_keaLock == NULL )
+            INITERROR;
+    }
+
+#if PY_MAJOR_VERSION >= 3
+    pModule = PyModule_Create(&moduledef);
+#else
+    pModule = Py_InitModule("keaio", KEAIOMethods);
+#endif
+    if( pModule == NULL )
+        INITERROR;
+
+    state = GETSTATE(pModule);
+
+    /* Create and add our exception type */
+    state->error = PyErr_NewException("keaio.error", NULL, NULL);
+    if( state->error == NULL )
+    {
+        Py_DECREF(pModule);
+        INITERROR;
+    }
+    Py_INCREF(state->error);
+    g_pKEAIOError = state->error;
+    PyModule_AddObject(pModule, "error", state->error);
+
+    Py_INCREF(&KEAImageType);
+    PyModule_AddObject(pModule, "KEAImage", (PyObject*)&KEAImageType);
+
+    PyModule_AddIntConstant(pModule, "KEA_8INT", kealib::kea_8int);
+    PyModule_AddIntConstant(pModule, "KEA_16INT", kealib::kea_16int);
+    PyModule_AddIntConstant(pModule, "KEA_32INT", kealib::kea_32int);
+    PyModule_AddIntConstant(pModule, "KEA_64INT", kealib::kea_64int);
+    PyModule_AddIntConstant(pModule, "KEA_8UINT", kealib::kea_8uint);
+    PyModule_AddIntConstant(pModule, "KEA_16UINT", kealib::kea_16uint);
+    PyModule_AddIntConstant(pModule, "KEA_32UINT", kealib::kea_32uint);
+    PyModule_AddIntConstant(pModule, "KEA_64UINT", kealib::kea_64uint);
+    PyModule_AddIntConstant(pModule, "KEA_32FLOAT", kealib::kea_32float);
+    PyModule_AddIntConstant(pModule, "KEA_64FLOAT", kealib::kea_64float);
+
+    PyModule_AddIntConstant(pModule, "FIELD_BOOL", kealib::kea_att_bool);
+    PyModule_AddIntConstant(pModule, "FIELD_INT", kealib::kea_att_int);
+    PyModule_AddIntConstant(pModule, "FIELD_FLOAT", kealib::kea_att_float);
+    PyModule_AddIntConstant(pModule, "FIELD_STRING", kealib::kea_att_string);
+
+#if PY_MAJOR_VERSION >= 3
+    return pModule;
+#endif
+}
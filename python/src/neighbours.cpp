@@ -29,6 +29,7 @@
  */
 
 #include <vector>
+#include <string>
 #include <Python.h>
 #include "numpy/arrayobject.h"
 #include "gdal_priv.h"
@@ -102,6 +103,7 @@ static struct NeighboursState _state;
 
 #define NEIGHBOURS_LIST 0
 #define NEIGHBOURS_ARRAY 1
+#define NEIGHBOURS_CSR 2
 
 void freeNeighbourLists(std::vector<std::vector<size_t>* > *pNeighbours)
 {
@@ -114,6 +116,45 @@ void freeNeighbourLists(std::vector<std::vector<size_t>* > *pNeighbours)
 
 }
 
+/* called when the last numpy array using a vector from neighbourVectorAsArray goes */
+static void freeNeighbourVector(PyObject *pCapsule)
+{
+    delete (std::vector<size_t>*)PyCapsule_GetPointer(pCapsule, NULL);
+}
+
+/* returns a 1d numpy array which uses the memory of pVec rather than a copy.
+ The array takes ownership of pVec, which is deleted if this fails */
+static PyObject *neighbourVectorAsArray(std::vector<size_t> *pVec)
+{
+    npy_intp dims[] = {(npy_intp)pVec->size()};
+    if( pVec->empty() )
+    {
+        delete pVec;
+        return PyArray_EMPTY(1, dims, NPY_UINTP, 0);
+    }
+
+    PyObject *pCapsule = PyCapsule_New(pVec, NULL, freeNeighbourVector);
+    if( pCapsule == NULL )
+    {
+        delete pVec;
+        return NULL;
+    }
+
+    PyObject *pArray = PyArray_SimpleNewFromData(1, dims, NPY_UINTP, &(*pVec)[0]);
+    if( pArray == NULL )
+    {
+        Py_DECREF(pCapsule);
+        return NULL;
+    }
+    /* steals the reference to pCapsule even on failure */
+    if( PyArray_SetBaseObject((PyArrayObject*)pArray, pCapsule) != 0 )
+    {
+        Py_DECREF(pArray);
+        return NULL;
+    }
+    return pArray;
+}
+
 static PyObject *neighbours_setNeighbours(PyObject *self, PyObject *args)
 {
     PyObject *pPythonDataset; /* gdal.Dataset */
@@ -335,6 +376,51 @@ static PyObject *neighbours_getNeighbours(PyObject *self, PyObject *args)
             return NULL;
         }
 
+        if( nRetType == NEIGHBOURS_CSR )
+        {
+            /* The offsets and indices are read straight into the vectors
+             which then become the memory of the numpy arrays */
+            std::vector<size_t> *pOffsets = new std::vector<size_t>;
+            std::vector<size_t> *pIndices = new std::vector<size_t>;
+            std::string sError;
+            Py_BEGIN_ALLOW_THREADS
+            try
+            {
+                pRAT->getNeighboursCSR(startfid, length, pOffsets, pIndices);
+            }
+            catch(kealib::KEAException &e)
+            {
+                sError = e.what();
+            }
+            Py_END_ALLOW_THREADS
+            kealib::KEAAttributeTable::destroyAttributeTable(pRAT);
+            if( !sError.empty() )
+            {
+                delete pOffsets;
+                delete pIndices;
+                PyErr_Format(GETSTATE(self)->error, "Error from libkea: %s", sError.c_str());
+                return NULL;
+            }
+
+            PyObject *pOffsetsArray = neighbourVectorAsArray(pOffsets);
+            if( pOffsetsArray == NULL )
+            {
+                delete pIndices;
+                return NULL;
+            }
+            PyObject *pIndicesArray = neighbourVectorAsArray(pIndices);
+            if( pIndicesArray == NULL )
+            {
+                Py_DECREF(pOffsetsArray);
+                return NULL;
+            }
+
+            pRetVal = PyTuple_New(2);
+            PyTuple_SET_ITEM(pRetVal, 0, pOffsetsArray);
+            PyTuple_SET_ITEM(pRetVal, 1, pIndicesArray);
+            return pRetVal;
+        }
+
         /* Read the neighbours */
         std::vector<std::vector<size_t>* > neighbours;
         pRAT->getNeighbours(startfid, length, &neighbours);
@@ -410,6 +496,105 @@ static PyObject *neighbours_getNeighbours(PyObject *self, PyObject *args)
     return pRetVal;
 }
 
+static PyObject *neighbours_setNeighboursCSR(PyObject *self, PyObject *args)
+{
+    PyObject *pPythonDataset; /* gdal.Dataset */
+    int nBand;
+    Py_ssize_t startfid;
+    PyObject *pOffsetsObj, *pIndicesObj;
+
+    if( !PyArg_ParseTuple(args, "OinOO:setNeighboursCSR", &pPythonDataset, &nBand, &startfid, &pOffsetsObj, &pIndicesObj))
+        return NULL;
+
+    void *pPtr = getUnderlyingPtrFromSWIGPyObject(pPythonDataset, GETSTATE(self)->error);
+    if( pPtr == NULL )
+        return NULL;
+
+    GDALDataset *pDataset = (GDALDataset*)pPtr;
+
+    GDALDriver *pDriver = pDataset->GetDriver();
+    const char *pszName = pDriver->GetDescription();
+    if( (strlen(pszName) != 3) || (pszName[0] != 'K') || (pszName[1] != 'E') || (pszName[2] != 'A'))
+    {
+        PyErr_SetString(GETSTATE(self)->error, "This function only works on KEA files");
+        return NULL;
+    }
+
+    kealib::KEAImageIO *pImageIO = (kealib::KEAImageIO*)pDataset->GetInternalHandle(NULL);
+    if( pImageIO == NULL )
+    {
+        PyErr_SetString(GETSTATE(self)->error, "GetInternalHandle returned NULL");
+        return NULL;
+    }
+
+    /* Only copied if they are not already contiguous arrays of the size_t type */
+    PyArrayObject *pOffsetsArr = (PyArrayObject*)PyArray_FROMANY(pOffsetsObj, NPY_UINTP, 1, 1, NPY_ARRAY_IN_ARRAY);
+    if( pOffsetsArr == NULL )
+        return NULL;
+    PyArrayObject *pIndicesArr = (PyArrayObject*)PyArray_FROMANY(pIndicesObj, NPY_UINTP, 1, 1, NPY_ARRAY_IN_ARRAY);
+    if( pIndicesArr == NULL )
+    {
+        Py_DECREF(pOffsetsArr);
+        return NULL;
+    }
+
+    npy_intp nOffsets = PyArray_DIM(pOffsetsArr, 0);
+    npy_intp nIndices = PyArray_DIM(pIndicesArr, 0);
+    const size_t *pOffsets = (const size_t*)PyArray_DATA(pOffsetsArr);
+    const size_t *pIndices = (const size_t*)PyArray_DATA(pIndicesArr);
+    bool bValid = (nOffsets > 0) && (pOffsets[nOffsets-1] <= (size_t)nIndices);
+    for( npy_intp n = 1; bValid && (n < nOffsets); n++ )
+    {
+        bValid = pOffsets[n-1] <= pOffsets[n];
+    }
+    if( !bValid )
+    {
+        Py_DECREF(pOffsetsArr);
+        Py_DECREF(pIndicesArr);
+        PyErr_SetString(GETSTATE(self)->error, "offsets must be increasing, have at least one value and not go past the end of indices");
+        return NULL;
+    }
+
+    std::string sError;
+    Py_BEGIN_ALLOW_THREADS
+    try
+    {
+        kealib::KEAAttributeTable *pRAT = pImageIO->getAttributeTable(kealib::kea_att_file, nBand);
+        if( pRAT == NULL )
+        {
+            sError = "No Attribute table in this file";
+        }
+        else
+        {
+            try
+            {
+                pRAT->setNeighboursCSR(startfid, nOffsets - 1, pOffsets, pIndices);
+            }
+            catch(...)
+            {
+                kealib::KEAAttributeTable::destroyAttributeTable(pRAT);
+                throw;
+            }
+            kealib::KEAAttributeTable::destroyAttributeTable(pRAT);
+        }
+    }
+    catch(kealib::KEAException &e)
+    {
+        sError = e.what();
+    }
+    Py_END_ALLOW_THREADS
+
+    Py_DECREF(pOffsetsArr);
+    Py_DECREF(pIndicesArr);
+    if( !sError.empty() )
+    {
+        PyErr_Format(GETSTATE(self)->error, "Error from libkea: %s", sError.c_str());
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
 /* Our list of functions in this module*/
 static PyMethodDef NeighboursMethods[] = {
     {"setNeighbours", neighbours_setNeighbours, METH_VARARGS, 
@@ -421,6 +606,16 @@ static PyMethodDef NeighboursMethods[] = {
 "  startfid is the feature to start with\n"
 "  seq is a sequence with an element for each feature to be set.\n"
 "    each element must be a sequence. Can also be a 2d masked numpy array.\n"},
+    {"setNeighboursCSR", neighbours_setNeighboursCSR, METH_VARARGS,
+"set the neighbours for given feature id(s) from CSR arrays.\n"
+"call signature: setNeighboursCSR(ds, band, startfid, offsets, indices)\n"
+"where:\n"
+"  ds is an instance of gdal.Dataset\n"
+"  band is the band number (1-based)\n"
+"  startfid is the feature to start with\n"
+"  offsets is a 1d array with one more value than the features to be set\n"
+"  indices is a 1d array, the neighbours of feature startfid+i being\n"
+"    indices[offsets[i]:offsets[i+1]]\n"},
     {"getNeighbours", neighbours_getNeighbours, METH_VARARGS,
 "get the neighbours for given feature id(s).\n"
 "call signature: getNeighbours(ds, band, startfid, len, type=NEIGHBOURS_LIST)\n"
@@ -430,7 +625,9 @@ static PyMethodDef NeighboursMethods[] = {
 "  startfid is the feature to start with\n"
 "  len is the number of features to read\n"
 "  type is an optional parameter. If NEIGHBOURS_LIST, a list of lists is returned.\n"
-"    If NEIGHBOURS_ARRAY a tuple with a 2d numpy array of values and 2d boolean numpy array specifying where these are valid\n"},
+"    If NEIGHBOURS_ARRAY a tuple with a 2d numpy array of values and 2d boolean numpy array specifying where these are valid\n"
+"    If NEIGHBOURS_CSR a tuple of 1d numpy arrays (offsets, indices), the neighbours of feature startfid+i being\n"
+"    indices[offsets[i]:offsets[i+1]]. The arrays are not copied from what was read from the file\n"},
     {NULL}        /* Sentinel */
 };
 
@@ -497,6 +694,7 @@ initneighbours(void)
     PyModule_AddObject(pModule, "error", state->error);
     PyModule_AddIntMacro(pModule, NEIGHBOURS_LIST);
     PyModule_AddIntMacro(pModule, NEIGHBOURS_ARRAY);
+    PyModule_AddIntMacro(pModule, NEIGHBOURS_CSR);
 
 #if PY_MAJOR_VERSION >= 3
     return pModule;
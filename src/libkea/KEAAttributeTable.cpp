@@ -29,6 +29,14 @@
  */
 
 #include "libkea/KEAAttributeTable.h"
+#include "libkea/KEAAttributeTableInMem.h"
+#include "libkea/KEAWorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <string.h>
 
 namespace kealib{
     
@@ -125,7 +133,7 @@ namespace kealib{
         }
     }
     
-    void KEAAttributeTable::setBoolValue(size_t colIdx, bool value)
+    void KEAAttributeTable::setBoolValue(size_t colIdx, bool /*value*/)
     {
         if(colIdx > numBoolFields)
         {
@@ -136,7 +144,7 @@ namespace kealib{
         throw KEAATTException("Setting all has not be implemented yet as needs an iterator...");
     }
     
-    void KEAAttributeTable::setIntValue(size_t colIdx, int64_t value)
+    void KEAAttributeTable::setIntValue(size_t colIdx, int64_t /*value*/)
     {
         if(colIdx > numIntFields)
         {
@@ -147,7 +155,7 @@ namespace kealib{
         throw KEAATTException("Setting all has not be implemented yet as needs an iterator...");
     }
     
-    void KEAAttributeTable::setFloatValue(size_t colIdx, double value)
+    void KEAAttributeTable::setFloatValue(size_t colIdx, double /*value*/)
     {
         if(colIdx > numFloatFields)
         {
@@ -158,7 +166,7 @@ namespace kealib{
         throw KEAATTException("Setting all has not be implemented yet as needs an iterator...");
     }
     
-    void KEAAttributeTable::setStringValue(size_t colIdx, const std::string &value)
+    void KEAAttributeTable::setStringValue(size_t colIdx, const std::string &/*value*/)
     {
         if(colIdx > numStringFields)
         {
@@ -169,6 +177,2472 @@ namespace kealib{
         throw KEAATTException("Setting all has not be implemented yet as needs an iterator...");
     }
     
+    void KEAAttributeTable::getBoolColumns(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, bool **pbBuffers) const
+    {
+        for(size_t i = 0; i < colIdxs.size(); ++i)
+        {
+            this->getBoolFields(startfid, len, colIdxs[i], pbBuffers[i]);
+        }
+    }
+    
+    void KEAAttributeTable::getIntColumns(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, int64_t **pnBuffers) const
+    {
+        for(size_t i = 0; i < colIdxs.size(); ++i)
+        {
+            this->getIntFields(startfid, len, colIdxs[i], pnBuffers[i]);
+        }
+    }
+    
+    void KEAAttributeTable::getFloatColumns(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, double **pfBuffers) const
+    {
+        for(size_t i = 0; i < colIdxs.size(); ++i)
+        {
+            this->getFloatFields(startfid, len, colIdxs[i], pfBuffers[i]);
+        }
+    }
+    
+    void KEAAttributeTable::getStringColumns(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, std::vector<std::string> **psBuffers) const
+    {
+        for(size_t i = 0; i < colIdxs.size(); ++i)
+        {
+            this->getStringFields(startfid, len, colIdxs[i], psBuffers[i]);
+        }
+    }
+    
+    void KEAAttributeTable::getBoolBlock(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, bool *pbBuffer) const
+    {
+        size_t numCols = colIdxs.size();
+        bool *colVals = new bool[len];
+        try
+        {
+            for(size_t i = 0; i < numCols; ++i)
+            {
+                this->getBoolFields(startfid, len, colIdxs[i], colVals);
+                for(size_t n = 0; n < len; ++n)
+                {
+                    pbBuffer[(n * numCols) + i] = colVals[n];
+                }
+            }
+        }
+        catch(KEAATTException &e)
+        {
+            delete[] colVals;
+            throw e;
+        }
+        delete[] colVals;
+    }
+    
+    void KEAAttributeTable::getIntBlock(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, int64_t *pnBuffer) const
+    {
+        size_t numCols = colIdxs.size();
+        int64_t *colVals = new int64_t[len];
+        try
+        {
+            for(size_t i = 0; i < numCols; ++i)
+            {
+                this->getIntFields(startfid, len, colIdxs[i], colVals);
+                for(size_t n = 0; n < len; ++n)
+                {
+                    pnBuffer[(n * numCols) + i] = colVals[n];
+                }
+            }
+        }
+        catch(KEAATTException &e)
+        {
+            delete[] colVals;
+            throw e;
+        }
+        delete[] colVals;
+    }
+    
+    void KEAAttributeTable::getFloatBlock(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, double *pfBuffer) const
+    {
+        size_t numCols = colIdxs.size();
+        double *colVals = new double[len];
+        try
+        {
+            for(size_t i = 0; i < numCols; ++i)
+            {
+                this->getFloatFields(startfid, len, colIdxs[i], colVals);
+                for(size_t n = 0; n < len; ++n)
+                {
+                    pfBuffer[(n * numCols) + i] = colVals[n];
+                }
+            }
+        }
+        catch(KEAATTException &e)
+        {
+            delete[] colVals;
+            throw e;
+        }
+        delete[] colVals;
+    }
+    
+    void KEAAttributeTable::getStringBlock(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, std::vector<std::string> *psBuffer) const
+    {
+        size_t numCols = colIdxs.size();
+        psBuffer->clear();
+        psBuffer->resize(len * numCols);
+        std::vector<std::string> colVals;
+        for(size_t i = 0; i < numCols; ++i)
+        {
+            this->getStringFields(startfid, len, colIdxs[i], &colVals);
+            for(size_t n = 0; n < len; ++n)
+            {
+                psBuffer->at((n * numCols) + i).swap(colVals[n]);
+            }
+        }
+    }
+    
+    static void keaArrowReleaseArray(ArrowArray *array)
+    {
+        for(int64_t i = 0; i < array->n_children; ++i)
+        {
+            if(array->children[i]->release != NULL)
+            {
+                array->children[i]->release(array->children[i]);
+            }
+            delete array->children[i];
+        }
+        delete[] array->children;
+        delete[] array->buffers;
+        
+        std::vector<uint8_t*> *buffers = (std::vector<uint8_t*>*) array->private_data;
+        for(std::vector<uint8_t*>::iterator iterBuf = buffers->begin(); iterBuf != buffers->end(); ++iterBuf)
+        {
+            delete[] *iterBuf;
+        }
+        delete buffers;
+        array->release = NULL;
+    }
+    
+    static void keaArrowReleaseSchema(ArrowSchema *schema)
+    {
+        for(int64_t i = 0; i < schema->n_children; ++i)
+        {
+            if(schema->children[i]->release != NULL)
+            {
+                schema->children[i]->release(schema->children[i]);
+            }
+            delete schema->children[i];
+        }
+        delete[] schema->children;
+        delete (std::string*) schema->private_data;
+        schema->release = NULL;
+    }
+    
+    static void keaArrowInitArray(ArrowArray *array, size_t length, int64_t nBuffers, int64_t nChildren)
+    {
+        array->length = length;
+        array->null_count = 0;
+        array->offset = 0;
+        array->n_buffers = nBuffers;
+        array->n_children = nChildren;
+        array->buffers = new const void*[nBuffers];
+        for(int64_t i = 0; i < nBuffers; ++i)
+        {
+            array->buffers[i] = NULL;
+        }
+        array->children = NULL;
+        if(nChildren > 0)
+        {
+            array->children = new ArrowArray*[nChildren];
+            for(int64_t i = 0; i < nChildren; ++i)
+            {
+                // ZERO INITIALISED SO A PARTIALLY BUILT ARRAY CAN BE RELEASED
+                array->children[i] = new ArrowArray();
+            }
+        }
+        array->dictionary = NULL;
+        array->release = keaArrowReleaseArray;
+        array->private_data = new std::vector<uint8_t*>();
+    }
+    
+    static void keaArrowInitSchema(ArrowSchema *schema, const char *format, const std::string &name, int64_t nChildren)
+    {
+        std::string *nameData = new std::string(name);
+        schema->format = format;
+        schema->name = nameData->c_str();
+        schema->metadata = NULL;
+        schema->flags = 0;
+        schema->n_children = nChildren;
+        schema->children = NULL;
+        if(nChildren > 0)
+        {
+            schema->children = new ArrowSchema*[nChildren];
+            for(int64_t i = 0; i < nChildren; ++i)
+            {
+                schema->children[i] = new ArrowSchema();
+            }
+        }
+        schema->dictionary = NULL;
+        schema->release = keaArrowReleaseSchema;
+        schema->private_data = nameData;
+    }
+    
+    static uint8_t* keaArrowAllocBuffer(ArrowArray *array, int64_t bufIdx, size_t nBytes)
+    {
+        // NEVER HAND OUT A NULL DATA BUFFER, EVEN FOR AN EMPTY ARRAY
+        uint8_t *buffer = new uint8_t[std::max(nBytes, (size_t)1)];
+        ((std::vector<uint8_t*>*) array->private_data)->push_back(buffer);
+        array->buffers[bufIdx] = buffer;
+        return buffer;
+    }
+    
+    void KEAAttributeTable::exportColumnsArrow(size_t startfid, size_t len, const std::vector<std::string> &columns, ArrowArray *array, ArrowSchema *schema) const
+    {
+        if((startfid+len) > this->getSize())
+        {
+            std::string message = std::string("Requested feature (") + sizet2Str(startfid+len) + std::string(") is not within the table.");
+            throw KEAATTException(message);
+        }
+        
+        std::vector<KEAATTField> colFields;
+        for(std::vector<std::string>::const_iterator iterName = columns.begin(); iterName != columns.end(); ++iterName)
+        {
+            colFields.push_back(this->getField(*iterName));
+        }
+        
+        keaArrowInitArray(array, len, 1, colFields.size());
+        keaArrowInitSchema(schema, "+s", "", colFields.size());
+        try
+        {
+            for(size_t i = 0; i < colFields.size(); ++i)
+            {
+                ArrowArray *colArray = array->children[i];
+                ArrowSchema *colSchema = schema->children[i];
+                const KEAATTField &field = colFields[i];
+                if(field.dataType == kea_att_bool)
+                {
+                    keaArrowInitArray(colArray, len, 2, 0);
+                    keaArrowInitSchema(colSchema, "b", field.name, 0);
+                    uint8_t *bits = keaArrowAllocBuffer(colArray, 1, (len + 7) / 8);
+                    memset(bits, 0, (len + 7) / 8);
+                    if(len > 0)
+                    {
+                        bool *boolVals = new bool[len];
+                        try
+                        {
+                            this->getBoolFields(startfid, len, field.idx, boolVals);
+                        }
+                        catch(KEAException &e)
+                        {
+                            delete[] boolVals;
+                            throw;
+                        }
+                        for(size_t n = 0; n < len; ++n)
+                        {
+                            if(boolVals[n])
+                            {
+                                bits[n / 8] |= (uint8_t)(1 << (n % 8));
+                            }
+                        }
+                        delete[] boolVals;
+                    }
+                }
+                else if(field.dataType == kea_att_int)
+                {
+                    keaArrowInitArray(colArray, len, 2, 0);
+                    keaArrowInitSchema(colSchema, "l", field.name, 0);
+                    int64_t *intVals = (int64_t*) keaArrowAllocBuffer(colArray, 1, len * sizeof(int64_t));
+                    if(len > 0)
+                    {
+                        this->getIntFields(startfid, len, field.idx, intVals);
+                    }
+                }
+                else if(field.dataType == kea_att_float)
+                {
+                    keaArrowInitArray(colArray, len, 2, 0);
+                    keaArrowInitSchema(colSchema, "g", field.name, 0);
+                    double *floatVals = (double*) keaArrowAllocBuffer(colArray, 1, len * sizeof(double));
+                    if(len > 0)
+                    {
+                        this->getFloatFields(startfid, len, field.idx, floatVals);
+                    }
+                }
+                else if(field.dataType == kea_att_string)
+                {
+                    // LARGE UTF8 (64 BIT OFFSETS) SO THERE IS NO LIMIT ON THE COLUMN SIZE
+                    keaArrowInitArray(colArray, len, 3, 0);
+                    keaArrowInitSchema(colSchema, "U", field.name, 0);
+                    std::vector<std::string> strVals;
+                    if(len > 0)
+                    {
+                        this->getStringFields(startfid, len, field.idx, &strVals);
+                    }
+                    int64_t *offsets = (int64_t*) keaArrowAllocBuffer(colArray, 1, (len + 1) * sizeof(int64_t));
+                    offsets[0] = 0;
+                    for(size_t n = 0; n < len; ++n)
+                    {
+                        offsets[n+1] = offsets[n] + strVals[n].size();
+                    }
+                    uint8_t *strData = keaArrowAllocBuffer(colArray, 2, offsets[len]);
+                    for(size_t n = 0; n < len; ++n)
+                    {
+                        memcpy(strData + offsets[n], strVals[n].data(), strVals[n].size());
+                    }
+                }
+                else
+                {
+                    std::string message = std::string("Field \'") + field.name + std::string("\' has a type which cannot be exported to Arrow.");
+                    throw KEAATTException(message);
+                }
+            }
+        }
+        catch(KEAException &e)
+        {
+            array->release(array);
+            schema->release(schema);
+            throw;
+        }
+    }
+    
+    template <typename T>
+    static T keaArrowNumericValue(char format, const void *data, size_t idx)
+    {
+        switch(format)
+        {
+            case 'b':
+                return (T)((((const uint8_t*)data)[idx / 8] >> (idx % 8)) & 1);
+            case 'c':
+                return (T)((const int8_t*)data)[idx];
+            case 'C':
+                return (T)((const uint8_t*)data)[idx];
+            case 's':
+                return (T)((const int16_t*)data)[idx];
+            case 'S':
+                return (T)((const uint16_t*)data)[idx];
+            case 'i':
+                return (T)((const int32_t*)data)[idx];
+            case 'I':
+                return (T)((const uint32_t*)data)[idx];
+            case 'l':
+                return (T)((const int64_t*)data)[idx];
+            case 'L':
+                return (T)((const uint64_t*)data)[idx];
+            case 'f':
+                return (T)((const float*)data)[idx];
+            case 'g':
+                return (T)((const double*)data)[idx];
+        }
+        return (T)0;
+    }
+    
+    static void keaArrowImportColumn(KEAAttributeTable *att, size_t startfid, size_t len, size_t parentOffset, const ArrowArray *colArray, const ArrowSchema *colSchema)
+    {
+        if((colSchema->name == NULL) || (colSchema->name[0] == '\0'))
+        {
+            throw KEAATTException("Arrow columns must be named to be imported into the attribute table.");
+        }
+        std::string name = std::string(colSchema->name);
+        std::string format = std::string(colSchema->format);
+        
+        if((size_t)colArray->length < (parentOffset + len))
+        {
+            std::string message = std::string("Arrow column \'") + name + std::string("\' is shorter than its parent array.");
+            throw KEAATTException(message);
+        }
+        
+        bool isString = ((format == "u") || (format == "U"));
+        bool isNumeric = ((format.size() == 1) && (std::string("bcCsSiIlLfg").find(format[0]) != std::string::npos));
+        if(!isString && !isNumeric)
+        {
+            std::string message = std::string("Arrow format \'") + format + std::string("\' of column \'") + name + std::string("\' is not supported.");
+            throw KEAATTException(message);
+        }
+        
+        if(!att->hasField(name))
+        {
+            if(isString)
+            {
+                att->addAttStringField(name, "");
+            }
+            else if(format == "b")
+            {
+                att->addAttBoolField(name, false);
+            }
+            else if((format == "f") || (format == "g"))
+            {
+                att->addAttFloatField(name, 0);
+            }
+            else
+            {
+                att->addAttIntField(name, 0);
+            }
+        }
+        KEAATTField field = att->getField(name);
+        if(isString != (field.dataType == kea_att_string))
+        {
+            std::string message = std::string("Arrow column \'") + name + std::string("\' does not match the type of the attribute table column.");
+            throw KEAATTException(message);
+        }
+        
+        if(len == 0)
+        {
+            return;
+        }
+        
+        size_t off = colArray->offset + parentOffset;
+        const uint8_t *validity = (colArray->null_count != 0)? (const uint8_t*) colArray->buffers[0] : NULL;
+        char fmt = format[0];
+        if(field.dataType == kea_att_string)
+        {
+            std::vector<std::string> strVals(len);
+            const char *strData = (const char*) colArray->buffers[2];
+            for(size_t n = 0; n < len; ++n)
+            {
+                size_t idx = off + n;
+                if((validity != NULL) && !((validity[idx / 8] >> (idx % 8)) & 1))
+                {
+                    continue;
+                }
+                int64_t start = keaArrowNumericValue<int64_t>((fmt == 'u')? 'i' : 'l', colArray->buffers[1], idx);
+                int64_t end = keaArrowNumericValue<int64_t>((fmt == 'u')? 'i' : 'l', colArray->buffers[1], idx + 1);
+                strVals[n].assign(strData + start, end - start);
+            }
+            att->setStringFields(startfid, len, field.idx, &strVals);
+        }
+        else if(field.dataType == kea_att_bool)
+        {
+            bool *boolVals = new bool[len];
+            for(size_t n = 0; n < len; ++n)
+            {
+                size_t idx = off + n;
+                bool valid = (validity == NULL) || ((validity[idx / 8] >> (idx % 8)) & 1);
+                boolVals[n] = valid && (keaArrowNumericValue<double>(fmt, colArray->buffers[1], idx) != 0);
+            }
+            try
+            {
+                att->setBoolFields(startfid, len, field.idx, boolVals);
+            }
+            catch(KEAException &e)
+            {
+                delete[] boolVals;
+                throw;
+            }
+            delete[] boolVals;
+        }
+        else if(field.dataType == kea_att_int)
+        {
+            std::vector<int64_t> intVals(len, 0);
+            for(size_t n = 0; n < len; ++n)
+            {
+                size_t idx = off + n;
+                if((validity == NULL) || ((validity[idx / 8] >> (idx % 8)) & 1))
+                {
+                    intVals[n] = keaArrowNumericValue<int64_t>(fmt, colArray->buffers[1], idx);
+                }
+            }
+            att->setIntFields(startfid, len, field.idx, &intVals[0]);
+        }
+        else if(field.dataType == kea_att_float)
+        {
+            std::vector<double> floatVals(len, 0);
+            for(size_t n = 0; n < len; ++n)
+            {
+                size_t idx = off + n;
+                if((validity == NULL) || ((validity[idx / 8] >> (idx % 8)) & 1))
+                {
+                    floatVals[n] = keaArrowNumericValue<double>(fmt, colArray->buffers[1], idx);
+                }
+            }
+            att->setFloatFields(startfid, len, field.idx, &floatVals[0]);
+        }
+    }
+    
+    void KEAAttributeTable::importColumnsArrow(size_t startfid, const ArrowArray *array, const ArrowSchema *schema)
+    {
+        if((array == NULL) || (schema == NULL) || (array->release == NULL) || (schema->release == NULL))
+        {
+            throw KEAATTException("The Arrow array or schema passed has already been released.");
+        }
+        
+        if((startfid+array->length) > this->getSize())
+        {
+            std::string message = std::string("Requested feature (") + sizet2Str(startfid+array->length) + std::string(") is not within the table.");
+            throw KEAATTException(message);
+        }
+        
+        if(std::string(schema->format) == "+s")
+        {
+            if(array->n_children != schema->n_children)
+            {
+                throw KEAATTException("The Arrow array and schema do not have the same number of children.");
+            }
+            for(int64_t i = 0; i < array->n_children; ++i)
+            {
+                keaArrowImportColumn(this, startfid, array->length, array->offset, array->children[i], schema->children[i]);
+            }
+        }
+        else
+        {
+            keaArrowImportColumn(this, startfid, array->length, 0, array, schema);
+        }
+    }
+    
+    static const size_t KEA_ATT_SCAN_BLOCKS = 16;
+    
+    template <typename T>
+    static void keaATTCompareColumn(const T *vals, size_t len, KEAATTCompareOp op, T value, uint8_t *mask)
+    {
+        // BRANCH FREE LOOPS SO THE COMPILER CAN VECTORISE THE COMPARISONS
+        switch(op)
+        {
+            case kea_att_eq:
+                for(size_t i = 0; i < len; ++i)
+                {
+                    mask[i] &= (uint8_t)(vals[i] == value);
+                }
+                break;
+            case kea_att_ne:
+                for(size_t i = 0; i < len; ++i)
+                {
+                    mask[i] &= (uint8_t)(vals[i] != value);
+                }
+                break;
+            case kea_att_lt:
+                for(size_t i = 0; i < len; ++i)
+                {
+                    mask[i] &= (uint8_t)(vals[i] < value);
+                }
+                break;
+            case kea_att_le:
+                for(size_t i = 0; i < len; ++i)
+                {
+                    mask[i] &= (uint8_t)(vals[i] <= value);
+                }
+                break;
+            case kea_att_gt:
+                for(size_t i = 0; i < len; ++i)
+                {
+                    mask[i] &= (uint8_t)(vals[i] > value);
+                }
+                break;
+            case kea_att_ge:
+                for(size_t i = 0; i < len; ++i)
+                {
+                    mask[i] &= (uint8_t)(vals[i] >= value);
+                }
+                break;
+        }
+    }
+    
+    int KEAAttributeTable::rewriteIntPredicate(KEAATTCompareOp op, double value, KEAATTCompareOp *intOp, int64_t *intValue)
+    {
+        const double int64Lim = 9223372036854775808.0; // 2^63
+        *intOp = op;
+        if(value != value)
+        {
+            return (op == kea_att_ne)? 1 : 0;
+        }
+        else if(value >= int64Lim)
+        {
+            return ((op == kea_att_lt) || (op == kea_att_le) || (op == kea_att_ne))? 1 : 0;
+        }
+        else if(value < -int64Lim)
+        {
+            return ((op == kea_att_gt) || (op == kea_att_ge) || (op == kea_att_ne))? 1 : 0;
+        }
+        
+        double lower = floor(value);
+        if((lower != value) && (op == kea_att_eq))
+        {
+            return 0;
+        }
+        else if((lower != value) && (op == kea_att_ne))
+        {
+            return 1;
+        }
+        
+        if((op == kea_att_lt) || (op == kea_att_ge))
+        {
+            *intValue = (int64_t)ceil(value);
+        }
+        else
+        {
+            *intValue = (int64_t)lower;
+        }
+        return -1;
+    }
+    
+    bool KEAAttributeTable::evaluatePredicate(KEAATTCompareOp op, double lhs, double value)
+    {
+        switch(op)
+        {
+            case kea_att_eq:
+                return lhs == value;
+            case kea_att_ne:
+                return lhs != value;
+            case kea_att_lt:
+                return lhs < value;
+            case kea_att_le:
+                return lhs <= value;
+            case kea_att_gt:
+                return lhs > value;
+            case kea_att_ge:
+                return lhs >= value;
+        }
+        return false;
+    }
+    
+    size_t KEAAttributeTable::getScanBlockSize() const
+    {
+        return KEA_ATT_CHUNK_SIZE;
+    }
+    
+    bool KEAAttributeTable::predicateMayMatch(const KEAATTPredicate &/*predicate*/, const KEAATTField &/*field*/, size_t /*startfid*/, size_t /*len*/) const
+    {
+        return true;
+    }
+    
+    void KEAAttributeTable::scanRows(const std::vector<KEAATTPredicate> &predicates, std::vector<bool> *selection, std::vector<size_t> *fids) const
+    {
+        std::vector<KEAATTField> predFields;
+        for(std::vector<KEAATTPredicate>::const_iterator iterPred = predicates.begin(); iterPred != predicates.end(); ++iterPred)
+        {
+            KEAATTField field = this->getField((*iterPred).name);
+            if((field.dataType != kea_att_bool) && (field.dataType != kea_att_int) && (field.dataType != kea_att_float))
+            {
+                std::string message = std::string("Field \'") + field.name + std::string("\' cannot be used in a predicate, only int, float and bool fields can.");
+                throw KEAATTException(message);
+            }
+            predFields.push_back(field);
+        }
+        
+        size_t numRows = this->getSize();
+        if(selection != NULL)
+        {
+            selection->assign(numRows, false);
+        }
+        if(fids != NULL)
+        {
+            fids->clear();
+        }
+        
+        size_t blockSize = std::max(this->getScanBlockSize(), (size_t)1);
+        size_t batchSize = std::min(numRows, blockSize * KEA_ATT_SCAN_BLOCKS);
+        std::vector<uint8_t> mask(batchSize);
+        std::vector<int64_t> intVals;
+        std::vector<double> floatVals;
+        bool *boolVals = NULL;
+        try
+        {
+            for(size_t batchStart = 0; batchStart < numRows; batchStart += batchSize)
+            {
+                size_t batchLen = std::min(batchSize, numRows - batchStart);
+                std::fill(mask.begin(), mask.begin() + batchLen, 1);
+                for(size_t p = 0; p < predicates.size(); ++p)
+                {
+                    const KEAATTPredicate &pred = predicates[p];
+                    const KEAATTField &field = predFields[p];
+                    for(size_t blockStart = 0; blockStart < batchLen; blockStart += blockSize)
+                    {
+                        size_t blockLen = std::min(blockSize, batchLen - blockStart);
+                        if(!this->predicateMayMatch(pred, field, batchStart + blockStart, blockLen))
+                        {
+                            std::fill(mask.begin() + blockStart, mask.begin() + blockStart + blockLen, 0);
+                        }
+                    }
+                    
+                    // ONLY READ THE SPAN OF ROWS WHICH ARE STILL SELECTED
+                    size_t first = 0;
+                    while((first < batchLen) && (mask[first] == 0))
+                    {
+                        ++first;
+                    }
+                    if(first == batchLen)
+                    {
+                        break;
+                    }
+                    size_t last = batchLen;
+                    while(mask[last-1] == 0)
+                    {
+                        --last;
+                    }
+                    size_t spanStart = batchStart + first;
+                    size_t spanLen = last - first;
+                    uint8_t *spanMask = &mask[first];
+                    
+                    if(field.dataType == kea_att_int)
+                    {
+                        KEAATTCompareOp intOp;
+                        int64_t intValue = 0;
+                        int constResult = rewriteIntPredicate(pred.op, pred.value, &intOp, &intValue);
+                        if(constResult == 0)
+                        {
+                            std::fill(spanMask, spanMask + spanLen, 0);
+                        }
+                        else if(constResult < 0)
+                        {
+                            intVals.resize(spanLen);
+                            this->getIntFields(spanStart, spanLen, field.idx, &intVals[0]);
+                            keaATTCompareColumn(&intVals[0], spanLen, intOp, intValue, spanMask);
+                        }
+                    }
+                    else if(field.dataType == kea_att_float)
+                    {
+                        floatVals.resize(spanLen);
+                        this->getFloatFields(spanStart, spanLen, field.idx, &floatVals[0]);
+                        keaATTCompareColumn(&floatVals[0], spanLen, pred.op, pred.value, spanMask);
+                    }
+                    else
+                    {
+                        uint8_t matchTrue = evaluatePredicate(pred.op, 1, pred.value)? 1 : 0;
+                        uint8_t matchFalse = evaluatePredicate(pred.op, 0, pred.value)? 1 : 0;
+                        if(!matchTrue && !matchFalse)
+                        {
+                            std::fill(spanMask, spanMask + spanLen, 0);
+                        }
+                        else if(matchTrue != matchFalse)
+                        {
+                            if(boolVals == NULL)
+                            {
+                                boolVals = new bool[batchSize];
+                            }
+                            this->getBoolFields(spanStart, spanLen, field.idx, boolVals);
+                            for(size_t i = 0; i < spanLen; ++i)
+                            {
+                                spanMask[i] &= boolVals[i]? matchTrue : matchFalse;
+                            }
+                        }
+                    }
+                }
+                
+                for(size_t i = 0; i < batchLen; ++i)
+                {
+                    if(mask[i])
+                    {
+                        if(selection != NULL)
+                        {
+                            (*selection)[batchStart + i] = true;
+                        }
+                        if(fids != NULL)
+                        {
+                            fids->push_back(batchStart + i);
+                        }
+                    }
+                }
+            }
+        }
+        catch(KEAException &e)
+        {
+            delete[] boolVals;
+            throw;
+        }
+        delete[] boolVals;
+    }
+    
+    void KEAAttributeTable::selectRows(const std::vector<KEAATTPredicate> &predicates, std::vector<bool> *selection) const
+    {
+        this->scanRows(predicates, selection, NULL);
+    }
+    
+    void KEAAttributeTable::selectRowIds(const std::vector<KEAATTPredicate> &predicates, std::vector<size_t> *fids) const
+    {
+        this->scanRows(predicates, NULL, fids);
+    }
+    
+    // 64 BIT FINALISER FROM MURMURHASH3, STABLE ACROSS RUNS SO HASH INDEXES CAN BE SAVED
+    static uint64_t keaATTHashInt(uint64_t key)
+    {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return key;
+    }
+    
+    static uint64_t keaATTHashFloat(double key)
+    {
+        // -0.0 AND 0.0 ARE EQUAL SO MUST HASH THE SAME
+        if(key == 0)
+        {
+            key = 0;
+        }
+        uint64_t bits = 0;
+        memcpy(&bits, &key, sizeof(double));
+        return keaATTHashInt(bits);
+    }
+    
+    static uint64_t keaATTHashString(const std::string &key)
+    {
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ULL;
+        for(std::string::const_iterator iterChar = key.begin(); iterChar != key.end(); ++iterChar)
+        {
+            hash ^= (uint8_t)(*iterChar);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+    
+    // ORDERS NaN AFTER EVERY OTHER VALUE SO FLOAT KEYS CAN BE SORTED
+    static bool keaATTFloatLess(double a, double b)
+    {
+        if(a != a)
+        {
+            return false;
+        }
+        return (b != b) || (a < b);
+    }
+    
+    template <typename T>
+    struct KEAATTKeyLess
+    {
+        const std::vector<T> *keys;
+        bool operator()(size_t a, size_t b) const
+        {
+            return (*keys)[a] < (*keys)[b];
+        }
+    };
+    
+    struct KEAATTFloatKeyLess
+    {
+        const std::vector<double> *keys;
+        bool operator()(size_t a, size_t b) const
+        {
+            return keaATTFloatLess((*keys)[a], (*keys)[b]);
+        }
+    };
+    
+    // ARRANGE THE ROWS OF AN INDEX FROM THE COLUMN VALUES AND KEEP THE KEYS IN THE SAME ORDER
+    template <typename T, typename Less>
+    static void keaATTSortIndex(std::vector<T> *values, Less less, std::vector<uint64_t> *rows)
+    {
+        std::vector<size_t> order(values->size());
+        for(size_t i = 0; i < order.size(); ++i)
+        {
+            order[i] = i;
+        }
+        less.keys = values;
+        std::stable_sort(order.begin(), order.end(), less);
+        
+        std::vector<T> sortedKeys(values->size());
+        rows->resize(values->size());
+        for(size_t i = 0; i < order.size(); ++i)
+        {
+            (*rows)[i] = order[i];
+            sortedKeys[i] = (*values)[order[i]];
+        }
+        values->swap(sortedKeys);
+    }
+    
+    template <typename T, typename Hash>
+    static void keaATTHashIndex(std::vector<T> *values, Hash hash, std::vector<uint64_t> *rows, std::vector<uint64_t> *buckets)
+    {
+        size_t numBuckets = 1;
+        while(numBuckets < values->size())
+        {
+            numBuckets *= 2;
+        }
+        buckets->assign(numBuckets + 1, 0);
+        std::vector<uint64_t> rowBuckets(values->size());
+        for(size_t i = 0; i < values->size(); ++i)
+        {
+            rowBuckets[i] = hash((*values)[i]) & (numBuckets - 1);
+            ++(*buckets)[rowBuckets[i] + 1];
+        }
+        for(size_t b = 0; b < numBuckets; ++b)
+        {
+            (*buckets)[b + 1] += (*buckets)[b];
+        }
+        
+        std::vector<uint64_t> next(buckets->begin(), buckets->end() - 1);
+        std::vector<T> bucketKeys(values->size());
+        rows->resize(values->size());
+        for(size_t i = 0; i < values->size(); ++i)
+        {
+            uint64_t pos = next[rowBuckets[i]]++;
+            (*rows)[pos] = i;
+            bucketKeys[pos] = (*values)[i];
+        }
+        values->swap(bucketKeys);
+    }
+    
+    static void keaATTReadColumn(const KEAAttributeTable *att, size_t colIdx, std::vector<int64_t> *values)
+    {
+        values->resize(att->getSize());
+        if(!values->empty())
+        {
+            att->getIntFields(0, values->size(), colIdx, &(*values)[0]);
+        }
+    }
+    
+    static void keaATTReadColumn(const KEAAttributeTable *att, size_t colIdx, std::vector<double> *values)
+    {
+        values->resize(att->getSize());
+        if(!values->empty())
+        {
+            att->getFloatFields(0, values->size(), colIdx, &(*values)[0]);
+        }
+    }
+    
+    static void keaATTReadColumn(const KEAAttributeTable *att, size_t colIdx, std::vector<std::string> *values)
+    {
+        values->clear();
+        if(att->getSize() > 0)
+        {
+            att->getStringFields(0, att->getSize(), colIdx, values);
+        }
+    }
+    
+    void KEAAttributeTable::buildIndex(KEAATTIndex *index) const
+    {
+        index->rows.clear();
+        index->buckets.clear();
+        index->intKeys.clear();
+        index->floatKeys.clear();
+        index->strKeys.clear();
+        if(index->dataType == kea_att_int)
+        {
+            keaATTReadColumn(this, index->colIdx, &index->intKeys);
+            if(index->type == kea_att_index_sorted)
+            {
+                keaATTSortIndex(&index->intKeys, KEAATTKeyLess<int64_t>(), &index->rows);
+            }
+            else
+            {
+                keaATTHashIndex(&index->intKeys, keaATTHashInt, &index->rows, &index->buckets);
+            }
+        }
+        else if(index->dataType == kea_att_float)
+        {
+            keaATTReadColumn(this, index->colIdx, &index->floatKeys);
+            if(index->type == kea_att_index_sorted)
+            {
+                keaATTSortIndex(&index->floatKeys, KEAATTFloatKeyLess(), &index->rows);
+            }
+            else
+            {
+                keaATTHashIndex(&index->floatKeys, keaATTHashFloat, &index->rows, &index->buckets);
+            }
+        }
+        else
+        {
+            keaATTReadColumn(this, index->colIdx, &index->strKeys);
+            if(index->type == kea_att_index_sorted)
+            {
+                keaATTSortIndex(&index->strKeys, KEAATTKeyLess<std::string>(), &index->rows);
+            }
+            else
+            {
+                keaATTHashIndex(&index->strKeys, keaATTHashString, &index->rows, &index->buckets);
+            }
+        }
+        index->stale = false;
+        index->loaded = true;
+    }
+    
+    void KEAAttributeTable::loadIndexKeys(KEAATTIndex *index) const
+    {
+        // ONLY THE ROW ORDER IS SAVED, THE KEYS ARE GATHERED FROM THE COLUMN
+        if(index->dataType == kea_att_int)
+        {
+            std::vector<int64_t> values;
+            keaATTReadColumn(this, index->colIdx, &values);
+            index->intKeys.resize(index->rows.size());
+            for(size_t i = 0; i < index->rows.size(); ++i)
+            {
+                index->intKeys[i] = values[index->rows[i]];
+            }
+        }
+        else if(index->dataType == kea_att_float)
+        {
+            std::vector<double> values;
+            keaATTReadColumn(this, index->colIdx, &values);
+            index->floatKeys.resize(index->rows.size());
+            for(size_t i = 0; i < index->rows.size(); ++i)
+            {
+                index->floatKeys[i] = values[index->rows[i]];
+            }
+        }
+        else
+        {
+            std::vector<std::string> values;
+            keaATTReadColumn(this, index->colIdx, &values);
+            index->strKeys.resize(index->rows.size());
+            for(size_t i = 0; i < index->rows.size(); ++i)
+            {
+                index->strKeys[i] = values[index->rows[i]];
+            }
+        }
+    }
+    
+    KEAATTIndex* KEAAttributeTable::getUsableIndex(const KEAATTField &field) const
+    {
+        std::map<std::string, KEAATTIndex>::iterator iterIndex = indexes.find(field.name);
+        if(iterIndex == indexes.end())
+        {
+            return NULL;
+        }
+        
+        KEAATTIndex *index = &iterIndex->second;
+        if(!index->stale && !index->loaded)
+        {
+            this->loadIndex(field.name, index);
+            if(index->rows.size() == this->getSize())
+            {
+                this->loadIndexKeys(index);
+                index->loaded = true;
+            }
+            else
+            {
+                index->stale = true;
+            }
+        }
+        
+        // STALE INDEXES ARE ONLY REBUILT BY rebuildIndex(), LOOKUPS SCAN THE COLUMN UNTIL THEN
+        if(index->stale)
+        {
+            return NULL;
+        }
+        return index;
+    }
+    
+    void KEAAttributeTable::markIndexStale(KEAFieldDataType dataType, size_t colIdx)
+    {
+        if(indexes.empty())
+        {
+            return;
+        }
+        
+        for(std::map<std::string, KEAATTIndex>::iterator iterIndex = indexes.begin(); iterIndex != indexes.end(); ++iterIndex)
+        {
+            if((iterIndex->second.dataType == dataType) && (iterIndex->second.colIdx == colIdx) && !iterIndex->second.stale)
+            {
+                iterIndex->second.stale = true;
+                this->saveIndexState(iterIndex->first, iterIndex->second);
+            }
+        }
+    }
+    
+    void KEAAttributeTable::markIndexesStale()
+    {
+        for(std::map<std::string, KEAATTIndex>::iterator iterIndex = indexes.begin(); iterIndex != indexes.end(); ++iterIndex)
+        {
+            if(!iterIndex->second.stale)
+            {
+                iterIndex->second.stale = true;
+                this->saveIndexState(iterIndex->first, iterIndex->second);
+            }
+        }
+    }
+    
+    void KEAAttributeTable::loadIndex(const std::string &/*name*/, KEAATTIndex *index) const
+    {
+        // INDEXES ARE ONLY KEPT IN MEMORY BY DEFAULT
+        index->stale = true;
+    }
+    
+    void KEAAttributeTable::saveIndex(const std::string &/*name*/, const KEAATTIndex &/*index*/)
+    {
+    }
+    
+    void KEAAttributeTable::saveIndexState(const std::string &/*name*/, const KEAATTIndex &/*index*/)
+    {
+    }
+    
+    void KEAAttributeTable::removeIndex(const std::string &/*name*/, const KEAATTIndex &/*index*/)
+    {
+    }
+    
+    void KEAAttributeTable::createIndex(const std::string &name, KEAATTIndexType type)
+    {
+        KEAATTField field = this->getField(name);
+        if((field.dataType != kea_att_int) && (field.dataType != kea_att_float) && (field.dataType != kea_att_string))
+        {
+            std::string message = std::string("Field \'") + name + std::string("\' cannot be indexed, only int, float and string fields can.");
+            throw KEAATTException(message);
+        }
+        
+        if(indexes.count(name) > 0)
+        {
+            this->dropIndex(name);
+        }
+        
+        KEAATTIndex *index = &indexes[name];
+        index->type = type;
+        index->dataType = field.dataType;
+        index->colIdx = field.idx;
+        try
+        {
+            this->buildIndex(index);
+            this->saveIndex(name, *index);
+        }
+        catch(KEAException &e)
+        {
+            indexes.erase(name);
+            throw;
+        }
+    }
+    
+    void KEAAttributeTable::dropIndex(const std::string &name)
+    {
+        std::map<std::string, KEAATTIndex>::iterator iterIndex = indexes.find(name);
+        if(iterIndex != indexes.end())
+        {
+            this->removeIndex(name, iterIndex->second);
+            indexes.erase(iterIndex);
+        }
+    }
+    
+    bool KEAAttributeTable::hasIndex(const std::string &name) const
+    {
+        return (indexes.count(name) > 0);
+    }
+    
+    void KEAAttributeTable::rebuildIndex(const std::string &name)
+    {
+        std::map<std::string, KEAATTIndex>::iterator iterIndex = indexes.find(name);
+        if(iterIndex == indexes.end())
+        {
+            std::string message = std::string("Field \'") + name + std::string("\' does not have an index.");
+            throw KEAATTException(message);
+        }
+        
+        KEAATTIndex *index = &iterIndex->second;
+        if(!index->stale && !index->loaded)
+        {
+            this->loadIndex(name, index);
+        }
+        if(index->stale || (index->rows.size() != this->getSize()))
+        {
+            this->buildIndex(index);
+            this->saveIndex(name, *index);
+        }
+    }
+    
+    bool KEAAttributeTable::isIndexStale(const std::string &name) const
+    {
+        std::map<std::string, KEAATTIndex>::const_iterator iterIndex = indexes.find(name);
+        return (iterIndex != indexes.end()) && iterIndex->second.stale;
+    }
+    
+    // LOOK UP A VALUE IN A HASH OR SORTED INDEX, THE KEYS ARE IN THE SAME ORDER AS THE ROWS
+    template <typename T, typename Less>
+    static void keaATTIndexLookup(const KEAATTIndex *index, const std::vector<T> &keys, const T &value, uint64_t hash, Less less, std::vector<size_t> *fids)
+    {
+        fids->clear();
+        if(index->type == kea_att_index_hash)
+        {
+            uint64_t b = hash & (index->buckets.size() - 2);
+            for(uint64_t i = index->buckets[b]; i < index->buckets[b + 1]; ++i)
+            {
+                if(keys[i] == value)
+                {
+                    fids->push_back(index->rows[i]);
+                }
+            }
+        }
+        else
+        {
+            typename std::vector<T>::const_iterator iterFirst = std::lower_bound(keys.begin(), keys.end(), value, less);
+            for(typename std::vector<T>::const_iterator iterKey = iterFirst; (iterKey != keys.end()) && (*iterKey == value); ++iterKey)
+            {
+                fids->push_back(index->rows[iterKey - keys.begin()]);
+            }
+        }
+    }
+    
+    template <typename T>
+    static bool keaATTDefaultLess(const T &a, const T &b)
+    {
+        return a < b;
+    }
+    
+    KEAATTField KEAAttributeTable::getIndexableField(const std::string &name, KEAFieldDataType dataType) const
+    {
+        KEAATTField field = this->getField(name);
+        if(field.dataType != dataType)
+        {
+            std::string message = std::string("Field \'") + name + std::string("\' is not of the type being searched for.");
+            throw KEAATTException(message);
+        }
+        return field;
+    }
+    
+    void KEAAttributeTable::findIntRows(const std::string &name, int64_t value, std::vector<size_t> *fids) const
+    {
+        KEAATTField field = this->getIndexableField(name, kea_att_int);
+        KEAATTIndex *index = this->getUsableIndex(field);
+        if(index != NULL)
+        {
+            keaATTIndexLookup(index, index->intKeys, value, keaATTHashInt(value), keaATTDefaultLess<int64_t>, fids);
+        }
+        else
+        {
+            this->findIntRowsInRange(name, value, value, fids);
+        }
+    }
+    
+    void KEAAttributeTable::findFloatRows(const std::string &name, double value, std::vector<size_t> *fids) const
+    {
+        KEAATTField field = this->getIndexableField(name, kea_att_float);
+        KEAATTIndex *index = this->getUsableIndex(field);
+        if(index != NULL)
+        {
+            keaATTIndexLookup(index, index->floatKeys, value, keaATTHashFloat(value), keaATTFloatLess, fids);
+        }
+        else
+        {
+            this->findFloatRowsInRange(name, value, value, fids);
+        }
+    }
+    
+    void KEAAttributeTable::findStringRows(const std::string &name, const std::string &value, std::vector<size_t> *fids) const
+    {
+        KEAATTField field = this->getIndexableField(name, kea_att_string);
+        KEAATTIndex *index = this->getUsableIndex(field);
+        if(index != NULL)
+        {
+            keaATTIndexLookup(index, index->strKeys, value, keaATTHashString(value), keaATTDefaultLess<std::string>, fids);
+            return;
+        }
+        
+        fids->clear();
+        size_t numRows = this->getSize();
+        size_t batchSize = std::max(this->getScanBlockSize(), (size_t)1) * KEA_ATT_SCAN_BLOCKS;
+        std::vector<std::string> strVals;
+        for(size_t batchStart = 0; batchStart < numRows; batchStart += batchSize)
+        {
+            size_t batchLen = std::min(batchSize, numRows - batchStart);
+            this->getStringFields(batchStart, batchLen, field.idx, &strVals);
+            for(size_t i = 0; i < batchLen; ++i)
+            {
+                if(strVals[i] == value)
+                {
+                    fids->push_back(batchStart + i);
+                }
+            }
+        }
+    }
+    
+    void KEAAttributeTable::findIntRowsInRange(const std::string &name, int64_t lower, int64_t upper, std::vector<size_t> *fids) const
+    {
+        KEAATTField field = this->getIndexableField(name, kea_att_int);
+        KEAATTIndex *index = this->getUsableIndex(field);
+        fids->clear();
+        if((index != NULL) && (index->type == kea_att_index_sorted))
+        {
+            const std::vector<int64_t> &keys = index->intKeys;
+            std::vector<int64_t>::const_iterator iterFirst = std::lower_bound(keys.begin(), keys.end(), lower);
+            std::vector<int64_t>::const_iterator iterLast = std::upper_bound(iterFirst, keys.end(), upper);
+            for(std::vector<int64_t>::const_iterator iterKey = iterFirst; iterKey < iterLast; ++iterKey)
+            {
+                fids->push_back(index->rows[iterKey - keys.begin()]);
+            }
+            std::sort(fids->begin(), fids->end());
+            return;
+        }
+        
+        size_t numRows = this->getSize();
+        size_t batchSize = std::max(this->getScanBlockSize(), (size_t)1) * KEA_ATT_SCAN_BLOCKS;
+        std::vector<int64_t> intVals;
+        for(size_t batchStart = 0; batchStart < numRows; batchStart += batchSize)
+        {
+            size_t batchLen = std::min(batchSize, numRows - batchStart);
+            intVals.resize(batchLen);
+            this->getIntFields(batchStart, batchLen, field.idx, &intVals[0]);
+            for(size_t i = 0; i < batchLen; ++i)
+            {
+                if((intVals[i] >= lower) && (intVals[i] <= upper))
+                {
+                    fids->push_back(batchStart + i);
+                }
+            }
+        }
+    }
+    
+    void KEAAttributeTable::findFloatRowsInRange(const std::string &name, double lower, double upper, std::vector<size_t> *fids) const
+    {
+        KEAATTField field = this->getIndexableField(name, kea_att_float);
+        KEAATTIndex *index = this->getUsableIndex(field);
+        fids->clear();
+        if((index != NULL) && (index->type == kea_att_index_sorted))
+        {
+            if((lower != lower) || (upper != upper))
+            {
+                return;
+            }
+            const std::vector<double> &keys = index->floatKeys;
+            std::vector<double>::const_iterator iterFirst = std::lower_bound(keys.begin(), keys.end(), lower, keaATTFloatLess);
+            std::vector<double>::const_iterator iterLast = std::upper_bound(iterFirst, keys.end(), upper, keaATTFloatLess);
+            for(std::vector<double>::const_iterator iterKey = iterFirst; iterKey < iterLast; ++iterKey)
+            {
+                fids->push_back(index->rows[iterKey - keys.begin()]);
+            }
+            std::sort(fids->begin(), fids->end());
+            return;
+        }
+        
+        size_t numRows = this->getSize();
+        size_t batchSize = std::max(this->getScanBlockSize(), (size_t)1) * KEA_ATT_SCAN_BLOCKS;
+        std::vector<double> floatVals;
+        for(size_t batchStart = 0; batchStart < numRows; batchStart += batchSize)
+        {
+            size_t batchLen = std::min(batchSize, numRows - batchStart);
+            floatVals.resize(batchLen);
+            this->getFloatFields(batchStart, batchLen, field.idx, &floatVals[0]);
+            for(size_t i = 0; i < batchLen; ++i)
+            {
+                if((floatVals[i] >= lower) && (floatVals[i] <= upper))
+                {
+                    fids->push_back(batchStart + i);
+                }
+            }
+        }
+    }
+    
+    /**
+     * Running aggregate of one value column within one group, merged
+     * between partials with the parallel variance formula.
+     */
+    struct KEAATTAggState
+    {
+        uint64_t count;
+        double mean;
+        double m2;
+        double minVal;
+        double maxVal;
+        // COMPENSATED (NEUMAIER) SUM OF A FLOAT COLUMN, sum + sumComp
+        double sum;
+        double sumComp;
+        int64_t intSum;
+        int64_t intMin;
+        int64_t intMax;
+    };
+    
+    struct KEAATTAggColumn
+    {
+        size_t colIdx;
+        bool isInt;
+        std::vector<int64_t> intVals;
+        std::vector<double> floatVals;
+    };
+    
+    template <typename K>
+    struct KEAATTAggBatch
+    {
+        size_t len;
+        std::vector<K> groups;
+        std::vector<KEAATTAggColumn> columns;
+    };
+    
+    template <typename K>
+    struct KEAATTAggGroup
+    {
+        uint64_t rows;
+        std::vector<KEAATTAggState> states;
+    };
+    
+    template <typename K>
+    struct KEAATTAggTask
+    {
+        const KEAATTAggBatch<K> *batch;
+        size_t start;
+        size_t len;
+        std::map<K, KEAATTAggGroup<K> > partials;
+    };
+    
+    static void keaATTAggInitState(KEAATTAggState *state)
+    {
+        state->count = 0;
+        state->mean = 0;
+        state->m2 = 0;
+        state->minVal = std::numeric_limits<double>::infinity();
+        state->maxVal = -std::numeric_limits<double>::infinity();
+        state->sum = 0;
+        state->sumComp = 0;
+        state->intSum = 0;
+        state->intMin = std::numeric_limits<int64_t>::max();
+        state->intMax = std::numeric_limits<int64_t>::min();
+    }
+    
+    static inline void keaATTAggAddValue(KEAATTAggState *state, double value)
+    {
+        state->count++;
+        double delta = value - state->mean;
+        state->mean += delta / state->count;
+        state->m2 += delta * (value - state->mean);
+        state->minVal = std::min(state->minVal, value);
+        state->maxVal = std::max(state->maxVal, value);
+    }
+    
+    static inline void keaATTAggAddSum(KEAATTAggState *state, double value)
+    {
+        // KEEP THE LOW ORDER BITS LOST BY EACH ADDITION
+        double total = state->sum + value;
+        if(fabs(state->sum) >= fabs(value))
+        {
+            state->sumComp += (state->sum - total) + value;
+        }
+        else
+        {
+            state->sumComp += (value - total) + state->sum;
+        }
+        state->sum = total;
+    }
+    
+    static void keaATTAggMergeState(KEAATTAggState *state, const KEAATTAggState &other)
+    {
+        if(other.count == 0)
+        {
+            return;
+        }
+        uint64_t count = state->count + other.count;
+        double delta = other.mean - state->mean;
+        state->m2 += other.m2 + ((delta * delta) * ((double)state->count * (double)other.count / count));
+        state->mean += delta * ((double)other.count / count);
+        state->count = count;
+        state->minVal = std::min(state->minVal, other.minVal);
+        state->maxVal = std::max(state->maxVal, other.maxVal);
+        keaATTAggAddSum(state, other.sum);
+        keaATTAggAddSum(state, other.sumComp);
+        state->intSum += other.intSum;
+        state->intMin = std::min(state->intMin, other.intMin);
+        state->intMax = std::max(state->intMax, other.intMax);
+    }
+    
+    template <typename K>
+    static void keaATTAggregateTask(void *arg)
+    {
+        KEAATTAggTask<K> *task = (KEAATTAggTask<K>*) arg;
+        const KEAATTAggBatch<K> *batch = task->batch;
+        size_t numCols = batch->columns.size();
+        typename std::map<K, KEAATTAggGroup<K> >::iterator iterGroup = task->partials.end();
+        for(size_t i = task->start; i < (task->start + task->len); ++i)
+        {
+            // RUNS OF THE SAME GROUP ARE COMMON SO AVOID THE LOOKUP FOR THEM
+            if((iterGroup == task->partials.end()) || ((*iterGroup).first != batch->groups[i]))
+            {
+                iterGroup = task->partials.find(batch->groups[i]);
+                if(iterGroup == task->partials.end())
+                {
+                    KEAATTAggGroup<K> group;
+                    group.rows = 0;
+                    group.states.resize(numCols);
+                    for(size_t c = 0; c < numCols; ++c)
+                    {
+                        keaATTAggInitState(&group.states[c]);
+                    }
+                    iterGroup = task->partials.insert(std::make_pair(batch->groups[i], group)).first;
+                }
+            }
+            
+            KEAATTAggGroup<K> &group = (*iterGroup).second;
+            group.rows++;
+            for(size_t c = 0; c < numCols; ++c)
+            {
+                const KEAATTAggColumn &column = batch->columns[c];
+                KEAATTAggState *state = &group.states[c];
+                if(column.isInt)
+                {
+                    int64_t value = column.intVals[i];
+                    keaATTAggAddValue(state, (double)value);
+                    state->intSum += value;
+                    state->intMin = std::min(state->intMin, value);
+                    state->intMax = std::max(state->intMax, value);
+                }
+                else if(column.floatVals[i] == column.floatVals[i])
+                {
+                    keaATTAggAddValue(state, column.floatVals[i]);
+                    keaATTAggAddSum(state, column.floatVals[i]);
+                }
+            }
+        }
+    }
+    
+    static void keaATTAggReadGroups(const KEAAttributeTable *att, const KEAATTField &field, size_t startfid, size_t len, std::vector<int64_t> *groups)
+    {
+        groups->resize(len);
+        if(field.dataType == kea_att_bool)
+        {
+            bool *boolVals = new bool[len];
+            att->getBoolFields(startfid, len, field.idx, boolVals);
+            for(size_t i = 0; i < len; ++i)
+            {
+                (*groups)[i] = boolVals[i]?1:0;
+            }
+            delete[] boolVals;
+        }
+        else
+        {
+            att->getIntFields(startfid, len, field.idx, &(*groups)[0]);
+        }
+    }
+    
+    static void keaATTAggReadGroups(const KEAAttributeTable *att, const KEAATTField &field, size_t startfid, size_t len, std::vector<std::string> *groups)
+    {
+        att->getStringFields(startfid, len, field.idx, groups);
+    }
+    
+    template <typename K>
+    static void keaATTAggReadBatch(const KEAAttributeTable *att, const KEAATTField &groupField, size_t startfid, size_t len, KEAATTAggBatch<K> *batch)
+    {
+        batch->len = len;
+        keaATTAggReadGroups(att, groupField, startfid, len, &batch->groups);
+        for(std::vector<KEAATTAggColumn>::iterator iterCol = batch->columns.begin(); iterCol != batch->columns.end(); ++iterCol)
+        {
+            if((*iterCol).isInt)
+            {
+                (*iterCol).intVals.resize(len);
+                att->getIntFields(startfid, len, (*iterCol).colIdx, &(*iterCol).intVals[0]);
+            }
+            else
+            {
+                (*iterCol).floatVals.resize(len);
+                att->getFloatFields(startfid, len, (*iterCol).colIdx, &(*iterCol).floatVals[0]);
+            }
+        }
+    }
+    
+    /**
+     * Streams the table through the aggregation. Batches are read on the calling
+     * thread (HDF5 is not thread safe) while the workers aggregate the previous
+     * batch, each into its own partials which are merged once the scan is done.
+     */
+    template <typename K>
+    static void keaATTAggregateScan(const KEAAttributeTable *att, const KEAATTField &groupField, const std::vector<KEAATTAggColumn> &columns, size_t batchSize, size_t numThreads, std::map<K, KEAATTAggGroup<K> > *groups)
+    {
+        size_t numRows = att->getSize();
+        KEAATTAggBatch<K> batches[2];
+        batches[0].columns = columns;
+        batches[1].columns = columns;
+        
+        std::vector<KEAATTAggTask<K> > tasks(numThreads);
+        // THE SAME WORKERS TAKE EVERY BATCH
+        KEAWorkerPool pool(numThreads);
+        size_t current = 0;
+        if(numRows > 0)
+        {
+            keaATTAggReadBatch(att, groupField, 0, std::min(batchSize, numRows), &batches[current]);
+        }
+        for(size_t batchStart = 0; batchStart < numRows; batchStart += batchSize)
+        {
+            // SPLIT THE BATCH BETWEEN THE WORKERS
+            const KEAATTAggBatch<K> &batch = batches[current];
+            size_t sliceLen = (batch.len + numThreads - 1) / numThreads;
+            for(size_t t = 0; t < numThreads; ++t)
+            {
+                tasks[t].batch = &batch;
+                tasks[t].start = std::min(t * sliceLen, batch.len);
+                tasks[t].len = std::min(sliceLen, batch.len - tasks[t].start);
+                if(tasks[t].len > 0)
+                {
+                    pool.submit(keaATTAggregateTask<K>, &tasks[t]);
+                }
+            }
+            
+            // READ THE NEXT BATCH WHILE THE WORKERS RUN
+            size_t nextStart = batchStart + batchSize;
+            if(nextStart < numRows)
+            {
+                keaATTAggReadBatch(att, groupField, nextStart, std::min(batchSize, numRows - nextStart), &batches[1 - current]);
+            }
+            pool.wait();
+            current = 1 - current;
+        }
+        
+        // MERGE THE PARTIALS
+        groups->clear();
+        for(typename std::vector<KEAATTAggTask<K> >::iterator iterTask = tasks.begin(); iterTask != tasks.end(); ++iterTask)
+        {
+            for(typename std::map<K, KEAATTAggGroup<K> >::iterator iterPart = (*iterTask).partials.begin(); iterPart != (*iterTask).partials.end(); ++iterPart)
+            {
+                typename std::map<K, KEAATTAggGroup<K> >::iterator iterGroup = groups->find((*iterPart).first);
+                if(iterGroup == groups->end())
+                {
+                    groups->insert(*iterPart);
+                }
+                else
+                {
+                    (*iterGroup).second.rows += (*iterPart).second.rows;
+                    for(size_t c = 0; c < columns.size(); ++c)
+                    {
+                        keaATTAggMergeState(&(*iterGroup).second.states[c], (*iterPart).second.states[c]);
+                    }
+                }
+            }
+        }
+    }
+    
+    static void keaATTAggWriteGroups(KEAAttributeTable *out, const KEAATTField &groupField, const std::map<int64_t, KEAATTAggGroup<int64_t> > &groups)
+    {
+        size_t numGroups = groups.size();
+        if(numGroups == 0)
+        {
+            if(groupField.dataType == kea_att_bool)
+            {
+                out->addAttBoolField(groupField.name, false, groupField.usage);
+            }
+            else
+            {
+                out->addAttIntField(groupField.name, 0, groupField.usage);
+            }
+        }
+        else if(groupField.dataType == kea_att_bool)
+        {
+            out->addAttBoolField(groupField.name, false, groupField.usage);
+            bool *boolVals = new bool[numGroups];
+            size_t i = 0;
+            for(std::map<int64_t, KEAATTAggGroup<int64_t> >::const_iterator iterGroup = groups.begin(); iterGroup != groups.end(); ++iterGroup)
+            {
+                boolVals[i++] = ((*iterGroup).first != 0);
+            }
+            out->setBoolFields(0, numGroups, out->getFieldIndex(groupField.name), boolVals);
+            delete[] boolVals;
+        }
+        else
+        {
+            out->addAttIntField(groupField.name, 0, groupField.usage);
+            std::vector<int64_t> intVals;
+            for(std::map<int64_t, KEAATTAggGroup<int64_t> >::const_iterator iterGroup = groups.begin(); iterGroup != groups.end(); ++iterGroup)
+            {
+                intVals.push_back((*iterGroup).first);
+            }
+            out->setIntFields(0, numGroups, out->getFieldIndex(groupField.name), &intVals[0]);
+        }
+    }
+    
+    static void keaATTAggWriteGroups(KEAAttributeTable *out, const KEAATTField &groupField, const std::map<std::string, KEAATTAggGroup<std::string> > &groups)
+    {
+        out->addAttStringField(groupField.name, "", groupField.usage);
+        if(groups.empty())
+        {
+            return;
+        }
+        std::vector<std::string> strVals;
+        for(std::map<std::string, KEAATTAggGroup<std::string> >::const_iterator iterGroup = groups.begin(); iterGroup != groups.end(); ++iterGroup)
+        {
+            strVals.push_back((*iterGroup).first);
+        }
+        out->setStringFields(0, groups.size(), out->getFieldIndex(groupField.name), &strVals);
+    }
+    
+    /**
+     * Fills the output table - the group column then a column per aggregate,
+     * named <column>_<op> (or count for a count without a column). Counts and
+     * the sum, min and max of int columns are int columns, the rest are float.
+     */
+    template <typename K>
+    static void keaATTAggWriteTable(KEAAttributeTable *out, const KEAATTField &groupField, const std::vector<KEAATTAggregate> &aggregates, const std::vector<size_t> &aggCols, const std::vector<KEAATTAggColumn> &columns, const std::map<K, KEAATTAggGroup<K> > &groups)
+    {
+        size_t numGroups = groups.size();
+        out->addRows(numGroups);
+        keaATTAggWriteGroups(out, groupField, groups);
+        
+        static const char *opNames[] = {"count", "sum", "mean", "min", "max", "stddev"};
+        std::vector<int64_t> intVals(numGroups);
+        std::vector<double> floatVals(numGroups);
+        for(size_t a = 0; a < aggregates.size(); ++a)
+        {
+            const KEAATTAggregate &aggregate = aggregates[a];
+            std::string name = opNames[aggregate.op];
+            if(aggregate.name != "")
+            {
+                name = aggregate.name + std::string("_") + name;
+            }
+            
+            bool isIntColumn = (aggCols[a] < columns.size()) && columns[aggCols[a]].isInt;
+            bool intOutput = (aggregate.op == kea_att_agg_count) || (isIntColumn && ((aggregate.op == kea_att_agg_sum) || (aggregate.op == kea_att_agg_min) || (aggregate.op == kea_att_agg_max)));
+            
+            size_t i = 0;
+            for(typename std::map<K, KEAATTAggGroup<K> >::const_iterator iterGroup = groups.begin(); iterGroup != groups.end(); ++iterGroup, ++i)
+            {
+                const KEAATTAggGroup<K> &group = (*iterGroup).second;
+                if(aggregate.op == kea_att_agg_count)
+                {
+                    // A COUNT OF A FLOAT COLUMN SKIPS ITS NANS
+                    intVals[i] = (aggCols[a] < columns.size())?group.states[aggCols[a]].count:group.rows;
+                    continue;
+                }
+                
+                const KEAATTAggState &state = group.states[aggCols[a]];
+                double nan = std::numeric_limits<double>::quiet_NaN();
+                switch(aggregate.op)
+                {
+                    case kea_att_agg_sum:
+                        intVals[i] = state.intSum;
+                        floatVals[i] = state.sum + state.sumComp;
+                        break;
+                    case kea_att_agg_mean:
+                        floatVals[i] = (state.count > 0)?state.mean:nan;
+                        break;
+                    case kea_att_agg_min:
+                        intVals[i] = state.intMin;
+                        floatVals[i] = (state.count > 0)?state.minVal:nan;
+                        break;
+                    case kea_att_agg_max:
+                        intVals[i] = state.intMax;
+                        floatVals[i] = (state.count > 0)?state.maxVal:nan;
+                        break;
+                    case kea_att_agg_stddev:
+                        // SAMPLE STANDARD DEVIATION
+                        floatVals[i] = (state.count > 1)?sqrt(state.m2 / (state.count - 1)):nan;
+                        break;
+                    default:
+                        break;
+                }
+            }
+            
+            if(intOutput)
+            {
+                out->addAttIntField(name, 0);
+                if(numGroups > 0)
+                {
+                    out->setIntFields(0, numGroups, out->getFieldIndex(name), &intVals[0]);
+                }
+            }
+            else
+            {
+                out->addAttFloatField(name, 0);
+                if(numGroups > 0)
+                {
+                    out->setFloatFields(0, numGroups, out->getFieldIndex(name), &floatVals[0]);
+                }
+            }
+        }
+    }
+    
+    template <typename K>
+    static KEAAttributeTable* keaATTAggregate(const KEAAttributeTable *att, const KEAATTField &groupField, const std::vector<KEAATTAggregate> &aggregates, const std::vector<size_t> &aggCols, const std::vector<KEAATTAggColumn> &columns, size_t batchSize, size_t numThreads)
+    {
+        std::map<K, KEAATTAggGroup<K> > groups;
+        keaATTAggregateScan(att, groupField, columns, batchSize, numThreads, &groups);
+        
+        KEAAttributeTable *out = new KEAAttributeTableInMem();
+        try
+        {
+            keaATTAggWriteTable(out, groupField, aggregates, aggCols, columns, groups);
+        }
+        catch(...)
+        {
+            delete out;
+            throw;
+        }
+        return out;
+    }
+    
+    KEAAttributeTable* KEAAttributeTable::aggregate(const std::string &groupName, const std::vector<KEAATTAggregate> &aggregates) const
+    {
+        KEAATTField groupField = this->getField(groupName);
+        if(groupField.dataType == kea_att_float)
+        {
+            std::string message = std::string("Field \'") + groupName + std::string("\' cannot be grouped on as it is a float column.");
+            throw KEAATTException(message);
+        }
+        
+        // EACH VALUE COLUMN IS READ ONCE HOWEVER MANY AGGREGATES USE IT
+        std::vector<KEAATTAggColumn> columns;
+        std::vector<size_t> aggCols;
+        std::map<std::string, size_t> colLookup;
+        for(std::vector<KEAATTAggregate>::const_iterator iterAgg = aggregates.begin(); iterAgg != aggregates.end(); ++iterAgg)
+        {
+            if(((*iterAgg).op < kea_att_agg_count) || ((*iterAgg).op > kea_att_agg_stddev))
+            {
+                throw KEAATTException("Unknown aggregate operation.");
+            }
+            if(((*iterAgg).op == kea_att_agg_count) && ((*iterAgg).name == ""))
+            {
+                aggCols.push_back(std::numeric_limits<size_t>::max());
+                continue;
+            }
+            
+            std::map<std::string, size_t>::iterator iterCol = colLookup.find((*iterAgg).name);
+            if(iterCol != colLookup.end())
+            {
+                aggCols.push_back((*iterCol).second);
+                continue;
+            }
+            
+            KEAATTField field = this->getField((*iterAgg).name);
+            if((field.dataType != kea_att_int) && (field.dataType != kea_att_float))
+            {
+                std::string message = std::string("Field \'") + (*iterAgg).name + std::string("\' cannot be aggregated as it is not an int or float column.");
+                throw KEAATTException(message);
+            }
+            KEAATTAggColumn column;
+            column.colIdx = field.idx;
+            column.isInt = (field.dataType == kea_att_int);
+            colLookup[(*iterAgg).name] = columns.size();
+            aggCols.push_back(columns.size());
+            columns.push_back(column);
+        }
+        
+        size_t numThreads = std::thread::hardware_concurrency();
+        if(numThreads == 0)
+        {
+            numThreads = 1;
+        }
+        // GIVE EACH WORKER A FULL SCAN'S WORTH OF ROWS PER BATCH
+        size_t batchSize = std::max(this->getScanBlockSize(), (size_t)1) * KEA_ATT_SCAN_BLOCKS * numThreads;
+        
+        if(groupField.dataType == kea_att_string)
+        {
+            return keaATTAggregate<std::string>(this, groupField, aggregates, aggCols, columns, batchSize, numThreads);
+        }
+        return keaATTAggregate<int64_t>(this, groupField, aggregates, aggCols, columns, batchSize, numThreads);
+    }
+    
+    /**
+     * A batch of rows with their neighbours, read by keaATTGraphScan() and split
+     * between the workers (rows start to start+len of the batch each).
+     */
+    struct KEAATTGraphBatch
+    {
+        size_t startfid;
+        size_t len;
+        std::vector<size_t> offsets;
+        std::vector<size_t> indices;
+    };
+    
+    struct KEAATTComponentTask
+    {
+        const KEAATTGraphBatch *batch;
+        size_t start;
+        size_t len;
+        size_t numRows;
+        const std::vector<bool> *selection;
+        std::atomic<size_t> *parent;
+    };
+    
+    struct KEAATTGrowTask
+    {
+        const KEAATTGraphBatch *batch;
+        size_t start;
+        size_t len;
+        size_t numRows;
+        size_t step;
+        const std::vector<bool> *selection;
+        std::atomic<size_t> *steps;
+        std::atomic<size_t> *labels;
+        std::vector<size_t> reached;
+    };
+    
+    struct KEAATTEdgeTask
+    {
+        const KEAATTGraphBatch *batch;
+        size_t start;
+        size_t len;
+        size_t numRows;
+        std::vector<std::pair<size_t, size_t> > edges;
+    };
+    
+    struct KEAATTMergeEdge
+    {
+        size_t region1;
+        size_t region2;
+        double cost;
+    };
+    
+    struct KEAATTMergeCostTask
+    {
+        const KEAATTMergeCriterion *criterion;
+        const std::vector<size_t> *recost;
+        std::vector<KEAATTMergeEdge> *edges;
+        size_t start;
+        size_t len;
+    };
+    
+    static size_t keaATTGraphThreads()
+    {
+        size_t numThreads = std::thread::hardware_concurrency();
+        if(numThreads == 0)
+        {
+            numThreads = 1;
+        }
+        return numThreads;
+    }
+    
+    static void keaATTReadGraphBatch(const KEAAttributeTable *att, const std::pair<size_t, size_t> &range, KEAATTGraphBatch *batch)
+    {
+        batch->startfid = range.first;
+        batch->len = range.second;
+        att->getNeighboursCSR(range.first, range.second, &batch->offsets, &batch->indices);
+    }
+    
+    /**
+     * Streams the neighbours of the ranges of rows through the task. As for the
+     * aggregation the batches are read on the calling thread while the workers
+     * of the caller's pool process the previous one, so only two batches are
+     * held at a time.
+     */
+    template <typename T>
+    static void keaATTGraphScan(const KEAAttributeTable *att, const std::vector<std::pair<size_t, size_t> > &ranges, KEAWorkerPool *pool, std::vector<T> *tasks, KEAWorkerJob taskFn)
+    {
+        if(ranges.empty())
+        {
+            return;
+        }
+        
+        KEAATTGraphBatch batches[2];
+        size_t numThreads = tasks->size();
+        try
+        {
+            size_t current = 0;
+            keaATTReadGraphBatch(att, ranges[0], &batches[current]);
+            for(size_t r = 0; r < ranges.size(); ++r)
+            {
+                const KEAATTGraphBatch &batch = batches[current];
+                size_t sliceLen = (batch.len + numThreads - 1) / numThreads;
+                for(size_t t = 0; t < numThreads; ++t)
+                {
+                    (*tasks)[t].batch = &batch;
+                    (*tasks)[t].start = std::min(t * sliceLen, batch.len);
+                    (*tasks)[t].len = std::min(sliceLen, batch.len - (*tasks)[t].start);
+                    if((*tasks)[t].len > 0)
+                    {
+                        pool->submit(taskFn, &(*tasks)[t]);
+                    }
+                }
+                
+                if((r + 1) < ranges.size())
+                {
+                    keaATTReadGraphBatch(att, ranges[r + 1], &batches[1 - current]);
+                }
+                pool->wait();
+                current = 1 - current;
+            }
+        }
+        catch(...)
+        {
+            // THE POOL OUTLIVES THE BATCHES SO LET THE JOBS USING THEM FINISH
+            try
+            {
+                pool->wait();
+            }
+            catch(...)
+            {
+            }
+            throw;
+        }
+    }
+    
+    static void keaATTGraphRanges(size_t numRows, size_t batchSize, std::vector<std::pair<size_t, size_t> > *ranges)
+    {
+        ranges->clear();
+        for(size_t batchStart = 0; batchStart < numRows; batchStart += batchSize)
+        {
+            ranges->push_back(std::make_pair(batchStart, std::min(batchSize, numRows - batchStart)));
+        }
+    }
+    
+    static size_t keaATTFindRoot(std::atomic<size_t> *parent, size_t fid)
+    {
+        // PATH HALVING, A ROW'S PARENT IS NEVER GREATER THAN THE ROW SO THE
+        // PARENTS ONLY EVER DECREASE AND A FAILED EXCHANGE CAN BE IGNORED
+        while(true)
+        {
+            size_t up = parent[fid].load();
+            if(up == fid)
+            {
+                return fid;
+            }
+            size_t upUp = parent[up].load();
+            if(upUp != up)
+            {
+                parent[fid].compare_exchange_weak(up, upUp);
+            }
+            fid = upUp;
+        }
+    }
+    
+    static void keaATTUnite(std::atomic<size_t> *parent, size_t fid1, size_t fid2)
+    {
+        while(true)
+        {
+            fid1 = keaATTFindRoot(parent, fid1);
+            fid2 = keaATTFindRoot(parent, fid2);
+            if(fid1 == fid2)
+            {
+                return;
+            }
+            // THE LOWER ROW BECOMES THE ROOT, SO A ROOT IS ITS COMPONENT'S FIRST ROW
+            if(fid1 < fid2)
+            {
+                std::swap(fid1, fid2);
+            }
+            size_t expected = fid1;
+            if(parent[fid1].compare_exchange_strong(expected, fid2))
+            {
+                return;
+            }
+        }
+    }
+    
+    static void keaATTComponentTask(void *arg)
+    {
+        KEAATTComponentTask *task = (KEAATTComponentTask*) arg;
+        const KEAATTGraphBatch *batch = task->batch;
+        for(size_t i = task->start; i < (task->start + task->len); ++i)
+        {
+            size_t fid = batch->startfid + i;
+            if(!(*task->selection)[fid])
+            {
+                continue;
+            }
+            for(size_t n = batch->offsets[i]; n < batch->offsets[i+1]; ++n)
+            {
+                size_t neighbour = batch->indices[n];
+                if((neighbour < task->numRows) && (neighbour != fid) && (*task->selection)[neighbour])
+                {
+                    keaATTUnite(task->parent, fid, neighbour);
+                }
+            }
+        }
+    }
+    
+    static void keaATTGrowTask(void *arg)
+    {
+        KEAATTGrowTask *task = (KEAATTGrowTask*) arg;
+        const KEAATTGraphBatch *batch = task->batch;
+        for(size_t i = task->start; i < (task->start + task->len); ++i)
+        {
+            size_t fid = batch->startfid + i;
+            if(task->steps[fid].load() != task->step)
+            {
+                continue;
+            }
+            size_t label = task->labels[fid].load();
+            for(size_t n = batch->offsets[i]; n < batch->offsets[i+1]; ++n)
+            {
+                size_t neighbour = batch->indices[n];
+                if((neighbour >= task->numRows) || !(*task->selection)[neighbour])
+                {
+                    continue;
+                }
+                size_t expected = KEA_ATT_NO_LABEL;
+                if(task->steps[neighbour].compare_exchange_strong(expected, task->step + 1))
+                {
+                    task->reached.push_back(neighbour);
+                }
+                else if(expected != (task->step + 1))
+                {
+                    continue;
+                }
+                
+                // A ROW REACHED FROM SEVERAL SEEDS IN ONE STEP TAKES THE FIRST
+                size_t current = task->labels[neighbour].load();
+                while((label < current) && !task->labels[neighbour].compare_exchange_weak(current, label))
+                {
+                }
+            }
+        }
+    }
+    
+    static void keaATTEdgeTask(void *arg)
+    {
+        KEAATTEdgeTask *task = (KEAATTEdgeTask*) arg;
+        const KEAATTGraphBatch *batch = task->batch;
+        for(size_t i = task->start; i < (task->start + task->len); ++i)
+        {
+            size_t fid = batch->startfid + i;
+            for(size_t n = batch->offsets[i]; n < batch->offsets[i+1]; ++n)
+            {
+                size_t neighbour = batch->indices[n];
+                if((neighbour < task->numRows) && (neighbour != fid))
+                {
+                    task->edges.push_back(std::make_pair(std::min(fid, neighbour), std::max(fid, neighbour)));
+                }
+            }
+        }
+    }
+    
+    static void keaATTMergeCostTask(void *arg)
+    {
+        KEAATTMergeCostTask *task = (KEAATTMergeCostTask*) arg;
+        for(size_t i = task->start; i < (task->start + task->len); ++i)
+        {
+            KEAATTMergeEdge &edge = (*task->edges)[(*task->recost)[i]];
+            edge.cost = task->criterion->cost(edge.region1, edge.region2);
+        }
+    }
+    
+    static const size_t KEA_ATT_MERGE_COSTS_PER_THREAD = 16384;
+    
+    template <typename T>
+    static void keaATTSortUnique(std::vector<T> *vals)
+    {
+        std::sort(vals->begin(), vals->end());
+        vals->erase(std::unique(vals->begin(), vals->end()), vals->end());
+    }
+    
+    static bool keaATTMergeEdgeLess(const KEAATTMergeEdge &edge1, const KEAATTMergeEdge &edge2)
+    {
+        return (edge1.region1 < edge2.region1) || ((edge1.region1 == edge2.region1) && (edge1.region2 < edge2.region2));
+    }
+    
+    static bool keaATTMergeEdgeEqual(const KEAATTMergeEdge &edge1, const KEAATTMergeEdge &edge2)
+    {
+        return (edge1.region1 == edge2.region1) && (edge1.region2 == edge2.region2);
+    }
+    
+    static void keaATTMergeCosts(const KEAATTMergeCriterion *criterion, const std::vector<size_t> &recost, std::vector<KEAATTMergeEdge> *edges, KEAWorkerPool *pool)
+    {
+        // LATER ROUNDS ONLY RECOST A FEW EDGES, NOT WORTH HANDING TO THE WORKERS
+        size_t numThreads = std::max(std::min(pool->getNumThreads(), recost.size() / KEA_ATT_MERGE_COSTS_PER_THREAD), (size_t)1);
+        std::vector<KEAATTMergeCostTask> tasks(numThreads);
+        size_t sliceLen = (recost.size() + numThreads - 1) / numThreads;
+        try
+        {
+            for(size_t t = 0; t < numThreads; ++t)
+            {
+                tasks[t].criterion = criterion;
+                tasks[t].recost = &recost;
+                tasks[t].edges = edges;
+                tasks[t].start = std::min(t * sliceLen, recost.size());
+                tasks[t].len = std::min(sliceLen, recost.size() - tasks[t].start);
+                if(numThreads == 1)
+                {
+                    keaATTMergeCostTask(&tasks[t]);
+                }
+                else if(tasks[t].len > 0)
+                {
+                    pool->submit(keaATTMergeCostTask, &tasks[t]);
+                }
+            }
+        }
+        catch(...)
+        {
+            try
+            {
+                pool->wait();
+            }
+            catch(...)
+            {
+            }
+            throw;
+        }
+        pool->wait();
+    }
+    
+    static size_t keaATTFindRegion(std::vector<size_t> *parent, size_t fid)
+    {
+        size_t root = fid;
+        while((*parent)[root] != root)
+        {
+            root = (*parent)[root];
+        }
+        while((*parent)[fid] != root)
+        {
+            size_t up = (*parent)[fid];
+            (*parent)[fid] = root;
+            fid = up;
+        }
+        return root;
+    }
+    
+    void KEAAttributeTable::selectGraphRows(const std::vector<KEAATTPredicate> &predicates, std::vector<bool> *selection) const
+    {
+        if(predicates.empty())
+        {
+            selection->assign(this->getSize(), true);
+        }
+        else
+        {
+            this->selectRows(predicates, selection);
+        }
+    }
+    
+    size_t KEAAttributeTable::findComponents(const std::vector<KEAATTPredicate> &predicates, std::vector<size_t> *labels) const
+    {
+        size_t numRows = this->getSize();
+        std::vector<bool> selection;
+        this->selectGraphRows(predicates, &selection);
+        
+        size_t numThreads = keaATTGraphThreads();
+        size_t batchSize = std::max(this->getScanBlockSize(), (size_t)1) * KEA_ATT_SCAN_BLOCKS * numThreads;
+        std::vector<std::pair<size_t, size_t> > ranges;
+        keaATTGraphRanges(numRows, batchSize, &ranges);
+        
+        std::atomic<size_t> *parent = new std::atomic<size_t>[numRows];
+        size_t numLabels = 0;
+        try
+        {
+            for(size_t i = 0; i < numRows; ++i)
+            {
+                parent[i].store(i);
+            }
+            std::vector<KEAATTComponentTask> tasks(numThreads);
+            for(std::vector<KEAATTComponentTask>::iterator iterTask = tasks.begin(); iterTask != tasks.end(); ++iterTask)
+            {
+                (*iterTask).numRows = numRows;
+                (*iterTask).selection = &selection;
+                (*iterTask).parent = parent;
+            }
+            KEAWorkerPool pool(numThreads);
+            keaATTGraphScan(this, ranges, &pool, &tasks, keaATTComponentTask);
+            
+            // A COMPONENT'S ROOT IS ITS FIRST ROW SO IS LABELLED BEFORE THE REST
+            labels->assign(numRows, KEA_ATT_NO_LABEL);
+            for(size_t i = 0; i < numRows; ++i)
+            {
+                if(selection[i])
+                {
+                    size_t root = keaATTFindRoot(parent, i);
+                    (*labels)[i] = (root == i)?numLabels++:(*labels)[root];
+                }
+            }
+        }
+        catch(...)
+        {
+            delete[] parent;
+            throw;
+        }
+        delete[] parent;
+        return numLabels;
+    }
+    
+    size_t KEAAttributeTable::growRegions(const std::vector<size_t> &seeds, const std::vector<KEAATTPredicate> &predicates, size_t maxSteps, std::vector<size_t> *labels) const
+    {
+        size_t numRows = this->getSize();
+        for(std::vector<size_t>::const_iterator iterSeed = seeds.begin(); iterSeed != seeds.end(); ++iterSeed)
+        {
+            if((*iterSeed) >= numRows)
+            {
+                std::string message = std::string("Seed (") + sizet2Str(*iterSeed) + std::string(") is not within the table.");
+                throw KEAATTException(message);
+            }
+        }
+        std::vector<bool> selection;
+        this->selectGraphRows(predicates, &selection);
+        
+        size_t numThreads = keaATTGraphThreads();
+        size_t blockSize = std::max(this->getScanBlockSize(), (size_t)1);
+        size_t batchSize = blockSize * KEA_ATT_SCAN_BLOCKS * numThreads;
+        
+        std::atomic<size_t> *steps = new std::atomic<size_t>[numRows];
+        std::atomic<size_t> *rowLabels = new std::atomic<size_t>[numRows];
+        size_t numReached = 0;
+        try
+        {
+            for(size_t i = 0; i < numRows; ++i)
+            {
+                steps[i].store(KEA_ATT_NO_LABEL);
+                rowLabels[i].store(KEA_ATT_NO_LABEL);
+            }
+            std::vector<size_t> frontier;
+            for(size_t s = 0; s < seeds.size(); ++s)
+            {
+                if(steps[seeds[s]].load() == KEA_ATT_NO_LABEL)
+                {
+                    steps[seeds[s]].store(0);
+                    rowLabels[seeds[s]].store(s);
+                    frontier.push_back(seeds[s]);
+                }
+            }
+            
+            std::vector<KEAATTGrowTask> tasks(numThreads);
+            for(std::vector<KEAATTGrowTask>::iterator iterTask = tasks.begin(); iterTask != tasks.end(); ++iterTask)
+            {
+                (*iterTask).numRows = numRows;
+                (*iterTask).selection = &selection;
+                (*iterTask).steps = steps;
+                (*iterTask).labels = rowLabels;
+            }
+            // EVERY STEP IS SCANNED BY THE SAME WORKERS
+            KEAWorkerPool pool(numThreads);
+            std::vector<std::pair<size_t, size_t> > ranges;
+            for(size_t step = 0; !frontier.empty(); ++step)
+            {
+                numReached += frontier.size();
+                if((maxSteps > 0) && (step == maxSteps))
+                {
+                    break;
+                }
+                
+                // ONLY READ THE BLOCKS HOLDING THE FRONTIER, RUNS OF THEM TOGETHER
+                std::sort(frontier.begin(), frontier.end());
+                ranges.clear();
+                size_t i = 0;
+                while(i < frontier.size())
+                {
+                    size_t rangeStart = (frontier[i] / blockSize) * blockSize;
+                    size_t rangeEnd = rangeStart;
+                    while((i < frontier.size()) && (frontier[i] < (rangeStart + batchSize)) && (((frontier[i] / blockSize) * blockSize) <= rangeEnd))
+                    {
+                        rangeEnd = std::min(((frontier[i] / blockSize) + 1) * blockSize, numRows);
+                        ++i;
+                    }
+                    ranges.push_back(std::make_pair(rangeStart, rangeEnd - rangeStart));
+                }
+                
+                for(std::vector<KEAATTGrowTask>::iterator iterTask = tasks.begin(); iterTask != tasks.end(); ++iterTask)
+                {
+                    (*iterTask).step = step;
+                    (*iterTask).reached.clear();
+                }
+                keaATTGraphScan(this, ranges, &pool, &tasks, keaATTGrowTask);
+                
+                frontier.clear();
+                for(std::vector<KEAATTGrowTask>::iterator iterTask = tasks.begin(); iterTask != tasks.end(); ++iterTask)
+                {
+                    frontier.insert(frontier.end(), (*iterTask).reached.begin(), (*iterTask).reached.end());
+                }
+            }
+            
+            labels->resize(numRows);
+            for(size_t i = 0; i < numRows; ++i)
+            {
+                (*labels)[i] = rowLabels[i].load();
+            }
+        }
+        catch(...)
+        {
+            delete[] steps;
+            delete[] rowLabels;
+            throw;
+        }
+        delete[] steps;
+        delete[] rowLabels;
+        return numReached;
+    }
+    
+    size_t KEAAttributeTable::mergeRegions(KEAATTMergeCriterion *criterion, double maxCost, std::vector<size_t> *labels) const
+    {
+        size_t numRows = this->getSize();
+        size_t numThreads = keaATTGraphThreads();
+        size_t batchSize = std::max(this->getScanBlockSize(), (size_t)1) * KEA_ATT_SCAN_BLOCKS * numThreads;
+        std::vector<std::pair<size_t, size_t> > ranges;
+        keaATTGraphRanges(numRows, batchSize, &ranges);
+        // THE SAME WORKERS FIND THE EDGES AND COST THEM IN EVERY ROUND
+        KEAWorkerPool pool(numThreads);
+        
+        // THE ADJACENCY OF THE REGIONS, EACH EDGE ONCE AS (LOWER, HIGHER) REGION
+        std::vector<KEAATTMergeEdge> edges;
+        {
+            std::vector<std::pair<size_t, size_t> > rowEdges;
+            std::vector<KEAATTEdgeTask> tasks(numThreads);
+            for(std::vector<KEAATTEdgeTask>::iterator iterTask = tasks.begin(); iterTask != tasks.end(); ++iterTask)
+            {
+                (*iterTask).numRows = numRows;
+            }
+            keaATTGraphScan(this, ranges, &pool, &tasks, keaATTEdgeTask);
+            for(std::vector<KEAATTEdgeTask>::iterator iterTask = tasks.begin(); iterTask != tasks.end(); ++iterTask)
+            {
+                rowEdges.insert(rowEdges.end(), (*iterTask).edges.begin(), (*iterTask).edges.end());
+                std::vector<std::pair<size_t, size_t> >().swap((*iterTask).edges);
+            }
+            keaATTSortUnique(&rowEdges);
+            edges.resize(rowEdges.size());
+            for(size_t e = 0; e < rowEdges.size(); ++e)
+            {
+                edges[e].region1 = rowEdges[e].first;
+                edges[e].region2 = rowEdges[e].second;
+            }
+        }
+        
+        std::vector<size_t> recost(edges.size());
+        for(size_t e = 0; e < edges.size(); ++e)
+        {
+            recost[e] = e;
+        }
+        std::vector<size_t> parent(numRows);
+        for(size_t i = 0; i < numRows; ++i)
+        {
+            parent[i] = i;
+        }
+        std::vector<size_t> bestEdge(numRows, KEA_ATT_NO_LABEL);
+        std::vector<size_t> mergedRound(numRows, 0);
+        std::vector<KEAATTMergeEdge> moved;
+        for(size_t round = 1; !edges.empty(); ++round)
+        {
+            keaATTMergeCosts(criterion, recost, &edges, &pool);
+            
+            // EACH REGION'S CHEAPEST EDGE, TIES GOING TO THE EARLIER EDGE SO THE
+            // CHEAPEST EDGE OVERALL IS ALWAYS THE CHEAPEST FOR BOTH ITS REGIONS
+            for(std::vector<KEAATTMergeEdge>::iterator iterEdge = edges.begin(); iterEdge != edges.end(); ++iterEdge)
+            {
+                bestEdge[(*iterEdge).region1] = KEA_ATT_NO_LABEL;
+                bestEdge[(*iterEdge).region2] = KEA_ATT_NO_LABEL;
+            }
+            for(size_t e = 0; e < edges.size(); ++e)
+            {
+                double cost = edges[e].cost;
+                if(!(cost <= maxCost))
+                {
+                    continue;
+                }
+                size_t best = bestEdge[edges[e].region1];
+                if((best == KEA_ATT_NO_LABEL) || (cost < edges[best].cost))
+                {
+                    bestEdge[edges[e].region1] = e;
+                }
+                best = bestEdge[edges[e].region2];
+                if((best == KEA_ATT_NO_LABEL) || (cost < edges[best].cost))
+                {
+                    bestEdge[edges[e].region2] = e;
+                }
+            }
+            
+            // MERGE THE PAIRS WHICH ARE EACH OTHER'S CHEAPEST, INTO THE LOWER REGION
+            size_t numMerged = 0;
+            for(size_t e = 0; e < edges.size(); ++e)
+            {
+                size_t region1 = edges[e].region1;
+                size_t region2 = edges[e].region2;
+                if((bestEdge[region1] == e) && (bestEdge[region2] == e))
+                {
+                    criterion->merge(region1, region2);
+                    parent[region2] = region1;
+                    mergedRound[region1] = round;
+                    mergedRound[region2] = round;
+                    ++numMerged;
+                }
+            }
+            if(numMerged == 0)
+            {
+                break;
+            }
+            
+            // ONLY THE EDGES OF THE MERGED REGIONS CHANGE, THE REST STAY IN ORDER
+            // SO ONLY THE MOVED EDGES NEED SORTING BEFORE THE TWO ARE MERGED
+            moved.clear();
+            size_t numKept = 0;
+            for(std::vector<KEAATTMergeEdge>::iterator iterEdge = edges.begin(); iterEdge != edges.end(); ++iterEdge)
+            {
+                if((mergedRound[(*iterEdge).region1] != round) && (mergedRound[(*iterEdge).region2] != round))
+                {
+                    edges[numKept++] = *iterEdge;
+                    continue;
+                }
+                size_t region1 = parent[(*iterEdge).region1];
+                size_t region2 = parent[(*iterEdge).region2];
+                if(region1 != region2)
+                {
+                    KEAATTMergeEdge edge;
+                    edge.region1 = std::min(region1, region2);
+                    edge.region2 = std::max(region1, region2);
+                    moved.push_back(edge);
+                }
+            }
+            std::sort(moved.begin(), moved.end(), keaATTMergeEdgeLess);
+            moved.erase(std::unique(moved.begin(), moved.end(), keaATTMergeEdgeEqual), moved.end());
+            edges.resize(numKept);
+            edges.insert(edges.end(), moved.begin(), moved.end());
+            std::inplace_merge(edges.begin(), edges.begin() + numKept, edges.end(), keaATTMergeEdgeLess);
+            
+            recost.clear();
+            for(size_t e = 0; e < edges.size(); ++e)
+            {
+                if((mergedRound[edges[e].region1] == round) || (mergedRound[edges[e].region2] == round))
+                {
+                    recost.push_back(e);
+                }
+            }
+        }
+        
+        size_t numLabels = 0;
+        labels->assign(numRows, KEA_ATT_NO_LABEL);
+        for(size_t i = 0; i < numRows; ++i)
+        {
+            size_t root = keaATTFindRegion(&parent, i);
+            (*labels)[i] = (root == i)?numLabels++:(*labels)[root];
+        }
+        return numLabels;
+    }
+    
     KEAFieldDataType KEAAttributeTable::getDataFieldType(const std::string &name) const
     {
         std::map<std::string, KEAATTField>::iterator iterField = fields->find(name);
@@ -521,7 +2995,7 @@ namespace kealib{
         delete feat;
     }
     
-    void KEAAttributeTable::exportToASCII(const std::string &outputFile)
+    void KEAAttributeTable::exportToASCII(const std::string &/*outputFile*/)
     {
         
     }
@@ -695,6 +3169,435 @@ namespace kealib{
         delete fields;
     }
 
+    size_t KEAAttributeTable::readATTHeaderColumn(H5::H5File *keaImg, const std::string &path, const H5::DataType &memType, size_t n, void *vals, H5::DSetMemXferPropList *xfer)
+    {
+        // OPTIONAL HEADERS - NOTHING IS READ IF THE DATASET IS NOT PRESENT
+        if((n == 0) || (H5Lexists(keaImg->getId(), path.c_str(), H5P_DEFAULT) <= 0))
+        {
+            return 0;
+        }
+        
+        H5::DataSet headerDataset = keaImg->openDataSet(path);
+        H5::DataSpace headerDataspace = headerDataset.getSpace();
+        hsize_t headerDims[1];
+        headerDataspace.getSimpleExtentDims(headerDims);
+        hsize_t headerCount[1];
+        headerCount[0] = std::min((hsize_t)n, headerDims[0]);
+        if(headerCount[0] > 0)
+        {
+            hsize_t headerOffset[1];
+            headerOffset[0] = 0;
+            headerDataspace.selectHyperslab(H5S_SELECT_SET, headerCount, headerOffset);
+            H5::DataSpace headerMemspace = H5::DataSpace(1, headerCount);
+            if(xfer != NULL)
+            {
+                headerDataset.read(vals, memType, headerMemspace, headerDataspace, *xfer);
+            }
+            else
+            {
+                headerDataset.read(vals, memType, headerMemspace, headerDataspace);
+            }
+            headerMemspace.close();
+        }
+        headerDataspace.close();
+        headerDataset.close();
+        
+        return headerCount[0];
+    }
+    
+    void KEAAttributeTable::writeATTHeaderColumn(H5::H5File *keaImg, const std::string &path, const H5::DataType &diskType, const H5::DataType &memType, size_t n, const void *vals, unsigned int chunkSize, unsigned int deflate)
+    {
+        if(n == 0)
+        {
+            return;
+        }
+        
+        hsize_t headerDims[1];
+        headerDims[0] = n;
+        H5::DataSet headerDataset;
+        if(H5Lexists(keaImg->getId(), path.c_str(), H5P_DEFAULT) > 0)
+        {
+            headerDataset = keaImg->openDataSet(path);
+            H5::DataSpace dimsDataspace = headerDataset.getSpace();
+            hsize_t dataDims[1];
+            dimsDataspace.getSimpleExtentDims(dataDims);
+            if(dataDims[0] < headerDims[0])
+            {
+                headerDataset.extend(headerDims);
+            }
+            dimsDataspace.close();
+        }
+        else
+        {
+            hsize_t maxHeaderDims[1];
+            maxHeaderDims[0] = H5S_UNLIMITED;
+            H5::DataSpace headerCreateDataspace = H5::DataSpace(1, headerDims, maxHeaderDims);
+            
+            hsize_t dimsHeaderChunk[1];
+            dimsHeaderChunk[0] = chunkSize;
+            H5::DSetCreatPropList creationHeaderDSPList;
+            creationHeaderDSPList.setChunk(1, dimsHeaderChunk);
+            creationHeaderDSPList.setShuffle();
+            creationHeaderDSPList.setDeflate(deflate);
+            headerDataset = keaImg->createDataSet(path, diskType, headerCreateDataspace, creationHeaderDSPList);
+            headerCreateDataspace.close();
+        }
+        
+        hsize_t headerOffset[1];
+        headerOffset[0] = 0;
+        H5::DataSpace headerWriteDataspace = headerDataset.getSpace();
+        headerWriteDataspace.selectHyperslab(H5S_SELECT_SET, headerDims, headerOffset);
+        H5::DataSpace headerMemspace = H5::DataSpace(1, headerDims);
+        headerDataset.write(vals, memType, headerMemspace, headerWriteDataspace);
+        headerMemspace.close();
+        headerWriteDataspace.close();
+        headerDataset.close();
+    }
+    
+    void KEAAttributeTable::getNeighboursCSR(size_t startfid, size_t len, std::vector<size_t> *offsets, std::vector<size_t> *indices) const
+    {
+        std::vector<std::vector<size_t>* > neighbours;
+        try
+        {
+            this->getNeighbours(startfid, len, &neighbours);
+            
+            offsets->assign(1, 0);
+            offsets->reserve(len + 1);
+            indices->clear();
+            for(std::vector<std::vector<size_t>* >::iterator iterNeigh = neighbours.begin(); iterNeigh != neighbours.end(); ++iterNeigh)
+            {
+                indices->insert(indices->end(), (*iterNeigh)->begin(), (*iterNeigh)->end());
+                offsets->push_back(indices->size());
+            }
+        }
+        catch(...)
+        {
+            for(std::vector<std::vector<size_t>* >::iterator iterNeigh = neighbours.begin(); iterNeigh != neighbours.end(); ++iterNeigh)
+            {
+                delete *iterNeigh;
+            }
+            throw;
+        }
+        for(std::vector<std::vector<size_t>* >::iterator iterNeigh = neighbours.begin(); iterNeigh != neighbours.end(); ++iterNeigh)
+        {
+            delete *iterNeigh;
+        }
+    }
+    
+    void KEAAttributeTable::setNeighboursCSR(size_t startfid, size_t len, const size_t *offsets, const size_t *indices)
+    {
+        std::vector<std::vector<size_t>* > neighbours;
+        try
+        {
+            neighbours.reserve(len);
+            for(size_t i = 0; i < len; ++i)
+            {
+                neighbours.push_back(new std::vector<size_t>(indices + offsets[i], indices + offsets[i+1]));
+            }
+            this->setNeighbours(startfid, len, &neighbours);
+        }
+        catch(...)
+        {
+            for(std::vector<std::vector<size_t>* >::iterator iterNeigh = neighbours.begin(); iterNeigh != neighbours.end(); ++iterNeigh)
+            {
+                delete *iterNeigh;
+            }
+            throw;
+        }
+        for(std::vector<std::vector<size_t>* >::iterator iterNeigh = neighbours.begin(); iterNeigh != neighbours.end(); ++iterNeigh)
+        {
+            delete *iterNeigh;
+        }
+    }
+    
+    KEAATTNeighboursLayout KEAAttributeTable::readNeighboursLayout(H5::H5File *keaImg, const std::string &bandPathBase)
+    {
+        std::string offsetsPath = bandPathBase + KEA_ATT_NEIGHBOURS_OFFSETS_DATA;
+        if(H5Lexists(keaImg->getId(), offsetsPath.c_str(), H5P_DEFAULT) > 0)
+        {
+            return kea_att_neighbours_csr;
+        }
+        return kea_att_neighbours_varlen;
+    }
+    
+    void KEAAttributeTable::readNeighboursCSR(H5::H5File *keaImg, const std::string &bandPathBase, KEAATTNeighboursLayout layout, size_t startfid, size_t len, std::vector<size_t> *offsets, std::vector<size_t> *indices)
+    {
+        offsets->assign(len + 1, 0);
+        indices->clear();
+        if(len == 0)
+        {
+            return;
+        }
+        
+        if(layout == kea_att_neighbours_csr)
+        {
+            H5::DataSet offsetsDataset = keaImg->openDataSet(bandPathBase + KEA_ATT_NEIGHBOURS_OFFSETS_DATA);
+            H5::DataSpace offsetsDataspace = offsetsDataset.getSpace();
+            hsize_t offsetsDims[1];
+            offsetsDataspace.getSimpleExtentDims(offsetsDims);
+            if((startfid + len + 1) > offsetsDims[0])
+            {
+                throw KEAIOException("The number of features in neighbours offsets dataset smaller than expected.");
+            }
+            hsize_t offsetsOffset[1];
+            offsetsOffset[0] = startfid;
+            hsize_t offsetsCount[1];
+            offsetsCount[0] = len + 1;
+            offsetsDataspace.selectHyperslab(H5S_SELECT_SET, offsetsCount, offsetsOffset);
+            H5::DataSpace offsetsMemspace(1, offsetsCount);
+            offsetsDataset.read(&(*offsets)[0], H5::PredType::NATIVE_HSIZE, offsetsMemspace, offsetsDataspace);
+            offsetsMemspace.close();
+            offsetsDataspace.close();
+            offsetsDataset.close();
+            
+            // OFFSETS ARE RETURNED RELATIVE TO THE FIRST ROW READ
+            size_t firstIndex = (*offsets)[0];
+            for(size_t i = 0; i <= len; ++i)
+            {
+                if(((*offsets)[i] < firstIndex) || ((i > 0) && ((*offsets)[i] < (*offsets)[i-1])))
+                {
+                    throw KEAIOException("The neighbours offsets are not in order.");
+                }
+                (*offsets)[i] -= firstIndex;
+            }
+            
+            size_t numIndices = (*offsets)[len];
+            if(numIndices > 0)
+            {
+                H5::DataSet indicesDataset = keaImg->openDataSet(bandPathBase + KEA_ATT_NEIGHBOURS_INDICES_DATA);
+                H5::DataSpace indicesDataspace = indicesDataset.getSpace();
+                hsize_t indicesDims[1];
+                indicesDataspace.getSimpleExtentDims(indicesDims);
+                if((firstIndex + numIndices) > indicesDims[0])
+                {
+                    throw KEAIOException("The neighbours offsets are beyond the end of the indices dataset.");
+                }
+                indices->resize(numIndices);
+                hsize_t indicesOffset[1];
+                indicesOffset[0] = firstIndex;
+                hsize_t indicesCount[1];
+                indicesCount[0] = numIndices;
+                indicesDataspace.selectHyperslab(H5S_SELECT_SET, indicesCount, indicesOffset);
+                H5::DataSpace indicesMemspace(1, indicesCount);
+                indicesDataset.read(&(*indices)[0], H5::PredType::NATIVE_HSIZE, indicesMemspace, indicesDataspace);
+                indicesMemspace.close();
+                indicesDataspace.close();
+                indicesDataset.close();
+            }
+        }
+        else
+        {
+            // A TABLE WHOSE NEIGHBOURS HAVE NEVER BEEN WRITTEN HAS NONE
+            std::string neighboursPath = bandPathBase + KEA_ATT_NEIGHBOURS_DATA;
+            if(H5Lexists(keaImg->getId(), neighboursPath.c_str(), H5P_DEFAULT) <= 0)
+            {
+                return;
+            }
+            H5::DataSet neighboursDataset = keaImg->openDataSet(neighboursPath);
+            H5::DataSpace neighboursDataspace = neighboursDataset.getSpace();
+            if(neighboursDataspace.getSimpleExtentNdims() != 1)
+            {
+                throw KEAIOException("The neighbours datasets needs to have 1 dimension.");
+            }
+            hsize_t neighboursDims[1];
+            neighboursDataspace.getSimpleExtentDims(neighboursDims);
+            
+            // ROWS PAST THE END OF THE DATASET HAVE NEVER BEEN WRITTEN SO HAVE NONE
+            if(startfid >= neighboursDims[0])
+            {
+                return;
+            }
+            size_t numStored = std::min(len, (size_t)(neighboursDims[0] - startfid));
+            
+            hsize_t neighboursOffset[1];
+            neighboursOffset[0] = startfid;
+            hsize_t neighboursCount[1];
+            neighboursCount[0] = numStored;
+            neighboursDataspace.selectHyperslab(H5S_SELECT_SET, neighboursCount, neighboursOffset);
+            H5::DataSpace neighboursMemspace(1, neighboursCount);
+            H5::DataType intVarLenMemDT = H5::VarLenType(&H5::PredType::NATIVE_HSIZE);
+            VarLenFieldHDF *neighbourVals = new VarLenFieldHDF[numStored];
+            try
+            {
+                neighboursDataset.read(neighbourVals, intVarLenMemDT, neighboursMemspace, neighboursDataspace);
+            }
+            catch(H5::Exception &e)
+            {
+                delete[] neighbourVals;
+                throw;
+            }
+            
+            size_t numIndices = 0;
+            for(size_t i = 0; i < len; ++i)
+            {
+                if(i < numStored)
+                {
+                    numIndices += neighbourVals[i].length;
+                }
+                (*offsets)[i+1] = numIndices;
+            }
+            indices->resize(numIndices);
+            for(size_t i = 0; i < numStored; ++i)
+            {
+                if(neighbourVals[i].length > 0)
+                {
+                    memcpy(&(*indices)[(*offsets)[i]], neighbourVals[i].p, neighbourVals[i].length * sizeof(hsize_t));
+                }
+            }
+            H5::DataSet::vlenReclaim(neighbourVals, intVarLenMemDT, neighboursMemspace);
+            delete[] neighbourVals;
+            neighboursMemspace.close();
+            neighboursDataspace.close();
+            neighboursDataset.close();
+        }
+    }
+    
+    void KEAAttributeTable::createNeighboursCSR(H5::H5File *keaImg, const std::string &bandPathBase, size_t numRows, unsigned int chunkSize, unsigned int deflate)
+    {
+        std::string offsetsPath = bandPathBase + KEA_ATT_NEIGHBOURS_OFFSETS_DATA;
+        std::string indicesPath = bandPathBase + KEA_ATT_NEIGHBOURS_INDICES_DATA;
+        if(H5Lexists(keaImg->getId(), offsetsPath.c_str(), H5P_DEFAULT) > 0)
+        {
+            H5Ldelete(keaImg->getId(), offsetsPath.c_str(), H5P_DEFAULT);
+        }
+        if(H5Lexists(keaImg->getId(), indicesPath.c_str(), H5P_DEFAULT) > 0)
+        {
+            H5Ldelete(keaImg->getId(), indicesPath.c_str(), H5P_DEFAULT);
+        }
+        
+        // AN OFFSET PER ROW PLUS THE END, ALL ZERO (NO NEIGHBOURS) UNTIL WRITTEN
+        hsize_t offsetsDims[1];
+        offsetsDims[0] = numRows + 1;
+        hsize_t maxOffsetsDims[1];
+        maxOffsetsDims[0] = H5S_UNLIMITED;
+        H5::DataSpace offsetsDataspace = H5::DataSpace(1, offsetsDims, maxOffsetsDims);
+        hsize_t dimsOffsetsChunk[1];
+        dimsOffsetsChunk[0] = chunkSize;
+        hsize_t offsetsFill = 0;
+        H5::DSetCreatPropList creationOffsetsDSPList;
+        creationOffsetsDSPList.setChunk(1, dimsOffsetsChunk);
+        creationOffsetsDSPList.setShuffle();
+        creationOffsetsDSPList.setDeflate(deflate);
+        creationOffsetsDSPList.setFillValue(H5::PredType::NATIVE_HSIZE, &offsetsFill);
+        H5::DataSet offsetsDataset = keaImg->createDataSet(offsetsPath, H5::PredType::STD_U64LE, offsetsDataspace, creationOffsetsDSPList);
+        offsetsDataset.close();
+        offsetsDataspace.close();
+        
+        // 32 BIT INDICES UNLESS THE ROWS CAN'T BE ADDRESSED WITH THEM
+        hsize_t indicesDims[1];
+        indicesDims[0] = 0;
+        hsize_t maxIndicesDims[1];
+        maxIndicesDims[0] = H5S_UNLIMITED;
+        H5::DataSpace indicesDataspace = H5::DataSpace(1, indicesDims, maxIndicesDims);
+        hsize_t dimsIndicesChunk[1];
+        dimsIndicesChunk[0] = std::max((hsize_t)chunkSize, KEA_ATT_NEIGHBOURS_INDICES_CHUNK);
+        H5::DSetCreatPropList creationIndicesDSPList;
+        creationIndicesDSPList.setChunk(1, dimsIndicesChunk);
+        creationIndicesDSPList.setShuffle();
+        creationIndicesDSPList.setDeflate(deflate);
+        H5::PredType indicesType = (numRows <= std::numeric_limits<uint32_t>::max())?H5::PredType::STD_U32LE:H5::PredType::STD_U64LE;
+        H5::DataSet indicesDataset = keaImg->createDataSet(indicesPath, indicesType, indicesDataspace, creationIndicesDSPList);
+        indicesDataset.close();
+        indicesDataspace.close();
+    }
+    
+    void KEAAttributeTable::writeNeighboursCSR(H5::H5File *keaImg, const std::string &bandPathBase, size_t startfid, size_t len, const size_t *offsets, const size_t *indices, size_t firstIndex)
+    {
+        if(len == 0)
+        {
+            return;
+        }
+        
+        // THE INDICES OF THE ROWS GO IN FROM firstIndex, THE OFFSET OF startfid
+        size_t numIndices = offsets[len] - offsets[0];
+        H5::DataSet indicesDataset = keaImg->openDataSet(bandPathBase + KEA_ATT_NEIGHBOURS_INDICES_DATA);
+        if(numIndices > 0)
+        {
+            H5::DataSpace dimsDataspace = indicesDataset.getSpace();
+            hsize_t indicesDims[1];
+            dimsDataspace.getSimpleExtentDims(indicesDims);
+            dimsDataspace.close();
+            if(indicesDims[0] < (firstIndex + numIndices))
+            {
+                indicesDims[0] = firstIndex + numIndices;
+                indicesDataset.extend(indicesDims);
+            }
+            
+            hsize_t indicesOffset[1];
+            indicesOffset[0] = firstIndex;
+            hsize_t indicesCount[1];
+            indicesCount[0] = numIndices;
+            H5::DataSpace indicesDataspace = indicesDataset.getSpace();
+            indicesDataspace.selectHyperslab(H5S_SELECT_SET, indicesCount, indicesOffset);
+            H5::DataSpace indicesMemspace(1, indicesCount);
+            indicesDataset.write(&indices[offsets[0]], H5::PredType::NATIVE_HSIZE, indicesMemspace, indicesDataspace);
+            indicesMemspace.close();
+            indicesDataspace.close();
+        }
+        indicesDataset.close();
+        
+        // THE OFFSET OF startfid IS ALREADY firstIndex, THE REST ARE THE ENDS OF EACH ROW
+        std::vector<hsize_t> rowEnds(len);
+        for(size_t i = 0; i < len; ++i)
+        {
+            rowEnds[i] = firstIndex + (offsets[i+1] - offsets[0]);
+        }
+        H5::DataSet offsetsDataset = keaImg->openDataSet(bandPathBase + KEA_ATT_NEIGHBOURS_OFFSETS_DATA);
+        H5::DataSpace dimsDataspace = offsetsDataset.getSpace();
+        hsize_t offsetsDims[1];
+        dimsDataspace.getSimpleExtentDims(offsetsDims);
+        dimsDataspace.close();
+        if(offsetsDims[0] < (startfid + len + 1))
+        {
+            offsetsDims[0] = startfid + len + 1;
+            offsetsDataset.extend(offsetsDims);
+        }
+        hsize_t offsetsOffset[1];
+        offsetsOffset[0] = startfid + 1;
+        hsize_t offsetsCount[1];
+        offsetsCount[0] = len;
+        H5::DataSpace offsetsDataspace = offsetsDataset.getSpace();
+        offsetsDataspace.selectHyperslab(H5S_SELECT_SET, offsetsCount, offsetsOffset);
+        H5::DataSpace offsetsMemspace(1, offsetsCount);
+        offsetsDataset.write(&rowEnds[0], H5::PredType::NATIVE_HSIZE, offsetsMemspace, offsetsDataspace);
+        offsetsMemspace.close();
+        offsetsDataspace.close();
+        offsetsDataset.close();
+    }
+    
+    void KEAAttributeTable::createVarLenNeighbours(H5::H5File *keaImg, const std::string &bandPathBase, size_t numRows, unsigned int chunkSize, unsigned int deflate)
+    {
+        std::string neighboursPath = bandPathBase + KEA_ATT_NEIGHBOURS_DATA;
+        if(H5Lexists(keaImg->getId(), neighboursPath.c_str(), H5P_DEFAULT) > 0)
+        {
+            H5Ldelete(keaImg->getId(), neighboursPath.c_str(), H5P_DEFAULT);
+        }
+        
+        hsize_t initDimsNeighboursDS[1];
+        initDimsNeighboursDS[0] = numRows;
+        hsize_t maxDimsNeighboursDS[1];
+        maxDimsNeighboursDS[0] = H5S_UNLIMITED;
+        H5::DataSpace neighboursDataspace = H5::DataSpace(1, initDimsNeighboursDS, maxDimsNeighboursDS);
+        
+        hsize_t dimsNeighboursChunk[1];
+        dimsNeighboursChunk[0] = chunkSize;
+        
+        H5::DataType intVarLenDiskDT = H5::VarLenType(&H5::PredType::STD_U64LE);
+        H5::DataType intVarLenMemDT = H5::VarLenType(&H5::PredType::NATIVE_HSIZE);
+        VarLenFieldHDF neighboursDataFillVal[1];
+        neighboursDataFillVal[0].p = NULL;
+        neighboursDataFillVal[0].length = 0;
+        H5::DSetCreatPropList creationNeighboursDSPList;
+        creationNeighboursDSPList.setChunk(1, dimsNeighboursChunk);
+        creationNeighboursDSPList.setShuffle();
+        creationNeighboursDSPList.setDeflate(deflate);
+        creationNeighboursDSPList.setFillValue(intVarLenMemDT, &neighboursDataFillVal);
+        
+        H5::DataSet neighboursDataset = keaImg->createDataSet(neighboursPath, intVarLenDiskDT, neighboursDataspace, creationNeighboursDSPList);
+        neighboursDataset.close();
+        neighboursDataspace.close();
+    }
+    
     void KEAAttributeTable::destroyAttributeTable(KEAAttributeTable *pTable)
     {
         delete pTable;
@@ -0,0 +1,259 @@
+/*
+ *  KEAAttributeTableAppender.cpp
+ *  LibKEA
+ *
+ *  Copyright 2026 LibKEA. All rights reserved.
+ *
+ *  This file is part of LibKEA.
+ *
+ *  Permission is hereby granted, free of charge, to any person 
+ *  obtaining a copy of this software and associated documentation 
+ *  files (the "Software"), to deal in the Software without restriction, 
+ *  including without limitation the rights to use, copy, modify, 
+ *  merge, publish, distribute, sublicense, and/or sell copies of the 
+ *  Software, and to permit persons to whom the Software is furnished 
+ *  to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be 
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR 
+ *  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+ *  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "libkea/KEAAttributeTableAppender.h"
+#include <algorithm>
+
+namespace kealib{
+    
+    KEAAttributeTableAppender::KEAAttributeTableAppender(KEAAttributeTableFile *table)
+    {
+        this->table = table;
+        chunkSize = std::max(table->getChunkSize(), (size_t)1);
+        numBuffered = 0;
+        neighbourOffsets.push_back(0);
+        this->resizeColumns();
+    }
+    
+    size_t KEAAttributeTableAppender::appendRow()
+    {
+        // THE ROW STARTED LAST IS COMPLETE SO WRITE UP TO THE LAST CHUNK
+        // BOUNDARY, KEEPING ANY PARTIAL CHUNK
+        if(numBuffered >= chunkSize)
+        {
+            this->writeRows(numBuffered - ((table->getSize() + numBuffered) % chunkSize));
+        }
+        if((boolColumns.size() != table->getNumBoolFields()) || (intColumns.size() != table->getNumIntFields()) ||
+           (floatColumns.size() != table->getNumFloatFields()) || (strColumns.size() != table->getNumStringFields()))
+        {
+            this->flush();
+            this->resizeColumns();
+        }
+        
+        for(size_t i = 0; i < boolColumns.size(); ++i)
+        {
+            boolColumns[i].push_back(boolDefaults[i]);
+        }
+        for(size_t i = 0; i < intColumns.size(); ++i)
+        {
+            intColumns[i].push_back(intDefaults[i]);
+        }
+        for(size_t i = 0; i < floatColumns.size(); ++i)
+        {
+            floatColumns[i].push_back(floatDefaults[i]);
+        }
+        for(size_t i = 0; i < strColumns.size(); ++i)
+        {
+            strColumns[i].push_back(stringDefaults[i]);
+        }
+        neighbourOffsets.push_back(neighbourIndices.size());
+        ++numBuffered;
+        
+        return table->getSize() + numBuffered - 1;
+    }
+    
+    void KEAAttributeTableAppender::setBoolField(size_t colIdx, bool value)
+    {
+        this->checkRow(colIdx, boolColumns.size());
+        boolColumns[colIdx].back() = value? 1 : 0;
+    }
+    
+    void KEAAttributeTableAppender::setIntField(size_t colIdx, int64_t value)
+    {
+        this->checkRow(colIdx, intColumns.size());
+        intColumns[colIdx].back() = value;
+    }
+    
+    void KEAAttributeTableAppender::setFloatField(size_t colIdx, double value)
+    {
+        this->checkRow(colIdx, floatColumns.size());
+        floatColumns[colIdx].back() = value;
+    }
+    
+    void KEAAttributeTableAppender::setStringField(size_t colIdx, const std::string &value)
+    {
+        this->checkRow(colIdx, strColumns.size());
+        strColumns[colIdx].back() = value;
+    }
+    
+    void KEAAttributeTableAppender::setNeighbours(const std::vector<size_t> &neighbours)
+    {
+        this->checkRow(0, 1);
+        neighbourIndices.resize(neighbourOffsets[numBuffered - 1]);
+        neighbourIndices.insert(neighbourIndices.end(), neighbours.begin(), neighbours.end());
+        neighbourOffsets.back() = neighbourIndices.size();
+    }
+    
+    void KEAAttributeTableAppender::flush()
+    {
+        if(numBuffered > 0)
+        {
+            this->writeRows(numBuffered);
+        }
+    }
+    
+    size_t KEAAttributeTableAppender::getSize() const
+    {
+        return table->getSize() + numBuffered;
+    }
+    
+    size_t KEAAttributeTableAppender::getNumBuffered() const
+    {
+        return numBuffered;
+    }
+    
+    void KEAAttributeTableAppender::writeRows(size_t len)
+    {
+        size_t startfid = table->getSize();
+        
+        // EVERY COLUMN IS WRITTEN BELOW SO THE DEFAULTS ARE NOT WRITTEN FIRST
+        table->appendRows(len);
+        
+        if(!boolColumns.empty())
+        {
+            bool *pbBuffer = new bool[len];
+            try
+            {
+                for(size_t i = 0; i < boolColumns.size(); ++i)
+                {
+                    for(size_t j = 0; j < len; ++j)
+                    {
+                        pbBuffer[j] = (boolColumns[i][j] != 0);
+                    }
+                    table->setBoolFields(startfid, len, i, pbBuffer);
+                }
+            }
+            catch(...)
+            {
+                delete[] pbBuffer;
+                throw;
+            }
+            delete[] pbBuffer;
+        }
+        for(size_t i = 0; i < intColumns.size(); ++i)
+        {
+            table->setIntFields(startfid, len, i, &intColumns[i][0]);
+        }
+        for(size_t i = 0; i < floatColumns.size(); ++i)
+        {
+            table->setFloatFields(startfid, len, i, &floatColumns[i][0]);
+        }
+        for(size_t i = 0; i < strColumns.size(); ++i)
+        {
+            std::vector<std::string> values(strColumns[i].begin(), strColumns[i].begin() + len);
+            table->setStringFields(startfid, len, i, &values);
+        }
+        // THE NEW ROWS ALREADY HAVE NO NEIGHBOURS
+        if(neighbourOffsets[len] > 0)
+        {
+            table->setNeighboursCSR(startfid, len, &neighbourOffsets[0], &neighbourIndices[0]);
+        }
+        
+        // KEEP THE ROWS NOT WRITTEN AT THE START OF THE BUFFERS
+        for(size_t i = 0; i < boolColumns.size(); ++i)
+        {
+            boolColumns[i].erase(boolColumns[i].begin(), boolColumns[i].begin() + len);
+        }
+        for(size_t i = 0; i < intColumns.size(); ++i)
+        {
+            intColumns[i].erase(intColumns[i].begin(), intColumns[i].begin() + len);
+        }
+        for(size_t i = 0; i < floatColumns.size(); ++i)
+        {
+            floatColumns[i].erase(floatColumns[i].begin(), floatColumns[i].begin() + len);
+        }
+        for(size_t i = 0; i < strColumns.size(); ++i)
+        {
+            strColumns[i].erase(strColumns[i].begin(), strColumns[i].begin() + len);
+        }
+        size_t firstIndex = neighbourOffsets[len];
+        neighbourIndices.erase(neighbourIndices.begin(), neighbourIndices.begin() + firstIndex);
+        neighbourOffsets.erase(neighbourOffsets.begin(), neighbourOffsets.begin() + len);
+        for(std::vector<size_t>::iterator iterOff = neighbourOffsets.begin(); iterOff != neighbourOffsets.end(); ++iterOff)
+        {
+            *iterOff -= firstIndex;
+        }
+        numBuffered -= len;
+    }
+    
+    void KEAAttributeTableAppender::resizeColumns()
+    {
+        boolColumns.resize(table->getNumBoolFields());
+        intColumns.resize(table->getNumIntFields());
+        floatColumns.resize(table->getNumFloatFields());
+        strColumns.resize(table->getNumStringFields());
+        
+        boolDefaults.resize(boolColumns.size());
+        for(size_t i = 0; i < boolColumns.size(); ++i)
+        {
+            boolDefaults[i] = table->getBoolDefault(i)? 1 : 0;
+        }
+        intDefaults.resize(intColumns.size());
+        for(size_t i = 0; i < intColumns.size(); ++i)
+        {
+            intDefaults[i] = table->getIntDefault(i);
+        }
+        floatDefaults.resize(floatColumns.size());
+        for(size_t i = 0; i < floatColumns.size(); ++i)
+        {
+            floatDefaults[i] = table->getFloatDefault(i);
+        }
+        stringDefaults.resize(strColumns.size());
+        for(size_t i = 0; i < strColumns.size(); ++i)
+        {
+            stringDefaults[i] = table->getStringDefault(i);
+        }
+    }
+    
+    void KEAAttributeTableAppender::checkRow(size_t colIdx, size_t numCols) const
+    {
+        if(numBuffered == 0)
+        {
+            throw KEAATTException("appendRow() must be called before the fields of a row are set.");
+        }
+        if(colIdx >= numCols)
+        {
+            std::string message = std::string("Requested column (") + sizet2Str(colIdx) + std::string(") is not within the rows being appended.");
+            throw KEAATTException(message);
+        }
+    }
+    
+    KEAAttributeTableAppender::~KEAAttributeTableAppender()
+    {
+        try
+        {
+            this->flush();
+        }
+        catch(...)
+        {
+            // flush() must be called to find out about errors
+        }
+    }
+    
+}
@@ -32,26 +32,140 @@
 #include <stdlib.h>
 #include <string.h>
 #include <algorithm>
+#include <limits>
 
 namespace kealib{
 
-    static void* kealibmalloc(size_t nSize, void* ignored)
+    static void* kealibmalloc(size_t nSize, void* /*ignored*/)
     {
         return malloc(nSize);
     }
 
-    static void kealibfree(void* ptr, void* ignored)
+    static void kealibfree(void* ptr, void* /*ignored*/)
     {
         free(ptr);
     }
+    
+    // sorted, unique list of the columns requested and where each request sits within it
+    static void keaATTSortColumns(const std::vector<size_t> &colIdxs, std::vector<size_t> *uniqueCols, std::vector<size_t> *colPos)
+    {
+        *uniqueCols = colIdxs;
+        std::sort(uniqueCols->begin(), uniqueCols->end());
+        uniqueCols->erase(std::unique(uniqueCols->begin(), uniqueCols->end()), uniqueCols->end());
+        colPos->resize(colIdxs.size());
+        for(size_t i = 0; i < colIdxs.size(); ++i)
+        {
+            (*colPos)[i] = std::lower_bound(uniqueCols->begin(), uniqueCols->end(), colIdxs[i]) - uniqueCols->begin();
+        }
+    }
+    
+    // replaces the values read for lazy columns with the column default
+    template <typename U, typename D>
+    static void keaATTApplyDefaults(U *vals, size_t len, const std::vector<size_t> &uniqueCols, const std::vector<uint8_t> &lazy, const std::vector<D> &defaults)
+    {
+        size_t numUnique = uniqueCols.size();
+        for(size_t u = 0; u < numUnique; ++u)
+        {
+            if(lazy[uniqueCols[u]])
+            {
+                for(size_t n = 0; n < len; ++n)
+                {
+                    vals[(n * numUnique) + u] = defaults[uniqueCols[u]];
+                }
+            }
+        }
+    }
+    
+    // number of rows written per call when a lazy column is materialised
+    static const size_t KEA_ATT_MATERIALISE_CHUNKS = 64;
+    
+    // number of chunks of rows whose neighbours can be held in memory, having
+    // changed length, before they are merged into the CSR datasets
+    static const size_t KEA_ATT_NEIGHBOUR_EDIT_CHUNKS = 64;
+    
+    // next run of rows to fill when materialising a column, stepping over the
+    // rows about to be written by the caller. Returns 0 once the column is done.
+    static size_t keaATTNextFillRun(size_t *rowOff, size_t numRows, size_t batchLen, size_t skipStart, size_t skipLen)
+    {
+        if((skipLen > 0) && ((*rowOff) == skipStart))
+        {
+            (*rowOff) += skipLen;
+        }
+        if((*rowOff) >= numRows)
+        {
+            return 0;
+        }
+        size_t runEnd = std::min(numRows, (*rowOff) + batchLen);
+        if(((*rowOff) < skipStart) && (runEnd > skipStart))
+        {
+            runEnd = skipStart;
+        }
+        return runEnd - (*rowOff);
+    }
+    
+    template <typename T, typename U>
+    static void keaATTScatterColumns(const U *vals, size_t len, size_t numUnique, const std::vector<size_t> &colPos, T **buffers)
+    {
+        for(size_t i = 0; i < colPos.size(); ++i)
+        {
+            T *buffer = buffers[i];
+            for(size_t n = 0; n < len; ++n)
+            {
+                buffer[n] = static_cast<T>(vals[(n * numUnique) + colPos[i]]);
+            }
+        }
+    }
+    
+    template <typename T, typename U>
+    static void keaATTScatterBlock(const U *vals, size_t len, size_t numUnique, const std::vector<size_t> &colPos, T *buffer)
+    {
+        size_t numCols = colPos.size();
+        for(size_t n = 0; n < len; ++n)
+        {
+            for(size_t i = 0; i < numCols; ++i)
+            {
+                buffer[(n * numCols) + i] = static_cast<T>(vals[(n * numUnique) + colPos[i]]);
+            }
+        }
+    }
 
     KEAAttributeTableFile::KEAAttributeTableFile(H5::H5File *keaImgIn, const std::string &bandPathBaseIn, size_t numRowsIn, size_t chunkSizeIn, unsigned int deflateIn) : KEAAttributeTable(kea_att_file)
     {
         numRows = numRowsIn;
+        reservedRows = numRowsIn;
         chunkSize = chunkSizeIn;
         deflate = deflateIn;
         keaImg = keaImgIn;
         bandPathBase = bandPathBaseIn;
+        
+        cachedBoolDataset = NULL;
+        cachedIntDataset = NULL;
+        cachedFloatDataset = NULL;
+        cachedStringDataset = NULL;
+        cachedNeighboursDataset = NULL;
+        neighboursLayout = kea_att_neighbours_varlen;
+        strTypeMem = KEAAttributeTable::createKeaStringCompTypeMem();
+        neighboursTypeMem = new H5::VarLenType(&H5::PredType::NATIVE_HSIZE);
+    }
+    
+    H5::DataSet* KEAAttributeTableFile::getCachedDataset(const std::string &datasetName, H5::DataSet **cachedDataset) const
+    {
+        // OPEN THE DATASET ON FIRST USE AND KEEP THE HANDLE FOR THE LIFE OF THE TABLE
+        if(*cachedDataset == NULL)
+        {
+            *cachedDataset = new H5::DataSet(keaImg->openDataSet(bandPathBase + datasetName));
+        }
+        return *cachedDataset;
+    }
+    
+    void KEAAttributeTableFile::closeCachedDataset(H5::DataSet **cachedDataset) const
+    {
+        if(*cachedDataset != NULL)
+        {
+            (*cachedDataset)->close();
+            delete *cachedDataset;
+            *cachedDataset = NULL;
+        }
     }
     
     bool KEAAttributeTableFile::getBoolField(size_t fid, const std::string &name) const
@@ -332,9 +446,15 @@ namespace kealib{
             throw KEAATTException(message);
         }
         
+        if(boolLazy[colIdx])
+        {
+            std::fill(pbBuffer, pbBuffer + len, (bool)boolDefaults[colIdx]);
+            return;
+        }
+        
         try
         {
-            H5::DataSet boolDataset;
+            H5::DataSet *boolDataset = this->getCachedDataset(KEA_ATT_BOOL_DATA, &this->cachedBoolDataset);
             H5::DataSpace boolDataspace;
             H5::DataSpace boolFieldsMemspace;
             int *boolVals = new int[len];
@@ -343,8 +463,7 @@ namespace kealib{
             hsize_t boolFieldsDimsRead[2];
             hsize_t boolFieldsOffset_out[2];
             hsize_t boolFieldsCount_out[2];
-            boolDataset = keaImg->openDataSet( (bandPathBase + KEA_ATT_BOOL_DATA) );
-            boolDataspace = boolDataset.getSpace();
+            boolDataspace = boolDataset->getSpace();
             
             int boolNDims = boolDataspace.getSimpleExtentNdims();
             
@@ -353,7 +472,7 @@ namespace kealib{
                 throw KEAIOException("The boolean datasets needs to have 2 dimensions.");
             }
             
-            hsize_t *boolDims = new hsize_t[boolNDims];
+            hsize_t boolDims[2];
             boolDataspace.getSimpleExtentDims(boolDims);
             
             if(numRows > boolDims[0])
@@ -365,7 +484,6 @@ namespace kealib{
             {
                 throw KEAIOException("The number of boolean fields is smaller than expected.");
             }
-            delete[] boolDims;
             
             boolFieldsOffset[0] = startfid;
             boolFieldsOffset[1] = colIdx;
@@ -385,13 +503,12 @@ namespace kealib{
             boolFieldsCount_out[1] = 1;
             boolFieldsMemspace.selectHyperslab( H5S_SELECT_SET, boolFieldsCount_out, boolFieldsOffset_out );
             
-            boolDataset.read(boolVals, H5::PredType::NATIVE_INT, boolFieldsMemspace, boolDataspace);
+            boolDataset->read(boolVals, H5::PredType::NATIVE_INT, boolFieldsMemspace, boolDataspace);
             for( size_t i = 0; i < len; i++ )
             {
                 pbBuffer[i] = (boolVals[i] != 0);
             }
             
-            boolDataset.close();
             boolDataspace.close();
             boolFieldsMemspace.close();
             
@@ -429,9 +546,15 @@ namespace kealib{
             throw KEAATTException(message);
         }
         
+        if(intLazy[colIdx])
+        {
+            std::fill(pnBuffer, pnBuffer + len, intDefaults[colIdx]);
+            return;
+        }
+        
         try
         {
-            H5::DataSet intDataset;
+            H5::DataSet *intDataset = this->getCachedDataset(KEA_ATT_INT_DATA, &this->cachedIntDataset);
             H5::DataSpace intDataspace;
             H5::DataSpace intFieldsMemspace;
             hsize_t intFieldsOffset[2];
@@ -439,8 +562,7 @@ namespace kealib{
             hsize_t intFieldsDimsRead[2];
             hsize_t intFieldsOffset_out[2];
             hsize_t intFieldsCount_out[2];
-            intDataset = keaImg->openDataSet( (bandPathBase + KEA_ATT_INT_DATA) );
-            intDataspace = intDataset.getSpace();
+            intDataspace = intDataset->getSpace();
             
             int intNDims = intDataspace.getSimpleExtentNdims();
             
@@ -449,7 +571,7 @@ namespace kealib{
                 throw KEAIOException("The integer datasets needs to have 2 dimensions.");
             }
             
-            hsize_t *intDims = new hsize_t[intNDims];
+            hsize_t intDims[2];
             intDataspace.getSimpleExtentDims(intDims);
             
             if(numRows > intDims[0])
@@ -461,7 +583,6 @@ namespace kealib{
             {
                 throw KEAIOException("The number of integer fields is smaller than expected.");
             }
-            delete[] intDims;
             
             intFieldsOffset[0] = startfid;
             intFieldsOffset[1] = colIdx;
@@ -481,9 +602,8 @@ namespace kealib{
             intFieldsCount_out[1] = 1;
             intFieldsMemspace.selectHyperslab( H5S_SELECT_SET, intFieldsCount_out, intFieldsOffset_out );
             
-            intDataset.read(pnBuffer, H5::PredType::NATIVE_INT64, intFieldsMemspace, intDataspace);
+            intDataset->read(pnBuffer, H5::PredType::NATIVE_INT64, intFieldsMemspace, intDataspace);
             
-            intDataset.close();
             intDataspace.close();
             intFieldsMemspace.close();
         }
@@ -519,9 +639,15 @@ namespace kealib{
             throw KEAATTException(message);
         }
         
+        if(floatLazy[colIdx])
+        {
+            std::fill(pfBuffer, pfBuffer + len, floatDefaults[colIdx]);
+            return;
+        }
+        
         try
         {
-            H5::DataSet floatDataset;
+            H5::DataSet *floatDataset = this->getCachedDataset(KEA_ATT_FLOAT_DATA, &this->cachedFloatDataset);
             H5::DataSpace floatDataspace;
             H5::DataSpace floatFieldsMemspace;
             hsize_t floatFieldsOffset[2];
@@ -529,8 +655,7 @@ namespace kealib{
             hsize_t floatFieldsDimsRead[2];
             hsize_t floatFieldsOffset_out[2];
             hsize_t floatFieldsCount_out[2];
-            floatDataset = keaImg->openDataSet( (bandPathBase + KEA_ATT_FLOAT_DATA) );
-            floatDataspace = floatDataset.getSpace();
+            floatDataspace = floatDataset->getSpace();
             
             int floatNDims = floatDataspace.getSimpleExtentNdims();
             
@@ -539,7 +664,7 @@ namespace kealib{
                 throw KEAIOException("The float datasets needs to have 2 dimensions.");
             }
             
-            hsize_t *floatDims = new hsize_t[floatNDims];
+            hsize_t floatDims[2];
             floatDataspace.getSimpleExtentDims(floatDims);
             
             if(numRows > floatDims[0])
@@ -551,7 +676,6 @@ namespace kealib{
             {
                 throw KEAIOException("The number of float fields is smaller than expected.");
             }
-            delete[] floatDims;
             
             floatFieldsOffset[0] = startfid;
             floatFieldsOffset[1] = colIdx;
@@ -571,9 +695,8 @@ namespace kealib{
             floatFieldsCount_out[1] = 1;
             floatFieldsMemspace.selectHyperslab( H5S_SELECT_SET, floatFieldsCount_out, floatFieldsOffset_out );
             
-            floatDataset.read(pfBuffer, H5::PredType::NATIVE_DOUBLE, floatFieldsMemspace, floatDataspace);
+            floatDataset->read(pfBuffer, H5::PredType::NATIVE_DOUBLE, floatFieldsMemspace, floatDataspace);
             
-            floatDataset.close();
             floatDataspace.close();
             floatFieldsMemspace.close();
         }
@@ -609,19 +732,35 @@ namespace kealib{
             throw KEAATTException(message);
         }
         
+        if(stringLazy[colIdx])
+        {
+            psBuffer->assign(len, stringDefaults[colIdx]);
+            return;
+        }
+        
+        if(stringEncoding[colIdx] == kea_att_str_dictionary)
+        {
+            psBuffer->resize(len);
+            if(len > 0)
+            {
+                std::vector<int32_t> codes(len);
+                this->readStringCodes(startfid, len, colIdx, &codes[0]);
+                this->decodeStringCodes(colIdx, &codes[0], len, &(*psBuffer)[0], 1);
+            }
+            return;
+        }
+        
         try
         {
-            H5::DataSet strDataset;
+            H5::DataSet *strDataset = this->getCachedDataset(KEA_ATT_STRING_DATA, &this->cachedStringDataset);
             H5::DataSpace strDataspace;
             H5::DataSpace strFieldsMemspace;
-            H5::CompType *strTypeMem = KEAAttributeTable::createKeaStringCompTypeMem();
             hsize_t strFieldsOffset[2];
             hsize_t strFieldsCount[2];
             hsize_t strFieldsDimsRead[2];
             hsize_t strFieldsOffset_out[2];
             hsize_t strFieldsCount_out[2];
-            strDataset = keaImg->openDataSet( (bandPathBase + KEA_ATT_STRING_DATA) );
-            strDataspace = strDataset.getSpace();
+            strDataspace = strDataset->getSpace();
             KEAString *stringVals = new KEAString[len];
             
             int strNDims = strDataspace.getSimpleExtentNdims();
@@ -631,7 +770,7 @@ namespace kealib{
                 throw KEAIOException("The str datasets needs to have 2 dimensions.");
             }
             
-            hsize_t *strDims = new hsize_t[strNDims];
+            hsize_t strDims[2];
             strDataspace.getSimpleExtentDims(strDims);
             
             if(numRows > strDims[0])
@@ -643,7 +782,6 @@ namespace kealib{
             {
                 throw KEAIOException("The number of str fields is smaller than expected.");
             }
-            delete[] strDims;
             
             strFieldsOffset[0] = startfid;
             strFieldsOffset[1] = colIdx;
@@ -663,19 +801,18 @@ namespace kealib{
             strFieldsCount_out[1] = 1;
             strFieldsMemspace.selectHyperslab( H5S_SELECT_SET, strFieldsCount_out, strFieldsOffset_out );
             
-            strDataset.read(stringVals, *strTypeMem, strFieldsMemspace, strDataspace);
+            strDataset->read(stringVals, *this->strTypeMem, strFieldsMemspace, strDataspace);
             psBuffer->clear();
             psBuffer->reserve(len);
             for( size_t i = 0; i < len; i++ )
             {
-                psBuffer->push_back(std::string(stringVals[i].str));
+                // ROWS THAT WERE NEVER WRITTEN HOLD A NULL REFERENCE
+                psBuffer->push_back((stringVals[i].str != NULL)? std::string(stringVals[i].str) : std::string(""));
                 free(stringVals[i].str);
             }
 
-            strDataset.close();
             strDataspace.close();
             strFieldsMemspace.close();
-            delete strTypeMem;
             delete[] stringVals;
         }
         catch(H5::Exception &e)
@@ -710,8 +847,30 @@ namespace kealib{
             }
             neighbours->reserve(len);
             
-            H5::DataSet neighboursDataset = keaImg->openDataSet( (bandPathBase + KEA_ATT_NEIGHBOURS_DATA) );
-            H5::DataSpace neighboursDataspace = neighboursDataset.getSpace();
+            if(neighboursLayout == kea_att_neighbours_csr)
+            {
+                std::vector<size_t> offsets;
+                std::vector<size_t> indices;
+                this->readNeighbourRows(startfid, len, &offsets, &indices);
+                for(size_t i = 0; i < len; ++i)
+                {
+                    neighbours->push_back(new std::vector<size_t>(indices.begin() + offsets[i], indices.begin() + offsets[i+1]));
+                }
+                return;
+            }
+            
+            // A TABLE WHOSE NEIGHBOURS HAVE NEVER BEEN WRITTEN HAS NONE
+            if((this->cachedNeighboursDataset == NULL) && (H5Lexists(keaImg->getId(), (bandPathBase + KEA_ATT_NEIGHBOURS_DATA).c_str(), H5P_DEFAULT) <= 0))
+            {
+                for(size_t i = 0; i < len; ++i)
+                {
+                    neighbours->push_back(new std::vector<size_t>());
+                }
+                return;
+            }
+            
+            H5::DataSet *neighboursDataset = this->getCachedDataset(KEA_ATT_NEIGHBOURS_DATA, &this->cachedNeighboursDataset);
+            H5::DataSpace neighboursDataspace = neighboursDataset->getSpace();
             
             int neighboursNDims = neighboursDataspace.getSimpleExtentNdims();
             if(neighboursNDims != 1)
@@ -719,48 +878,52 @@ namespace kealib{
                 throw KEAIOException("The neighbours datasets needs to have 1 dimension.");
             }
             
-            hsize_t *neighboursDims = new hsize_t[neighboursNDims];
+            hsize_t neighboursDims[1];
             neighboursDataspace.getSimpleExtentDims(neighboursDims);
-            if(this->getSize() > neighboursDims[0])
+            
+            // ROWS ADDED SINCE THE NEIGHBOURS WERE LAST WRITTEN ARE PAST THE END
+            // OF THE DATASET AND HAVE NONE
+            size_t numStored = 0;
+            if(startfid < neighboursDims[0])
             {
-                throw KEAIOException("The number of features in neighbours dataset smaller than expected.");
+                numStored = std::min(len, (size_t)(neighboursDims[0] - startfid));
             }
-            delete[] neighboursDims;
-            
-            VarLenFieldHDF *neighbourVals = new VarLenFieldHDF[len];
-            H5::DataType intVarLenMemDT = H5::VarLenType(&H5::PredType::NATIVE_HSIZE);
-            hsize_t neighboursOffset[1];
-            neighboursOffset[0] = 0;
-            hsize_t neighboursCount[1];
-            neighboursCount[0] = len;
-            neighboursDataspace.selectHyperslab( H5S_SELECT_SET, neighboursCount, neighboursOffset );
-            
-            hsize_t neighboursDimsRead[1];
-            neighboursDimsRead[0] = len;
-            H5::DataSpace neighboursMemspace( 1, neighboursDimsRead );
-            
-            hsize_t neighboursOffset_out[1];
-            neighboursOffset_out[0] = 0;
-            hsize_t neighboursCount_out[1];
-            neighboursCount_out[0] = len;
-            neighboursMemspace.selectHyperslab( H5S_SELECT_SET, neighboursCount_out, neighboursOffset_out );
-            
-            neighboursOffset[0] = startfid;
-            neighboursDataspace.selectHyperslab( H5S_SELECT_SET, neighboursCount, neighboursOffset );
-            neighboursDataset.read(neighbourVals, intVarLenMemDT, neighboursMemspace, neighboursDataspace);
             
-            for(size_t i = 0; i < len; ++i)
+            if(numStored > 0)
             {
-                neighbours->push_back(new std::vector<size_t>());
-                if(neighbourVals[i].length > 0)
+                VarLenFieldHDF *neighbourVals = new VarLenFieldHDF[numStored];
+                hsize_t neighboursOffset[1];
+                neighboursOffset[0] = startfid;
+                hsize_t neighboursCount[1];
+                neighboursCount[0] = numStored;
+                neighboursDataspace.selectHyperslab( H5S_SELECT_SET, neighboursCount, neighboursOffset );
+                
+                hsize_t neighboursDimsRead[1];
+                neighboursDimsRead[0] = numStored;
+                H5::DataSpace neighboursMemspace( 1, neighboursDimsRead );
+                neighboursDataset->read(neighbourVals, *this->neighboursTypeMem, neighboursMemspace, neighboursDataspace);
+                
+                for(size_t i = 0; i < numStored; ++i)
                 {
-                    neighbours->back()->reserve(neighbourVals[i].length);
-                    for(hsize_t n = 0; n < neighbourVals[i].length; ++n)
+                    neighbours->push_back(new std::vector<size_t>());
+                    if(neighbourVals[i].length > 0)
                     {
-                        neighbours->back()->push_back(((size_t*)neighbourVals[i].p)[n]);
+                        neighbours->back()->reserve(neighbourVals[i].length);
+                        for(hsize_t n = 0; n < neighbourVals[i].length; ++n)
+                        {
+                            neighbours->back()->push_back(((size_t*)neighbourVals[i].p)[n]);
+                        }
                     }
                 }
+                H5::DataSet::vlenReclaim(neighbourVals, *this->neighboursTypeMem, neighboursMemspace);
+                delete[] neighbourVals;
+                neighboursMemspace.close();
+            }
+            for(size_t i = numStored; i < len; ++i)
+            {
+                neighbours->push_back(new std::vector<size_t>());
             }
+            neighboursDataspace.close();
         }
         catch(H5::Exception &e)
         {
@@ -780,6 +943,232 @@ namespace kealib{
         }
     }
     
+    void KEAAttributeTableFile::checkColumnsRequest(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, size_t numFields, const std::string &typeName) const
+    {
+        if((startfid+len) > numRows)
+        {
+            std::string message = std::string("Requested feature (") + sizet2Str(startfid+len) + std::string(") is not within the table.");
+            throw KEAATTException(message);
+        }
+        
+        for(std::vector<size_t>::const_iterator iterCol = colIdxs.begin(); iterCol != colIdxs.end(); ++iterCol)
+        {
+            if((*iterCol) >= numFields)
+            {
+                std::string message = std::string("Requested ") + typeName + std::string(" column (") + sizet2Str(*iterCol) + std::string(") is not within the table.");
+                throw KEAATTException(message);
+            }
+        }
+    }
+    
+    void KEAAttributeTableFile::readColumnSelection(H5::DataSet *dataset, const H5::DataType &memType, size_t startfid, size_t len, const std::vector<size_t> &uniqueCols, size_t numFields, void *pBuffer, H5::DSetMemXferPropList *xfer) const
+    {
+        H5::DataSpace dataspace = dataset->getSpace();
+        if(dataspace.getSimpleExtentNdims() != 2)
+        {
+            throw KEAIOException("The attribute datasets needs to have 2 dimensions.");
+        }
+        
+        hsize_t dataDims[2];
+        dataspace.getSimpleExtentDims(dataDims);
+        if(numRows > dataDims[0])
+        {
+            throw KEAIOException("The number of features in the attribute dataset is smaller than expected.");
+        }
+        if(numFields > dataDims[1])
+        {
+            throw KEAIOException("The number of fields in the attribute dataset is smaller than expected.");
+        }
+        
+        // ONE SELECTION COVERING ALL THE COLUMNS SO A SINGLE READ IS ISSUED.
+        // VALUES ARRIVE ROW MAJOR IN THE ORDER OF uniqueCols.
+        hsize_t fieldsOffset[2];
+        hsize_t fieldsCount[2];
+        fieldsOffset[0] = startfid;
+        fieldsCount[0] = len;
+        fieldsCount[1] = 1;
+        for(size_t i = 0; i < uniqueCols.size(); ++i)
+        {
+            fieldsOffset[1] = uniqueCols[i];
+            dataspace.selectHyperslab( (i == 0)?H5S_SELECT_SET:H5S_SELECT_OR, fieldsCount, fieldsOffset );
+        }
+        
+        hsize_t fieldsDimsRead[2];
+        fieldsDimsRead[0] = len;
+        fieldsDimsRead[1] = uniqueCols.size();
+        H5::DataSpace fieldsMemspace = H5::DataSpace( 2, fieldsDimsRead );
+        
+        if(xfer != NULL)
+        {
+            dataset->read(pBuffer, memType, fieldsMemspace, dataspace, *xfer);
+        }
+        else
+        {
+            dataset->read(pBuffer, memType, fieldsMemspace, dataspace);
+        }
+        
+        dataspace.close();
+        fieldsMemspace.close();
+    }
+    
+    void KEAAttributeTableFile::readColumnValues(size_t startfid, size_t len, const std::vector<size_t> &uniqueCols, std::vector<int> *pbVals) const
+    {
+        // BOOLEANS ARE STORED (AND READ) AS INTEGERS
+        pbVals->resize(len * uniqueCols.size());
+        H5::DataSet *boolDataset = this->getCachedDataset(KEA_ATT_BOOL_DATA, &this->cachedBoolDataset);
+        this->readColumnSelection(boolDataset, H5::PredType::NATIVE_INT, startfid, len, uniqueCols, numBoolFields, &(*pbVals)[0]);
+        keaATTApplyDefaults(&(*pbVals)[0], len, uniqueCols, boolLazy, boolDefaults);
+    }
+    
+    void KEAAttributeTableFile::readColumnValues(size_t startfid, size_t len, const std::vector<size_t> &uniqueCols, std::vector<int64_t> *pnVals) const
+    {
+        pnVals->resize(len * uniqueCols.size());
+        H5::DataSet *intDataset = this->getCachedDataset(KEA_ATT_INT_DATA, &this->cachedIntDataset);
+        this->readColumnSelection(intDataset, H5::PredType::NATIVE_INT64, startfid, len, uniqueCols, numIntFields, &(*pnVals)[0]);
+        keaATTApplyDefaults(&(*pnVals)[0], len, uniqueCols, intLazy, intDefaults);
+    }
+    
+    void KEAAttributeTableFile::readColumnValues(size_t startfid, size_t len, const std::vector<size_t> &uniqueCols, std::vector<double> *pfVals) const
+    {
+        pfVals->resize(len * uniqueCols.size());
+        H5::DataSet *floatDataset = this->getCachedDataset(KEA_ATT_FLOAT_DATA, &this->cachedFloatDataset);
+        this->readColumnSelection(floatDataset, H5::PredType::NATIVE_DOUBLE, startfid, len, uniqueCols, numFloatFields, &(*pfVals)[0]);
+        keaATTApplyDefaults(&(*pfVals)[0], len, uniqueCols, floatLazy, floatDefaults);
+    }
+    
+    void KEAAttributeTableFile::readColumnValues(size_t startfid, size_t len, const std::vector<size_t> &uniqueCols, std::vector<std::string> *psVals) const
+    {
+        KEAString *stringVals = new KEAString[len * uniqueCols.size()];
+        try
+        {
+            H5::DataSet *strDataset = this->getCachedDataset(KEA_ATT_STRING_DATA, &this->cachedStringDataset);
+            H5::DSetMemXferPropList xfer;
+            /* Ensures that malloc()/free() are from the same C runtime */
+            xfer.setVlenMemManager(kealibmalloc, NULL, kealibfree, NULL);
+            this->readColumnSelection(strDataset, *this->strTypeMem, startfid, len, uniqueCols, numStringFields, stringVals, &xfer);
+            
+            psVals->clear();
+            psVals->reserve(len * uniqueCols.size());
+            for(size_t i = 0; i < (len * uniqueCols.size()); ++i)
+            {
+                psVals->push_back((stringVals[i].str != NULL)? std::string(stringVals[i].str) : std::string(""));
+                free(stringVals[i].str);
+            }
+            delete[] stringVals;
+            stringVals = NULL;
+            keaATTApplyDefaults(&(*psVals)[0], len, uniqueCols, stringLazy, stringDefaults);
+            
+            // DICTIONARY ENCODED COLUMNS ARE NOT HELD IN THE STRING DATASET
+            std::vector<int32_t> codes;
+            for(size_t u = 0; u < uniqueCols.size(); ++u)
+            {
+                if((stringEncoding[uniqueCols[u]] == kea_att_str_dictionary) && !stringLazy[uniqueCols[u]])
+                {
+                    codes.resize(len);
+                    this->readStringCodes(startfid, len, uniqueCols[u], &codes[0]);
+                    this->decodeStringCodes(uniqueCols[u], &codes[0], len, &(*psVals)[u], uniqueCols.size());
+                }
+            }
+        }
+        catch(H5::Exception &e)
+        {
+            delete[] stringVals;
+            throw KEAATTException(e.getDetailMsg());
+        }
+        catch (KEAIOException &e)
+        {
+            delete[] stringVals;
+            throw KEAATTException(e.what());
+        }
+    }
+    
+    template <typename T, typename U>
+    void KEAAttributeTableFile::getColumnValues(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, size_t numFields, const std::string &typeName, T **buffers, T *block) const
+    {
+        // EACH COLUMN IS READ ONCE, HOWEVER MANY TIMES AND IN WHATEVER ORDER IT
+        // IS REQUESTED, THEN COPIED TO EACH BUFFER (OR BLOCK POSITION) ASKING FOR IT
+        this->checkColumnsRequest(startfid, len, colIdxs, numFields, typeName);
+        if((len == 0) || colIdxs.empty())
+        {
+            return;
+        }
+        
+        std::vector<size_t> uniqueCols;
+        std::vector<size_t> colPos;
+        keaATTSortColumns(colIdxs, &uniqueCols, &colPos);
+        std::vector<U> vals;
+        try
+        {
+            this->readColumnValues(startfid, len, uniqueCols, &vals);
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAATTException(e.getDetailMsg());
+        }
+        catch (KEAIOException &e)
+        {
+            throw KEAATTException(e.what());
+        }
+        
+        if(buffers != NULL)
+        {
+            keaATTScatterColumns(&vals[0], len, uniqueCols.size(), colPos, buffers);
+        }
+        else
+        {
+            keaATTScatterBlock(&vals[0], len, uniqueCols.size(), colPos, block);
+        }
+    }
+    
+    void KEAAttributeTableFile::getBoolColumns(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, bool **pbBuffers) const
+    {
+        this->getColumnValues<bool, int>(startfid, len, colIdxs, numBoolFields, "boolean", pbBuffers, NULL);
+    }
+    
+    void KEAAttributeTableFile::getIntColumns(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, int64_t **pnBuffers) const
+    {
+        this->getColumnValues<int64_t, int64_t>(startfid, len, colIdxs, numIntFields, "integer", pnBuffers, NULL);
+    }
+    
+    void KEAAttributeTableFile::getFloatColumns(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, double **pfBuffers) const
+    {
+        this->getColumnValues<double, double>(startfid, len, colIdxs, numFloatFields, "float", pfBuffers, NULL);
+    }
+    
+    void KEAAttributeTableFile::getStringColumns(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, std::vector<std::string> **psBuffers) const
+    {
+        std::vector<std::string*> buffers(colIdxs.size(), NULL);
+        for(size_t i = 0; i < colIdxs.size(); ++i)
+        {
+            psBuffers[i]->clear();
+            psBuffers[i]->resize(len);
+            buffers[i] = (len > 0)? &(*psBuffers[i])[0] : NULL;
+        }
+        this->getColumnValues<std::string, std::string>(startfid, len, colIdxs, numStringFields, "string", buffers.empty()? NULL : &buffers[0], NULL);
+    }
+    
+    void KEAAttributeTableFile::getBoolBlock(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, bool *pbBuffer) const
+    {
+        this->getColumnValues<bool, int>(startfid, len, colIdxs, numBoolFields, "boolean", NULL, pbBuffer);
+    }
+    
+    void KEAAttributeTableFile::getIntBlock(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, int64_t *pnBuffer) const
+    {
+        this->getColumnValues<int64_t, int64_t>(startfid, len, colIdxs, numIntFields, "integer", NULL, pnBuffer);
+    }
+    
+    void KEAAttributeTableFile::getFloatBlock(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, double *pfBuffer) const
+    {
+        this->getColumnValues<double, double>(startfid, len, colIdxs, numFloatFields, "float", NULL, pfBuffer);
+    }
+    
+    void KEAAttributeTableFile::getStringBlock(size_t startfid, size_t len, const std::vector<size_t> &colIdxs, std::vector<std::string> *psBuffer) const
+    {
+        psBuffer->clear();
+        psBuffer->resize(len * colIdxs.size());
+        this->getColumnValues<std::string, std::string>(startfid, len, colIdxs, numStringFields, "string", NULL, psBuffer->empty()? NULL : &(*psBuffer)[0]);
+    }
+    
     void KEAAttributeTableFile::setBoolField(size_t fid, size_t colIdx, bool value)
     {
         if(fid >= numRows)
@@ -864,9 +1253,14 @@ namespace kealib{
             throw KEAATTException(message);
         }
         
+        if(boolLazy[colIdx])
+        {
+            this->materialiseBoolField(colIdx, startfid, len);
+        }
+        
         try
         {
-            H5::DataSet boolDataset;
+            H5::DataSet *boolDataset = this->getCachedDataset(KEA_ATT_BOOL_DATA, &this->cachedBoolDataset);
             H5::DataSpace boolDataspace;
             H5::DataSpace boolFieldsMemspace;
             int *boolVals = new int[len];
@@ -875,8 +1269,7 @@ namespace kealib{
             hsize_t boolFieldsDimsRead[2];
             hsize_t boolFieldsOffset_out[2];
             hsize_t boolFieldsCount_out[2];
-            boolDataset = keaImg->openDataSet( (bandPathBase + KEA_ATT_BOOL_DATA) );
-            boolDataspace = boolDataset.getSpace();
+            boolDataspace = boolDataset->getSpace();
             
             int boolNDims = boolDataspace.getSimpleExtentNdims();
             
@@ -885,7 +1278,7 @@ namespace kealib{
                 throw KEAIOException("The boolean datasets needs to have 2 dimensions.");
             }
             
-            hsize_t *boolDims = new hsize_t[boolNDims];
+            hsize_t boolDims[2];
             boolDataspace.getSimpleExtentDims(boolDims);
             
             if(numRows > boolDims[0])
@@ -897,7 +1290,6 @@ namespace kealib{
             {
                 throw KEAIOException("The number of boolean fields is smaller than expected.");
             }
-            delete[] boolDims;
             
             boolFieldsOffset[0] = startfid;
             boolFieldsOffset[1] = colIdx;
@@ -922,9 +1314,8 @@ namespace kealib{
                 boolVals[i] = pbBuffer[i]? 1:0;
             }
             
-            boolDataset.write(boolVals, H5::PredType::NATIVE_INT, boolFieldsMemspace, boolDataspace);
+            boolDataset->write(boolVals, H5::PredType::NATIVE_INT, boolFieldsMemspace, boolDataspace);
             
-            boolDataset.close();
             boolDataspace.close();
             boolFieldsMemspace.close();
             
@@ -962,9 +1353,16 @@ namespace kealib{
             throw KEAATTException(message);
         }
         
+        this->markIndexStale(kea_att_int, colIdx);
+        
+        if(intLazy[colIdx])
+        {
+            this->materialiseIntField(colIdx, startfid, len);
+        }
+        
         try
         {
-            H5::DataSet intDataset;
+            H5::DataSet *intDataset = this->getCachedDataset(KEA_ATT_INT_DATA, &this->cachedIntDataset);
             H5::DataSpace intDataspace;
             H5::DataSpace intFieldsMemspace;
             hsize_t intFieldsOffset[2];
@@ -972,8 +1370,7 @@ namespace kealib{
             hsize_t intFieldsDimsRead[2];
             hsize_t intFieldsOffset_out[2];
             hsize_t intFieldsCount_out[2];
-            intDataset = keaImg->openDataSet( (bandPathBase + KEA_ATT_INT_DATA) );
-            intDataspace = intDataset.getSpace();
+            intDataspace = intDataset->getSpace();
             
             int intNDims = intDataspace.getSimpleExtentNdims();
             
@@ -982,7 +1379,7 @@ namespace kealib{
                 throw KEAIOException("The integer datasets needs to have 2 dimensions.");
             }
             
-            hsize_t *intDims = new hsize_t[intNDims];
+            hsize_t intDims[2];
             intDataspace.getSimpleExtentDims(intDims);
             
             if(numRows > intDims[0])
@@ -994,7 +1391,6 @@ namespace kealib{
             {
                 throw KEAIOException("The number of integer fields is smaller than expected.");
             }
-            delete[] intDims;
             
             intFieldsOffset[0] = startfid;
             intFieldsOffset[1] = colIdx;
@@ -1014,11 +1410,15 @@ namespace kealib{
             intFieldsCount_out[1] = 1;
             intFieldsMemspace.selectHyperslab( H5S_SELECT_SET, intFieldsCount_out, intFieldsOffset_out );
             
-            intDataset.write(pnBuffer, H5::PredType::NATIVE_INT64, intFieldsMemspace, intDataspace);
+            intDataset->write(pnBuffer, H5::PredType::NATIVE_INT64, intFieldsMemspace, intDataspace);
             
-            intDataset.close();
             intDataspace.close();
             intFieldsMemspace.close();
+            
+            if(intZoneMaps.count(colIdx) > 0)
+            {
+                this->widenIntZones(colIdx, startfid, len, pnBuffer);
+            }
         }
         catch(H5::Exception &e)
         {
@@ -1052,9 +1452,16 @@ namespace kealib{
             throw KEAATTException(message);
         }
         
+        this->markIndexStale(kea_att_float, colIdx);
+        
+        if(floatLazy[colIdx])
+        {
+            this->materialiseFloatField(colIdx, startfid, len);
+        }
+        
         try
         {
-            H5::DataSet floatDataset;
+            H5::DataSet *floatDataset = this->getCachedDataset(KEA_ATT_FLOAT_DATA, &this->cachedFloatDataset);
             H5::DataSpace floatDataspace;
             H5::DataSpace floatFieldsMemspace;
             hsize_t floatFieldsOffset[2];
@@ -1062,8 +1469,7 @@ namespace kealib{
             hsize_t floatFieldsDimsRead[2];
             hsize_t floatFieldsOffset_out[2];
             hsize_t floatFieldsCount_out[2];
-            floatDataset = keaImg->openDataSet( (bandPathBase + KEA_ATT_FLOAT_DATA) );
-            floatDataspace = floatDataset.getSpace();
+            floatDataspace = floatDataset->getSpace();
             
             int floatNDims = floatDataspace.getSimpleExtentNdims();
             
@@ -1072,7 +1478,7 @@ namespace kealib{
                 throw KEAIOException("The float datasets needs to have 2 dimensions.");
             }
             
-            hsize_t *floatDims = new hsize_t[floatNDims];
+            hsize_t floatDims[2];
             floatDataspace.getSimpleExtentDims(floatDims);
             
             if(numRows > floatDims[0])
@@ -1084,7 +1490,6 @@ namespace kealib{
             {
                 throw KEAIOException("The number of float fields is smaller than expected.");
             }
-            delete[] floatDims;
             
             floatFieldsOffset[0] = startfid;
             floatFieldsOffset[1] = colIdx;
@@ -1104,11 +1509,15 @@ namespace kealib{
             floatFieldsCount_out[1] = 1;
             floatFieldsMemspace.selectHyperslab( H5S_SELECT_SET, floatFieldsCount_out, floatFieldsOffset_out );
             
-            floatDataset.write(pfBuffer, H5::PredType::NATIVE_DOUBLE, floatFieldsMemspace, floatDataspace);
+            floatDataset->write(pfBuffer, H5::PredType::NATIVE_DOUBLE, floatFieldsMemspace, floatDataspace);
             
-            floatDataset.close();
             floatDataspace.close();
             floatFieldsMemspace.close();
+            
+            if(floatZoneMaps.count(colIdx) > 0)
+            {
+                this->widenFloatZones(colIdx, startfid, len, pfBuffer);
+            }
         }
         catch(H5::Exception &e)
         {
@@ -1142,6 +1551,49 @@ namespace kealib{
             throw KEAATTException(message);
         }
         
+        this->markIndexStale(kea_att_string, colIdx);
+        
+        if(stringLazy[colIdx])
+        {
+            this->materialiseStringField(colIdx, startfid, len);
+        }
+        
+        if(stringEncoding[colIdx] == kea_att_str_dictionary)
+        {
+            if(papszStrList->size() != len)
+            {
+                throw KEAATTException("The number of items in the vector<std::string> passed was not equal to the length specified.");
+            }
+            
+            // LOOK UP (OR ADD) EACH VALUE IN THE DICTIONARY AND WRITE THE CODES
+            KEAATTStringDictionary *dictionary = this->getStringDictionary(colIdx);
+            size_t firstNew = dictionary->values.size();
+            std::vector<int32_t> codes(len);
+            for(size_t i = 0; i < len; ++i)
+            {
+                std::map<std::string, int32_t>::iterator iterCode = dictionary->codes.find(papszStrList->at(i));
+                if(iterCode == dictionary->codes.end())
+                {
+                    codes[i] = (int32_t)dictionary->values.size();
+                    dictionary->codes.insert(std::pair<std::string, int32_t>(papszStrList->at(i), codes[i]));
+                    dictionary->values.push_back(papszStrList->at(i));
+                }
+                else
+                {
+                    codes[i] = iterCode->second;
+                }
+            }
+            if(dictionary->values.size() > firstNew)
+            {
+                this->appendStringDictionary(colIdx, firstNew);
+            }
+            if(len > 0)
+            {
+                this->writeStringCodes(startfid, len, colIdx, &codes[0]);
+            }
+            return;
+        }
+        
         try
         {
             if(papszStrList->size() != len)
@@ -1149,17 +1601,15 @@ namespace kealib{
                 throw KEAATTException("The number of items in the vector<std::string> passed was not equal to the length specified.");
             }
             
-            H5::DataSet strDataset;
+            H5::DataSet *strDataset = this->getCachedDataset(KEA_ATT_STRING_DATA, &this->cachedStringDataset);
             H5::DataSpace strDataspace;
             H5::DataSpace strFieldsMemspace;
-            H5::CompType *strTypeMem = KEAAttributeTable::createKeaStringCompTypeMem();
             hsize_t strFieldsOffset[2];
             hsize_t strFieldsCount[2];
             hsize_t strFieldsDimsRead[2];
             hsize_t strFieldsOffset_out[2];
             hsize_t strFieldsCount_out[2];
-            strDataset = keaImg->openDataSet( (bandPathBase + KEA_ATT_STRING_DATA) );
-            strDataspace = strDataset.getSpace();
+            strDataspace = strDataset->getSpace();
             KEAString *stringVals = new KEAString[len];
             
             int strNDims = strDataspace.getSimpleExtentNdims();
@@ -1169,7 +1619,7 @@ namespace kealib{
                 throw KEAIOException("The str datasets needs to have 2 dimensions.");
             }
             
-            hsize_t *strDims = new hsize_t[strNDims];
+            hsize_t strDims[2];
             strDataspace.getSimpleExtentDims(strDims);
             
             if(numRows > strDims[0])
@@ -1181,7 +1631,6 @@ namespace kealib{
             {
                 throw KEAIOException("The number of str fields is smaller than expected.");
             }
-            delete[] strDims;
             
             strFieldsOffset[0] = startfid;
             strFieldsOffset[1] = colIdx;
@@ -1207,12 +1656,10 @@ namespace kealib{
                 stringVals[i].str = const_cast<char*>(papszStrList->at(i).c_str());
             }
             
-            strDataset.write(stringVals, *strTypeMem, strFieldsMemspace, strDataspace);
+            strDataset->write(stringVals, *this->strTypeMem, strFieldsMemspace, strDataspace);
             
-            strDataset.close();
             strDataspace.close();
             strFieldsMemspace.close();
-            delete strTypeMem;
             delete[] stringVals;
         }
         catch(H5::Exception &e)
@@ -1237,12 +1684,30 @@ namespace kealib{
     {
         //throw KEAATTException("KEAAttributeTableFile::setNeighbours(size_t startfid, size_t len, std::vector<size_t> neighbours) is not implemented.");
         
+        if(neighboursLayout == kea_att_neighbours_csr)
+        {
+            if(neighbours->size() < len)
+            {
+                throw KEAATTException("Fewer neighbour lists were provided than rows to be written.");
+            }
+            std::vector<size_t> offsets(1, 0);
+            offsets.reserve(len + 1);
+            std::vector<size_t> indices;
+            for(size_t i = 0; i < len; ++i)
+            {
+                indices.insert(indices.end(), (*neighbours)[i]->begin(), (*neighbours)[i]->end());
+                offsets.push_back(indices.size());
+            }
+            this->setNeighboursCSR(startfid, len, &offsets[0], indices.empty()?NULL:&indices[0]);
+            return;
+        }
+        
         try
         {
             H5::DataSet *neighboursDataset = NULL;
             try
             {
-                neighboursDataset = new H5::DataSet(keaImg->openDataSet(bandPathBase + KEA_ATT_NEIGHBOURS_DATA));
+                neighboursDataset = this->getCachedDataset(KEA_ATT_NEIGHBOURS_DATA, &this->cachedNeighboursDataset);
                 H5::DataSpace dimsDataSpace = neighboursDataset->getSpace();
                 
                 hsize_t dataDims[1];
@@ -1282,6 +1747,7 @@ namespace kealib{
                 
                 neighboursDataset = new H5::DataSet(keaImg->createDataSet((bandPathBase + KEA_ATT_NEIGHBOURS_DATA), intVarLenDiskDT, neighboursDataspace, creationNeighboursDSPList));
                 neighboursDataspace.close();
+                this->cachedNeighboursDataset = neighboursDataset;
             }
             
             VarLenFieldHDF *neighbourVals = new VarLenFieldHDF[len];
@@ -1290,7 +1756,6 @@ namespace kealib{
             neighboursDataOffset[0] = startfid;
             hsize_t neighboursDataDims[1];
             neighboursDataDims[0] = len;
-            H5::DataType intVarLenMemDT = H5::VarLenType(&H5::PredType::NATIVE_HSIZE);
             H5::DataSpace memNeighboursDataspace = H5::DataSpace(1, neighboursDataDims);
             
             
@@ -1314,7 +1779,7 @@ namespace kealib{
             
             H5::DataSpace neighboursWriteDataSpace = neighboursDataset->getSpace();
             neighboursWriteDataSpace.selectHyperslab(H5S_SELECT_SET, neighboursDataDims, neighboursDataOffset);
-            neighboursDataset->write(neighbourVals, intVarLenMemDT, memNeighboursDataspace, neighboursWriteDataSpace);
+            neighboursDataset->write(neighbourVals, *this->neighboursTypeMem, memNeighboursDataspace, neighboursWriteDataSpace);
             neighboursWriteDataSpace.close();
             
             for(size_t i = 0; i < len; ++i)
@@ -1325,8 +1790,7 @@ namespace kealib{
                     delete[] ((hsize_t*)neighbourVals[i].p);
                 }
             }
-            
-            
+            delete[] neighbourVals;
         }
         catch(H5::Exception &e)
         {
@@ -1538,21 +2002,24 @@ namespace kealib{
         
         // expand or create bool_DATA
         H5::DataSet *boolDataset = NULL;
+        bool lazy = false;
         try
         {
-            boolDataset = new H5::DataSet(keaImg->openDataSet(bandPathBase + KEA_ATT_BOOL_DATA));
+            boolDataset = this->getCachedDataset(KEA_ATT_BOOL_DATA, &this->cachedBoolDataset);
             
-            hsize_t extendDatasetTo[2];
-            extendDatasetTo[0] = this->numRows;
-            extendDatasetTo[1] = this->numBoolFields+1;
-            boolDataset->extend(extendDatasetTo);
-            // TODO: don't know how to set reset the fill value
+            this->extendRowDataset(boolDataset, this->numBoolFields+1);
+            
+            // THE NEW COLUMN READS AS THE DATASET FILL VALUE SO IF THAT ISN'T
+            // THE DEFAULT RECORD IT AND MATERIALISE THE COLUMN ON FIRST WRITE.
+            int fill = 0;
+            boolDataset->getCreatePlist().getFillValue(H5::PredType::NATIVE_INT, &fill);
+            lazy = ((fill != 0) != val);
             
         }
         catch(H5::Exception &e)
         {
             hsize_t initDimsbools[2];
-            initDimsbools[0] = numRows;
+            initDimsbools[0] = reservedRows;
             initDimsbools[1] = this->numBoolFields+1;
             hsize_t maxDimsbool[2];
             maxDimsbool[0] = H5S_UNLIMITED;
@@ -1572,9 +2039,12 @@ namespace kealib{
             
             boolDataset = new H5::DataSet(keaImg->createDataSet((bandPathBase + KEA_ATT_BOOL_DATA), H5::PredType::STD_I8LE, boolDataSpace, creationboolDSPList));
             boolDataSpace.close();
+            this->cachedBoolDataset = boolDataset;
         }
-        boolDataset->close();
-        delete boolDataset;
+        
+        boolDefaults.push_back((val? 1:0));
+        boolLazy.push_back(lazy? 1:0);
+        this->writeColumnDefaults(kea_att_bool);
     }
     
     void KEAAttributeTableFile::addAttIntField(KEAATTField field, int64_t val)
@@ -1674,21 +2144,24 @@ namespace kealib{
         
         // expand or create INT_DATA
         H5::DataSet *intDataset = NULL;
+        bool lazy = false;
         try
         {
-            intDataset = new H5::DataSet(keaImg->openDataSet(bandPathBase + KEA_ATT_INT_DATA));
+            intDataset = this->getCachedDataset(KEA_ATT_INT_DATA, &this->cachedIntDataset);
             
-            hsize_t extendDatasetTo[2];
-            extendDatasetTo[0] = this->numRows;
-            extendDatasetTo[1] = this->numIntFields+1;
-            intDataset->extend(extendDatasetTo);
-            // TODO: don't know how to set reset the fill value
+            this->extendRowDataset(intDataset, this->numIntFields+1);
+            
+            // THE NEW COLUMN READS AS THE DATASET FILL VALUE SO IF THAT ISN'T
+            // THE DEFAULT RECORD IT AND MATERIALISE THE COLUMN ON FIRST WRITE.
+            int64_t fill = 0;
+            intDataset->getCreatePlist().getFillValue(H5::PredType::NATIVE_INT64, &fill);
+            lazy = (fill != val);
             
         }
         catch(H5::Exception &e)
         {
             hsize_t initDimsInts[2];
-            initDimsInts[0] = numRows;
+            initDimsInts[0] = reservedRows;
             initDimsInts[1] = this->numIntFields+1;
             hsize_t maxDimsInt[2];
             maxDimsInt[0] = H5S_UNLIMITED;
@@ -1707,9 +2180,12 @@ namespace kealib{
             
             intDataset = new H5::DataSet(keaImg->createDataSet((bandPathBase + KEA_ATT_INT_DATA), H5::PredType::STD_I64LE, intDataSpace, creationIntDSPList));
             intDataSpace.close();
+            this->cachedIntDataset = intDataset;
         }
-        intDataset->close();
-        delete intDataset;
+        
+        intDefaults.push_back(val);
+        intLazy.push_back(lazy? 1:0);
+        this->writeColumnDefaults(kea_att_int);
     }
     
     void KEAAttributeTableFile::addAttFloatField(KEAATTField field, float val)
@@ -1809,21 +2285,24 @@ namespace kealib{
         
         // expand or create float_DATA
         H5::DataSet *floatDataset = NULL;
+        bool lazy = false;
         try
         {
-            floatDataset = new H5::DataSet(keaImg->openDataSet(bandPathBase + KEA_ATT_FLOAT_DATA));
+            floatDataset = this->getCachedDataset(KEA_ATT_FLOAT_DATA, &this->cachedFloatDataset);
             
-            hsize_t extendDatasetTo[2];
-            extendDatasetTo[0] = this->numRows;
-            extendDatasetTo[1] = this->numFloatFields+1;
-            floatDataset->extend(extendDatasetTo);
-            // TODO: don't know how to set reset the fill value
+            this->extendRowDataset(floatDataset, this->numFloatFields+1);
+            
+            // THE NEW COLUMN READS AS THE DATASET FILL VALUE SO IF THAT ISN'T
+            // THE DEFAULT RECORD IT AND MATERIALISE THE COLUMN ON FIRST WRITE.
+            double fill = 0;
+            floatDataset->getCreatePlist().getFillValue(H5::PredType::NATIVE_DOUBLE, &fill);
+            lazy = (fill != val);
             
         }
         catch(H5::Exception &e)
         {
             hsize_t initDimsfloats[2];
-            initDimsfloats[0] = numRows;
+            initDimsfloats[0] = reservedRows;
             initDimsfloats[1] = this->numFloatFields+1;
             hsize_t maxDimsfloat[2];
             maxDimsfloat[0] = H5S_UNLIMITED;
@@ -1838,13 +2317,16 @@ namespace kealib{
             creationfloatDSPList.setChunk(2, dimsfloatChunk);
             creationfloatDSPList.setShuffle();
             creationfloatDSPList.setDeflate(deflate);
-            creationfloatDSPList.setFillValue( H5::PredType::NATIVE_FLOAT, &val);
+            creationfloatDSPList.setFillValue( H5::PredType::NATIVE_DOUBLE, &val);
             
             floatDataset = new H5::DataSet(keaImg->createDataSet((bandPathBase + KEA_ATT_FLOAT_DATA), H5::PredType::IEEE_F64LE, floatDataSpace, creationfloatDSPList));
             floatDataSpace.close();
+            this->cachedFloatDataset = floatDataset;
         }
-        floatDataset->close();
-        delete floatDataset;
+        
+        floatDefaults.push_back(val);
+        floatLazy.push_back(lazy? 1:0);
+        this->writeColumnDefaults(kea_att_float);
     }
     
     void KEAAttributeTableFile::addAttStringField(KEAATTField field, const std::string &val)
@@ -1946,21 +2428,26 @@ namespace kealib{
         
         // expand or create string_DATA
         H5::DataSet *stringDataset = NULL;
+        bool lazy = false;
         try
         {
-            stringDataset = new H5::DataSet(keaImg->openDataSet(bandPathBase + KEA_ATT_STRING_DATA));
+            stringDataset = this->getCachedDataset(KEA_ATT_STRING_DATA, &this->cachedStringDataset);
             
-            hsize_t extendDatasetTo[2];
-            extendDatasetTo[0] = this->numRows;
-            extendDatasetTo[1] = this->numStringFields+1;
-            stringDataset->extend(extendDatasetTo);
-            // TODO: don't know how to set reset the fill value
+            this->extendRowDataset(stringDataset, this->numStringFields+1);
+            
+            // THE NEW COLUMN READS AS THE DATASET FILL VALUE SO IF THAT ISN'T
+            // THE DEFAULT RECORD IT AND MATERIALISE THE COLUMN ON FIRST WRITE.
+            KEAString fill = KEAString();
+            fill.str = NULL;
+            stringDataset->getCreatePlist().getFillValue(*strTypeMem, &fill);
+            lazy = (val != ((fill.str != NULL)? fill.str : ""));
+            free(fill.str);
             
         }
         catch(H5::Exception &e)
         {
             hsize_t initDimsstrings[2];
-            initDimsstrings[0] = numRows;
+            initDimsstrings[0] = reservedRows;
             initDimsstrings[1] = this->numStringFields+1;
             hsize_t maxDimsstring[2];
             maxDimsstring[0] = H5S_UNLIMITED;
@@ -1981,206 +2468,1872 @@ namespace kealib{
             
             stringDataset = new H5::DataSet(keaImg->createDataSet((bandPathBase + KEA_ATT_STRING_DATA), *strTypeMem, stringDataSpace, creationstringDSPList));
             stringDataSpace.close();
+            this->cachedStringDataset = stringDataset;
         }
-        stringDataset->close();
-        delete stringDataset;
         delete strTypeMem;
+        
+        stringDefaults.push_back(val);
+        stringLazy.push_back(lazy? 1:0);
+        stringEncoding.push_back(kea_att_str_plain);
+        this->writeColumnDefaults(kea_att_string);
     }
     
-    void KEAAttributeTableFile::addRows(size_t numRowsIn)
+    void KEAAttributeTableFile::readColumnFills(int *boolFill, int64_t *intFill, double *floatFill, std::string *stringFill) const
     {
-        if( numRowsIn > 0 )
+        // THE VALUE UNWRITTEN ROWS OF EACH DATA TABLE READ AS, LEFT AS PASSED IN
+        // WHERE THE TABLE DOESN'T EXIST YET
+        if(numBoolFields > 0)
         {
-            // update header
-            numRows += numRowsIn;
-            updateSizeHeader(numBoolFields, numIntFields, numFloatFields, numStringFields);
-            
-            // extend the various data tables if they exist
-            hsize_t extendDatasetTo[2];
-            extendDatasetTo[0] = this->numRows;
-            try
+            H5::DataSet *boolDataset = this->getCachedDataset(KEA_ATT_BOOL_DATA, &this->cachedBoolDataset);
+            boolDataset->getCreatePlist().getFillValue(H5::PredType::NATIVE_INT, boolFill);
+        }
+        if(numIntFields > 0)
+        {
+            H5::DataSet *intDataset = this->getCachedDataset(KEA_ATT_INT_DATA, &this->cachedIntDataset);
+            intDataset->getCreatePlist().getFillValue(H5::PredType::NATIVE_INT64, intFill);
+        }
+        if(numFloatFields > 0)
+        {
+            H5::DataSet *floatDataset = this->getCachedDataset(KEA_ATT_FLOAT_DATA, &this->cachedFloatDataset);
+            floatDataset->getCreatePlist().getFillValue(H5::PredType::NATIVE_DOUBLE, floatFill);
+        }
+        if(numStringFields > 0)
+        {
+            H5::DataSet *stringDataset = this->getCachedDataset(KEA_ATT_STRING_DATA, &this->cachedStringDataset);
+            KEAString fill = KEAString();
+            fill.str = NULL;
+            stringDataset->getCreatePlist().getFillValue(*strTypeMem, &fill);
+            *stringFill = (fill.str != NULL)? fill.str : "";
+            free(fill.str);
+        }
+    }
+    
+    void KEAAttributeTableFile::loadColumnDefaults()
+    {
+        // FILES WRITTEN WITHOUT THE DEFAULTS HEADERS GIVE NEW ROWS THE FILL VALUE
+        int boolFill = 0;
+        int64_t intFill = 0;
+        double floatFill = 0;
+        std::string stringFill = "";
+        this->readColumnFills(&boolFill, &intFill, &floatFill, &stringFill);
+        
+        boolDefaults.assign(numBoolFields, (boolFill != 0)? 1:0);
+        boolLazy.assign(numBoolFields, 0);
+        intDefaults.assign(numIntFields, intFill);
+        intLazy.assign(numIntFields, 0);
+        floatDefaults.assign(numFloatFields, floatFill);
+        floatLazy.assign(numFloatFields, 0);
+        stringDefaults.assign(numStringFields, stringFill);
+        stringLazy.assign(numStringFields, 0);
+        
+        // FILES WRITTEN WITHOUT THESE HEADERS HAVE NO LAZY COLUMNS
+        if(numBoolFields > 0)
+        {
+            readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_BOOL_DEFAULTS_HEADER, H5::PredType::NATIVE_UINT8, numBoolFields, &boolDefaults[0]);
+            readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_BOOL_LAZY_HEADER, H5::PredType::NATIVE_UINT8, numBoolFields, &boolLazy[0]);
+        }
+        if(numIntFields > 0)
+        {
+            readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_INT_DEFAULTS_HEADER, H5::PredType::NATIVE_INT64, numIntFields, &intDefaults[0]);
+            readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_INT_LAZY_HEADER, H5::PredType::NATIVE_UINT8, numIntFields, &intLazy[0]);
+        }
+        if(numFloatFields > 0)
+        {
+            readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_FLOAT_DEFAULTS_HEADER, H5::PredType::NATIVE_DOUBLE, numFloatFields, &floatDefaults[0]);
+            readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_FLOAT_LAZY_HEADER, H5::PredType::NATIVE_UINT8, numFloatFields, &floatLazy[0]);
+        }
+        if(numStringFields > 0)
+        {
+            KEAString *stringVals = new KEAString[numStringFields];
+            H5::DSetMemXferPropList xfer;
+            /* Ensures that malloc()/free() are from the same C runtime */
+            xfer.setVlenMemManager(kealibmalloc, NULL, kealibfree, NULL);
+            size_t numRead = readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_STRING_DEFAULTS_HEADER, *strTypeMem, numStringFields, stringVals, &xfer);
+            for(size_t i = 0; i < numRead; ++i)
             {
-                H5::DataSet *boolDataset = new H5::DataSet(keaImg->openDataSet(bandPathBase + KEA_ATT_BOOL_DATA));
-                extendDatasetTo[1] = this->numBoolFields;
-                boolDataset->extend(extendDatasetTo);
-                boolDataset->close();
-                delete boolDataset;
+                if(stringVals[i].str != NULL)
+                {
+                    stringDefaults[i] = std::string(stringVals[i].str);
+                    free(stringVals[i].str);
+                }
             }
-            catch(H5::Exception &e)
+            delete[] stringVals;
+            readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_STRING_LAZY_HEADER, H5::PredType::NATIVE_UINT8, numStringFields, &stringLazy[0]);
+        }
+    }
+    
+    void KEAAttributeTableFile::writeColumnDefaults(KEAFieldDataType dataType)
+    {
+        try
+        {
+            if((dataType == kea_att_bool) && !boolDefaults.empty())
             {
-                // can't exist
+                writeATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_BOOL_DEFAULTS_HEADER, H5::PredType::STD_U8LE, H5::PredType::NATIVE_UINT8, boolDefaults.size(), &boolDefaults[0], chunkSize, deflate);
+                writeATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_BOOL_LAZY_HEADER, H5::PredType::STD_U8LE, H5::PredType::NATIVE_UINT8, boolLazy.size(), &boolLazy[0], chunkSize, deflate);
             }
-            
-            try
+            else if((dataType == kea_att_int) && !intDefaults.empty())
             {
-                H5::DataSet *intDataset = new H5::DataSet(keaImg->openDataSet(bandPathBase + KEA_ATT_INT_DATA));
-                extendDatasetTo[1] = this->numIntFields;
-                intDataset->extend(extendDatasetTo);
-                intDataset->close();
-                delete intDataset;
+                writeATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_INT_DEFAULTS_HEADER, H5::PredType::STD_I64LE, H5::PredType::NATIVE_INT64, intDefaults.size(), &intDefaults[0], chunkSize, deflate);
+                writeATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_INT_LAZY_HEADER, H5::PredType::STD_U8LE, H5::PredType::NATIVE_UINT8, intLazy.size(), &intLazy[0], chunkSize, deflate);
             }
-            catch(H5::Exception &e)
+            else if((dataType == kea_att_float) && !floatDefaults.empty())
             {
-                // can't exist
+                writeATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_FLOAT_DEFAULTS_HEADER, H5::PredType::IEEE_F64LE, H5::PredType::NATIVE_DOUBLE, floatDefaults.size(), &floatDefaults[0], chunkSize, deflate);
+                writeATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_FLOAT_LAZY_HEADER, H5::PredType::STD_U8LE, H5::PredType::NATIVE_UINT8, floatLazy.size(), &floatLazy[0], chunkSize, deflate);
             }
-            
-            try
+            else if((dataType == kea_att_string) && !stringDefaults.empty())
             {
-                H5::DataSet *floatDataset = new H5::DataSet(keaImg->openDataSet(bandPathBase + KEA_ATT_FLOAT_DATA));
-                extendDatasetTo[1] = this->numFloatFields;
-                floatDataset->extend(extendDatasetTo);
-                floatDataset->close();
-                delete floatDataset;
+                KEAString *stringVals = new KEAString[stringDefaults.size()];
+                for(size_t i = 0; i < stringDefaults.size(); ++i)
+                {
+                    stringVals[i].str = const_cast<char*>(stringDefaults[i].c_str());
+                }
+                writeATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_STRING_DEFAULTS_HEADER, *strTypeMem, *strTypeMem, stringDefaults.size(), stringVals, chunkSize, deflate);
+                delete[] stringVals;
+                writeATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_STRING_LAZY_HEADER, H5::PredType::STD_U8LE, H5::PredType::NATIVE_UINT8, stringLazy.size(), &stringLazy[0], chunkSize, deflate);
             }
-            catch(H5::Exception &e)
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAATTException(e.getDetailMsg());
+        }
+    }
+    
+    void KEAAttributeTableFile::writeDefaultsToRows(size_t startfid, size_t len)
+    {
+        // NEW ROWS READ AS THE FILL VALUE OF THEIR DATA TABLE, WHICH IS ONLY THE
+        // DEFAULT OF THE COLUMN THE TABLE WAS CREATED FOR. LAZY COLUMNS ALREADY
+        // READ AS THEIR DEFAULT AND DICTIONARY CODES FILL WITH THE DEFAULT CODE.
+        int boolFill = 0;
+        int64_t intFill = 0;
+        double floatFill = 0;
+        std::string stringFill = "";
+        try
+        {
+            this->readColumnFills(&boolFill, &intFill, &floatFill, &stringFill);
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAATTException(e.getDetailMsg());
+        }
+        
+        size_t batchLen = std::min(len, chunkSize * KEA_ATT_MATERIALISE_CHUNKS);
+        size_t endfid = startfid + len;
+        for(size_t i = 0; i < boolDefaults.size(); ++i)
+        {
+            if((boolLazy[i] == 0) && ((boolDefaults[i] != 0) != (boolFill != 0)))
             {
-                // can't exist
+                bool *boolVals = new bool[batchLen];
+                std::fill(boolVals, boolVals + batchLen, (bool)boolDefaults[i]);
+                try
+                {
+                    for(size_t rowOff = startfid; rowOff < endfid; rowOff += batchLen)
+                    {
+                        this->setBoolFields(rowOff, std::min(batchLen, endfid - rowOff), i, boolVals);
+                    }
+                }
+                catch(KEAException &e)
+                {
+                    delete[] boolVals;
+                    throw;
+                }
+                delete[] boolVals;
             }
-            
-            try
+        }
+        for(size_t i = 0; i < intDefaults.size(); ++i)
+        {
+            if((intLazy[i] == 0) && (intDefaults[i] != intFill))
             {
-                H5::DataSet *stringDataset = new H5::DataSet(keaImg->openDataSet(bandPathBase + KEA_ATT_STRING_DATA));
-                extendDatasetTo[1] = this->numStringFields;
-                stringDataset->extend(extendDatasetTo);
-                stringDataset->close();
-                delete stringDataset;
+                std::vector<int64_t> intVals(batchLen, intDefaults[i]);
+                for(size_t rowOff = startfid; rowOff < endfid; rowOff += batchLen)
+                {
+                    this->setIntFields(rowOff, std::min(batchLen, endfid - rowOff), i, &intVals[0]);
+                }
             }
-            catch(H5::Exception &e)
+        }
+        for(size_t i = 0; i < floatDefaults.size(); ++i)
+        {
+            if((floatLazy[i] == 0) && (floatDefaults[i] != floatFill))
+            {
+                std::vector<double> floatVals(batchLen, floatDefaults[i]);
+                for(size_t rowOff = startfid; rowOff < endfid; rowOff += batchLen)
+                {
+                    this->setFloatFields(rowOff, std::min(batchLen, endfid - rowOff), i, &floatVals[0]);
+                }
+            }
+        }
+        for(size_t i = 0; i < stringDefaults.size(); ++i)
+        {
+            if((stringLazy[i] == 0) && (stringEncoding[i] != kea_att_str_dictionary) && (stringDefaults[i] != stringFill))
             {
-                // can't exist
+                std::vector<std::string> stringVals(batchLen, stringDefaults[i]);
+                for(size_t rowOff = startfid; rowOff < endfid; rowOff += batchLen)
+                {
+                    size_t runLen = std::min(batchLen, endfid - rowOff);
+                    if(runLen < batchLen)
+                    {
+                        stringVals.resize(runLen);
+                    }
+                    this->setStringFields(rowOff, runLen, i, &stringVals);
+                }
             }
         }
     }
     
-    KEAAttributeTable* KEAAttributeTableFile::createKeaAtt(H5::H5File *keaImg, unsigned int band, unsigned int chunkSizeIn, unsigned int deflate)
+    void KEAAttributeTableFile::materialiseBoolField(size_t colIdx, size_t skipStart, size_t skipLen)
     {
-        // Create instance of class to populate and return.
-        std::string bandPathBase = KEA_DATASETNAME_BAND + uint2Str(band);
-        KEAAttributeTableFile *att = NULL;
-        
+        // clear the flag first so the writes below go to the file
+        boolLazy[colIdx] = 0;
+        size_t batchLen = std::min(numRows, chunkSize * KEA_ATT_MATERIALISE_CHUNKS);
+        bool *boolVals = new bool[batchLen];
+        std::fill(boolVals, boolVals + batchLen, (bool)boolDefaults[colIdx]);
         try
         {
-            // Read header size.
-            hsize_t attSize[5];
-            try
+            size_t rowOff = 0;
+            size_t runLen = 0;
+            while((runLen = keaATTNextFillRun(&rowOff, numRows, batchLen, skipStart, skipLen)) > 0)
             {
-                hsize_t dimsValue[1];
-                dimsValue[0] = 5;
-                H5::DataSpace valueDataSpace(1, dimsValue);
-                H5::DataSet datasetAttSize = keaImg->openDataSet( bandPathBase + KEA_ATT_SIZE_HEADER );
-                datasetAttSize.read(attSize, H5::PredType::NATIVE_HSIZE, valueDataSpace);
-                datasetAttSize.close();
-                valueDataSpace.close();
+                this->setBoolFields(rowOff, runLen, colIdx, boolVals);
+                rowOff += runLen;
             }
-            catch (H5::Exception &e)
+            this->writeColumnDefaults(kea_att_bool);
+        }
+        catch(KEAException &e)
+        {
+            boolLazy[colIdx] = 1;
+            delete[] boolVals;
+            throw;
+        }
+        delete[] boolVals;
+    }
+    
+    void KEAAttributeTableFile::materialiseIntField(size_t colIdx, size_t skipStart, size_t skipLen)
+    {
+        // clear the flag first so the writes below go to the file
+        intLazy[colIdx] = 0;
+        size_t batchLen = std::min(numRows, chunkSize * KEA_ATT_MATERIALISE_CHUNKS);
+        int64_t *intVals = new int64_t[batchLen];
+        std::fill(intVals, intVals + batchLen, intDefaults[colIdx]);
+        try
+        {
+            size_t rowOff = 0;
+            size_t runLen = 0;
+            while((runLen = keaATTNextFillRun(&rowOff, numRows, batchLen, skipStart, skipLen)) > 0)
             {
-                throw KEAIOException("The attribute table size field is not present.");
+                this->setIntFields(rowOff, runLen, colIdx, intVals);
+                rowOff += runLen;
             }
-            
-            size_t numRows = attSize[0];
-            // READ ATTRIBUTE TABLE FROM KEA IMAGE BAND...
-            
-            // READ THE CHUNK SIZE - default to given
-            size_t chunkSize = chunkSizeIn;
-            try
+            this->writeColumnDefaults(kea_att_int);
+        }
+        catch(KEAException &e)
+        {
+            intLazy[colIdx] = 1;
+            delete[] intVals;
+            throw;
+        }
+        delete[] intVals;
+    }
+    
+    void KEAAttributeTableFile::materialiseFloatField(size_t colIdx, size_t skipStart, size_t skipLen)
+    {
+        // clear the flag first so the writes below go to the file
+        floatLazy[colIdx] = 0;
+        size_t batchLen = std::min(numRows, chunkSize * KEA_ATT_MATERIALISE_CHUNKS);
+        double *floatVals = new double[batchLen];
+        std::fill(floatVals, floatVals + batchLen, floatDefaults[colIdx]);
+        try
+        {
+            size_t rowOff = 0;
+            size_t runLen = 0;
+            while((runLen = keaATTNextFillRun(&rowOff, numRows, batchLen, skipStart, skipLen)) > 0)
             {
-                hsize_t dimsValue[1];
-                dimsValue[0] = 1;
-                H5::DataSpace valueDataSpace(1, dimsValue);
-                H5::DataSet datasetAttSize = keaImg->openDataSet( bandPathBase + KEA_ATT_CHUNKSIZE_HEADER );
-                hsize_t hChunkSize = 0;
-                datasetAttSize.read(&hChunkSize, H5::PredType::NATIVE_HSIZE, valueDataSpace);
-                datasetAttSize.close();
-                valueDataSpace.close();
-                if(hChunkSize > 0)
-                {
-                    chunkSize = hChunkSize;
-                }
+                this->setFloatFields(rowOff, runLen, colIdx, floatVals);
+                rowOff += runLen;
             }
-            catch(H5::Exception &e)
+            this->writeColumnDefaults(kea_att_float);
+        }
+        catch(KEAException &e)
+        {
+            floatLazy[colIdx] = 1;
+            delete[] floatVals;
+            throw;
+        }
+        delete[] floatVals;
+    }
+    
+    void KEAAttributeTableFile::materialiseStringField(size_t colIdx, size_t skipStart, size_t skipLen)
+    {
+        // clear the flag first so the writes below go to the file
+        stringLazy[colIdx] = 0;
+        size_t batchLen = std::min(numRows, chunkSize * KEA_ATT_MATERIALISE_CHUNKS);
+        std::vector<std::string> stringVals(batchLen, stringDefaults[colIdx]);
+        try
+        {
+            size_t rowOff = 0;
+            size_t runLen = 0;
+            while((runLen = keaATTNextFillRun(&rowOff, numRows, batchLen, skipStart, skipLen)) > 0)
             {
-                throw KEAIOException("The attribute table size field is not present.");
+                stringVals.resize(runLen, stringDefaults[colIdx]);
+                this->setStringFields(rowOff, runLen, colIdx, &stringVals);
+                rowOff += runLen;
             }
-            
-            att = new KEAAttributeTableFile(keaImg, bandPathBase, numRows, chunkSize, deflate);
-            
-            // READ TABLE HEADERS
-            H5::CompType *fieldCompTypeMem = KEAAttributeTable::createAttibuteIdxCompTypeMem();
-            
-            bool firstColNum = true;
-            
-            // READ BOOLEAN HEADERS
-            att->numBoolFields = attSize[1];
-            if(att->numBoolFields > 0)
+            this->writeColumnDefaults(kea_att_string);
+        }
+        catch(KEAException &e)
+        {
+            stringLazy[colIdx] = 1;
+            throw;
+        }
+    }
+    
+    void KEAAttributeTableFile::loadStringEncodings()
+    {
+        stringEncoding.assign(numStringFields, kea_att_str_plain);
+        if(numStringFields > 0)
+        {
+            readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_STRING_ENCODING_HEADER, H5::PredType::NATIVE_UINT8, numStringFields, &stringEncoding[0]);
+        }
+    }
+    
+    KEAATTStringDictionary* KEAAttributeTableFile::getStringDictionary(size_t colIdx) const
+    {
+        std::map<size_t, KEAATTStringDictionary>::iterator iterDict = stringDictionaries.find(colIdx);
+        if(iterDict != stringDictionaries.end())
+        {
+            return &iterDict->second;
+        }
+        
+        KEAATTStringDictionary *dictionary = &stringDictionaries[colIdx];
+        try
+        {
+            H5::DataSet dictDataset = keaImg->openDataSet(bandPathBase + KEA_ATT_STRING_DICT_DATA + sizet2Str(colIdx));
+            H5::DataSpace dictDataspace = dictDataset.getSpace();
+            hsize_t dictDims[1];
+            dictDataspace.getSimpleExtentDims(dictDims);
+            if(dictDims[0] > 0)
             {
-                try
-                {
-                    H5::DataSet boolFieldsDataset = keaImg->openDataSet( bandPathBase + KEA_ATT_BOOL_FIELDS_HEADER );
-                    
-                    H5::DataSpace boolFieldsDataspace = boolFieldsDataset.getSpace();
-                    hsize_t boolFieldOff[1];
-                    boolFieldOff[0] = 0;
-                    
-                    hsize_t boolFieldsDims[1];
-                    boolFieldsDims[0] = att->numBoolFields;
-                    H5::DataSpace boolFieldsMemspace(1, boolFieldsDims);
-                    
-                    boolFieldsDataspace.selectHyperslab( H5S_SELECT_SET, boolFieldsDims, boolFieldOff );
-                    
-                    KEAAttributeIdx *inFields = new KEAAttributeIdx[att->numBoolFields];
-                    
-                    boolFieldsDataset.read(inFields, *fieldCompTypeMem, boolFieldsMemspace, boolFieldsDataspace);
-                    
-                    KEAATTField field;
-                    for(unsigned int i = 0; i < att->numBoolFields; ++i)
-                    {
-                        field = KEAATTField();
-                        field.name = std::string(inFields[i].name);
-                        field.dataType = kea_att_bool;
-                        field.idx = inFields[i].idx;
-                        field.usage = std::string(inFields[i].usage);
-                        field.colNum = inFields[i].colNum;
-                        
-                        if(firstColNum)
-                        {
-                            if(field.colNum == 0)
-                            {
-                                att->numOfCols = 1;
-                            }
-                            else
-                            {
-                                att->numOfCols = field.colNum + 1;
-                            }
-                            firstColNum = false;
-                        }
-                        else if(field.colNum >= att->numOfCols)
-                        {
-                            att->numOfCols = field.colNum + 1;
-                        }
-                        
-                        att->fields->insert(std::pair<std::string, KEAATTField>(field.name, field));
-                    }
-                    
-                    boolFieldsDataset.close();
-                    boolFieldsDataspace.close();
-                    boolFieldsMemspace.close();
-                    
-                    delete[] inFields;
-                }
-                catch( H5::Exception &e )
+                KEAString *stringVals = new KEAString[dictDims[0]];
+                H5::DataSpace dictMemspace = H5::DataSpace(1, dictDims);
+                H5::DSetMemXferPropList xfer;
+                /* Ensures that malloc()/free() are from the same C runtime */
+                xfer.setVlenMemManager(kealibmalloc, NULL, kealibfree, NULL);
+                dictDataset.read(stringVals, *strTypeMem, dictMemspace, dictDataspace, xfer);
+                dictionary->values.reserve(dictDims[0]);
+                for(hsize_t i = 0; i < dictDims[0]; ++i)
                 {
-                    throw KEAIOException(e.getDetailMsg());
+                    dictionary->values.push_back((stringVals[i].str != NULL)? std::string(stringVals[i].str) : std::string(""));
+                    dictionary->codes.insert(std::pair<std::string, int32_t>(dictionary->values.back(), (int32_t)i));
+                    free(stringVals[i].str);
                 }
+                delete[] stringVals;
+                dictMemspace.close();
             }
-            
-            // READ INTEGER HEADERS
-            att->numIntFields = attSize[2];
-            if(att->numIntFields > 0)
+            dictDataspace.close();
+            dictDataset.close();
+        }
+        catch(H5::Exception &e)
+        {
+            stringDictionaries.erase(colIdx);
+            throw KEAATTException(e.getDetailMsg());
+        }
+        return dictionary;
+    }
+    
+    void KEAAttributeTableFile::appendStringDictionary(size_t colIdx, size_t firstNew)
+    {
+        KEAATTStringDictionary *dictionary = this->getStringDictionary(colIdx);
+        try
+        {
+            H5::DataSet dictDataset = keaImg->openDataSet(bandPathBase + KEA_ATT_STRING_DICT_DATA + sizet2Str(colIdx));
+            hsize_t dictDims[1];
+            dictDims[0] = dictionary->values.size();
+            dictDataset.extend(dictDims);
+            
+            hsize_t dictOffset[1];
+            dictOffset[0] = firstNew;
+            hsize_t dictCount[1];
+            dictCount[0] = dictionary->values.size() - firstNew;
+            H5::DataSpace dictDataspace = dictDataset.getSpace();
+            dictDataspace.selectHyperslab(H5S_SELECT_SET, dictCount, dictOffset);
+            H5::DataSpace dictMemspace = H5::DataSpace(1, dictCount);
+            
+            KEAString *stringVals = new KEAString[dictCount[0]];
+            for(hsize_t i = 0; i < dictCount[0]; ++i)
             {
-                try
-                {
-                    H5::DataSet intFieldsDataset = keaImg->openDataSet( bandPathBase + KEA_ATT_INT_FIELDS_HEADER );
-                    H5::DataSpace intFieldsDataspace = intFieldsDataset.getSpace();
+                stringVals[i].str = const_cast<char*>(dictionary->values[firstNew + i].c_str());
+            }
+            dictDataset.write(stringVals, *strTypeMem, dictMemspace, dictDataspace);
+            delete[] stringVals;
+            
+            dictMemspace.close();
+            dictDataspace.close();
+            dictDataset.close();
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAIOException(e.getDetailMsg());
+        }
+    }
+    
+    void KEAAttributeTableFile::readStringCodes(size_t startfid, size_t len, size_t colIdx, int32_t *pnCodes) const
+    {
+        try
+        {
+            H5::DataSet *codesDataset = this->getCachedDataset(KEA_ATT_STRING_CODES_DATA + sizet2Str(colIdx), &this->cachedCodesDatasets[colIdx]);
+            H5::DataSpace codesDataspace = codesDataset->getSpace();
+            hsize_t codesOffset[1];
+            codesOffset[0] = startfid;
+            hsize_t codesCount[1];
+            codesCount[0] = len;
+            codesDataspace.selectHyperslab(H5S_SELECT_SET, codesCount, codesOffset);
+            H5::DataSpace codesMemspace = H5::DataSpace(1, codesCount);
+            codesDataset->read(pnCodes, H5::PredType::NATIVE_INT32, codesMemspace, codesDataspace);
+            codesMemspace.close();
+            codesDataspace.close();
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAATTException(e.getDetailMsg());
+        }
+    }
+    
+    void KEAAttributeTableFile::writeStringCodes(size_t startfid, size_t len, size_t colIdx, const int32_t *pnCodes)
+    {
+        try
+        {
+            H5::DataSet *codesDataset = this->getCachedDataset(KEA_ATT_STRING_CODES_DATA + sizet2Str(colIdx), &this->cachedCodesDatasets[colIdx]);
+            H5::DataSpace codesDataspace = codesDataset->getSpace();
+            hsize_t codesOffset[1];
+            codesOffset[0] = startfid;
+            hsize_t codesCount[1];
+            codesCount[0] = len;
+            codesDataspace.selectHyperslab(H5S_SELECT_SET, codesCount, codesOffset);
+            H5::DataSpace codesMemspace = H5::DataSpace(1, codesCount);
+            codesDataset->write(pnCodes, H5::PredType::NATIVE_INT32, codesMemspace, codesDataspace);
+            codesMemspace.close();
+            codesDataspace.close();
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAIOException(e.getDetailMsg());
+        }
+    }
+    
+    void KEAAttributeTableFile::decodeStringCodes(size_t colIdx, const int32_t *pnCodes, size_t len, std::string *psVals, size_t stride) const
+    {
+        KEAATTStringDictionary *dictionary = this->getStringDictionary(colIdx);
+        int32_t numValues = (int32_t)dictionary->values.size();
+        for(size_t i = 0; i < len; ++i)
+        {
+            if((pnCodes[i] >= 0) && (pnCodes[i] < numValues))
+            {
+                psVals[i * stride] = dictionary->values[pnCodes[i]];
+            }
+            else
+            {
+                psVals[i * stride] = stringDefaults[colIdx];
+            }
+        }
+    }
+    
+    void KEAAttributeTableFile::dictionaryEncodeStringField(size_t colIdx)
+    {
+        if(colIdx >= numStringFields)
+        {
+            std::string message = std::string("Requested string column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
+            throw KEAATTException(message);
+        }
+        
+        if(stringEncoding[colIdx] == kea_att_str_dictionary)
+        {
+            return;
+        }
+        
+        try
+        {
+            std::string codesPath = bandPathBase + KEA_ATT_STRING_CODES_DATA + sizet2Str(colIdx);
+            std::string dictPath = bandPathBase + KEA_ATT_STRING_DICT_DATA + sizet2Str(colIdx);
+            // CLEAR OUT ANY DATASETS LEFT FROM A PREVIOUS ENCODING OF THE COLUMN
+            if(H5Lexists(keaImg->getId(), codesPath.c_str(), H5P_DEFAULT) > 0)
+            {
+                H5Ldelete(keaImg->getId(), codesPath.c_str(), H5P_DEFAULT);
+            }
+            if(H5Lexists(keaImg->getId(), dictPath.c_str(), H5P_DEFAULT) > 0)
+            {
+                H5Ldelete(keaImg->getId(), dictPath.c_str(), H5P_DEFAULT);
+            }
+            stringDictionaries.erase(colIdx);
+            
+            // CREATE THE CODES DATASET - UNWRITTEN ROWS ARE THE COLUMN DEFAULT
+            hsize_t codesDims[1];
+            codesDims[0] = reservedRows;
+            hsize_t maxCodesDims[1];
+            maxCodesDims[0] = H5S_UNLIMITED;
+            H5::DataSpace codesDataspace = H5::DataSpace(1, codesDims, maxCodesDims);
+            hsize_t dimsCodesChunk[1];
+            dimsCodesChunk[0] = chunkSize;
+            int32_t codesFill = -1;
+            H5::DSetCreatPropList creationCodesDSPList;
+            creationCodesDSPList.setChunk(1, dimsCodesChunk);
+            creationCodesDSPList.setShuffle();
+            creationCodesDSPList.setDeflate(deflate);
+            creationCodesDSPList.setFillValue(H5::PredType::NATIVE_INT32, &codesFill);
+            H5::DataSet codesDataset = keaImg->createDataSet(codesPath, H5::PredType::STD_I32LE, codesDataspace, creationCodesDSPList);
+            codesDataset.close();
+            codesDataspace.close();
+            
+            // CREATE AN EMPTY DICTIONARY
+            hsize_t dictDims[1];
+            dictDims[0] = 0;
+            hsize_t maxDictDims[1];
+            maxDictDims[0] = H5S_UNLIMITED;
+            H5::DataSpace dictDataspace = H5::DataSpace(1, dictDims, maxDictDims);
+            hsize_t dimsDictChunk[1];
+            dimsDictChunk[0] = chunkSize;
+            H5::DSetCreatPropList creationDictDSPList;
+            creationDictDSPList.setChunk(1, dimsDictChunk);
+            creationDictDSPList.setShuffle();
+            creationDictDSPList.setDeflate(deflate);
+            H5::DataSet dictDataset = keaImg->createDataSet(dictPath, *strTypeMem, dictDataspace, creationDictDSPList);
+            dictDataset.close();
+            dictDataspace.close();
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAIOException(e.getDetailMsg());
+        }
+        
+        // RE-WRITE THE CURRENT VALUES THROUGH THE DICTIONARY, A LAZY COLUMN
+        // ONLY NEEDS THE DEFAULT SO IS LEFT WITH THE FILL CODE.
+        if(!stringLazy[colIdx])
+        {
+            size_t batchLen = std::min(numRows, chunkSize * KEA_ATT_MATERIALISE_CHUNKS);
+            std::vector<std::string> stringVals;
+            for(size_t rowOff = 0; rowOff < numRows; rowOff += batchLen)
+            {
+                size_t runLen = std::min(batchLen, numRows - rowOff);
+                this->getStringFields(rowOff, runLen, colIdx, &stringVals);
+                stringEncoding[colIdx] = kea_att_str_dictionary;
+                this->setStringFields(rowOff, runLen, colIdx, &stringVals);
+                stringEncoding[colIdx] = kea_att_str_plain;
+            }
+        }
+        stringLazy[colIdx] = 0;
+        stringEncoding[colIdx] = kea_att_str_dictionary;
+        this->writeColumnDefaults(kea_att_string);
+        
+        try
+        {
+            writeATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_STRING_ENCODING_HEADER, H5::PredType::STD_U8LE, H5::PredType::NATIVE_UINT8, stringEncoding.size(), &stringEncoding[0], chunkSize, deflate);
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAIOException(e.getDetailMsg());
+        }
+    }
+    
+    bool KEAAttributeTableFile::isStringFieldDictionaryEncoded(size_t colIdx) const
+    {
+        if(colIdx >= numStringFields)
+        {
+            std::string message = std::string("Requested string column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
+            throw KEAATTException(message);
+        }
+        return (stringEncoding[colIdx] == kea_att_str_dictionary);
+    }
+    
+    void KEAAttributeTableFile::getStringFieldCodes(size_t startfid, size_t len, size_t colIdx, int32_t *pnCodes) const
+    {
+        if((startfid+len) > numRows)
+        {
+            std::string message = std::string("Requested feature (") + sizet2Str(startfid+len) + std::string(") is not within the table.");
+            throw KEAATTException(message);
+        }
+        
+        if(!this->isStringFieldDictionaryEncoded(colIdx))
+        {
+            std::string message = std::string("String column (") + sizet2Str(colIdx) + std::string(") is not dictionary encoded.");
+            throw KEAATTException(message);
+        }
+        
+        if(len > 0)
+        {
+            this->readStringCodes(startfid, len, colIdx, pnCodes);
+        }
+    }
+    
+    void KEAAttributeTableFile::getStringFieldDictionary(size_t colIdx, std::vector<std::string> *psDictionary) const
+    {
+        if(!this->isStringFieldDictionaryEncoded(colIdx))
+        {
+            std::string message = std::string("String column (") + sizet2Str(colIdx) + std::string(") is not dictionary encoded.");
+            throw KEAATTException(message);
+        }
+        
+        *psDictionary = this->getStringDictionary(colIdx)->values;
+    }
+    
+    void KEAAttributeTableFile::getNeighboursCSR(size_t startfid, size_t len, std::vector<size_t> *offsets, std::vector<size_t> *indices) const
+    {
+        if((startfid+len) > numRows)
+        {
+            std::string message = std::string("Requested feature (") + sizet2Str(startfid+len) + std::string(") is not within the table.");
+            throw KEAATTException(message);
+        }
+        
+        try
+        {
+            if(neighboursLayout == kea_att_neighbours_csr)
+            {
+                this->readNeighbourRows(startfid, len, offsets, indices);
+            }
+            else
+            {
+                readNeighboursCSR(keaImg, bandPathBase, neighboursLayout, startfid, len, offsets, indices);
+            }
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAIOException(e.getDetailMsg());
+        }
+    }
+    
+    KEAATTNeighboursLayout KEAAttributeTableFile::getNeighboursLayout() const
+    {
+        return neighboursLayout;
+    }
+    
+    void KEAAttributeTableFile::setNeighboursLayout(KEAATTNeighboursLayout layout)
+    {
+        if(layout == neighboursLayout)
+        {
+            return;
+        }
+        
+        this->flushNeighbourEdits();
+        try
+        {
+            size_t batchLen = std::max(std::min(numRows, chunkSize * KEA_ATT_MATERIALISE_CHUNKS), (size_t)1);
+            std::vector<size_t> offsets;
+            std::vector<size_t> indices;
+            this->closeCachedDataset(&this->cachedNeighboursDataset);
+            
+            if(layout == kea_att_neighbours_csr)
+            {
+                // ROWS MISSING FROM THE VARIABLE LENGTH DATASET HAVE NO NEIGHBOURS
+                size_t numStored = 0;
+                std::string neighboursPath = bandPathBase + KEA_ATT_NEIGHBOURS_DATA;
+                if(H5Lexists(keaImg->getId(), neighboursPath.c_str(), H5P_DEFAULT) > 0)
+                {
+                    H5::DataSet neighboursDataset = keaImg->openDataSet(neighboursPath);
+                    H5::DataSpace neighboursDataspace = neighboursDataset.getSpace();
+                    hsize_t neighboursDims[1];
+                    neighboursDataspace.getSimpleExtentDims(neighboursDims);
+                    numStored = std::min((size_t)neighboursDims[0], numRows);
+                    neighboursDataspace.close();
+                    neighboursDataset.close();
+                }
+                
+                createNeighboursCSR(keaImg, bandPathBase, numRows, chunkSize, deflate);
+                size_t numIndices = 0;
+                for(size_t rowOff = 0; rowOff < numStored; rowOff += batchLen)
+                {
+                    size_t runLen = std::min(batchLen, numStored - rowOff);
+                    readNeighboursCSR(keaImg, bandPathBase, kea_att_neighbours_varlen, rowOff, runLen, &offsets, &indices);
+                    writeNeighboursCSR(keaImg, bandPathBase, rowOff, runLen, &offsets[0], indices.empty()?NULL:&indices[0], numIndices);
+                    numIndices += indices.size();
+                }
+                if(numStored < numRows)
+                {
+                    std::vector<size_t> emptyOffsets(numRows - numStored + 1, 0);
+                    writeNeighboursCSR(keaImg, bandPathBase, numStored, numRows - numStored, &emptyOffsets[0], NULL, numIndices);
+                }
+                
+                // LEAVE EMPTY LISTS FOR READERS WHICH ONLY KNOW THE VARIABLE LENGTH LAYOUT
+                createVarLenNeighbours(keaImg, bandPathBase, numRows, chunkSize, deflate);
+            }
+            else
+            {
+                createVarLenNeighbours(keaImg, bandPathBase, numRows, chunkSize, deflate);
+                neighboursLayout = kea_att_neighbours_varlen;
+                
+                std::vector<std::vector<size_t> > rowNeighbours;
+                std::vector<std::vector<size_t>* > rowPtrs;
+                for(size_t rowOff = 0; rowOff < numRows; rowOff += batchLen)
+                {
+                    size_t runLen = std::min(batchLen, numRows - rowOff);
+                    readNeighboursCSR(keaImg, bandPathBase, kea_att_neighbours_csr, rowOff, runLen, &offsets, &indices);
+                    rowNeighbours.resize(runLen);
+                    rowPtrs.resize(runLen);
+                    for(size_t i = 0; i < runLen; ++i)
+                    {
+                        rowNeighbours[i].assign(indices.begin() + offsets[i], indices.begin() + offsets[i+1]);
+                        rowPtrs[i] = &rowNeighbours[i];
+                    }
+                    this->setNeighbours(rowOff, runLen, &rowPtrs);
+                }
+                
+                std::string offsetsPath = bandPathBase + KEA_ATT_NEIGHBOURS_OFFSETS_DATA;
+                std::string indicesPath = bandPathBase + KEA_ATT_NEIGHBOURS_INDICES_DATA;
+                H5Ldelete(keaImg->getId(), offsetsPath.c_str(), H5P_DEFAULT);
+                if(H5Lexists(keaImg->getId(), indicesPath.c_str(), H5P_DEFAULT) > 0)
+                {
+                    H5Ldelete(keaImg->getId(), indicesPath.c_str(), H5P_DEFAULT);
+                }
+            }
+            neighboursLayout = layout;
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAIOException(e.getDetailMsg());
+        }
+    }
+    
+    size_t KEAAttributeTableFile::readNeighbourOffset(size_t fid) const
+    {
+        H5::DataSet offsetsDataset = keaImg->openDataSet(bandPathBase + KEA_ATT_NEIGHBOURS_OFFSETS_DATA);
+        H5::DataSpace offsetsDataspace = offsetsDataset.getSpace();
+        hsize_t offsetsOffset[1];
+        offsetsOffset[0] = fid;
+        hsize_t offsetsCount[1];
+        offsetsCount[0] = 1;
+        offsetsDataspace.selectHyperslab(H5S_SELECT_SET, offsetsCount, offsetsOffset);
+        H5::DataSpace offsetsMemspace(1, offsetsCount);
+        hsize_t offset = 0;
+        offsetsDataset.read(&offset, H5::PredType::NATIVE_HSIZE, offsetsMemspace, offsetsDataspace);
+        offsetsMemspace.close();
+        offsetsDataspace.close();
+        offsetsDataset.close();
+        return offset;
+    }
+    
+    void KEAAttributeTableFile::setNeighboursCSR(size_t startfid, size_t len, const size_t *offsets, const size_t *indices)
+    {
+        if(neighboursLayout != kea_att_neighbours_csr)
+        {
+            // THE VARIABLE LENGTH DATASET IS WRITTEN ONE LIST PER ROW
+            KEAAttributeTable::setNeighboursCSR(startfid, len, offsets, indices);
+            return;
+        }
+        
+        if((startfid+len) > numRows)
+        {
+            std::string message = std::string("Requested feature (") + sizet2Str(startfid+len) + std::string(") is not within the table.");
+            throw KEAATTException(message);
+        }
+        if(len == 0)
+        {
+            return;
+        }
+        
+        try
+        {
+            // IF THE NUMBER OF INDICES CHANGES THE INDICES OF THE ROWS AFTER
+            // WOULD HAVE TO MOVE, SO HOLD THE ROWS UNTIL THEY ARE MERGED IN
+            size_t numIndices = offsets[len] - offsets[0];
+            size_t firstIndex = this->readNeighbourOffset(startfid);
+            size_t oldEnd = this->readNeighbourOffset(startfid + len);
+            if(((oldEnd - firstIndex) != numIndices) && ((startfid + len) < numRows))
+            {
+                for(size_t i = 0; i < len; ++i)
+                {
+                    neighbourEdits[startfid + i].assign(indices + offsets[i], indices + offsets[i+1]);
+                }
+                if(neighbourEdits.size() > (chunkSize * KEA_ATT_NEIGHBOUR_EDIT_CHUNKS))
+                {
+                    this->flushNeighbourEdits();
+                }
+                return;
+            }
+            
+            neighbourEdits.erase(neighbourEdits.lower_bound(startfid), neighbourEdits.lower_bound(startfid + len));
+            writeNeighboursCSR(keaImg, bandPathBase, startfid, len, offsets, indices, firstIndex);
+            this->trimNeighbourIndices();
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAIOException(e.getDetailMsg());
+        }
+    }
+    
+    void KEAAttributeTableFile::readNeighbourRows(size_t startfid, size_t len, std::vector<size_t> *offsets, std::vector<size_t> *indices) const
+    {
+        readNeighboursCSR(keaImg, bandPathBase, kea_att_neighbours_csr, startfid, len, offsets, indices);
+        
+        std::map<size_t, std::vector<size_t> >::const_iterator iterEdit = neighbourEdits.lower_bound(startfid);
+        if((iterEdit == neighbourEdits.end()) || (iterEdit->first >= (startfid + len)))
+        {
+            return;
+        }
+        
+        // THE ROWS HELD IN MEMORY REPLACE THOSE READ
+        std::vector<size_t> storedOffsets;
+        std::vector<size_t> storedIndices;
+        storedOffsets.swap(*offsets);
+        storedIndices.swap(*indices);
+        offsets->reserve(len + 1);
+        offsets->push_back(0);
+        indices->reserve(storedIndices.size());
+        for(size_t i = 0; i < len; ++i)
+        {
+            if((iterEdit != neighbourEdits.end()) && (iterEdit->first == (startfid + i)))
+            {
+                indices->insert(indices->end(), iterEdit->second.begin(), iterEdit->second.end());
+                ++iterEdit;
+            }
+            else
+            {
+                indices->insert(indices->end(), storedIndices.begin() + storedOffsets[i], storedIndices.begin() + storedOffsets[i+1]);
+            }
+            offsets->push_back(indices->size());
+        }
+    }
+    
+    void KEAAttributeTableFile::flushNeighbourEdits()
+    {
+        if(neighbourEdits.empty())
+        {
+            return;
+        }
+        
+        try
+        {
+            // ONE PASS REWRITING THE ROWS FROM THE FIRST ONE CHANGED
+            size_t firstRow = neighbourEdits.begin()->first;
+            std::vector<size_t> offsets;
+            std::vector<size_t> indices;
+            this->readNeighbourRows(firstRow, numRows - firstRow, &offsets, &indices);
+            writeNeighboursCSR(keaImg, bandPathBase, firstRow, numRows - firstRow, &offsets[0], indices.empty()?NULL:&indices[0], this->readNeighbourOffset(firstRow));
+            neighbourEdits.clear();
+            this->trimNeighbourIndices();
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAIOException(e.getDetailMsg());
+        }
+    }
+    
+    void KEAAttributeTableFile::trimNeighbourIndices()
+    {
+        // DROP ANY INDICES LEFT PAST THE END OF THE LAST ROW
+        hsize_t totalIndices[1];
+        totalIndices[0] = this->readNeighbourOffset(numRows);
+        H5::DataSet indicesDataset = keaImg->openDataSet(bandPathBase + KEA_ATT_NEIGHBOURS_INDICES_DATA);
+        H5::DataSpace indicesDataspace = indicesDataset.getSpace();
+        hsize_t indicesDims[1];
+        indicesDataspace.getSimpleExtentDims(indicesDims);
+        indicesDataspace.close();
+        if(indicesDims[0] > totalIndices[0])
+        {
+            H5Dset_extent(indicesDataset.getId(), totalIndices);
+        }
+        indicesDataset.close();
+    }
+    
+    // WHETHER ANY VALUE IN [minVal, maxVal] CAN SATISFY (value op cmpVal)
+    template <typename T>
+    static bool keaATTZoneMayMatch(KEAATTCompareOp op, T cmpVal, T minVal, T maxVal)
+    {
+        switch(op)
+        {
+            case kea_att_eq:
+                return (minVal <= cmpVal) && (cmpVal <= maxVal);
+            case kea_att_ne:
+                return !((minVal == cmpVal) && (maxVal == cmpVal));
+            case kea_att_lt:
+                return minVal < cmpVal;
+            case kea_att_le:
+                return minVal <= cmpVal;
+            case kea_att_gt:
+                return maxVal > cmpVal;
+            case kea_att_ge:
+                return maxVal >= cmpVal;
+        }
+        return true;
+    }
+    
+    size_t KEAAttributeTableFile::getScanBlockSize() const
+    {
+        return chunkSize;
+    }
+    
+    bool KEAAttributeTableFile::predicateMayMatch(const KEAATTPredicate &predicate, const KEAATTField &field, size_t startfid, size_t len) const
+    {
+        // A COLUMN WHICH HAS NOT BEEN WRITTEN HOLDS ITS DEFAULT IN EVERY ROW
+        if((field.dataType == kea_att_bool) && boolLazy[field.idx])
+        {
+            return evaluatePredicate(predicate.op, boolDefaults[field.idx]? 1 : 0, predicate.value);
+        }
+        else if((field.dataType == kea_att_int) && intLazy[field.idx])
+        {
+            return evaluatePredicate(predicate.op, (double)intDefaults[field.idx], predicate.value);
+        }
+        else if((field.dataType == kea_att_float) && floatLazy[field.idx])
+        {
+            return evaluatePredicate(predicate.op, floatDefaults[field.idx], predicate.value);
+        }
+        
+        size_t endChunk = (startfid + len + chunkSize - 1) / chunkSize;
+        if(field.dataType == kea_att_int)
+        {
+            std::map<size_t, std::vector<int64_t> >::const_iterator iterZones = intZoneMaps.find(field.idx);
+            if(iterZones != intZoneMaps.end())
+            {
+                KEAATTCompareOp intOp;
+                int64_t intValue = 0;
+                int constResult = rewriteIntPredicate(predicate.op, predicate.value, &intOp, &intValue);
+                if(constResult >= 0)
+                {
+                    return (constResult == 1);
+                }
+                const std::vector<int64_t> &zones = iterZones->second;
+                for(size_t c = startfid / chunkSize; c < endChunk; ++c)
+                {
+                    if(keaATTZoneMayMatch(intOp, intValue, zones[(c*2)], zones[(c*2)+1]))
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            }
+        }
+        else if(field.dataType == kea_att_float)
+        {
+            std::map<size_t, std::vector<double> >::const_iterator iterZones = floatZoneMaps.find(field.idx);
+            if(iterZones != floatZoneMaps.end())
+            {
+                const std::vector<double> &zones = iterZones->second;
+                for(size_t c = startfid / chunkSize; c < endChunk; ++c)
+                {
+                    // NaN != value IS ALWAYS TRUE, OTHERWISE A NaN NEVER MATCHES
+                    if((predicate.op == kea_att_ne) && (zones[(c*3)+2] > 0))
+                    {
+                        return true;
+                    }
+                    if((zones[(c*3)] <= zones[(c*3)+1]) && keaATTZoneMayMatch(predicate.op, predicate.value, zones[(c*3)], zones[(c*3)+1]))
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    void KEAAttributeTableFile::loadZoneMaps()
+    {
+        size_t numChunks = (numRows + chunkSize - 1) / chunkSize;
+        try
+        {
+            for(int t = 0; t < 2; ++t)
+            {
+                KEAFieldDataType dataType = (t == 0)? kea_att_int : kea_att_float;
+                size_t numFields = (t == 0)? numIntFields : numFloatFields;
+                size_t width = (t == 0)? 2 : 3;
+                for(size_t i = 0; i < numFields; ++i)
+                {
+                    std::string zonePath = bandPathBase + ((t == 0)? KEA_ATT_INT_ZONEMAP_HEADER : KEA_ATT_FLOAT_ZONEMAP_HEADER) + sizet2Str(i);
+                    if(H5Lexists(keaImg->getId(), zonePath.c_str(), H5P_DEFAULT) <= 0)
+                    {
+                        continue;
+                    }
+                    
+                    H5::DataSet zoneDataset = keaImg->openDataSet(zonePath);
+                    H5::DataSpace zoneDataspace = zoneDataset.getSpace();
+                    hsize_t zoneDims[2];
+                    zoneDataspace.getSimpleExtentDims(zoneDims);
+                    hsize_t zoneOffset[2];
+                    zoneOffset[0] = 0;
+                    zoneOffset[1] = 0;
+                    hsize_t zoneCount[2];
+                    zoneCount[0] = std::min((size_t)zoneDims[0], numChunks);
+                    zoneCount[1] = width;
+                    
+                    if(dataType == kea_att_int)
+                    {
+                        intZoneMaps[i].assign(numChunks * width, 0);
+                    }
+                    else
+                    {
+                        floatZoneMaps[i].assign(numChunks * width, 0);
+                    }
+                    if(zoneCount[0] > 0)
+                    {
+                        void *zoneVals = (dataType == kea_att_int)? (void*)&intZoneMaps[i][0] : (void*)&floatZoneMaps[i][0];
+                        zoneDataspace.selectHyperslab(H5S_SELECT_SET, zoneCount, zoneOffset);
+                        H5::DataSpace zoneMemspace = H5::DataSpace(2, zoneCount);
+                        if(dataType == kea_att_int)
+                        {
+                            zoneDataset.read(zoneVals, H5::PredType::NATIVE_INT64, zoneMemspace, zoneDataspace);
+                        }
+                        else
+                        {
+                            zoneDataset.read(zoneVals, H5::PredType::NATIVE_DOUBLE, zoneMemspace, zoneDataspace);
+                        }
+                        zoneMemspace.close();
+                    }
+                    zoneDataspace.close();
+                    zoneDataset.close();
+                    
+                    // A MAP WHICH DOES NOT COVER THE TABLE IS COMPLETED FROM THE DATA
+                    if(zoneCount[0] < numChunks)
+                    {
+                        if(dataType == kea_att_int)
+                        {
+                            this->computeIntZones(i, zoneCount[0], numChunks);
+                        }
+                        else
+                        {
+                            this->computeFloatZones(i, zoneCount[0], numChunks);
+                        }
+                    }
+                }
+            }
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAIOException(e.getDetailMsg());
+        }
+    }
+    
+    void KEAAttributeTableFile::computeIntZones(size_t colIdx, size_t firstChunk, size_t endChunk)
+    {
+        std::vector<int64_t> &zones = intZoneMaps[colIdx];
+        zones.resize(((numRows + chunkSize - 1) / chunkSize) * 2, 0);
+        
+        size_t batchLen = chunkSize * KEA_ATT_MATERIALISE_CHUNKS;
+        std::vector<int64_t> intVals;
+        size_t endRow = std::min(endChunk * chunkSize, numRows);
+        for(size_t rowOff = firstChunk * chunkSize; rowOff < endRow; rowOff += batchLen)
+        {
+            size_t runLen = std::min(batchLen, endRow - rowOff);
+            intVals.resize(runLen);
+            this->getIntFields(rowOff, runLen, colIdx, &intVals[0]);
+            for(size_t chunkOff = 0; chunkOff < runLen; chunkOff += chunkSize)
+            {
+                size_t c = (rowOff + chunkOff) / chunkSize;
+                size_t chunkLen = std::min(chunkSize, runLen - chunkOff);
+                int64_t minVal = intVals[chunkOff];
+                int64_t maxVal = intVals[chunkOff];
+                for(size_t n = chunkOff + 1; n < chunkOff + chunkLen; ++n)
+                {
+                    minVal = std::min(minVal, intVals[n]);
+                    maxVal = std::max(maxVal, intVals[n]);
+                }
+                zones[(c*2)] = minVal;
+                zones[(c*2)+1] = maxVal;
+            }
+        }
+        this->writeZoneMap(kea_att_int, colIdx, firstChunk, endChunk);
+    }
+    
+    void KEAAttributeTableFile::computeFloatZones(size_t colIdx, size_t firstChunk, size_t endChunk)
+    {
+        std::vector<double> &zones = floatZoneMaps[colIdx];
+        zones.resize(((numRows + chunkSize - 1) / chunkSize) * 3, 0);
+        
+        size_t batchLen = chunkSize * KEA_ATT_MATERIALISE_CHUNKS;
+        std::vector<double> floatVals;
+        size_t endRow = std::min(endChunk * chunkSize, numRows);
+        for(size_t rowOff = firstChunk * chunkSize; rowOff < endRow; rowOff += batchLen)
+        {
+            size_t runLen = std::min(batchLen, endRow - rowOff);
+            floatVals.resize(runLen);
+            this->getFloatFields(rowOff, runLen, colIdx, &floatVals[0]);
+            for(size_t chunkOff = 0; chunkOff < runLen; chunkOff += chunkSize)
+            {
+                size_t c = (rowOff + chunkOff) / chunkSize;
+                size_t chunkLen = std::min(chunkSize, runLen - chunkOff);
+                // A CHUNK WITH NOTHING BUT NaN VALUES ENDS UP WITH min > max
+                double minVal = std::numeric_limits<double>::infinity();
+                double maxVal = -std::numeric_limits<double>::infinity();
+                size_t nanCount = 0;
+                for(size_t n = chunkOff; n < chunkOff + chunkLen; ++n)
+                {
+                    if(floatVals[n] != floatVals[n])
+                    {
+                        ++nanCount;
+                    }
+                    else
+                    {
+                        minVal = std::min(minVal, floatVals[n]);
+                        maxVal = std::max(maxVal, floatVals[n]);
+                    }
+                }
+                zones[(c*3)] = minVal;
+                zones[(c*3)+1] = maxVal;
+                zones[(c*3)+2] = (double)nanCount;
+            }
+        }
+        this->writeZoneMap(kea_att_float, colIdx, firstChunk, endChunk);
+    }
+    
+    void KEAAttributeTableFile::widenIntZones(size_t colIdx, size_t startfid, size_t len, const int64_t *pnBuffer)
+    {
+        if(len == 0)
+        {
+            return;
+        }
+        std::vector<int64_t> &zones = intZoneMaps[colIdx];
+        for(size_t n = 0; n < len; ++n)
+        {
+            size_t c = (startfid + n) / chunkSize;
+            zones[(c*2)] = std::min(zones[(c*2)], pnBuffer[n]);
+            zones[(c*2)+1] = std::max(zones[(c*2)+1], pnBuffer[n]);
+        }
+        this->markZonesDirty(kea_att_int, colIdx, startfid / chunkSize, ((startfid + len - 1) / chunkSize) + 1);
+    }
+    
+    void KEAAttributeTableFile::widenFloatZones(size_t colIdx, size_t startfid, size_t len, const double *pfBuffer)
+    {
+        if(len == 0)
+        {
+            return;
+        }
+        std::vector<double> &zones = floatZoneMaps[colIdx];
+        for(size_t n = 0; n < len; ++n)
+        {
+            size_t c = (startfid + n) / chunkSize;
+            if(pfBuffer[n] != pfBuffer[n])
+            {
+                size_t chunkLen = std::min(chunkSize, numRows - (c * chunkSize));
+                zones[(c*3)+2] = std::min(zones[(c*3)+2] + 1, (double)chunkLen);
+            }
+            else
+            {
+                zones[(c*3)] = std::min(zones[(c*3)], pfBuffer[n]);
+                zones[(c*3)+1] = std::max(zones[(c*3)+1], pfBuffer[n]);
+            }
+        }
+        this->markZonesDirty(kea_att_float, colIdx, startfid / chunkSize, ((startfid + len - 1) / chunkSize) + 1);
+    }
+    
+    void KEAAttributeTableFile::markZonesDirty(KEAFieldDataType dataType, size_t colIdx, size_t firstChunk, size_t endChunk)
+    {
+        // THE ZONES WRITTEN BACK ARE ONE RANGE OF CHUNKS PER COLUMN, WIDENED
+        // TO TAKE IN EACH CHANGE UNTIL THEY ARE FLUSHED
+        std::map<size_t, std::pair<size_t, size_t> > &dirty = (dataType == kea_att_int)? intZonesDirty : floatZonesDirty;
+        std::map<size_t, std::pair<size_t, size_t> >::iterator iterDirty = dirty.find(colIdx);
+        if(iterDirty == dirty.end())
+        {
+            dirty[colIdx] = std::pair<size_t, size_t>(firstChunk, endChunk);
+        }
+        else
+        {
+            iterDirty->second.first = std::min(iterDirty->second.first, firstChunk);
+            iterDirty->second.second = std::max(iterDirty->second.second, endChunk);
+        }
+    }
+    
+    void KEAAttributeTableFile::flushZoneMaps()
+    {
+        for(std::map<size_t, std::pair<size_t, size_t> >::iterator iterDirty = intZonesDirty.begin(); iterDirty != intZonesDirty.end(); ++iterDirty)
+        {
+            this->writeZoneMap(kea_att_int, iterDirty->first, iterDirty->second.first, iterDirty->second.second);
+        }
+        intZonesDirty.clear();
+        for(std::map<size_t, std::pair<size_t, size_t> >::iterator iterDirty = floatZonesDirty.begin(); iterDirty != floatZonesDirty.end(); ++iterDirty)
+        {
+            this->writeZoneMap(kea_att_float, iterDirty->first, iterDirty->second.first, iterDirty->second.second);
+        }
+        floatZonesDirty.clear();
+    }
+    
+    void KEAAttributeTableFile::writeZoneMap(KEAFieldDataType dataType, size_t colIdx, size_t firstChunk, size_t endChunk)
+    {
+        std::string zonePath = bandPathBase + ((dataType == kea_att_int)? KEA_ATT_INT_ZONEMAP_HEADER : KEA_ATT_FLOAT_ZONEMAP_HEADER) + sizet2Str(colIdx);
+        hsize_t width = (dataType == kea_att_int)? 2 : 3;
+        size_t numChunks = (numRows + chunkSize - 1) / chunkSize;
+        try
+        {
+            H5::DataSet zoneDataset;
+            hsize_t zoneDims[2];
+            zoneDims[0] = numChunks;
+            zoneDims[1] = width;
+            if(H5Lexists(keaImg->getId(), zonePath.c_str(), H5P_DEFAULT) > 0)
+            {
+                zoneDataset = keaImg->openDataSet(zonePath);
+                hsize_t currentDims[2];
+                H5::DataSpace currentDataspace = zoneDataset.getSpace();
+                currentDataspace.getSimpleExtentDims(currentDims);
+                currentDataspace.close();
+                if(currentDims[0] < numChunks)
+                {
+                    zoneDataset.extend(zoneDims);
+                }
+            }
+            else
+            {
+                hsize_t maxZoneDims[2];
+                maxZoneDims[0] = H5S_UNLIMITED;
+                maxZoneDims[1] = width;
+                hsize_t dimsZoneChunk[2];
+                dimsZoneChunk[0] = chunkSize;
+                dimsZoneChunk[1] = width;
+                H5::DataSpace zoneDataspace = H5::DataSpace(2, zoneDims, maxZoneDims);
+                H5::DSetCreatPropList creationZoneDSPList;
+                creationZoneDSPList.setChunk(2, dimsZoneChunk);
+                creationZoneDSPList.setShuffle();
+                creationZoneDSPList.setDeflate(deflate);
+                zoneDataset = keaImg->createDataSet(zonePath, (dataType == kea_att_int)? H5::PredType::STD_I64LE : H5::PredType::IEEE_F64LE, zoneDataspace, creationZoneDSPList);
+                zoneDataspace.close();
+            }
+            
+            endChunk = std::min(endChunk, numChunks);
+            if(endChunk > firstChunk)
+            {
+                hsize_t zoneOffset[2];
+                zoneOffset[0] = firstChunk;
+                zoneOffset[1] = 0;
+                hsize_t zoneCount[2];
+                zoneCount[0] = endChunk - firstChunk;
+                zoneCount[1] = width;
+                H5::DataSpace zoneDataspace = zoneDataset.getSpace();
+                zoneDataspace.selectHyperslab(H5S_SELECT_SET, zoneCount, zoneOffset);
+                H5::DataSpace zoneMemspace = H5::DataSpace(2, zoneCount);
+                if(dataType == kea_att_int)
+                {
+                    zoneDataset.write(&intZoneMaps[colIdx][firstChunk * width], H5::PredType::NATIVE_INT64, zoneMemspace, zoneDataspace);
+                }
+                else
+                {
+                    zoneDataset.write(&floatZoneMaps[colIdx][firstChunk * width], H5::PredType::NATIVE_DOUBLE, zoneMemspace, zoneDataspace);
+                }
+                zoneMemspace.close();
+                zoneDataspace.close();
+            }
+            zoneDataset.close();
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAIOException(e.getDetailMsg());
+        }
+    }
+    
+    void KEAAttributeTableFile::buildZoneMap(const std::string &name)
+    {
+        KEAATTField field = this->getField(name);
+        this->flushZoneMaps();
+        size_t numChunks = (numRows + chunkSize - 1) / chunkSize;
+        if(field.dataType == kea_att_int)
+        {
+            intZoneMaps[field.idx].assign(numChunks * 2, 0);
+            this->computeIntZones(field.idx, 0, numChunks);
+        }
+        else if(field.dataType == kea_att_float)
+        {
+            floatZoneMaps[field.idx].assign(numChunks * 3, 0);
+            this->computeFloatZones(field.idx, 0, numChunks);
+        }
+        else
+        {
+            std::string message = std::string("Field \'") + name + std::string("\' is not an integer or float field so cannot have a zone map.");
+            throw KEAATTException(message);
+        }
+    }
+    
+    bool KEAAttributeTableFile::hasZoneMap(const std::string &name) const
+    {
+        KEAATTField field = this->getField(name);
+        if(field.dataType == kea_att_int)
+        {
+            return (intZoneMaps.count(field.idx) > 0);
+        }
+        else if(field.dataType == kea_att_float)
+        {
+            return (floatZoneMaps.count(field.idx) > 0);
+        }
+        return false;
+    }
+    
+    void KEAAttributeTableFile::dropZoneMap(const std::string &name)
+    {
+        KEAATTField field = this->getField(name);
+        std::string zonePath;
+        if(field.dataType == kea_att_int)
+        {
+            intZoneMaps.erase(field.idx);
+            intZonesDirty.erase(field.idx);
+            zonePath = bandPathBase + KEA_ATT_INT_ZONEMAP_HEADER + sizet2Str(field.idx);
+        }
+        else if(field.dataType == kea_att_float)
+        {
+            floatZoneMaps.erase(field.idx);
+            floatZonesDirty.erase(field.idx);
+            zonePath = bandPathBase + KEA_ATT_FLOAT_ZONEMAP_HEADER + sizet2Str(field.idx);
+        }
+        else
+        {
+            return;
+        }
+        
+        if(H5Lexists(keaImg->getId(), zonePath.c_str(), H5P_DEFAULT) > 0)
+        {
+            H5Ldelete(keaImg->getId(), zonePath.c_str(), H5P_DEFAULT);
+        }
+    }
+    
+    void KEAAttributeTableFile::getIntZoneMap(size_t colIdx, std::vector<int64_t> *mins, std::vector<int64_t> *maxs) const
+    {
+        std::map<size_t, std::vector<int64_t> >::const_iterator iterZones = intZoneMaps.find(colIdx);
+        if(iterZones == intZoneMaps.end())
+        {
+            std::string message = std::string("Integer column (") + sizet2Str(colIdx) + std::string(") does not have a zone map.");
+            throw KEAATTException(message);
+        }
+        
+        size_t numChunks = (numRows + chunkSize - 1) / chunkSize;
+        mins->resize(numChunks);
+        maxs->resize(numChunks);
+        for(size_t c = 0; c < numChunks; ++c)
+        {
+            (*mins)[c] = iterZones->second[(c*2)];
+            (*maxs)[c] = iterZones->second[(c*2)+1];
+        }
+    }
+    
+    void KEAAttributeTableFile::getFloatZoneMap(size_t colIdx, std::vector<double> *mins, std::vector<double> *maxs, std::vector<uint64_t> *nanCounts) const
+    {
+        std::map<size_t, std::vector<double> >::const_iterator iterZones = floatZoneMaps.find(colIdx);
+        if(iterZones == floatZoneMaps.end())
+        {
+            std::string message = std::string("Float column (") + sizet2Str(colIdx) + std::string(") does not have a zone map.");
+            throw KEAATTException(message);
+        }
+        
+        size_t numChunks = (numRows + chunkSize - 1) / chunkSize;
+        mins->resize(numChunks);
+        maxs->resize(numChunks);
+        nanCounts->resize(numChunks);
+        for(size_t c = 0; c < numChunks; ++c)
+        {
+            (*mins)[c] = iterZones->second[(c*3)];
+            (*maxs)[c] = iterZones->second[(c*3)+1];
+            (*nanCounts)[c] = (uint64_t)iterZones->second[(c*3)+2];
+        }
+    }
+    
+    std::string KEAAttributeTableFile::getIndexPath(const KEAATTIndex &index) const
+    {
+        std::string typeName = "STRING";
+        if(index.dataType == kea_att_int)
+        {
+            typeName = "INT";
+        }
+        else if(index.dataType == kea_att_float)
+        {
+            typeName = "FLOAT";
+        }
+        return bandPathBase + KEA_ATT_INDEX_GROUP + std::string("/") + typeName + sizet2Str(index.colIdx);
+    }
+    
+    void KEAAttributeTableFile::loadIndexes()
+    {
+        for(std::map<std::string, KEAATTField>::iterator iterField = fields->begin(); iterField != fields->end(); ++iterField)
+        {
+            KEAATTIndex index;
+            index.dataType = iterField->second.dataType;
+            index.colIdx = iterField->second.idx;
+            if((index.dataType != kea_att_int) && (index.dataType != kea_att_float) && (index.dataType != kea_att_string))
+            {
+                continue;
+            }
+            
+            // HEADER IS {TYPE, STALE, NUMBER OF ROWS, NUMBER OF BUCKETS}
+            uint64_t header[4];
+            try
+            {
+                if(readATTHeaderColumn(keaImg, this->getIndexPath(index) + std::string("_HEADER"), H5::PredType::NATIVE_UINT64, 4, header) != 4)
+                {
+                    continue;
+                }
+            }
+            catch(H5::Exception &e)
+            {
+                throw KEAIOException(e.getDetailMsg());
+            }
+            index.type = (KEAATTIndexType) header[0];
+            index.stale = (header[1] != 0) || (header[2] != numRows);
+            index.loaded = false;
+            indexes[iterField->first] = index;
+        }
+    }
+    
+    void KEAAttributeTableFile::loadIndex(const std::string &/*name*/, KEAATTIndex *index) const
+    {
+        std::string indexPath = this->getIndexPath(*index);
+        try
+        {
+            uint64_t header[4];
+            if(readATTHeaderColumn(keaImg, indexPath + std::string("_HEADER"), H5::PredType::NATIVE_UINT64, 4, header) != 4)
+            {
+                index->stale = true;
+                return;
+            }
+            
+            index->rows.resize(header[2]);
+            if((header[2] > 0) && (readATTHeaderColumn(keaImg, indexPath + std::string("_ROWS"), H5::PredType::NATIVE_UINT64, header[2], &index->rows[0]) != header[2]))
+            {
+                index->stale = true;
+                return;
+            }
+            index->buckets.resize(header[3]);
+            if((header[3] > 0) && (readATTHeaderColumn(keaImg, indexPath + std::string("_BUCKETS"), H5::PredType::NATIVE_UINT64, header[3], &index->buckets[0]) != header[3]))
+            {
+                index->stale = true;
+                return;
+            }
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAIOException(e.getDetailMsg());
+        }
+    }
+    
+    void KEAAttributeTableFile::saveIndex(const std::string &name, const KEAATTIndex &index)
+    {
+        std::string indexPath = this->getIndexPath(index);
+        try
+        {
+            std::string indexGroupPath = bandPathBase + KEA_ATT_INDEX_GROUP;
+            if(H5Lexists(keaImg->getId(), indexGroupPath.c_str(), H5P_DEFAULT) <= 0)
+            {
+                keaImg->createGroup(indexGroupPath);
+            }
+            
+            if(!index.rows.empty())
+            {
+                writeATTHeaderColumn(keaImg, indexPath + std::string("_ROWS"), H5::PredType::STD_U64LE, H5::PredType::NATIVE_UINT64, index.rows.size(), &index.rows[0], chunkSize, deflate);
+            }
+            if(!index.buckets.empty())
+            {
+                writeATTHeaderColumn(keaImg, indexPath + std::string("_BUCKETS"), H5::PredType::STD_U64LE, H5::PredType::NATIVE_UINT64, index.buckets.size(), &index.buckets[0], chunkSize, deflate);
+            }
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAIOException(e.getDetailMsg());
+        }
+        this->saveIndexState(name, index);
+    }
+    
+    void KEAAttributeTableFile::saveIndexState(const std::string &/*name*/, const KEAATTIndex &index)
+    {
+        uint64_t header[4];
+        header[0] = index.type;
+        header[1] = index.stale? 1 : 0;
+        header[2] = index.rows.size();
+        header[3] = index.buckets.size();
+        try
+        {
+            writeATTHeaderColumn(keaImg, this->getIndexPath(index) + std::string("_HEADER"), H5::PredType::STD_U64LE, H5::PredType::NATIVE_UINT64, 4, header, chunkSize, deflate);
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAIOException(e.getDetailMsg());
+        }
+    }
+    
+    void KEAAttributeTableFile::removeIndex(const std::string &/*name*/, const KEAATTIndex &index)
+    {
+        std::string indexPath = this->getIndexPath(index);
+        std::string suffixes[3] = {"_HEADER", "_ROWS", "_BUCKETS"};
+        for(int i = 0; i < 3; ++i)
+        {
+            std::string path = indexPath + suffixes[i];
+            if(H5Lexists(keaImg->getId(), path.c_str(), H5P_DEFAULT) > 0)
+            {
+                H5Ldelete(keaImg->getId(), path.c_str(), H5P_DEFAULT);
+            }
+        }
+    }
+    
+    void KEAAttributeTableFile::addRows(size_t numRowsIn)
+    {
+        if( numRowsIn > 0 )
+        {
+            this->flushZoneMaps();
+            this->extendRows(numRowsIn);
+            
+            this->writeDefaultsToRows(numRows - numRowsIn, numRowsIn);
+            
+            this->markIndexesStale();
+            
+            // THE LAST PARTIAL CHUNK AND THE NEW CHUNKS NOW HOLD THE DEFAULTS
+            size_t firstChunk = (numRows - numRowsIn) / chunkSize;
+            size_t numChunks = (numRows + chunkSize - 1) / chunkSize;
+            for(std::map<size_t, std::vector<int64_t> >::iterator iterZones = intZoneMaps.begin(); iterZones != intZoneMaps.end(); ++iterZones)
+            {
+                this->computeIntZones(iterZones->first, firstChunk, numChunks);
+            }
+            for(std::map<size_t, std::vector<double> >::iterator iterZones = floatZoneMaps.begin(); iterZones != floatZoneMaps.end(); ++iterZones)
+            {
+                this->computeFloatZones(iterZones->first, firstChunk, numChunks);
+            }
+        }
+    }
+    
+    void KEAAttributeTableFile::appendRows(size_t numRowsIn)
+    {
+        if( numRowsIn > 0 )
+        {
+            this->flushZoneMaps();
+            this->extendRows(numRowsIn);
+            
+            this->markIndexesStale();
+            
+            // THE CALLER WRITES EVERY COLUMN OF THE NEW ROWS NEXT, SO THE NEW
+            // CHUNKS START WITH EMPTY ZONES WHICH THOSE WRITES WIDEN. THE LAST
+            // PARTIAL CHUNK KEEPS THE ZONE OF THE ROWS ALREADY IN IT.
+            size_t firstChunk = ((numRows - numRowsIn) + chunkSize - 1) / chunkSize;
+            size_t numChunks = (numRows + chunkSize - 1) / chunkSize;
+            for(std::map<size_t, std::vector<int64_t> >::iterator iterZones = intZoneMaps.begin(); iterZones != intZoneMaps.end(); ++iterZones)
+            {
+                std::vector<int64_t> &zones = iterZones->second;
+                zones.resize(numChunks * 2, 0);
+                for(size_t c = firstChunk; c < numChunks; ++c)
+                {
+                    zones[(c*2)] = std::numeric_limits<int64_t>::max();
+                    zones[(c*2)+1] = std::numeric_limits<int64_t>::min();
+                }
+                this->markZonesDirty(kea_att_int, iterZones->first, firstChunk, numChunks);
+            }
+            for(std::map<size_t, std::vector<double> >::iterator iterZones = floatZoneMaps.begin(); iterZones != floatZoneMaps.end(); ++iterZones)
+            {
+                std::vector<double> &zones = iterZones->second;
+                zones.resize(numChunks * 3, 0);
+                for(size_t c = firstChunk; c < numChunks; ++c)
+                {
+                    zones[(c*3)] = std::numeric_limits<double>::infinity();
+                    zones[(c*3)+1] = -std::numeric_limits<double>::infinity();
+                    zones[(c*3)+2] = 0;
+                }
+                this->markZonesDirty(kea_att_float, iterZones->first, firstChunk, numChunks);
+            }
+        }
+    }
+    
+    void KEAAttributeTableFile::extendRows(size_t numRowsIn)
+    {
+        // update header
+        numRows += numRowsIn;
+        updateSizeHeader(numBoolFields, numIntFields, numFloatFields, numStringFields);
+        
+        // the datasets only need extending once the rows reserved are used up,
+        // then they are doubled (in whole chunks) so adding rows one at a time
+        // only extends them a few times
+        if(numRows > reservedRows)
+        {
+            size_t reserve = std::max(numRows, reservedRows * 2);
+            reserve = ((reserve + chunkSize - 1) / chunkSize) * chunkSize;
+            this->reserveRows(reserve);
+        }
+        
+        if(neighboursLayout == kea_att_neighbours_csr)
+        {
+            // THE NEW ROWS HAVE NO NEIGHBOURS SO ALL END WHERE THE OLD LAST ROW DID
+            try
+            {
+                std::vector<size_t> newOffsets(numRowsIn + 1, 0);
+                writeNeighboursCSR(keaImg, bandPathBase, numRows - numRowsIn, numRowsIn, &newOffsets[0], NULL, this->readNeighbourOffset(numRows - numRowsIn));
+            }
+            catch(H5::Exception &e)
+            {
+                throw KEAIOException(e.getDetailMsg());
+            }
+        }
+    }
+    
+    void KEAAttributeTableFile::reserveRows(size_t numRowsIn)
+    {
+        if(numRowsIn <= reservedRows)
+        {
+            return;
+        }
+        reservedRows = numRowsIn;
+        
+        // extend the various data tables if they exist
+        try
+        {
+            H5::DataSet *boolDataset = this->getCachedDataset(KEA_ATT_BOOL_DATA, &this->cachedBoolDataset);
+            this->extendRowDataset(boolDataset, this->numBoolFields);
+        }
+        catch(H5::Exception &e)
+        {
+            // can't exist
+        }
+        
+        try
+        {
+            H5::DataSet *intDataset = this->getCachedDataset(KEA_ATT_INT_DATA, &this->cachedIntDataset);
+            this->extendRowDataset(intDataset, this->numIntFields);
+        }
+        catch(H5::Exception &e)
+        {
+            // can't exist
+        }
+        
+        try
+        {
+            H5::DataSet *floatDataset = this->getCachedDataset(KEA_ATT_FLOAT_DATA, &this->cachedFloatDataset);
+            this->extendRowDataset(floatDataset, this->numFloatFields);
+        }
+        catch(H5::Exception &e)
+        {
+            // can't exist
+        }
+        
+        try
+        {
+            H5::DataSet *stringDataset = this->getCachedDataset(KEA_ATT_STRING_DATA, &this->cachedStringDataset);
+            this->extendRowDataset(stringDataset, this->numStringFields);
+        }
+        catch(H5::Exception &e)
+        {
+            // can't exist
+        }
+        
+        try
+        {
+            for(size_t i = 0; i < stringEncoding.size(); ++i)
+            {
+                if(stringEncoding[i] == kea_att_str_dictionary)
+                {
+                    H5::DataSet *codesDataset = this->getCachedDataset(KEA_ATT_STRING_CODES_DATA + sizet2Str(i), &this->cachedCodesDatasets[i]);
+                    this->extendRowDataset(codesDataset, 1);
+                }
+            }
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAIOException(e.getDetailMsg());
+        }
+    }
+    
+    void KEAAttributeTableFile::loadReservedRows()
+    {
+        // THE ROWS RESERVED ARE NOT STORED, THEY ARE HOWEVER MANY ROWS THE DATA
+        // TABLES HAVE ALREADY BEEN EXTENDED TO (reserveRows() EXTENDS THEM ALL)
+        const std::string dataNames[4] = {KEA_ATT_BOOL_DATA, KEA_ATT_INT_DATA, KEA_ATT_FLOAT_DATA, KEA_ATT_STRING_DATA};
+        const size_t numFields[4] = {numBoolFields, numIntFields, numFloatFields, numStringFields};
+        size_t extent = 0;
+        bool found = false;
+        for(int i = 0; i < 4; ++i)
+        {
+            if(numFields[i] == 0)
+            {
+                continue;
+            }
+            H5::DataSpace dataspace = keaImg->openDataSet(bandPathBase + dataNames[i]).getSpace();
+            hsize_t dims[2] = {0, 0};
+            dataspace.getSimpleExtentDims(dims);
+            dataspace.close();
+            extent = found? std::min(extent, (size_t)dims[0]) : (size_t)dims[0];
+            found = true;
+        }
+        reservedRows = std::max(numRows, extent);
+    }
+    
+    size_t KEAAttributeTableFile::getReservedRows() const
+    {
+        return reservedRows;
+    }
+    
+    size_t KEAAttributeTableFile::getChunkSize() const
+    {
+        return chunkSize;
+    }
+    
+    bool KEAAttributeTableFile::getBoolDefault(size_t colIdx) const
+    {
+        if(colIdx >= boolDefaults.size())
+        {
+            std::string message = std::string("Requested boolean column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
+            throw KEAATTException(message);
+        }
+        return (boolDefaults[colIdx] != 0);
+    }
+    
+    int64_t KEAAttributeTableFile::getIntDefault(size_t colIdx) const
+    {
+        if(colIdx >= intDefaults.size())
+        {
+            std::string message = std::string("Requested integer column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
+            throw KEAATTException(message);
+        }
+        return intDefaults[colIdx];
+    }
+    
+    double KEAAttributeTableFile::getFloatDefault(size_t colIdx) const
+    {
+        if(colIdx >= floatDefaults.size())
+        {
+            std::string message = std::string("Requested float column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
+            throw KEAATTException(message);
+        }
+        return floatDefaults[colIdx];
+    }
+    
+    std::string KEAAttributeTableFile::getStringDefault(size_t colIdx) const
+    {
+        if(colIdx >= stringDefaults.size())
+        {
+            std::string message = std::string("Requested string column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
+            throw KEAATTException(message);
+        }
+        return stringDefaults[colIdx];
+    }
+    
+    void KEAAttributeTableFile::extendRowDataset(H5::DataSet *dataset, hsize_t numCols)
+    {
+        // ROWS PAST numRows ARE NEVER WRITTEN SO ONLY TAKE UP SPACE IN THE
+        // FILE ONCE addRows() REACHES THEM. A DATASET LEFT LONGER BY A
+        // PREVIOUS reserveRows() IS NOT SHRUNK.
+        H5::DataSpace dataspace = dataset->getSpace();
+        int nDims = dataspace.getSimpleExtentNdims();
+        hsize_t dims[2];
+        dataspace.getSimpleExtentDims(dims);
+        dataspace.close();
+        
+        hsize_t extendDatasetTo[2];
+        extendDatasetTo[0] = std::max(dims[0], (hsize_t)reservedRows);
+        extendDatasetTo[1] = numCols;
+        if((extendDatasetTo[0] != dims[0]) || ((nDims > 1) && (extendDatasetTo[1] != dims[1])))
+        {
+            dataset->extend(extendDatasetTo);
+        }
+    }
+    
+    KEAAttributeTable* KEAAttributeTableFile::createKeaAtt(H5::H5File *keaImg, unsigned int band, unsigned int chunkSizeIn, unsigned int deflate)
+    {
+        // Create instance of class to populate and return.
+        std::string bandPathBase = KEA_DATASETNAME_BAND + uint2Str(band);
+        KEAAttributeTableFile *att = NULL;
+        
+        try
+        {
+            // Read header size.
+            hsize_t attSize[5];
+            try
+            {
+                hsize_t dimsValue[1];
+                dimsValue[0] = 5;
+                H5::DataSpace valueDataSpace(1, dimsValue);
+                H5::DataSet datasetAttSize = keaImg->openDataSet( bandPathBase + KEA_ATT_SIZE_HEADER );
+                datasetAttSize.read(attSize, H5::PredType::NATIVE_HSIZE, valueDataSpace);
+                datasetAttSize.close();
+                valueDataSpace.close();
+            }
+            catch (H5::Exception &e)
+            {
+                throw KEAIOException("The attribute table size field is not present.");
+            }
+            
+            size_t numRows = attSize[0];
+            // READ ATTRIBUTE TABLE FROM KEA IMAGE BAND...
+            
+            // READ THE CHUNK SIZE - default to given
+            size_t chunkSize = chunkSizeIn;
+            try
+            {
+                hsize_t dimsValue[1];
+                dimsValue[0] = 1;
+                H5::DataSpace valueDataSpace(1, dimsValue);
+                H5::DataSet datasetAttSize = keaImg->openDataSet( bandPathBase + KEA_ATT_CHUNKSIZE_HEADER );
+                hsize_t hChunkSize = 0;
+                datasetAttSize.read(&hChunkSize, H5::PredType::NATIVE_HSIZE, valueDataSpace);
+                datasetAttSize.close();
+                valueDataSpace.close();
+                if(hChunkSize > 0)
+                {
+                    chunkSize = hChunkSize;
+                }
+            }
+            catch(H5::Exception &e)
+            {
+                throw KEAIOException("The attribute table size field is not present.");
+            }
+            
+            att = new KEAAttributeTableFile(keaImg, bandPathBase, numRows, chunkSize, deflate);
+            
+            // READ TABLE HEADERS
+            H5::CompType *fieldCompTypeMem = KEAAttributeTable::createAttibuteIdxCompTypeMem();
+            
+            bool firstColNum = true;
+            
+            // READ BOOLEAN HEADERS
+            att->numBoolFields = attSize[1];
+            if(att->numBoolFields > 0)
+            {
+                try
+                {
+                    H5::DataSet boolFieldsDataset = keaImg->openDataSet( bandPathBase + KEA_ATT_BOOL_FIELDS_HEADER );
+                    
+                    H5::DataSpace boolFieldsDataspace = boolFieldsDataset.getSpace();
+                    hsize_t boolFieldOff[1];
+                    boolFieldOff[0] = 0;
+                    
+                    hsize_t boolFieldsDims[1];
+                    boolFieldsDims[0] = att->numBoolFields;
+                    H5::DataSpace boolFieldsMemspace(1, boolFieldsDims);
+                    
+                    boolFieldsDataspace.selectHyperslab( H5S_SELECT_SET, boolFieldsDims, boolFieldOff );
+                    
+                    KEAAttributeIdx *inFields = new KEAAttributeIdx[att->numBoolFields];
+                    
+                    boolFieldsDataset.read(inFields, *fieldCompTypeMem, boolFieldsMemspace, boolFieldsDataspace);
+                    
+                    KEAATTField field;
+                    for(unsigned int i = 0; i < att->numBoolFields; ++i)
+                    {
+                        field = KEAATTField();
+                        field.name = std::string(inFields[i].name);
+                        field.dataType = kea_att_bool;
+                        field.idx = inFields[i].idx;
+                        field.usage = std::string(inFields[i].usage);
+                        field.colNum = inFields[i].colNum;
+                        
+                        if(firstColNum)
+                        {
+                            if(field.colNum == 0)
+                            {
+                                att->numOfCols = 1;
+                            }
+                            else
+                            {
+                                att->numOfCols = field.colNum + 1;
+                            }
+                            firstColNum = false;
+                        }
+                        else if(field.colNum >= att->numOfCols)
+                        {
+                            att->numOfCols = field.colNum + 1;
+                        }
+                        
+                        att->fields->insert(std::pair<std::string, KEAATTField>(field.name, field));
+                    }
+                    
+                    boolFieldsDataset.close();
+                    boolFieldsDataspace.close();
+                    boolFieldsMemspace.close();
+                    
+                    delete[] inFields;
+                }
+                catch( H5::Exception &e )
+                {
+                    throw KEAIOException(e.getDetailMsg());
+                }
+            }
+            
+            // READ INTEGER HEADERS
+            att->numIntFields = attSize[2];
+            if(att->numIntFields > 0)
+            {
+                try
+                {
+                    H5::DataSet intFieldsDataset = keaImg->openDataSet( bandPathBase + KEA_ATT_INT_FIELDS_HEADER );
+                    H5::DataSpace intFieldsDataspace = intFieldsDataset.getSpace();
                     
                     hsize_t intFieldOff[1];
                     intFieldOff[0] = 0;
@@ -2384,6 +4537,13 @@ namespace kealib{
             }
             
             delete fieldCompTypeMem;
+            
+            att->loadColumnDefaults();
+            att->loadReservedRows();
+            att->loadStringEncodings();
+            att->neighboursLayout = readNeighboursLayout(keaImg, att->bandPathBase);
+            att->loadZoneMaps();
+            att->loadIndexes();
         }
         catch(H5::Exception &e)
         {
@@ -2405,13 +4565,40 @@ namespace kealib{
         return att;
     }
     
-    void KEAAttributeTableFile::exportToKeaFile(H5::H5File *keaImg, unsigned int band, unsigned int chunkSize, unsigned int deflate)
+    void KEAAttributeTableFile::exportToKeaFile(H5::H5File */*keaImg*/, unsigned int /*band*/, unsigned int /*chunkSize*/, unsigned int /*deflate*/)
     {
         throw KEAIOException("KEAAttributeTableFile does not support exporting to file");
     }
     
     KEAAttributeTableFile::~KEAAttributeTableFile()
     {
+        try
+        {
+            this->flushZoneMaps();
+            this->flushNeighbourEdits();
+        }
+        catch(KEAIOException &e)
+        {
+            // the changes can't be written back, nothing to be done in a destructor
+        }
+        try
+        {
+            this->closeCachedDataset(&this->cachedBoolDataset);
+            this->closeCachedDataset(&this->cachedIntDataset);
+            this->closeCachedDataset(&this->cachedFloatDataset);
+            this->closeCachedDataset(&this->cachedStringDataset);
+            this->closeCachedDataset(&this->cachedNeighboursDataset);
+            for(std::map<size_t, H5::DataSet*>::iterator iterCodes = cachedCodesDatasets.begin(); iterCodes != cachedCodesDatasets.end(); ++iterCodes)
+            {
+                this->closeCachedDataset(&iterCodes->second);
+            }
+        }
+        catch(H5::Exception &e)
+        {
+            // nothing to be done if the file has already gone
+        }
+        delete strTypeMem;
+        delete neighboursTypeMem;
     }
     
 }
@@ -29,13 +29,32 @@
  */
 
 #include "libkea/KEAAttributeTableInMem.h"
+#include "libkea/KEAWorkerPool.h"
 #include <string.h>
+#include <algorithm>
+
+#ifdef LIBKEA_HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 namespace kealib{
     
+    // ROWS READ OR WRITTEN AT A TIME BY createKeaAtt AND exportToKeaFile (ROUNDED TO WHOLE CHUNKS)
+    static const size_t KEA_ATT_SLAB_ROWS = 262144;
+    // CHUNKS COMPRESSED PER THREAD IN EACH BATCH OF A DIRECT CHUNK EXPORT
+    static const size_t KEA_ATT_EXPORT_CHUNKS_PER_THREAD = 16;
+    // REPLACED STRING BYTES BELOW WHICH THE STRING ARENA IS NEVER COMPACTED
+    static const size_t KEA_ATT_STRING_COMPACT_MIN = KEA_STRING_ARENA_BLOCK_SIZE;
+    
+    // ROWS FROM getFeature() KEPT AS VIEWS, PAST THIS THE OLDEST IS WRITTEN BACK AND DROPPED
+    static const size_t KEA_ATT_MAX_FEATURE_VIEWS = 1024;
+    
     KEAAttributeTableInMem::KEAAttributeTableInMem() : KEAAttributeTable(kea_att_mem)
     {
-        attRows = new std::vector<KEAATTFeature*>();
+        numRows = 0;
+        neighbourOffsets.push_back(0);
+        neighboursLayout = kea_att_neighbours_varlen;
+        strDeadBytes = 0;
     }
     
     bool KEAAttributeTableInMem::getBoolField(size_t fid, const std::string &name) const
@@ -198,300 +217,499 @@ namespace kealib{
         }
     }
     
+    static inline bool keaATTGetBit(const std::vector<uint64_t> &bits, size_t i)
+    {
+        return ((bits[i >> 6] >> (i & 63)) & 1) != 0;
+    }
+    
+    static inline void keaATTSetBit(std::vector<uint64_t> &bits, size_t i, bool value)
+    {
+        uint64_t mask = ((uint64_t)1) << (i & 63);
+        if(value)
+        {
+            bits[i >> 6] |= mask;
+        }
+        else
+        {
+            bits[i >> 6] &= ~mask;
+        }
+    }
+    
+    static void keaATTFillBits(std::vector<uint64_t> &bits, size_t numBits, bool value)
+    {
+        bits.assign((numBits + 63) / 64, value?~((uint64_t)0):0);
+        // BITS PAST THE END MUST STAY CLEAR SO NEW ROWS ARE FALSE
+        if(value && ((numBits & 63) != 0))
+        {
+            bits.back() &= (((uint64_t)1) << (numBits & 63)) - 1;
+        }
+    }
+    
     bool KEAAttributeTableInMem::getBoolField(size_t fid, size_t colIdx) const
     {
-        if(fid >= attRows->size())
+        if(fid >= numRows)
         {
             std::string message = std::string("Requested feature (") + sizet2Str(fid) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        if(colIdx >= attRows->at(fid)->boolFields->size())
+        if(colIdx >= boolColumns.size())
         {
             std::string message = std::string("Requested boolean column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        return attRows->at(fid)->boolFields->at(colIdx);
+        this->syncFeatureViews(fid, 1);
+        return keaATTGetBit(boolColumns[colIdx], fid);
     }
     
     int64_t KEAAttributeTableInMem::getIntField(size_t fid, size_t colIdx) const
     {
-        if(fid >= attRows->size())
+        if(fid >= numRows)
         {
             std::string message = std::string("Requested feature (") + sizet2Str(fid) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        if(colIdx >= attRows->at(fid)->intFields->size())
+        if(colIdx >= intColumns.size())
         {
             std::string message = std::string("Requested integer column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        return attRows->at(fid)->intFields->at(colIdx);
+        this->syncFeatureViews(fid, 1);
+        return intColumns[colIdx][fid];
     }
     
     double KEAAttributeTableInMem::getFloatField(size_t fid, size_t colIdx) const
     {
-        if(fid >= attRows->size())
+        if(fid >= numRows)
         {
             std::string message = std::string("Requested feature (") + sizet2Str(fid) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        if(colIdx >= attRows->at(fid)->floatFields->size())
+        if(colIdx >= floatColumns.size())
         {
             std::string message = std::string("Requested float column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        return attRows->at(fid)->floatFields->at(colIdx);
+        this->syncFeatureViews(fid, 1);
+        return floatColumns[colIdx][fid];
     }
     
     std::string KEAAttributeTableInMem::getStringField(size_t fid, size_t colIdx) const
     {
-        if(fid >= attRows->size())
+        if(fid >= numRows)
         {
             std::string message = std::string("Requested feature (") + sizet2Str(fid) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        if(colIdx >= attRows->at(fid)->strFields->size())
+        if(colIdx >= strColumns.size())
         {
             std::string message = std::string("Requested string column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        return attRows->at(fid)->strFields->at(colIdx);
+        this->syncFeatureViews(fid, 1);
+        return std::string(strColumns[colIdx][fid]);
     }
     
     // RFC40
     void KEAAttributeTableInMem::getBoolFields(size_t startfid, size_t len, size_t colIdx, bool *pbBuffer) const
     {
-        if((startfid+len) > attRows->size())
+        if((startfid+len) > numRows)
         {
             std::string message = std::string("Requested feature (") + sizet2Str(startfid+len) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        if(colIdx >= attRows->at(startfid)->boolFields->size())
+        if(colIdx >= boolColumns.size())
         {
             std::string message = std::string("Requested boolean column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
+        this->syncFeatureViews(startfid, len);
+        const std::vector<uint64_t> &bits = boolColumns[colIdx];
         for(size_t n = 0; n < len; n++)
         {
-            pbBuffer[n] = attRows->at(n+startfid)->boolFields->at(colIdx);
+            pbBuffer[n] = keaATTGetBit(bits, n+startfid);
         }
     }
 
     void KEAAttributeTableInMem::getIntFields(size_t startfid, size_t len, size_t colIdx, int64_t *pnBuffer) const
     {
-        if((startfid+len) > attRows->size())
+        if((startfid+len) > numRows)
         {
             std::string message = std::string("Requested feature (") + sizet2Str(startfid+len) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        if(colIdx >= attRows->at(startfid)->intFields->size())
+        if(colIdx >= intColumns.size())
         {
             std::string message = std::string("Requested integer column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        for(size_t n = 0; n < len; n++)
+        this->syncFeatureViews(startfid, len);
+        if(len > 0)
         {
-            pnBuffer[n] = attRows->at(n+startfid)->intFields->at(colIdx);
+            memcpy(pnBuffer, &intColumns[colIdx][startfid], len * sizeof(int64_t));
         }
     }
 
     void KEAAttributeTableInMem::getFloatFields(size_t startfid, size_t len, size_t colIdx, double *pfBuffer) const
     {
-        if((startfid+len) > attRows->size())
+        if((startfid+len) > numRows)
         {
             std::string message = std::string("Requested feature (") + sizet2Str(startfid+len) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        if(colIdx >= attRows->at(startfid)->floatFields->size())
+        if(colIdx >= floatColumns.size())
         {
             std::string message = std::string("Requested float column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        for(size_t n = 0; n < len; n++)
+        this->syncFeatureViews(startfid, len);
+        if(len > 0)
         {
-            pfBuffer[n] = attRows->at(n+startfid)->floatFields->at(colIdx);
+            memcpy(pfBuffer, &floatColumns[colIdx][startfid], len * sizeof(double));
         }
     }
 
     void KEAAttributeTableInMem::getStringFields(size_t startfid, size_t len, size_t colIdx, std::vector<std::string> *psBuffer) const
     {
-        if((startfid+len) > attRows->size())
+        if((startfid+len) > numRows)
         {
             std::string message = std::string("Requested feature (") + sizet2Str(startfid+len) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        if(colIdx >= attRows->at(startfid)->strFields->size())
+        if(colIdx >= strColumns.size())
         {
             std::string message = std::string("Requested string column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
+        this->syncFeatureViews(startfid, len);
+        const std::vector<const char*> &column = strColumns[colIdx];
         psBuffer->clear();
         psBuffer->reserve(len);
         for(size_t n = 0; n < len; n++)
         {
-            psBuffer->push_back(std::string(attRows->at(n+startfid)->strFields->at(colIdx).c_str()));
+            psBuffer->push_back(std::string(column[n+startfid]));
         }
     }
     
     void KEAAttributeTableInMem::getNeighbours(size_t startfid, size_t len, std::vector<std::vector<size_t>* > *neighbours) const
     {
-        throw KEAATTException("KEAAttributeTableInMem::getNeighbours(size_t startfid, size_t len, std::vector<size_t> neighbours) is not implemented.");
+        if((startfid+len) > numRows)
+        {
+            std::string message = std::string("Requested feature (") + sizet2Str(startfid+len) + std::string(") is not within the table.");
+            throw KEAATTException(message);
+        }
+        this->syncFeatureViews(startfid, len);
+        
+        for(std::vector<std::vector<size_t>* >::iterator iterNeigh = neighbours->begin(); iterNeigh != neighbours->end(); ++iterNeigh)
+        {
+            delete *iterNeigh;
+        }
+        neighbours->clear();
+        neighbours->reserve(len);
+        for(size_t i = 0; i < len; ++i)
+        {
+            size_t numNeighbours = 0;
+            const size_t *rowNeighbours = this->findRowNeighbours(startfid + i, &numNeighbours);
+            neighbours->push_back(new std::vector<size_t>(rowNeighbours, rowNeighbours + numNeighbours));
+        }
     }
-
+    
+    void KEAAttributeTableInMem::getNeighboursCSR(size_t startfid, size_t len, std::vector<size_t> *offsets, std::vector<size_t> *indices) const
+    {
+        if((startfid+len) > numRows)
+        {
+            std::string message = std::string("Requested feature (") + sizet2Str(startfid+len) + std::string(") is not within the table.");
+            throw KEAATTException(message);
+        }
+        this->syncFeatureViews(startfid, len);
+        this->compactNeighbours();
+        
+        // ROWS PAST THE END OF THE CSR ARRAYS HAVE NO NEIGHBOURS
+        size_t numStored = neighbourOffsets.size() - 1;
+        size_t storedEnd = std::min(startfid + len, numStored);
+        offsets->assign(len + 1, 0);
+        indices->clear();
+        if(startfid < storedEnd)
+        {
+            size_t firstIndex = neighbourOffsets[startfid];
+            for(size_t i = startfid; i < storedEnd; ++i)
+            {
+                (*offsets)[i - startfid + 1] = neighbourOffsets[i + 1] - firstIndex;
+            }
+            for(size_t i = storedEnd; i < (startfid + len); ++i)
+            {
+                (*offsets)[i - startfid + 1] = (*offsets)[storedEnd - startfid];
+            }
+            indices->assign(neighbourIndices.begin() + firstIndex, neighbourIndices.begin() + neighbourOffsets[storedEnd]);
+        }
+    }
+    
+    const size_t* KEAAttributeTableInMem::getRowNeighbours(size_t fid, size_t *numNeighbours) const
+    {
+        if(fid >= numRows)
+        {
+            std::string message = std::string("Requested feature (") + sizet2Str(fid) + std::string(") is not within the table.");
+            throw KEAATTException(message);
+        }
+        this->syncFeatureViews(fid, 1);
+        return this->findRowNeighbours(fid, numNeighbours);
+    }
+    
+    const size_t* KEAAttributeTableInMem::findRowNeighbours(size_t fid, size_t *numNeighbours) const
+    {
+        if(!neighbourEdits.empty())
+        {
+            std::map<size_t, std::vector<size_t> >::const_iterator iterEdit = neighbourEdits.find(fid);
+            if(iterEdit != neighbourEdits.end())
+            {
+                *numNeighbours = (*iterEdit).second.size();
+                return (*numNeighbours > 0)?&(*iterEdit).second[0]:NULL;
+            }
+        }
+        if((fid + 1) < neighbourOffsets.size())
+        {
+            *numNeighbours = neighbourOffsets[fid + 1] - neighbourOffsets[fid];
+            return (*numNeighbours > 0)?&neighbourIndices[neighbourOffsets[fid]]:NULL;
+        }
+        *numNeighbours = 0;
+        return NULL;
+    }
+    
+    void KEAAttributeTableInMem::storeRowNeighbours(size_t fid, const size_t *neighbourIds, size_t numNeighbours)
+    {
+        size_t numStored = neighbourOffsets.size() - 1;
+        if(fid >= numStored)
+        {
+            // APPEND, THE ROWS SKIPPED HAVE NO NEIGHBOURS
+            neighbourOffsets.resize(fid + 1, neighbourIndices.size());
+            neighbourIndices.insert(neighbourIndices.end(), neighbourIds, neighbourIds + numNeighbours);
+            neighbourOffsets.push_back(neighbourIndices.size());
+        }
+        else if((neighbourOffsets[fid + 1] - neighbourOffsets[fid]) == numNeighbours)
+        {
+            std::copy(neighbourIds, neighbourIds + numNeighbours, neighbourIndices.begin() + neighbourOffsets[fid]);
+        }
+        else if((fid + 1) == numStored)
+        {
+            neighbourIndices.resize(neighbourOffsets[fid]);
+            neighbourIndices.insert(neighbourIndices.end(), neighbourIds, neighbourIds + numNeighbours);
+            neighbourOffsets[fid + 1] = neighbourIndices.size();
+        }
+        else
+        {
+            // THE INDICES AFTER THE ROW WOULD HAVE TO MOVE SO KEEP IT ASIDE FOR NOW
+            neighbourEdits[fid].assign(neighbourIds, neighbourIds + numNeighbours);
+            return;
+        }
+        neighbourEdits.erase(fid);
+    }
+    
+    void KEAAttributeTableInMem::compactNeighbours() const
+    {
+        if(neighbourEdits.empty())
+        {
+            return;
+        }
+        
+        // EDITS ARE ONLY MADE TO ROWS WITHIN THE CSR ARRAYS
+        KEAAttributeTableInMem *table = const_cast<KEAAttributeTableInMem*>(this);
+        size_t numStored = neighbourOffsets.size() - 1;
+        std::vector<size_t> offsets;
+        offsets.reserve(numStored + 1);
+        offsets.push_back(0);
+        std::vector<size_t> indices;
+        indices.reserve(neighbourIndices.size());
+        std::map<size_t, std::vector<size_t> >::const_iterator iterEdit = neighbourEdits.begin();
+        size_t rowStart = 0;
+        while(rowStart < numStored)
+        {
+            size_t rowEnd = (iterEdit != neighbourEdits.end())?(*iterEdit).first:numStored;
+            indices.insert(indices.end(), neighbourIndices.begin() + neighbourOffsets[rowStart], neighbourIndices.begin() + neighbourOffsets[rowEnd]);
+            for(size_t i = rowStart; i < rowEnd; ++i)
+            {
+                offsets.push_back(offsets.back() + (neighbourOffsets[i + 1] - neighbourOffsets[i]));
+            }
+            if(iterEdit != neighbourEdits.end())
+            {
+                indices.insert(indices.end(), (*iterEdit).second.begin(), (*iterEdit).second.end());
+                offsets.push_back(indices.size());
+                ++iterEdit;
+                rowEnd += 1;
+            }
+            rowStart = rowEnd;
+        }
+        table->neighbourOffsets.swap(offsets);
+        table->neighbourIndices.swap(indices);
+        table->neighbourEdits.clear();
+    }
+    
     void KEAAttributeTableInMem::setBoolField(size_t fid, size_t colIdx, bool value)
     {
-        if(fid >= attRows->size())
+        if(fid >= numRows)
         {
             std::string message = std::string("Requested feature (") + sizet2Str(fid) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        if(colIdx >= attRows->at(fid)->boolFields->size())
+        if(colIdx >= boolColumns.size())
         {
             std::string message = std::string("Requested boolean column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        attRows->at(fid)->boolFields->at(colIdx) = value;
+        keaATTSetBit(boolColumns[colIdx], fid, value);
+        this->refreshFeatureViews(fid, 1, kea_att_bool, colIdx);
     }
     
     void KEAAttributeTableInMem::setIntField(size_t fid, size_t colIdx, int64_t value)
     {
-        if(fid >= attRows->size())
+        if(fid >= numRows)
         {
             std::string message = std::string("Requested feature (") + sizet2Str(fid) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        if(colIdx >= attRows->at(fid)->intFields->size())
+        if(colIdx >= intColumns.size())
         {
             std::string message = std::string("Requested integer column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        attRows->at(fid)->intFields->at(colIdx) = value;
+        this->markIndexStale(kea_att_int, colIdx);
+        intColumns[colIdx][fid] = value;
+        this->refreshFeatureViews(fid, 1, kea_att_int, colIdx);
     }
     
     void KEAAttributeTableInMem::setFloatField(size_t fid, size_t colIdx, double value)
     {
-        if(fid >= attRows->size())
+        if(fid >= numRows)
         {
             std::string message = std::string("Requested feature (") + sizet2Str(fid) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        if(colIdx >= attRows->at(fid)->floatFields->size())
+        if(colIdx >= floatColumns.size())
         {
             std::string message = std::string("Requested float column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        attRows->at(fid)->floatFields->at(colIdx) = value;
+        this->markIndexStale(kea_att_float, colIdx);
+        floatColumns[colIdx][fid] = value;
+        this->refreshFeatureViews(fid, 1, kea_att_float, colIdx);
     }
     
     void KEAAttributeTableInMem::setStringField(size_t fid, size_t colIdx, std::string value)
     {
-        if(fid >= attRows->size())
+        if(fid >= numRows)
         {
             std::string message = std::string("Requested feature (") + sizet2Str(fid) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        if(colIdx >= attRows->at(fid)->strFields->size())
+        if(colIdx >= strColumns.size())
         {
             std::string message = std::string("Requested string column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        attRows->at(fid)->strFields->at(colIdx) = value;
+        this->markIndexStale(kea_att_string, colIdx);
+        this->replaceString(strColumns[colIdx], fid, value);
+        this->compactStrings(false);
+        this->refreshFeatureViews(fid, 1, kea_att_string, colIdx);
     }
 
     // RFC40
     void KEAAttributeTableInMem::setBoolFields(size_t startfid, size_t len, size_t colIdx, bool *pbBuffer)
     {
-        if((startfid+len) > attRows->size())
+        if((startfid+len) > numRows)
         {
             std::string message = std::string("Requested feature (") + sizet2Str(startfid+len) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        if(colIdx >= attRows->at(startfid)->boolFields->size())
+        if(colIdx >= boolColumns.size())
         {
             std::string message = std::string("Requested boolean column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
+        std::vector<uint64_t> &bits = boolColumns[colIdx];
         for( size_t n = 0; n < len; n++)
         {
-            attRows->at(n+startfid)->boolFields->at(colIdx) = pbBuffer[n];
+            keaATTSetBit(bits, n+startfid, pbBuffer[n]);
         }
+        this->refreshFeatureViews(startfid, len, kea_att_bool, colIdx);
     }
 
     void KEAAttributeTableInMem::setIntFields(size_t startfid, size_t len, size_t colIdx, int64_t *pnBuffer)
     {
-        if((startfid+len) > attRows->size())
+        if((startfid+len) > numRows)
         {
             std::string message = std::string("Requested feature (") + sizet2Str(startfid+len) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        if(colIdx >= attRows->at(startfid)->intFields->size())
+        if(colIdx >= intColumns.size())
         {
             std::string message = std::string("Requested integer column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        for( size_t n = 0; n < len; n++)
+        this->markIndexStale(kea_att_int, colIdx);
+        if(len > 0)
         {
-            attRows->at(n+startfid)->intFields->at(colIdx) = pnBuffer[n];
+            memcpy(&intColumns[colIdx][startfid], pnBuffer, len * sizeof(int64_t));
         }
+        this->refreshFeatureViews(startfid, len, kea_att_int, colIdx);
     }
     
     void KEAAttributeTableInMem::setFloatFields(size_t startfid, size_t len, size_t colIdx, double *pfBuffer)
     {
-        if((startfid+len) > attRows->size())
+        if((startfid+len) > numRows)
         {
             std::string message = std::string("Requested feature (") + sizet2Str(startfid+len) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        if(colIdx >= attRows->at(startfid)->floatFields->size())
+        if(colIdx >= floatColumns.size())
         {
             std::string message = std::string("Requested float column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        for( size_t n = 0; n < len; n++)
+        this->markIndexStale(kea_att_float, colIdx);
+        if(len > 0)
         {
-            attRows->at(n+startfid)->floatFields->at(colIdx) = pfBuffer[n];
+            memcpy(&floatColumns[colIdx][startfid], pfBuffer, len * sizeof(double));
         }
+        this->refreshFeatureViews(startfid, len, kea_att_float, colIdx);
     }
 
     void KEAAttributeTableInMem::setStringFields(size_t startfid, size_t len, size_t colIdx, std::vector<std::string> *papszStrList)
     {
-        if((startfid+len) > attRows->size())
+        if((startfid+len) > numRows)
         {
             std::string message = std::string("Requested feature (") + sizet2Str(startfid+len) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
         
-        if(colIdx >= attRows->at(startfid)->strFields->size())
+        if(colIdx >= strColumns.size())
         {
             std::string message = std::string("Requested string column (") + sizet2Str(colIdx) + std::string(") is not within the table.");
             throw KEAATTException(message);
@@ -502,129 +720,838 @@ namespace kealib{
             throw KEAATTException("The number of items in the vector<std::string> passed was not equal to the length specified.");
         }
         
+        this->markIndexStale(kea_att_string, colIdx);
+        std::vector<const char*> &column = strColumns[colIdx];
         for( size_t n = 0; n < len; n++)
         {
-            attRows->at(n+startfid)->strFields->at(colIdx) = papszStrList->at(colIdx);
+            this->replaceString(column, n+startfid, papszStrList->at(n));
         }
+        this->compactStrings(false);
+        this->refreshFeatureViews(startfid, len, kea_att_string, colIdx);
     }
     
     void KEAAttributeTableInMem::setNeighbours(size_t startfid, size_t len, std::vector<std::vector<size_t>* > *neighbours)
     {
-        throw KEAATTException("KEAAttributeTableInMem::setNeighbours(size_t startfid, size_t len, std::vector<size_t> neighbours) is not implemented.");
+        if((startfid+len) > numRows)
+        {
+            std::string message = std::string("Requested feature (") + sizet2Str(startfid+len) + std::string(") is not within the table.");
+            throw KEAATTException(message);
+        }
+        if(neighbours->size() < len)
+        {
+            throw KEAATTException("Fewer neighbour lists were provided than rows to be written.");
+        }
+        
+        for(size_t i = 0; i < len; ++i)
+        {
+            std::vector<size_t> *rowNeighbours = (*neighbours)[i];
+            this->storeRowNeighbours(startfid + i, rowNeighbours->empty()?NULL:&(*rowNeighbours)[0], rowNeighbours->size());
+        }
+        this->refreshNeighbourViews(startfid, len);
     }
     
-    KEAATTFeature* KEAAttributeTableInMem::getFeature(size_t fid) const
+    void KEAAttributeTableInMem::setNeighboursCSR(size_t startfid, size_t len, const size_t *offsets, const size_t *indices)
     {
-        if(fid >= attRows->size())
+        if((startfid+len) > numRows)
         {
-            std::string message = std::string("Requested feature (") + sizet2Str(fid) + std::string(") is not within the table.");
+            std::string message = std::string("Requested feature (") + sizet2Str(startfid+len) + std::string(") is not within the table.");
             throw KEAATTException(message);
         }
+        if(len == 0)
+        {
+            return;
+        }
         
-        return attRows->at(fid);
-    }
+        // THE ROWS ARE SPLICED INTO THE CSR ARRAYS IN ONE GO, MOVING THE ROWS AFTER ONCE
+        this->compactNeighbours();
+        if(startfid >= neighbourOffsets.size())
+        {
+            neighbourOffsets.resize(startfid + 1, neighbourIndices.size());
+        }
+        size_t numStored = neighbourOffsets.size() - 1;
+        size_t endfid = std::min(startfid + len, numStored);
+        size_t firstIndex = neighbourOffsets[startfid];
+        size_t oldEnd = neighbourOffsets[endfid];
+        size_t numIndices = offsets[len] - offsets[0];
         
-    size_t KEAAttributeTableInMem::getSize() const
+        neighbourIndices.erase(neighbourIndices.begin() + firstIndex, neighbourIndices.begin() + oldEnd);
+        neighbourIndices.insert(neighbourIndices.begin() + firstIndex, indices + offsets[0], indices + offsets[len]);
+        
+        std::vector<size_t> tailOffsets(neighbourOffsets.begin() + endfid + 1, neighbourOffsets.end());
+        neighbourOffsets.resize(startfid + 1);
+        neighbourOffsets.reserve(startfid + len + 1 + tailOffsets.size());
+        for(size_t i = 0; i < len; ++i)
+        {
+            neighbourOffsets.push_back(firstIndex + (offsets[i+1] - offsets[0]));
+        }
+        for(std::vector<size_t>::iterator iterOff = tailOffsets.begin(); iterOff != tailOffsets.end(); ++iterOff)
+        {
+            neighbourOffsets.push_back((*iterOff - oldEnd) + firstIndex + numIndices);
+        }
+        this->refreshNeighbourViews(startfid, len);
+    }
+    
+    void KEAAttributeTableInMem::setRowNeighbours(size_t fid, const size_t *neighbourIds, size_t numNeighbours)
+    {
+        if(fid >= numRows)
+        {
+            std::string message = std::string("Requested feature (") + sizet2Str(fid) + std::string(") is not within the table.");
+            throw KEAATTException(message);
+        }
+        this->storeRowNeighbours(fid, neighbourIds, numNeighbours);
+        this->refreshNeighbourViews(fid, 1);
+    }
+    
+    KEAATTNeighboursLayout KEAAttributeTableInMem::getNeighboursLayout() const
     {
-        return attRows->size();
+        return neighboursLayout;
     }
     
-    void KEAAttributeTableInMem::addAttBoolField(KEAATTField field, bool val)
+    void KEAAttributeTableInMem::setNeighboursLayout(KEAATTNeighboursLayout layout)
+    {
+        neighboursLayout = layout;
+    }
+    
+    KEAATTFeature* KEAAttributeTableInMem::getFeature(size_t fid) const
     {
-        for(std::vector<KEAATTFeature*>::iterator iterFeat = attRows->begin(); iterFeat != attRows->end(); ++iterFeat)
+        if(fid >= numRows)
+        {
+            std::string message = std::string("Requested feature (") + sizet2Str(fid) + std::string(") is not within the table.");
+            throw KEAATTException(message);
+        }
+        
+        std::map<size_t, KEAATTFeature*>::iterator iterView = featureViews.find(fid);
+        if(iterView != featureViews.end())
+        {
+            return (*iterView).second;
+        }
+        
+        // MATERIALISE THE ROW FROM THE COLUMNS
+        KEAATTFeature *feat = new KEAATTFeature();
+        feat->fid = fid;
+        feat->boolFields = new std::vector<bool>();
+        feat->boolFields->reserve(boolColumns.size());
+        for(std::vector<std::vector<uint64_t> >::const_iterator iterCol = boolColumns.begin(); iterCol != boolColumns.end(); ++iterCol)
         {
-            (*iterFeat)->boolFields->push_back(val);
+            feat->boolFields->push_back(keaATTGetBit(*iterCol, fid));
         }
+        feat->intFields = new std::vector<int64_t>();
+        feat->intFields->reserve(intColumns.size());
+        for(std::vector<std::vector<int64_t> >::const_iterator iterCol = intColumns.begin(); iterCol != intColumns.end(); ++iterCol)
+        {
+            feat->intFields->push_back((*iterCol)[fid]);
+        }
+        feat->floatFields = new std::vector<double>();
+        feat->floatFields->reserve(floatColumns.size());
+        for(std::vector<std::vector<double> >::const_iterator iterCol = floatColumns.begin(); iterCol != floatColumns.end(); ++iterCol)
+        {
+            feat->floatFields->push_back((*iterCol)[fid]);
+        }
+        feat->strFields = new std::vector<std::string>();
+        feat->strFields->reserve(strColumns.size());
+        for(std::vector<std::vector<const char*> >::const_iterator iterCol = strColumns.begin(); iterCol != strColumns.end(); ++iterCol)
+        {
+            feat->strFields->push_back(std::string((*iterCol)[fid]));
+        }
+        size_t numNeighbours = 0;
+        const size_t *rowNeighbours = this->findRowNeighbours(fid, &numNeighbours);
+        feat->neighbours = new std::vector<size_t>(rowNeighbours, rowNeighbours + numNeighbours);
+        
+        featureViews[fid] = feat;
+        featureViewOrder.push_back(fid);
+        if(featureViews.size() > KEA_ATT_MAX_FEATURE_VIEWS)
+        {
+            size_t oldest = featureViewOrder.front();
+            featureViewOrder.pop_front();
+            this->syncFeatureViews(oldest, 1);
+            std::map<size_t, KEAATTFeature*>::iterator iterOldest = featureViews.find(oldest);
+            const_cast<KEAAttributeTableInMem*>(this)->deleteKeaFeature((*iterOldest).second);
+            featureViews.erase(iterOldest);
+        }
+        return feat;
     }
     
-    void KEAAttributeTableInMem::addAttIntField(KEAATTField field, int64_t val)
+    void KEAAttributeTableInMem::syncFeatureViews(size_t startfid, size_t len) const
     {
-        for(std::vector<KEAATTFeature*>::iterator iterFeat = attRows->begin(); iterFeat != attRows->end(); ++iterFeat)
+        if(featureViews.empty())
         {
-            (*iterFeat)->intFields->push_back(val);
+            return;
+        }
+        
+        // THE VIEWS MAY HAVE BEEN CHANGED BY THE CALLER SO THEY HOLD THE CURRENT VALUES
+        KEAAttributeTableInMem *table = const_cast<KEAAttributeTableInMem*>(this);
+        std::map<size_t, KEAATTFeature*>::iterator iterView = featureViews.lower_bound(startfid);
+        for(; (iterView != featureViews.end()) && ((*iterView).first < (startfid + len)); ++iterView)
+        {
+            size_t fid = (*iterView).first;
+            KEAATTFeature *feat = (*iterView).second;
+            for(size_t i = 0; i < boolColumns.size(); ++i)
+            {
+                keaATTSetBit(table->boolColumns[i], fid, feat->boolFields->at(i));
+            }
+            for(size_t i = 0; i < intColumns.size(); ++i)
+            {
+                table->intColumns[i][fid] = feat->intFields->at(i);
+            }
+            for(size_t i = 0; i < floatColumns.size(); ++i)
+            {
+                table->floatColumns[i][fid] = feat->floatFields->at(i);
+            }
+            for(size_t i = 0; i < strColumns.size(); ++i)
+            {
+                table->replaceString(table->strColumns[i], fid, feat->strFields->at(i));
+            }
+            size_t numNeighbours = 0;
+            const size_t *rowNeighbours = this->findRowNeighbours(fid, &numNeighbours);
+            if((numNeighbours != feat->neighbours->size()) || !std::equal(feat->neighbours->begin(), feat->neighbours->end(), rowNeighbours))
+            {
+                table->storeRowNeighbours(fid, feat->neighbours->empty()?NULL:&(*feat->neighbours)[0], feat->neighbours->size());
+            }
         }
     }
     
-    void KEAAttributeTableInMem::addAttFloatField(KEAATTField field, float val)
+    void KEAAttributeTableInMem::replaceString(std::vector<const char*> &column, size_t fid, const std::string &value)
     {
-        for(std::vector<KEAATTFeature*>::iterator iterFeat = attRows->begin(); iterFeat != attRows->end(); ++iterFeat)
+        const char *oldValue = column[fid];
+        if(value.compare(oldValue) == 0)
+        {
+            return;
+        }
+        if(oldValue[0] != '\0')
         {
-            (*iterFeat)->floatFields->push_back(val);
+            strDeadBytes += strlen(oldValue) + 1;
         }
+        column[fid] = strArena.add(value);
     }
     
-    void KEAAttributeTableInMem::addAttStringField(KEAATTField field, const std::string &val)
+    static const char* keaATTMoveString(KEAStringArena &newArena, std::map<const char*, const char*> &moved, const char *str)
     {
-        for(std::vector<KEAATTFeature*>::iterator iterFeat = attRows->begin(); iterFeat != attRows->end(); ++iterFeat)
+        size_t len = strlen(str);
+        if(len <= KEA_STRING_ARENA_INTERN_MAX)
+        {
+            return newArena.add(str, len);
+        }
+        std::map<const char*, const char*>::iterator iterMoved = moved.find(str);
+        if(iterMoved == moved.end())
         {
-            (*iterFeat)->strFields->push_back(val);
+            iterMoved = moved.insert(std::pair<const char*, const char*>(str, newArena.add(str, len))).first;
         }
+        return (*iterMoved).second;
     }
     
-    void KEAAttributeTableInMem::addRows(size_t numRows)
-    {        
-        KEAATTFeature *feat = NULL;
+    void KEAAttributeTableInMem::compactStrings(bool force)
+    {
+        // ONLY WORTH IT ONCE THE REPLACED STRINGS ARE OVER HALF THE ARENA
+        if(!force && ((strDeadBytes < KEA_ATT_STRING_COMPACT_MIN) || ((strDeadBytes * 2) < strArena.getUsedBytes())))
+        {
+            return;
+        }
         
-        for(size_t i = 0; i < numRows; ++i)
+        // COPY THE STRINGS STILL IN USE INTO A NEW ARENA, THE LONG STRINGS ARE NOT
+        // INTERNED SO KEEP THOSE SHARED BY SEVERAL ROWS (E.G. A DEFAULT) SHARED
+        KEAStringArena newArena;
+        std::map<const char*, const char*> moved;
+        for(std::vector<const char*>::iterator iterDefault = strDefaults.begin(); iterDefault != strDefaults.end(); ++iterDefault)
         {
-            feat = this->createKeaFeature();
-            feat->fid = attRows->size();
-            attRows->push_back(feat);
+            (*iterDefault) = keaATTMoveString(newArena, moved, *iterDefault);
+        }
+        for(std::vector<std::vector<const char*> >::iterator iterCol = strColumns.begin(); iterCol != strColumns.end(); ++iterCol)
+        {
+            for(std::vector<const char*>::iterator iterRow = (*iterCol).begin(); iterRow != (*iterCol).end(); ++iterRow)
+            {
+                (*iterRow) = keaATTMoveString(newArena, moved, *iterRow);
+            }
         }
+        strArena.swap(newArena);
+        strDeadBytes = 0;
     }
     
-    void KEAAttributeTableInMem::exportToKeaFile(H5::H5File *keaImg, unsigned int band, unsigned int chunkSize, unsigned int deflate)
-    {        
-        try
+    void KEAAttributeTableInMem::refreshFeatureViews(size_t startfid, size_t len, KEAFieldDataType dataType, size_t colIdx)
+    {
+        if(featureViews.empty())
         {
-            if(attRows->size() == 0)
+            return;
+        }
+        
+        std::map<size_t, KEAATTFeature*>::iterator iterView = featureViews.lower_bound(startfid);
+        for(; (iterView != featureViews.end()) && ((*iterView).first < (startfid + len)); ++iterView)
+        {
+            size_t fid = (*iterView).first;
+            KEAATTFeature *feat = (*iterView).second;
+            if(dataType == kea_att_bool)
             {
-                throw KEAATTException("There is no attribute table to be saved to the file.");
+                feat->boolFields->at(colIdx) = keaATTGetBit(boolColumns[colIdx], fid);
             }
-            
-            std::string bandPathBase = KEA_DATASETNAME_BAND + uint2Str(band);
-            
-            // Read header size.
-            hsize_t *attSize = new hsize_t[5];
-            try 
-            {   
-                hsize_t dimsValue[1];
-                dimsValue[0] = 5;
-                H5::DataSpace valueDataSpace(1, dimsValue);
-                H5::DataSet datasetAttSize = keaImg->openDataSet(bandPathBase + KEA_ATT_SIZE_HEADER );
-                datasetAttSize.read(attSize, H5::PredType::NATIVE_HSIZE, valueDataSpace);
-                datasetAttSize.close();
-                valueDataSpace.close();
-            } 
-            catch(H5::Exception &e) 
+            else if(dataType == kea_att_int)
             {
-                throw KEAIOException("The attribute table size field is not present.");
+                feat->intFields->at(colIdx) = intColumns[colIdx][fid];
             }
-                        
-            KEAAttributeIdx *boolFields = NULL;
-            if(this->numBoolFields > 0)
+            else if(dataType == kea_att_float)
             {
-                boolFields = new KEAAttributeIdx[this->numBoolFields];
+                feat->floatFields->at(colIdx) = floatColumns[colIdx][fid];
             }
-            KEAAttributeIdx *intFields = NULL;
-            if(this->numIntFields > 0)
+            else if(dataType == kea_att_string)
             {
-                intFields = new KEAAttributeIdx[this->numIntFields];
+                feat->strFields->at(colIdx) = strColumns[colIdx][fid];
             }
-            KEAAttributeIdx *floatFields = NULL;
-            if(this->numFloatFields > 0)
+        }
+    }
+    
+    void KEAAttributeTableInMem::refreshNeighbourViews(size_t startfid, size_t len)
+    {
+        std::map<size_t, KEAATTFeature*>::iterator iterView = featureViews.lower_bound(startfid);
+        for(; (iterView != featureViews.end()) && ((*iterView).first < (startfid + len)); ++iterView)
+        {
+            size_t numNeighbours = 0;
+            const size_t *rowNeighbours = this->findRowNeighbours((*iterView).first, &numNeighbours);
+            (*iterView).second->neighbours->assign(rowNeighbours, rowNeighbours + numNeighbours);
+        }
+    }
+        
+    size_t KEAAttributeTableInMem::getSize() const
+    {
+        return numRows;
+    }
+    
+    void KEAAttributeTableInMem::addAttBoolField(KEAATTField /*field*/, bool val)
+    {
+        boolColumns.push_back(std::vector<uint64_t>());
+        keaATTFillBits(boolColumns.back(), numRows, val);
+        boolDefaults.push_back(val? 1:0);
+        for(std::map<size_t, KEAATTFeature*>::iterator iterView = featureViews.begin(); iterView != featureViews.end(); ++iterView)
+        {
+            (*iterView).second->boolFields->push_back(val);
+        }
+    }
+    
+    void KEAAttributeTableInMem::addAttIntField(KEAATTField /*field*/, int64_t val)
+    {
+        intColumns.push_back(std::vector<int64_t>(numRows, val));
+        intDefaults.push_back(val);
+        for(std::map<size_t, KEAATTFeature*>::iterator iterView = featureViews.begin(); iterView != featureViews.end(); ++iterView)
+        {
+            (*iterView).second->intFields->push_back(val);
+        }
+    }
+    
+    void KEAAttributeTableInMem::addAttFloatField(KEAATTField /*field*/, float val)
+    {
+        floatColumns.push_back(std::vector<double>(numRows, val));
+        floatDefaults.push_back(val);
+        for(std::map<size_t, KEAATTFeature*>::iterator iterView = featureViews.begin(); iterView != featureViews.end(); ++iterView)
+        {
+            (*iterView).second->floatFields->push_back(val);
+        }
+    }
+    
+    void KEAAttributeTableInMem::addAttStringField(KEAATTField /*field*/, const std::string &val)
+    {
+        strDefaults.push_back(strArena.add(val));
+        strColumns.push_back(std::vector<const char*>(numRows, strDefaults.back()));
+        for(std::map<size_t, KEAATTFeature*>::iterator iterView = featureViews.begin(); iterView != featureViews.end(); ++iterView)
+        {
+            (*iterView).second->strFields->push_back(val);
+        }
+    }
+    
+    void KEAAttributeTableInMem::addRows(size_t numRows)
+    {        
+        this->markIndexesStale();
+        
+        // NEW ROWS TAKE THE DEFAULT OF EACH COLUMN
+        size_t firstNew = this->numRows;
+        this->numRows += numRows;
+        for(size_t i = 0; i < boolColumns.size(); ++i)
+        {
+            boolColumns[i].resize((this->numRows + 63) / 64, 0);
+            if(boolDefaults[i] != 0)
             {
-                floatFields = new KEAAttributeIdx[this->numFloatFields];
+                for(size_t j = firstNew; j < this->numRows; ++j)
+                {
+                    keaATTSetBit(boolColumns[i], j, true);
+                }
             }
-            KEAAttributeIdx *stringFields = NULL;
-            if(this->numStringFields > 0)
+        }
+        for(size_t i = 0; i < intColumns.size(); ++i)
+        {
+            intColumns[i].resize(this->numRows, intDefaults[i]);
+        }
+        for(size_t i = 0; i < floatColumns.size(); ++i)
+        {
+            floatColumns[i].resize(this->numRows, floatDefaults[i]);
+        }
+        for(size_t i = 0; i < strColumns.size(); ++i)
+        {
+            strColumns[i].resize(this->numRows, strDefaults[i]);
+        }
+    }
+    
+    /**
+     * A chunk of a numeric column compressed off the HDF5 thread, using the
+     * same shuffle and deflate filters as the dataset, for a direct chunk write.
+     */
+    struct KEAATTChunkFormat;
+    
+    struct KEAATTChunkTask
+    {
+        const KEAATTChunkFormat *format;
+        const unsigned char *src;
+        const std::vector<uint64_t> *bits;
+        size_t startRow;
+        size_t numValues;
+        size_t colIdx;
+        std::vector<unsigned char> compressed;
+        bool ok;
+    };
+    
+    struct KEAATTChunkFormat
+    {
+        size_t chunkSize;
+        size_t elemSize;
+        bool shuffle;
+        int level;
+    };
+    
+#if defined(LIBKEA_HAVE_ZLIB) && H5_VERSION_GE(1,10,3)
+    static void keaATTCompressChunk(const KEAATTChunkFormat &format, KEAATTChunkTask *task)
+    {
+        size_t rawSize = format.chunkSize * format.elemSize;
+        std::vector<unsigned char> raw(rawSize, 0);
+        if(task->bits != NULL)
+        {
+            for(size_t i = 0; i < task->numValues; ++i)
             {
-                stringFields = new KEAAttributeIdx[this->numStringFields];
+                size_t row = task->startRow + i;
+                raw[i] = (unsigned char)(((*task->bits)[row >> 6] >> (row & 63)) & 1);
             }
-            
-            unsigned int boolFieldsIdx = 0;
-            unsigned int intFieldsIdx = 0;
-            unsigned int floatFieldsIdx = 0;
+        }
+        else
+        {
+            memcpy(&raw[0], task->src + (task->startRow * format.elemSize), task->numValues * format.elemSize);
+        }
+        
+        const unsigned char *data = &raw[0];
+        std::vector<unsigned char> shuffled;
+        if(format.shuffle && (format.elemSize > 1))
+        {
+            shuffled.resize(rawSize);
+            for(size_t i = 0; i < format.chunkSize; ++i)
+            {
+                for(size_t b = 0; b < format.elemSize; ++b)
+                {
+                    shuffled[(b * format.chunkSize) + i] = raw[(i * format.elemSize) + b];
+                }
+            }
+            data = &shuffled[0];
+        }
+        
+        uLongf compressedSize = compressBound(rawSize);
+        task->compressed.resize(compressedSize);
+        task->ok = (compress2(&task->compressed[0], &compressedSize, data, rawSize, format.level) == Z_OK);
+        task->compressed.resize(compressedSize);
+    }
+    
+    static void keaATTCompressChunkJob(void *arg)
+    {
+        KEAATTChunkTask *task = (KEAATTChunkTask*) arg;
+        keaATTCompressChunk(*task->format, task);
+    }
+    
+    static void keaATTWriteChunks(H5::DataSet *dataset, const std::vector<KEAATTChunkTask> &chunks)
+    {
+        for(std::vector<KEAATTChunkTask>::const_iterator iterChunk = chunks.begin(); iterChunk != chunks.end(); ++iterChunk)
+        {
+            if(!(*iterChunk).ok)
+            {
+                throw KEAIOException("Failed to compress an attribute table chunk.");
+            }
+            hsize_t offset[2];
+            offset[0] = (*iterChunk).startRow;
+            offset[1] = (*iterChunk).colIdx;
+            if(H5Dwrite_chunk(dataset->getId(), H5P_DEFAULT, 0, offset, (*iterChunk).compressed.size(), &(*iterChunk).compressed[0]) < 0)
+            {
+                throw KEAIOException("Failed to write an attribute table chunk.");
+            }
+        }
+    }
+    
+    /**
+     * Returns true if the chunks of the dataset can be written directly, i.e. it
+     * has chunkSize x 1 chunks and the shuffle (optional) and deflate filters,
+     * in that order. elemSize is the size of a value as stored in the file.
+     */
+    static bool keaATTGetChunkFormat(H5::DataSet *dataset, size_t elemSize, size_t chunkSize, KEAATTChunkFormat *format)
+    {
+        H5::DSetCreatPropList creationPList = dataset->getCreatePlist();
+        hid_t plistId = creationPList.getId();
+        hsize_t chunkDims[2];
+        if((H5Pget_layout(plistId) != H5D_CHUNKED) || (H5Pget_chunk(plistId, 2, chunkDims) != 2) || (chunkDims[0] != chunkSize) || (chunkDims[1] != 1))
+        {
+            return false;
+        }
+        
+        format->chunkSize = chunkSize;
+        format->elemSize = elemSize;
+        format->shuffle = false;
+        format->level = -1;
+        int numFilters = H5Pget_nfilters(plistId);
+        for(int i = 0; i < numFilters; ++i)
+        {
+            unsigned int flags = 0;
+            size_t numValues = 1;
+            unsigned int values[1] = {0};
+            unsigned int config = 0;
+            H5Z_filter_t filter = H5Pget_filter2(plistId, i, &flags, &numValues, values, 0, NULL, &config);
+            if((filter == H5Z_FILTER_SHUFFLE) && (i == 0))
+            {
+                format->shuffle = true;
+            }
+            else if((filter == H5Z_FILTER_DEFLATE) && (i == (numFilters - 1)))
+            {
+                format->level = (numValues > 0)?(int)values[0]:Z_DEFAULT_COMPRESSION;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return (format->level >= 0);
+    }
+    
+    static bool keaATTHasDiskType(H5::DataSet *dataset, const H5::DataType &memType)
+    {
+        H5::DataType diskType = dataset->getDataType();
+        bool sameType = (H5Tequal(diskType.getId(), memType.getId()) > 0);
+        diskType.close();
+        return sameType;
+    }
+    
+    /**
+     * Compresses the chunks of the columns on a pool of workers started once
+     * for the whole write, a batch at a time, while this thread writes the
+     * previous batch to the file.
+     */
+    static void keaATTWriteChunksDirect(H5::DataSet *dataset, const KEAATTChunkFormat &format, const std::vector<const unsigned char*> &columns, const std::vector<const std::vector<uint64_t>*> &bitColumns, size_t numRows)
+    {
+        // ALL THE CHUNKS IN COLUMN ORDER
+        std::vector<KEAATTChunkTask> chunks;
+        size_t numCols = std::max(columns.size(), bitColumns.size());
+        for(size_t j = 0; j < numCols; ++j)
+        {
+            for(size_t startRow = 0; startRow < numRows; startRow += format.chunkSize)
+            {
+                KEAATTChunkTask task;
+                task.format = &format;
+                task.src = (j < columns.size())?columns[j]:NULL;
+                task.bits = (j < bitColumns.size())?bitColumns[j]:NULL;
+                task.startRow = startRow;
+                task.numValues = std::min(format.chunkSize, numRows - startRow);
+                task.colIdx = j;
+                task.ok = false;
+                chunks.push_back(task);
+            }
+        }
+        
+        std::vector<KEAATTChunkTask> batches[2];
+        // DECLARED AFTER THE BATCHES SO ITS WORKERS STOP BEFORE THEY GO
+        KEAWorkerPool pool;
+        size_t batchSize = pool.getNumThreads() * KEA_ATT_EXPORT_CHUNKS_PER_THREAD;
+        size_t current = 0;
+        for(size_t batchStart = 0; batchStart < chunks.size(); batchStart += batchSize)
+        {
+            // COMPRESS THIS BATCH
+            size_t batchEnd = std::min(batchStart + batchSize, chunks.size());
+            batches[current].assign(chunks.begin() + batchStart, chunks.begin() + batchEnd);
+            for(size_t i = 0; i < batches[current].size(); ++i)
+            {
+                pool.submit(keaATTCompressChunkJob, &batches[current][i]);
+            }
+            
+            // WRITE THE PREVIOUS ONE WHILE THE WORKERS RUN
+            keaATTWriteChunks(dataset, batches[1 - current]);
+            batches[1 - current].clear();
+            pool.wait();
+            current = 1 - current;
+        }
+        keaATTWriteChunks(dataset, batches[1 - current]);
+    }
+    
+#endif
+    
+    static void keaATTWriteColumnSlab(H5::DataSet *dataset, const H5::DataType &memType, size_t colIdx, size_t startRow, size_t len, const void *buffer)
+    {
+        H5::DataSpace dataspace = dataset->getSpace();
+        hsize_t offset[2];
+        offset[0] = startRow;
+        offset[1] = colIdx;
+        hsize_t count[2];
+        count[0] = len;
+        count[1] = 1;
+        dataspace.selectHyperslab(H5S_SELECT_SET, count, offset);
+        hsize_t memDims[1];
+        memDims[0] = len;
+        H5::DataSpace memspace(1, memDims);
+        dataset->write(buffer, memType, memspace, dataspace);
+        memspace.close();
+        dataspace.close();
+    }
+    
+    void KEAAttributeTableInMem::exportColumnData(H5::DataSet *boolDataset, H5::DataSet *intDataset, H5::DataSet *floatDataset, H5::DataSet *strDataset, const H5::CompType &strTypeMem, size_t chunkSize) const
+    {
+        size_t slabRows = std::max(KEA_ATT_SLAB_ROWS / std::max(chunkSize, (size_t)1), (size_t)1) * std::max(chunkSize, (size_t)1);
+        slabRows = std::min(slabRows, numRows);
+        
+        if(this->numBoolFields > 0)
+        {
+            bool written = false;
+#if defined(LIBKEA_HAVE_ZLIB) && H5_VERSION_GE(1,10,3)
+            KEAATTChunkFormat format;
+            if(keaATTHasDiskType(boolDataset, H5::PredType::NATIVE_INT8) && keaATTGetChunkFormat(boolDataset, H5::PredType::NATIVE_INT8.getSize(), chunkSize, &format))
+            {
+                std::vector<const std::vector<uint64_t>*> bitColumns;
+                for(size_t j = 0; j < this->numBoolFields; ++j)
+                {
+                    bitColumns.push_back(&boolColumns[j]);
+                }
+                keaATTWriteChunksDirect(boolDataset, format, std::vector<const unsigned char*>(), bitColumns, numRows);
+                written = true;
+            }
+#endif
+            if(!written)
+            {
+                int8_t *boolVals = new int8_t[slabRows];
+                for(size_t j = 0; j < this->numBoolFields; ++j)
+                {
+                    for(size_t slabStart = 0; slabStart < numRows; slabStart += slabRows)
+                    {
+                        size_t len = std::min(slabRows, numRows - slabStart);
+                        for(size_t i = 0; i < len; ++i)
+                        {
+                            boolVals[i] = keaATTGetBit(boolColumns[j], slabStart + i)?1:0;
+                        }
+                        keaATTWriteColumnSlab(boolDataset, H5::PredType::NATIVE_INT8, j, slabStart, len, boolVals);
+                    }
+                }
+                delete[] boolVals;
+            }
+        }
+        
+        if(this->numIntFields > 0)
+        {
+            bool written = false;
+#if defined(LIBKEA_HAVE_ZLIB) && H5_VERSION_GE(1,10,3)
+            KEAATTChunkFormat format;
+            if(keaATTHasDiskType(intDataset, H5::PredType::NATIVE_INT64) && keaATTGetChunkFormat(intDataset, H5::PredType::NATIVE_INT64.getSize(), chunkSize, &format))
+            {
+                std::vector<const unsigned char*> columns;
+                for(size_t j = 0; j < this->numIntFields; ++j)
+                {
+                    columns.push_back((const unsigned char*)&intColumns[j][0]);
+                }
+                keaATTWriteChunksDirect(intDataset, format, columns, std::vector<const std::vector<uint64_t>*>(), numRows);
+                written = true;
+            }
+#endif
+            if(!written)
+            {
+                for(size_t j = 0; j < this->numIntFields; ++j)
+                {
+                    keaATTWriteColumnSlab(intDataset, H5::PredType::NATIVE_INT64, j, 0, numRows, &intColumns[j][0]);
+                }
+            }
+        }
+        
+        if(this->numFloatFields > 0)
+        {
+            bool written = false;
+#if defined(LIBKEA_HAVE_ZLIB) && H5_VERSION_GE(1,10,3)
+            KEAATTChunkFormat format;
+            if(keaATTHasDiskType(floatDataset, H5::PredType::NATIVE_DOUBLE) && keaATTGetChunkFormat(floatDataset, H5::PredType::NATIVE_DOUBLE.getSize(), chunkSize, &format))
+            {
+                std::vector<const unsigned char*> columns;
+                for(size_t j = 0; j < this->numFloatFields; ++j)
+                {
+                    columns.push_back((const unsigned char*)&floatColumns[j][0]);
+                }
+                keaATTWriteChunksDirect(floatDataset, format, columns, std::vector<const std::vector<uint64_t>*>(), numRows);
+                written = true;
+            }
+#endif
+            if(!written)
+            {
+                for(size_t j = 0; j < this->numFloatFields; ++j)
+                {
+                    keaATTWriteColumnSlab(floatDataset, H5::PredType::NATIVE_DOUBLE, j, 0, numRows, &floatColumns[j][0]);
+                }
+            }
+        }
+        
+        // STRINGS ARE VARIABLE LENGTH SO HDF5 HAS TO WRITE THEM
+        if(this->numStringFields > 0)
+        {
+            KEAString *stringVals = new KEAString[slabRows];
+            for(size_t j = 0; j < this->numStringFields; ++j)
+            {
+                for(size_t slabStart = 0; slabStart < numRows; slabStart += slabRows)
+                {
+                    size_t len = std::min(slabRows, numRows - slabStart);
+                    for(size_t i = 0; i < len; ++i)
+                    {
+                        stringVals[i].str = const_cast<char*>(strColumns[j][slabStart + i]);
+                    }
+                    keaATTWriteColumnSlab(strDataset, strTypeMem, j, slabStart, len, stringVals);
+                }
+            }
+            delete[] stringVals;
+        }
+    }
+    
+    void KEAAttributeTableInMem::exportNeighbours(H5::H5File *keaImg, const std::string &bandPathBase, H5::DataSet *neighboursDataset, size_t chunkSize, unsigned int deflate) const
+    {
+        size_t slabRows = std::max(KEA_ATT_SLAB_ROWS / std::max(chunkSize, (size_t)1), (size_t)1) * std::max(chunkSize, (size_t)1);
+        slabRows = std::min(slabRows, numRows);
+        
+        this->compactNeighbours();
+        size_t numStored = std::min(neighbourOffsets.size() - 1, numRows);
+        
+        if(this->neighboursLayout == kea_att_neighbours_csr)
+        {
+            KEAATTNeighboursLayout fileLayout = readNeighboursLayout(keaImg, bandPathBase);
+            createNeighboursCSR(keaImg, bandPathBase, numRows, chunkSize, deflate);
+            std::vector<size_t> offsets;
+            for(size_t slabStart = 0; slabStart < numStored; slabStart += slabRows)
+            {
+                size_t len = std::min(slabRows, numStored - slabStart);
+                size_t firstIndex = neighbourOffsets[slabStart];
+                offsets.resize(len + 1);
+                for(size_t i = 0; i <= len; ++i)
+                {
+                    offsets[i] = neighbourOffsets[slabStart + i] - firstIndex;
+                }
+                writeNeighboursCSR(keaImg, bandPathBase, slabStart, len, &offsets[0], (offsets[len] > 0)?&neighbourIndices[firstIndex]:NULL, firstIndex);
+            }
+            if(numStored < numRows)
+            {
+                std::vector<size_t> emptyOffsets(numRows - numStored + 1, 0);
+                writeNeighboursCSR(keaImg, bandPathBase, numStored, numRows - numStored, &emptyOffsets[0], NULL, neighbourOffsets[numStored]);
+            }
+            
+            // LEAVE EMPTY LISTS FOR READERS WHICH ONLY KNOW THE VARIABLE LENGTH LAYOUT
+            if(fileLayout == kea_att_neighbours_varlen)
+            {
+                createVarLenNeighbours(keaImg, bandPathBase, numRows, chunkSize, deflate);
+            }
+            return;
+        }
+        
+        VarLenFieldHDF *neighbourVals = new VarLenFieldHDF[slabRows];
+        std::vector<hsize_t> neighbourIds;
+        H5::DataType intVarLenMemDT = H5::VarLenType(&H5::PredType::NATIVE_HSIZE);
+        for(size_t slabStart = 0; slabStart < numRows; slabStart += slabRows)
+        {
+            size_t len = std::min(slabRows, numRows - slabStart);
+            neighbourIds.clear();
+            for(size_t i = 0; i < len; ++i)
+            {
+                size_t fid = slabStart + i;
+                neighbourVals[i].length = 0;
+                if(fid < numStored)
+                {
+                    neighbourIds.insert(neighbourIds.end(), neighbourIndices.begin() + neighbourOffsets[fid], neighbourIndices.begin() + neighbourOffsets[fid+1]);
+                    neighbourVals[i].length = neighbourOffsets[fid+1] - neighbourOffsets[fid];
+                }
+            }
+            size_t idOff = 0;
+            for(size_t i = 0; i < len; ++i)
+            {
+                neighbourVals[i].p = (neighbourVals[i].length > 0)?&neighbourIds[idOff]:NULL;
+                idOff += neighbourVals[i].length;
+            }
+            
+            hsize_t neighboursOffset[1];
+            neighboursOffset[0] = slabStart;
+            hsize_t neighboursCount[1];
+            neighboursCount[0] = len;
+            H5::DataSpace neighboursWriteDataSpace = neighboursDataset->getSpace();
+            neighboursWriteDataSpace.selectHyperslab(H5S_SELECT_SET, neighboursCount, neighboursOffset);
+            H5::DataSpace neighboursMemspace(1, neighboursCount);
+            neighboursDataset->write(neighbourVals, intVarLenMemDT, neighboursMemspace, neighboursWriteDataSpace);
+            neighboursMemspace.close();
+            neighboursWriteDataSpace.close();
+        }
+        delete[] neighbourVals;
+        
+        // A CSR LAYOUT LEFT FROM AN EARLIER EXPORT WOULD HIDE THE LISTS JUST WRITTEN
+        std::string offsetsPath = bandPathBase + KEA_ATT_NEIGHBOURS_OFFSETS_DATA;
+        std::string indicesPath = bandPathBase + KEA_ATT_NEIGHBOURS_INDICES_DATA;
+        if(H5Lexists(keaImg->getId(), offsetsPath.c_str(), H5P_DEFAULT) > 0)
+        {
+            H5Ldelete(keaImg->getId(), offsetsPath.c_str(), H5P_DEFAULT);
+        }
+        if(H5Lexists(keaImg->getId(), indicesPath.c_str(), H5P_DEFAULT) > 0)
+        {
+            H5Ldelete(keaImg->getId(), indicesPath.c_str(), H5P_DEFAULT);
+        }
+    }
+    
+    void KEAAttributeTableInMem::exportToKeaFile(H5::H5File *keaImg, unsigned int band, unsigned int chunkSize, unsigned int deflate)
+    {        
+        try
+        {
+            if(numRows == 0)
+            {
+                throw KEAATTException("There is no attribute table to be saved to the file.");
+            }
+            this->syncFeatureViews(0, numRows);
+            if(strDeadBytes > 0)
+            {
+                // EVERY STRING IS VISITED BELOW ANYWAY SO DROP THE REPLACED ONES NOW
+                this->compactStrings(true);
+            }
+            
+            std::string bandPathBase = KEA_DATASETNAME_BAND + uint2Str(band);
+            
+            // Read header size.
+            hsize_t *attSize = new hsize_t[5];
+            try 
+            {   
+                hsize_t dimsValue[1];
+                dimsValue[0] = 5;
+                H5::DataSpace valueDataSpace(1, dimsValue);
+                H5::DataSet datasetAttSize = keaImg->openDataSet(bandPathBase + KEA_ATT_SIZE_HEADER );
+                datasetAttSize.read(attSize, H5::PredType::NATIVE_HSIZE, valueDataSpace);
+                datasetAttSize.close();
+                valueDataSpace.close();
+            } 
+            catch(H5::Exception &e) 
+            {
+                throw KEAIOException("The attribute table size field is not present.");
+            }
+                        
+            KEAAttributeIdx *boolFields = NULL;
+            if(this->numBoolFields > 0)
+            {
+                boolFields = new KEAAttributeIdx[this->numBoolFields];
+            }
+            KEAAttributeIdx *intFields = NULL;
+            if(this->numIntFields > 0)
+            {
+                intFields = new KEAAttributeIdx[this->numIntFields];
+            }
+            KEAAttributeIdx *floatFields = NULL;
+            if(this->numFloatFields > 0)
+            {
+                floatFields = new KEAAttributeIdx[this->numFloatFields];
+            }
+            KEAAttributeIdx *stringFields = NULL;
+            if(this->numStringFields > 0)
+            {
+                stringFields = new KEAAttributeIdx[this->numStringFields];
+            }
+            
+            unsigned int boolFieldsIdx = 0;
+            unsigned int intFieldsIdx = 0;
+            unsigned int floatFieldsIdx = 0;
             unsigned int stringFieldIdx = 0;
             for(std::map<std::string, KEAATTField>::iterator iterField = fields->begin(); iterField != fields->end(); ++iterField)
             {
@@ -983,9 +1910,9 @@ namespace kealib{
                         hsize_t extendDatasetTo[2];
                         bool extend = false;
                         
-                        if(this->attRows->size() > dataDims[0])
+                        if(numRows > dataDims[0])
                         {
-                            extendDatasetTo[0] = this->attRows->size();
+                            extendDatasetTo[0] = numRows;
                             extend = true;
                         }
                         else
@@ -1014,7 +1941,7 @@ namespace kealib{
                     {
                         // Create the boolean
                         hsize_t initDimsBools[2];
-                        initDimsBools[0] = this->attRows->size();
+                        initDimsBools[0] = numRows;
                         initDimsBools[1] = this->numBoolFields;
                         hsize_t maxDimsBool[2];
                         maxDimsBool[0] = H5S_UNLIMITED;
@@ -1049,9 +1976,9 @@ namespace kealib{
                         hsize_t extendDatasetTo[2];
                         bool extend = false;
                         
-                        if(this->attRows->size() > dataDims[0])
+                        if(numRows > dataDims[0])
                         {
-                            extendDatasetTo[0] = this->attRows->size();
+                            extendDatasetTo[0] = numRows;
                             extend = true;
                         }
                         else
@@ -1079,7 +2006,7 @@ namespace kealib{
                     catch(H5::Exception &e)
                     {
                         hsize_t initDimsInts[2];
-                        initDimsInts[0] = this->attRows->size();
+                        initDimsInts[0] = numRows;
                         initDimsInts[1] = this->numIntFields;
                         hsize_t maxDimsInt[2];
                         maxDimsInt[0] = H5S_UNLIMITED;
@@ -1114,9 +2041,9 @@ namespace kealib{
                         hsize_t extendDatasetTo[2];
                         bool extend = false;
                         
-                        if(this->attRows->size() > dataDims[0])
+                        if(numRows > dataDims[0])
                         {
-                            extendDatasetTo[0] = this->attRows->size();
+                            extendDatasetTo[0] = numRows;
                             extend = true;
                         }
                         else
@@ -1144,7 +2071,7 @@ namespace kealib{
                     catch(H5::Exception &e)
                     {
                         hsize_t initDimsFloats[2];
-                        initDimsFloats[0] = this->attRows->size();
+                        initDimsFloats[0] = numRows;
                         initDimsFloats[1] = this->numFloatFields;
                         hsize_t maxDimsFloat[2];
                         maxDimsFloat[0] = H5S_UNLIMITED;
@@ -1179,9 +2106,9 @@ namespace kealib{
                         hsize_t extendDatasetTo[2];
                         bool extend = false;
                         
-                        if(this->attRows->size() > dataDims[0])
+                        if(numRows > dataDims[0])
                         {
-                            extendDatasetTo[0] = this->attRows->size();
+                            extendDatasetTo[0] = numRows;
                             extend = true;
                         }
                         else
@@ -1209,7 +2136,7 @@ namespace kealib{
                     catch(H5::Exception &e)
                     {
                         hsize_t initDimsString[2];
-                        initDimsString[0] = this->attRows->size();
+                        initDimsString[0] = numRows;
                         initDimsString[1] = this->numStringFields;
                         hsize_t maxDimsString[2];
                         maxDimsString[0] = H5S_UNLIMITED;
@@ -1220,38 +2147,45 @@ namespace kealib{
                         dimsStringChunk[0] = chunkSize;
                         dimsStringChunk[1] = 1;
                         
-                        KEAString fillValueStr = KEAString();
-                        fillValueStr.str = const_cast<char*>(std::string("").c_str());
+                        // NO FILL VALUE SO HDF5 DOESN'T FILL EACH NEW CHUNK WITH COPIES OF ""
+                        // AND FREE THEM AGAIN AS THE VALUES ARE WRITTEN. UNWRITTEN ROWS HOLD
+                        // NULL REFERENCES, WHICH ARE READ AS "". (VARIABLE LENGTH TYPES
+                        // CAN'T USE H5D_FILL_TIME_NEVER.)
                         H5::DSetCreatPropList creationStringDSPList;
                         creationStringDSPList.setChunk(2, dimsStringChunk);
                         creationStringDSPList.setShuffle();
                         creationStringDSPList.setDeflate(deflate);
-                        creationStringDSPList.setFillValue(*strTypeMem, &fillValueStr);
+                        creationStringDSPList.setFillTime(H5D_FILL_TIME_IFSET);
                         strDataset = new H5::DataSet(keaImg->createDataSet((bandPathBase + KEA_ATT_STRING_DATA), *strTypeDisk, stringDataSpace, creationStringDSPList));
                         stringDataSpace.close();
                     }
                 }
                 
-                try
+                // A TABLE WHOSE NEIGHBOURS HAVE NEVER BEEN WRITTEN HAS NO DATASET FOR THEM
+                std::string neighboursPath = bandPathBase + KEA_ATT_NEIGHBOURS_DATA;
+                if(H5Lexists(keaImg->getId(), neighboursPath.c_str(), H5P_DEFAULT) > 0)
                 {
-                    neighboursDataset = new H5::DataSet(keaImg->openDataSet(bandPathBase + KEA_ATT_NEIGHBOURS_DATA));
-                    H5::DataSpace dimsDataSpace = neighboursDataset->getSpace();
-                    
-                    hsize_t dataDims[1];
-                    dimsDataSpace.getSimpleExtentDims(dataDims);
-                    hsize_t extendDatasetTo[1];
-                    
-                    if(this->attRows->size() > dataDims[0])
+                    try
                     {
-                        extendDatasetTo[0] = this->attRows->size();
-                        neighboursDataset->extend(extendDatasetTo);
+                        neighboursDataset = new H5::DataSet(keaImg->openDataSet(neighboursPath));
+                        H5::DataSpace dimsDataSpace = neighboursDataset->getSpace();
+                        
+                        hsize_t dataDims[1];
+                        dimsDataSpace.getSimpleExtentDims(dataDims);
+                        hsize_t extendDatasetTo[1];
+                        
+                        if(numRows > dataDims[0])
+                        {
+                            extendDatasetTo[0] = numRows;
+                            neighboursDataset->extend(extendDatasetTo);
+                        }
+                        
+                        dimsDataSpace.close();
+                    }
+                    catch(H5::Exception &e)
+                    {
+                        throw KEAIOException(e.getDetailMsg());
                     }
-                    
-                    dimsDataSpace.close();
-                }
-                catch(H5::Exception &e)
-                {
-                    throw KEAIOException(e.getDetailMsg());
                 }
             }
             else
@@ -1413,7 +2347,7 @@ namespace kealib{
                 {
                     // Create the boolean
                     hsize_t initDimsBools[2];
-                    initDimsBools[0] = this->attRows->size();
+                    initDimsBools[0] = numRows;
                     initDimsBools[1] = this->numBoolFields;
                     hsize_t maxDimsBool[2];
                     maxDimsBool[0] = H5S_UNLIMITED;
@@ -1439,7 +2373,7 @@ namespace kealib{
                 {
                     // Create the integer
                     hsize_t initDimsInts[2];
-                    initDimsInts[0] = this->attRows->size();
+                    initDimsInts[0] = numRows;
                     initDimsInts[1] = this->numIntFields;
                     hsize_t maxDimsInt[2];
                     maxDimsInt[0] = H5S_UNLIMITED;
@@ -1465,7 +2399,7 @@ namespace kealib{
                 {
                     // Create the float
                     hsize_t initDimsFloats[2];
-                    initDimsFloats[0] = this->attRows->size();
+                    initDimsFloats[0] = numRows;
                     initDimsFloats[1] = this->numFloatFields;
                     hsize_t maxDimsFloat[2];
                     maxDimsFloat[0] = H5S_UNLIMITED;
@@ -1491,7 +2425,7 @@ namespace kealib{
                 {
                     // Create the string
                     hsize_t initDimsString[2];
-                    initDimsString[0] = this->attRows->size();
+                    initDimsString[0] = numRows;
                     initDimsString[1] = this->numStringFields;
                     hsize_t maxDimsString[2];
                     maxDimsString[0] = H5S_UNLIMITED;
@@ -1502,20 +2436,25 @@ namespace kealib{
                     dimsStringChunk[0] = chunkSize;
                     dimsStringChunk[1] = 1;
                     
-                    KEAString fillValueStr = KEAString();
-                    fillValueStr.str = const_cast<char*>(std::string("").c_str());
+                    // NO FILL VALUE SO HDF5 DOESN'T FILL EACH NEW CHUNK WITH COPIES OF ""
+                    // AND FREE THEM AGAIN AS THE VALUES ARE WRITTEN. UNWRITTEN ROWS HOLD
+                    // NULL REFERENCES, WHICH ARE READ AS "". (VARIABLE LENGTH TYPES
+                    // CAN'T USE H5D_FILL_TIME_NEVER.)
                     H5::DSetCreatPropList creationStringDSPList;
                     creationStringDSPList.setChunk(2, dimsStringChunk);
                     creationStringDSPList.setShuffle();
                     creationStringDSPList.setDeflate(deflate);
-                    creationStringDSPList.setFillValue(*strTypeMem, &fillValueStr);
+                    creationStringDSPList.setFillTime(H5D_FILL_TIME_IFSET);
                     strDataset = new H5::DataSet(keaImg->createDataSet((bandPathBase + KEA_ATT_STRING_DATA), *strTypeDisk, stringDataSpace, creationStringDSPList));
                     stringDataSpace.close();
                 }
-                
+            }
+            
+            if(neighboursDataset == NULL)
+            {
                 // Create Neighbours dataset
                 hsize_t initDimsNeighboursDS[1];
-                initDimsNeighboursDS[0] = this->attRows->size();
+                initDimsNeighboursDS[0] = numRows;
                 hsize_t maxDimsNeighboursDS[1];
                 maxDimsNeighboursDS[0] = H5S_UNLIMITED;
                 H5::DataSpace neighboursDataspace = H5::DataSpace(1, initDimsNeighboursDS, maxDimsNeighboursDS);
@@ -1539,371 +2478,141 @@ namespace kealib{
             }
                         
             // WRITE DATA INTO THE STRUCTURE.
-            size_t numOfBlocks = 0;
-            numOfBlocks = floor(((double)attRows->size()/chunkSize));
-            size_t remainRows = attRows->size() - (numOfBlocks * chunkSize);
-                        
-            int *boolData = NULL;
+            this->exportColumnData(boolDataset, intDataset, floatDataset, strDataset, *strTypeMem, chunkSize);
+            this->exportNeighbours(keaImg, bandPathBase, neighboursDataset, chunkSize, deflate);
+            
+            // WRITE THE CHUNK SIZE USED TO THE FILE.
+            hsize_t chunkSizeDataOffset[1];
+            chunkSizeDataOffset[0] = 0;
+            hsize_t chunkSizeDataDims[1];
+            chunkSizeDataDims[0] = 1;
+            
+            H5::DataSet chunkSizeDataset = keaImg->openDataSet(bandPathBase + KEA_ATT_CHUNKSIZE_HEADER);
+            H5::DataSpace chunkSizeWriteDataSpace = chunkSizeDataset.getSpace();
+            chunkSizeWriteDataSpace.selectHyperslab(H5S_SELECT_SET, chunkSizeDataDims, chunkSizeDataOffset);
+            H5::DataSpace newChunkSizeDataspace = H5::DataSpace(1, chunkSizeDataDims);
+            chunkSizeDataset.write(&chunkSize, H5::PredType::NATIVE_UINT, newChunkSizeDataspace, chunkSizeWriteDataSpace);
+            chunkSizeDataset.close();
+            chunkSizeWriteDataSpace.close();
+            newChunkSizeDataspace.close();
+            
+            // WRITE THE ATT SIZE USED TO THE FILE.
+            hsize_t sizeDataOffset[1];
+            sizeDataOffset[0] = 0;
+            hsize_t sizeDataDims[1];
+            sizeDataDims[0] = 5;
+            
+            H5::DataSet sizeDataset = keaImg->openDataSet(bandPathBase + KEA_ATT_SIZE_HEADER);
+            H5::DataSpace sizeWriteDataSpace = sizeDataset.getSpace();
+            sizeWriteDataSpace.selectHyperslab(H5S_SELECT_SET, sizeDataDims, sizeDataOffset);
+            H5::DataSpace newSizeDataspace = H5::DataSpace(1, sizeDataDims);
+            
+            attSize[0] = numRows;
+            attSize[1] = this->numBoolFields;
+            attSize[2] = this->numIntFields;
+            attSize[3] = this->numFloatFields;
+            attSize[4] = this->numStringFields;
+            
+            sizeDataset.write(attSize, H5::PredType::NATIVE_HSIZE, newSizeDataspace, sizeWriteDataSpace);
+            sizeDataset.close();
+            sizeWriteDataSpace.close();
+            newSizeDataspace.close();
+            
+            // EVERY COLUMN HAS JUST BEEN WRITTEN SO NONE OF THEM ARE LAZY ANY MORE
+            std::string lazyHeaders[4] = {KEA_ATT_BOOL_LAZY_HEADER, KEA_ATT_INT_LAZY_HEADER, KEA_ATT_FLOAT_LAZY_HEADER, KEA_ATT_STRING_LAZY_HEADER};
+            for(int i = 0; i < 4; ++i)
+            {
+                std::string lazyHeaderPath = bandPathBase + lazyHeaders[i];
+                if(H5Lexists(keaImg->getId(), lazyHeaderPath.c_str(), H5P_DEFAULT) > 0)
+                {
+                    H5Ldelete(keaImg->getId(), lazyHeaderPath.c_str(), H5P_DEFAULT);
+                }
+            }
+            
+            // KEEP THE DEFAULTS SO ROWS ADDED TO THE FILE LATER TAKE THEM
             if(this->numBoolFields > 0)
             {
-                boolData = new int[this->numBoolFields*chunkSize];
+                writeATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_BOOL_DEFAULTS_HEADER, H5::PredType::STD_U8LE, H5::PredType::NATIVE_UINT8, boolDefaults.size(), &boolDefaults[0], chunkSize, deflate);
             }
-            int64_t *intData = NULL;
             if(this->numIntFields > 0)
             {
-                intData = new int64_t[this->numIntFields*chunkSize];
+                writeATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_INT_DEFAULTS_HEADER, H5::PredType::STD_I64LE, H5::PredType::NATIVE_INT64, intDefaults.size(), &intDefaults[0], chunkSize, deflate);
             }
-            double *floatData = NULL;
             if(this->numFloatFields > 0)
             {
-                floatData = new double[this->numFloatFields*chunkSize];
+                writeATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_FLOAT_DEFAULTS_HEADER, H5::PredType::IEEE_F64LE, H5::PredType::NATIVE_DOUBLE, floatDefaults.size(), &floatDefaults[0], chunkSize, deflate);
             }
-            KEAString *stringData = NULL;
             if(this->numStringFields > 0)
             {
-                stringData = new KEAString[this->numStringFields*chunkSize];
+                KEAString *stringVals = new KEAString[strDefaults.size()];
+                for(size_t i = 0; i < strDefaults.size(); ++i)
+                {
+                    stringVals[i].str = const_cast<char*>(strDefaults[i]);
+                }
+                writeATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_STRING_DEFAULTS_HEADER, *strTypeMem, *strTypeMem, strDefaults.size(), stringVals, chunkSize, deflate);
+                delete[] stringVals;
             }
             
-            VarLenFieldHDF *neighbourVals = new VarLenFieldHDF[chunkSize];
-            
-            if(numOfBlocks > 0)
-            {
-                hsize_t boolDataOffset[2];
-                boolDataOffset[0] = 0;
-                boolDataOffset[1] = 0;
-                hsize_t boolDataDims[2];
-                boolDataDims[0] = chunkSize;
-                boolDataDims[1] = this->numBoolFields;
-                
-                hsize_t intDataOffset[2];
-                intDataOffset[0] = 0;
-                intDataOffset[1] = 0;
-                hsize_t intDataDims[2];
-                intDataDims[0] = chunkSize;
-                intDataDims[1] = this->numIntFields;
-                
-                hsize_t floatDataOffset[2];
-                floatDataOffset[0] = 0;
-                floatDataOffset[1] = 0;
-                hsize_t floatDataDims[2];
-                floatDataDims[0] = chunkSize;
-                floatDataDims[1] = this->numFloatFields;
-                
-                hsize_t stringDataOffset[2];
-                stringDataOffset[0] = 0;
-                stringDataOffset[1] = 0;
-                hsize_t stringDataDims[2];
-                stringDataDims[0] = chunkSize;
-                stringDataDims[1] = this->numStringFields;
-                
-                hsize_t neighboursDataOffset[1];
-                neighboursDataOffset[0] = 0;
-                hsize_t neighboursDataDims[1];
-                neighboursDataDims[0] = chunkSize;
-                H5::DataType intVarLenMemDT = H5::VarLenType(&H5::PredType::NATIVE_HSIZE);
-                H5::DataSpace memNeighboursDataspace = H5::DataSpace(1, neighboursDataDims);
-                
-                size_t rowOff = 0;
-                KEAATTFeature *keaFeat = NULL;
-                for(size_t n = 0; n < numOfBlocks; ++n)
+            // ZONE MAPS DESCRIBE THE DATA WHICH HAS JUST BEEN REPLACED
+            for(size_t i = 0; i < std::max(this->numIntFields, this->numFloatFields); ++i)
+            {
+                std::string zonePaths[2] = {bandPathBase + KEA_ATT_INT_ZONEMAP_HEADER + sizet2Str(i), bandPathBase + KEA_ATT_FLOAT_ZONEMAP_HEADER + sizet2Str(i)};
+                for(int j = 0; j < 2; ++j)
                 {
-                    rowOff = n * chunkSize;
-                    
-                    for(size_t i = 0; i < chunkSize; ++i)
-                    {
-                        keaFeat = attRows->at(rowOff+i);
-                        for(size_t j = 0; j < this->numBoolFields; ++j)
-                        {
-                            boolData[(i*this->numBoolFields)+j] = keaFeat->boolFields->at(j);
-                        }
-                        for(size_t j = 0; j < this->numIntFields; ++j)
-                        {
-                            intData[(i*this->numIntFields)+j] = keaFeat->intFields->at(j);
-                        }
-                        for(size_t j = 0; j < this->numFloatFields; ++j)
-                        {
-                            floatData[(i*this->numFloatFields)+j] = keaFeat->floatFields->at(j);
-                        }
-                        for(size_t j = 0; j < this->numStringFields; ++j)
-                        {
-                            stringData[(i*this->numStringFields)+j].str = const_cast<char*>(keaFeat->strFields->at(j).c_str());
-                        }
-                        
-                        neighbourVals[i].length = 0;
-                        neighbourVals[i].p = NULL;
-                        if(keaFeat->neighbours->size() > 0)
-                        {
-                            neighbourVals[i].length = keaFeat->neighbours->size();
-                            neighbourVals[i].p = new hsize_t[keaFeat->neighbours->size()];
-                            for(unsigned int k = 0; k < keaFeat->neighbours->size(); ++k)
-                            {
-                                ((hsize_t*)neighbourVals[i].p)[k] = keaFeat->neighbours->at(k);
-                            }
-                        }
-                    }
-                                        
-                    if(this->numBoolFields > 0)
-                    {
-                        boolDataOffset[0] = rowOff;
-                        boolDataOffset[1] = 0;
-                        
-                        H5::DataSpace boolWriteDataSpace = boolDataset->getSpace();
-                        boolWriteDataSpace.selectHyperslab(H5S_SELECT_SET, boolDataDims, boolDataOffset);
-                        H5::DataSpace newBoolDataspace = H5::DataSpace(2, boolDataDims);
-                        boolDataset->write(boolData, H5::PredType::NATIVE_INT, newBoolDataspace, boolWriteDataSpace);
-                        newBoolDataspace.close();
-                        boolWriteDataSpace.close();
-                    }
-                    
-                    if(this->numIntFields > 0)
-                    {
-                        intDataOffset[0] = rowOff;
-                        intDataOffset[1] = 0;
-                        
-                        H5::DataSpace intWriteDataSpace = intDataset->getSpace();
-                        intWriteDataSpace.selectHyperslab(H5S_SELECT_SET, intDataDims, intDataOffset);
-                        H5::DataSpace newIntDataspace = H5::DataSpace(2, intDataDims);
-                        intDataset->write(intData, H5::PredType::NATIVE_INT64, newIntDataspace, intWriteDataSpace);
-                        intWriteDataSpace.close();
-                        newIntDataspace.close();
-                    }
-                    
-                    if(this->numFloatFields > 0)
-                    {
-                        floatDataOffset[0] = rowOff;
-                        floatDataOffset[1] = 0;
-                        
-                        H5::DataSpace floatWriteDataSpace = floatDataset->getSpace();
-                        floatWriteDataSpace.selectHyperslab(H5S_SELECT_SET, floatDataDims, floatDataOffset);
-                        H5::DataSpace newFloatDataspace = H5::DataSpace(2, floatDataDims);
-                        floatDataset->write(floatData, H5::PredType::NATIVE_DOUBLE, newFloatDataspace, floatWriteDataSpace);
-                        floatWriteDataSpace.close();
-                        newFloatDataspace.close();
-                    }
-                    
-                    if(this->numStringFields > 0)
-                    {
-                        stringDataOffset[0] = rowOff;
-                        stringDataOffset[1] = 0;
-                        
-                        H5::DataSpace stringWriteDataSpace = strDataset->getSpace();
-                        stringWriteDataSpace.selectHyperslab(H5S_SELECT_SET, stringDataDims, stringDataOffset);
-                        H5::DataSpace newStringDataspace = H5::DataSpace(2, stringDataDims);
-                        strDataset->write(stringData, *strTypeMem, newStringDataspace, stringWriteDataSpace);
-                        stringWriteDataSpace.close();
-                        newStringDataspace.close();
-                    }
-                    
-                    neighboursDataOffset[0] = rowOff;
-                    
-                    H5::DataSpace neighboursWriteDataSpace = neighboursDataset->getSpace();
-                    neighboursWriteDataSpace.selectHyperslab(H5S_SELECT_SET, neighboursDataDims, neighboursDataOffset);
-                    neighboursDataset->write(neighbourVals, intVarLenMemDT, memNeighboursDataspace, neighboursWriteDataSpace);
-                    neighboursWriteDataSpace.close();
-                    
-                    for(size_t i = 0; i < chunkSize; ++i)
+                    if(H5Lexists(keaImg->getId(), zonePaths[j].c_str(), H5P_DEFAULT) > 0)
                     {
-                        if(neighbourVals[i].length > 0)
-                        {
-                            neighbourVals[i].length = 0;
-                            delete[] ((hsize_t*)neighbourVals[i].p);
-                        }
+                        H5Ldelete(keaImg->getId(), zonePaths[j].c_str(), H5P_DEFAULT);
                     }
                 }
-                memNeighboursDataspace.close();
             }
             
-            if(remainRows > 0)
+            // AS DO ANY SAVED INDEXES
+            std::string indexGroupPath = bandPathBase + KEA_ATT_INDEX_GROUP;
+            if(H5Lexists(keaImg->getId(), indexGroupPath.c_str(), H5P_DEFAULT) > 0)
             {
-                size_t rowOff = numOfBlocks * chunkSize;
-                //size_t strOff = 0;
-                
-                hsize_t boolDataOffset[2];
-                boolDataOffset[0] = rowOff;
-                boolDataOffset[1] = 0;
-                hsize_t boolDataDims[2];
-                boolDataDims[0] = remainRows;
-                boolDataDims[1] = this->numBoolFields;
-                
-                hsize_t intDataOffset[2];
-                intDataOffset[0] = rowOff;
-                intDataOffset[1] = 0;
-                hsize_t intDataDims[2];
-                intDataDims[0] = remainRows;
-                intDataDims[1] = this->numIntFields;
-                
-                hsize_t floatDataOffset[2];
-                floatDataOffset[0] = rowOff;
-                floatDataOffset[1] = 0;
-                hsize_t floatDataDims[2];
-                floatDataDims[0] = remainRows;
-                floatDataDims[1] = this->numFloatFields;
-                
-                hsize_t stringDataOffset[2];
-                stringDataOffset[0] = rowOff;
-                stringDataOffset[1] = 0;
-                hsize_t stringDataDims[2];
-                stringDataDims[0] = remainRows;
-                stringDataDims[1] = this->numStringFields;
-                
-                hsize_t neighboursDataOffset[1];
-                neighboursDataOffset[0] = rowOff;
-                hsize_t neighboursDataDims[1];
-                neighboursDataDims[0] = remainRows;
-                H5::DataType intVarLenMemDT = H5::VarLenType(&H5::PredType::NATIVE_HSIZE);
-                
-                KEAATTFeature *keaFeat = NULL;
-                for(size_t i = 0; i < remainRows; ++i)
+                H5Ldelete(keaImg->getId(), indexGroupPath.c_str(), H5P_DEFAULT);
+            }
+            
+            // THE STRING COLUMNS ARE ALL WRITTEN PLAIN SO DROP ANY DICTIONARY ENCODING
+            std::string encodingHeaderPath = bandPathBase + KEA_ATT_STRING_ENCODING_HEADER;
+            if(H5Lexists(keaImg->getId(), encodingHeaderPath.c_str(), H5P_DEFAULT) > 0)
+            {
+                H5Ldelete(keaImg->getId(), encodingHeaderPath.c_str(), H5P_DEFAULT);
+                for(size_t i = 0; i < this->numStringFields; ++i)
                 {
-                    keaFeat = attRows->at(rowOff+i);
-                    for(size_t j = 0; j < this->numBoolFields; ++j)
-                    {
-                        boolData[(i*this->numBoolFields)+j] = keaFeat->boolFields->at(j);
-                    }
-                    for(size_t j = 0; j < this->numIntFields; ++j)
-                    {
-                        intData[(i*this->numIntFields)+j] = keaFeat->intFields->at(j);
-                    }
-                    for(size_t j = 0; j < this->numFloatFields; ++j)
-                    {
-                        floatData[(i*this->numFloatFields)+j] = keaFeat->floatFields->at(j);
-                    }
-                    for(size_t j = 0; j < this->numStringFields; ++j)
+                    std::string codesPath = bandPathBase + KEA_ATT_STRING_CODES_DATA + sizet2Str(i);
+                    if(H5Lexists(keaImg->getId(), codesPath.c_str(), H5P_DEFAULT) > 0)
                     {
-                        stringData[(i*this->numStringFields)+j].str = const_cast<char*>(keaFeat->strFields->at(j).c_str());
+                        H5Ldelete(keaImg->getId(), codesPath.c_str(), H5P_DEFAULT);
                     }
-                    neighbourVals[i].length = 0;
-                    neighbourVals[i].p = NULL;
-                    if(keaFeat->neighbours->size() > 0)
+                    std::string dictPath = bandPathBase + KEA_ATT_STRING_DICT_DATA + sizet2Str(i);
+                    if(H5Lexists(keaImg->getId(), dictPath.c_str(), H5P_DEFAULT) > 0)
                     {
-                        neighbourVals[i].length = keaFeat->neighbours->size();
-                        neighbourVals[i].p = new hsize_t[keaFeat->neighbours->size()];
-                        for(unsigned int k = 0; k < keaFeat->neighbours->size(); ++k)
-                        {
-                            ((hsize_t*)neighbourVals[i].p)[k] = keaFeat->neighbours->at(k);
-                        }
-                    }
-                }
-                                
-                if(this->numBoolFields > 0)
-                {
-                    H5::DataSpace boolWriteDataSpace = boolDataset->getSpace();
-                    boolWriteDataSpace.selectHyperslab(H5S_SELECT_SET, boolDataDims, boolDataOffset);
-                    H5::DataSpace newBoolDataspace = H5::DataSpace(2, boolDataDims);
-                    boolDataset->write(boolData, H5::PredType::NATIVE_INT, newBoolDataspace, boolWriteDataSpace);
-                    boolWriteDataSpace.close();
-                    newBoolDataspace.close();
-                }
-                
-                if(this->numIntFields > 0)
-                {
-                    H5::DataSpace intWriteDataSpace = intDataset->getSpace();
-                    intWriteDataSpace.selectHyperslab(H5S_SELECT_SET, intDataDims, intDataOffset);
-                    H5::DataSpace newIntDataspace = H5::DataSpace(2, intDataDims);
-                    intDataset->write(intData, H5::PredType::NATIVE_INT64, newIntDataspace, intWriteDataSpace);
-                    newIntDataspace.close();
-                    intWriteDataSpace.close();
-                }
-                
-                if(this->numFloatFields > 0)
-                {
-                    H5::DataSpace floatWriteDataSpace = floatDataset->getSpace();
-                    floatWriteDataSpace.selectHyperslab(H5S_SELECT_SET, floatDataDims, floatDataOffset);
-                    H5::DataSpace newFloatDataspace = H5::DataSpace(2, floatDataDims);
-                    floatDataset->write(floatData, H5::PredType::NATIVE_DOUBLE, newFloatDataspace, floatWriteDataSpace);
-                    newFloatDataspace.close();
-                    floatWriteDataSpace.close();
-                }
-                
-                if(this->numStringFields > 0)
-                {
-                    H5::DataSpace stringWriteDataSpace = strDataset->getSpace();
-                    stringWriteDataSpace.selectHyperslab(H5S_SELECT_SET, stringDataDims, stringDataOffset);
-                    H5::DataSpace newStringDataspace = H5::DataSpace(2, stringDataDims);
-                    strDataset->write(stringData, *strTypeMem, newStringDataspace, stringWriteDataSpace);
-                    newStringDataspace.close();
-                    stringWriteDataSpace.close();
-                }
-                                
-                H5::DataSpace neighboursWriteDataSpace = neighboursDataset->getSpace();
-                neighboursWriteDataSpace.selectHyperslab(H5S_SELECT_SET, neighboursDataDims, neighboursDataOffset);
-                H5::DataSpace newNeighboursDataspace = H5::DataSpace(1, neighboursDataDims);
-                neighboursDataset->write(neighbourVals, intVarLenMemDT, newNeighboursDataspace, neighboursWriteDataSpace);
-                newNeighboursDataspace.close();
-                neighboursWriteDataSpace.close();
-                
-                for(size_t i = 0; i < remainRows; ++i)
-                {
-                    if(neighbourVals[i].length > 0)
-                    {
-                        neighbourVals[i].length = 0;
-                        delete[] ((size_t*)neighbourVals[i].p);
+                        H5Ldelete(keaImg->getId(), dictPath.c_str(), H5P_DEFAULT);
                     }
                 }
             }
             
-            // WRITE THE CHUNK SIZE USED TO THE FILE.
-            hsize_t chunkSizeDataOffset[1];
-            chunkSizeDataOffset[0] = 0;
-            hsize_t chunkSizeDataDims[1];
-            chunkSizeDataDims[0] = 1;
-            
-            H5::DataSet chunkSizeDataset = keaImg->openDataSet(bandPathBase + KEA_ATT_CHUNKSIZE_HEADER);
-            H5::DataSpace chunkSizeWriteDataSpace = chunkSizeDataset.getSpace();
-            chunkSizeWriteDataSpace.selectHyperslab(H5S_SELECT_SET, chunkSizeDataDims, chunkSizeDataOffset);
-            H5::DataSpace newChunkSizeDataspace = H5::DataSpace(1, chunkSizeDataDims);
-            chunkSizeDataset.write(&chunkSize, H5::PredType::NATIVE_UINT, newChunkSizeDataspace, chunkSizeWriteDataSpace);
-            chunkSizeDataset.close();
-            chunkSizeWriteDataSpace.close();
-            newChunkSizeDataspace.close();
-            
-            // WRITE THE ATT SIZE USED TO THE FILE.
-            hsize_t sizeDataOffset[1];
-            sizeDataOffset[0] = 0;
-            hsize_t sizeDataDims[1];
-            sizeDataDims[0] = 5;
-            
-            H5::DataSet sizeDataset = keaImg->openDataSet(bandPathBase + KEA_ATT_SIZE_HEADER);
-            H5::DataSpace sizeWriteDataSpace = sizeDataset.getSpace();
-            sizeWriteDataSpace.selectHyperslab(H5S_SELECT_SET, sizeDataDims, sizeDataOffset);
-            H5::DataSpace newSizeDataspace = H5::DataSpace(1, sizeDataDims);
-            
-            attSize[0] = this->attRows->size();
-            attSize[1] = this->numBoolFields;
-            attSize[2] = this->numIntFields;
-            attSize[3] = this->numFloatFields;
-            attSize[4] = this->numStringFields;
-            
-            sizeDataset.write(attSize, H5::PredType::NATIVE_HSIZE, newSizeDataspace, sizeWriteDataSpace);
-            sizeDataset.close();
-            sizeWriteDataSpace.close();
-            newSizeDataspace.close();
-            
             if(this->numBoolFields > 0)
             {
-                delete[] boolData;
                 boolDataset->close();
                 delete boolDataset;
             }
             if(this->numIntFields > 0)
             {
-                delete[] intData;
                 intDataset->close();
                 delete intDataset;
             }
             if(this->numFloatFields > 0)
             {
-                delete[] floatData;
                 floatDataset->close();
                 delete floatDataset;
             }
             if(this->numStringFields > 0)
             {
-                delete[] stringData;
                 strDataset->close();
                 delete strDataset;
             }
-            delete[] neighbourVals;
             delete[] attSize;
             
             delete strTypeMem;
@@ -2245,588 +2954,407 @@ namespace kealib{
                     }
                 }
                 
-                // Reserve space in vector.
-                att->attRows->reserve(attSize[0]);
-                
-                size_t numOfBlocks = 0;
-                numOfBlocks = floor(((double)attSize[0]/chunkSize));
-                size_t remainRows = attSize[0] - (numOfBlocks * chunkSize);
-                
-                KEAATTFeature *feat = NULL;
-                size_t cFid = 0;
-                size_t rowOff = 0;
-                
-                H5::DataSet boolDataset;
-                H5::DataSpace boolDataspace;
-                H5::DataSpace boolFieldsMemspace;
-                int *boolVals = NULL;
-                hsize_t boolFieldsOffset[2];
-                hsize_t boolFieldsCount[2];
-                hsize_t boolFieldsDimsRead[2];
-                hsize_t boolFieldsOffset_out[2];
-                hsize_t boolFieldsCount_out[2];
-                if(att->numBoolFields > 0)
-                {
-                    boolDataset = keaImg->openDataSet( (bandPathBase + KEA_ATT_BOOL_DATA) );
-                    boolDataspace = boolDataset.getSpace();
-                    
-                    int boolNDims = boolDataspace.getSimpleExtentNdims();
-
-                    if(boolNDims != 2)
-                    {
-                        throw KEAIOException("The boolean datasets needs to have 2 dimensions.");
-                    }
-                    
-                    hsize_t *boolDims = new hsize_t[boolNDims];
-                    boolDataspace.getSimpleExtentDims(boolDims);
-                    
-                    if(attSize[0] > boolDims[0])
-                    {
-                        throw KEAIOException("The number of features in boolean dataset is smaller than expected.");
-                    }
-                    
-                    if(att->numBoolFields > boolDims[1])
-                    {
-                        throw KEAIOException("The number of boolean fields is smaller than expected.");
-                    }
-                    delete[] boolDims;
-                    
-                    boolVals = new int[chunkSize*att->numBoolFields];
-                    
-                    boolFieldsOffset[0] = 0;
-                    boolFieldsOffset[1] = 0;
-                    
-                    boolFieldsCount[0] = chunkSize;
-                    boolFieldsCount[1] = att->numBoolFields;
-                    
-                    boolDataspace.selectHyperslab( H5S_SELECT_SET, boolFieldsCount, boolFieldsOffset );
-                    
-                    boolFieldsDimsRead[0] = chunkSize;
-                    boolFieldsDimsRead[1] = att->numBoolFields;
-                    boolFieldsMemspace = H5::DataSpace( 2, boolFieldsDimsRead );
-                    
-                    boolFieldsOffset_out[0] = 0;
-                    boolFieldsOffset_out[1] = 0;
-                    
-                    boolFieldsCount_out[0] = chunkSize;
-                    boolFieldsCount_out[1] = att->numBoolFields;
-                    
-                    boolFieldsMemspace.selectHyperslab( H5S_SELECT_SET, boolFieldsCount_out, boolFieldsOffset_out );
-                }
+                // Allocate the columns.
+                att->boolColumns.resize(att->numBoolFields);
+                att->intColumns.resize(att->numIntFields);
+                att->floatColumns.resize(att->numFloatFields);
+                att->strColumns.resize(att->numStringFields);
+                att->boolDefaults.assign(att->numBoolFields, 0);
+                att->intDefaults.assign(att->numIntFields, 0);
+                att->floatDefaults.assign(att->numFloatFields, 0);
+                att->strDefaults.assign(att->numStringFields, KEAStringArena::empty());
+                att->addRows(attSize[0]);
                 
-                H5::DataSet intDataset;
-                H5::DataSpace intDataspace;
-                H5::DataSpace intFieldsMemspace;
-                int64_t *intVals = NULL;
-                hsize_t intFieldsOffset[2];
-                hsize_t intFieldsCount[2];
-                hsize_t intFieldsDimsRead[2];
-                hsize_t intFieldsOffset_out[2];
-                hsize_t intFieldsCount_out[2];
-                if(att->numIntFields > 0)
+                att->loadColumnData(keaImg, bandPathBase, chunkSize);
+            }
+            
+            att->loadLazyColumnDefaults(keaImg, bandPathBase);
+            att->loadDictionaryEncodedColumns(keaImg, bandPathBase);
+            
+            delete[] attSize;
+        }
+        catch(H5::Exception &e)
+        {
+            throw KEAIOException(e.getDetailMsg());
+        }
+        catch (KEAATTException &e)
+        {
+            throw e;
+        }
+        catch (KEAIOException &e)
+        {
+            throw e;
+        }
+        catch(std::exception &e)
+        {
+            throw KEAIOException(e.what());
+        }
+        
+        return att;
+    }
+    
+    static H5::DataSet keaATTOpenDataMatrix(H5::H5File *keaImg, const std::string &path, size_t numRows, size_t numCols, const std::string &typeName)
+    {
+        H5::DataSet dataset = keaImg->openDataSet(path);
+        H5::DataSpace dataspace = dataset.getSpace();
+        if(dataspace.getSimpleExtentNdims() != 2)
+        {
+            throw KEAIOException(std::string("The ") + typeName + std::string(" datasets needs to have 2 dimensions."));
+        }
+        
+        hsize_t dims[2];
+        dataspace.getSimpleExtentDims(dims);
+        if(numRows > dims[0])
+        {
+            throw KEAIOException(std::string("The number of features in ") + typeName + std::string(" dataset is smaller than expected."));
+        }
+        if(numCols > dims[1])
+        {
+            throw KEAIOException(std::string("The number of ") + typeName + std::string(" fields is smaller than expected."));
+        }
+        dataspace.close();
+        return dataset;
+    }
+    
+    static void keaATTReadColumnSlab(H5::DataSet &dataset, const H5::DataType &memType, size_t colIdx, size_t startRow, size_t len, void *buffer)
+    {
+        H5::DataSpace dataspace = dataset.getSpace();
+        hsize_t offset[2];
+        offset[0] = startRow;
+        offset[1] = colIdx;
+        hsize_t count[2];
+        count[0] = len;
+        count[1] = 1;
+        dataspace.selectHyperslab(H5S_SELECT_SET, count, offset);
+        hsize_t memDims[1];
+        memDims[0] = len;
+        H5::DataSpace memspace(1, memDims);
+        dataset.read(buffer, memType, memspace, dataspace);
+        memspace.close();
+        dataspace.close();
+    }
+    
+    struct KEAATTInternTask
+    {
+        KEAStringArena *arena;
+        KEAString *stringVals;
+        size_t len;
+        const char **column;
+    };
+    
+    static void keaATTInternStrings(void *arg)
+    {
+        KEAATTInternTask *task = (KEAATTInternTask*) arg;
+        for(size_t i = 0; i < task->len; ++i)
+        {
+            task->column[i] = task->arena->add(task->stringVals[i].str);
+            free(task->stringVals[i].str);
+        }
+    }
+    
+    void KEAAttributeTableInMem::loadColumnData(H5::H5File *keaImg, const std::string &bandPathBase, size_t chunkSize)
+    {
+        // THE DATA MATRICES ARE CHUNKED BY COLUMN SO EACH COLUMN IS READ ON ITS OWN,
+        // INT AND FLOAT COLUMNS STRAIGHT INTO THE TABLE AND THE REST IN LARGE SLABS.
+        size_t slabRows = std::max(KEA_ATT_SLAB_ROWS / std::max(chunkSize, (size_t)1), (size_t)1) * std::max(chunkSize, (size_t)1);
+        slabRows = std::min(slabRows, std::max(numRows, (size_t)1));
+        
+        if((this->numBoolFields > 0) && (numRows > 0))
+        {
+            H5::DataSet boolDataset = keaATTOpenDataMatrix(keaImg, bandPathBase + KEA_ATT_BOOL_DATA, numRows, this->numBoolFields, "boolean");
+            int *boolVals = new int[slabRows];
+            for(size_t j = 0; j < this->numBoolFields; ++j)
+            {
+                for(size_t slabStart = 0; slabStart < numRows; slabStart += slabRows)
                 {
-                    intDataset = keaImg->openDataSet( (bandPathBase + KEA_ATT_INT_DATA) );
-                    intDataspace = intDataset.getSpace();
-                    
-                    int intNDims = intDataspace.getSimpleExtentNdims();
-                    
-                    if(intNDims != 2)
+                    size_t len = std::min(slabRows, numRows - slabStart);
+                    keaATTReadColumnSlab(boolDataset, H5::PredType::NATIVE_INT, j, slabStart, len, boolVals);
+                    for(size_t i = 0; i < len; ++i)
                     {
-                        throw KEAIOException("The integer datasets needs to have 2 dimensions.");
+                        keaATTSetBit(boolColumns[j], slabStart + i, boolVals[i] != 0);
                     }
-                    
-                    hsize_t *intDims = new hsize_t[intNDims];
-                    intDataspace.getSimpleExtentDims(intDims);
-                    
-                    if(attSize[0] > intDims[0])
-                    {
-                        throw KEAIOException("The number of features in integer dataset is smaller than expected.");
-                    }
-                    
-                    if(att->numIntFields > intDims[1])
-                    {
-                        throw KEAIOException("The number of integer fields is smaller than expected.");
-                    }
-                    delete[] intDims;
-                    
-                    intVals = new int64_t[chunkSize*att->numIntFields];
-                    
-                    intFieldsOffset[0] = 0;
-                    intFieldsOffset[1] = 0;
-                    
-                    intFieldsCount[0] = chunkSize;
-                    intFieldsCount[1] = att->numIntFields;
-                    
-                    intDataspace.selectHyperslab( H5S_SELECT_SET, intFieldsCount, intFieldsOffset );
-                    
-                    intFieldsDimsRead[0] = chunkSize;
-                    intFieldsDimsRead[1] = att->numIntFields;
-                    intFieldsMemspace = H5::DataSpace( 2, intFieldsDimsRead );
-                    
-                    intFieldsOffset_out[0] = 0;
-                    intFieldsOffset_out[1] = 0;
-                    
-                    intFieldsCount_out[0] = chunkSize;
-                    intFieldsCount_out[1] = att->numIntFields;
-                    
-                    intFieldsMemspace.selectHyperslab( H5S_SELECT_SET, intFieldsCount_out, intFieldsOffset_out );
                 }
-                
-                H5::DataSet floatDataset;
-                H5::DataSpace floatDataspace;
-                H5::DataSpace floatFieldsMemspace;
-                double *floatVals = NULL;
-                hsize_t floatFieldsOffset[2];
-                hsize_t floatFieldsCount[2];
-                hsize_t floatFieldsDimsRead[2];
-                hsize_t floatFieldsOffset_out[2];
-                hsize_t floatFieldsCount_out[2];
-                if(att->numFloatFields > 0)
+            }
+            delete[] boolVals;
+            boolDataset.close();
+        }
+        
+        if((this->numIntFields > 0) && (numRows > 0))
+        {
+            H5::DataSet intDataset = keaATTOpenDataMatrix(keaImg, bandPathBase + KEA_ATT_INT_DATA, numRows, this->numIntFields, "integer");
+            for(size_t j = 0; j < this->numIntFields; ++j)
+            {
+                keaATTReadColumnSlab(intDataset, H5::PredType::NATIVE_INT64, j, 0, numRows, &intColumns[j][0]);
+            }
+            intDataset.close();
+        }
+        
+        if((this->numFloatFields > 0) && (numRows > 0))
+        {
+            H5::DataSet floatDataset = keaATTOpenDataMatrix(keaImg, bandPathBase + KEA_ATT_FLOAT_DATA, numRows, this->numFloatFields, "float");
+            for(size_t j = 0; j < this->numFloatFields; ++j)
+            {
+                keaATTReadColumnSlab(floatDataset, H5::PredType::NATIVE_DOUBLE, j, 0, numRows, &floatColumns[j][0]);
+            }
+            floatDataset.close();
+        }
+        
+        if((this->numStringFields > 0) && (numRows > 0))
+        {
+            H5::DataSet strDataset = keaATTOpenDataMatrix(keaImg, bandPathBase + KEA_ATT_STRING_DATA, numRows, this->numStringFields, "string");
+            H5::CompType *strTypeMem = KEAAttributeTable::createKeaStringCompTypeMem();
+            
+            // A WORKER COPIES EACH SLAB INTO THE ARENA WHILE THE NEXT ONE IS READ
+            // (HDF5 IS NOT THREAD SAFE SO THE READS STAY ON THIS THREAD).
+            std::vector<KEAString> slabs[2];
+            slabs[0].resize(slabRows);
+            slabs[1].resize(slabRows);
+            KEAATTInternTask tasks[2];
+            size_t current = 0;
+            try
+            {
+                // DECLARED AFTER THE SLABS SO ITS WORKER STOPS BEFORE THEY GO
+                KEAWorkerPool pool(1);
+                for(size_t j = 0; j < this->numStringFields; ++j)
                 {
-                    floatDataset = keaImg->openDataSet( (bandPathBase + KEA_ATT_FLOAT_DATA) );
-                    floatDataspace = floatDataset.getSpace();
-                    
-                    int floatNDims = floatDataspace.getSimpleExtentNdims();
-                    
-                    if(floatNDims != 2)
+                    for(size_t slabStart = 0; slabStart < numRows; slabStart += slabRows)
                     {
-                        throw KEAIOException("The float datasets needs to have 2 dimensions.");
+                        size_t len = std::min(slabRows, numRows - slabStart);
+                        keaATTReadColumnSlab(strDataset, *strTypeMem, j, slabStart, len, &slabs[current][0]);
+                        pool.wait();
+                        tasks[current].arena = &strArena;
+                        tasks[current].stringVals = &slabs[current][0];
+                        tasks[current].len = len;
+                        tasks[current].column = &strColumns[j][slabStart];
+                        pool.submit(keaATTInternStrings, &tasks[current]);
+                        current = 1 - current;
                     }
-                    
-                    hsize_t *floatDims = new hsize_t[floatNDims];
-                    floatDataspace.getSimpleExtentDims(floatDims);
-                    
-                    if(attSize[0] > floatDims[0])
-                    {
-                        throw KEAIOException("The number of features in float dataset is smaller than expected.");
-                    }
-                    
-                    if(att->numFloatFields > floatDims[1])
-                    {
-                        throw KEAIOException("The number of float fields is smaller than expected.");
-                    }
-                    delete[] floatDims;
-                    
-                    floatVals = new double[chunkSize*att->numFloatFields];
-                    
-                    floatFieldsOffset[0] = 0;
-                    floatFieldsOffset[1] = 0;
-                    
-                    floatFieldsCount[0] = chunkSize;
-                    floatFieldsCount[1] = att->numFloatFields;
-                    
-                    floatDataspace.selectHyperslab( H5S_SELECT_SET, floatFieldsCount, floatFieldsOffset );
-                    
-                    floatFieldsDimsRead[0] = chunkSize;
-                    floatFieldsDimsRead[1] = att->numFloatFields;
-                    
-                    floatFieldsMemspace = H5::DataSpace( 2, floatFieldsDimsRead );
-                    
-                    floatFieldsOffset_out[0] = 0;
-                    floatFieldsOffset_out[1] = 0;
-                    
-                    floatFieldsCount_out[0] = chunkSize;
-                    floatFieldsCount_out[1] = att->numFloatFields;
-                    
-                    floatFieldsMemspace.selectHyperslab( H5S_SELECT_SET, floatFieldsCount_out, floatFieldsOffset_out );
                 }
-
-                
-                H5::DataSet strDataset;
-                H5::DataSpace strDataspace;
-                H5::DataSpace strFieldsMemspace;
-                H5::CompType *strTypeMem = KEAAttributeTable::createKeaStringCompTypeMem();
-                KEAString *stringVals = NULL;
-                hsize_t strFieldsOffset[2];
-                hsize_t strFieldsCount[2];
-                hsize_t strFieldsDimsRead[2];
-                hsize_t strFieldsOffset_out[2];
-                hsize_t strFieldsCount_out[2];
-                if(att->numStringFields > 0)
+                pool.wait();
+            }
+            catch(...)
+            {
+                delete strTypeMem;
+                throw;
+            }
+            delete strTypeMem;
+            strDataset.close();
+        }
+        
+        // NEIGHBOURS IN EITHER LAYOUT, READ AS CSR A SLAB AT A TIME
+        this->neighboursLayout = readNeighboursLayout(keaImg, bandPathBase);
+        neighbourOffsets.assign(1, 0);
+        neighbourIndices.clear();
+        neighbourEdits.clear();
+        neighbourOffsets.reserve(numRows + 1);
+        std::vector<size_t> offsets;
+        std::vector<size_t> indices;
+        for(size_t slabStart = 0; slabStart < numRows; slabStart += slabRows)
+        {
+            size_t len = std::min(slabRows, numRows - slabStart);
+            readNeighboursCSR(keaImg, bandPathBase, this->neighboursLayout, slabStart, len, &offsets, &indices);
+            size_t firstIndex = neighbourIndices.size();
+            for(size_t i = 1; i <= len; ++i)
+            {
+                neighbourOffsets.push_back(firstIndex + offsets[i]);
+            }
+            neighbourIndices.insert(neighbourIndices.end(), indices.begin(), indices.end());
+        }
+    }
+    
+    void KEAAttributeTableInMem::loadLazyColumnDefaults(H5::H5File *keaImg, const std::string &bandPathBase)
+    {
+        // COLUMNS ADDED THROUGH A KEAAttributeTableFile WHICH HAVE NOT BEEN WRITTEN
+        // YET ONLY HOLD THE FILL VALUE, THEIR VALUES ARE THE DEFAULTS IN THE HEADER.
+        // FILES WRITTEN WITHOUT THE DEFAULTS HEADER GIVE NEW ROWS THE FILL VALUE.
+        if(this->numBoolFields > 0)
+        {
+            int fill = 0;
+            H5::DataSet boolDataset = keaImg->openDataSet(bandPathBase + KEA_ATT_BOOL_DATA);
+            boolDataset.getCreatePlist().getFillValue(H5::PredType::NATIVE_INT, &fill);
+            boolDataset.close();
+            boolDefaults.assign(this->numBoolFields, (fill != 0)? 1:0);
+            std::vector<uint8_t> lazy(this->numBoolFields, 0);
+            readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_BOOL_LAZY_HEADER, H5::PredType::NATIVE_UINT8, this->numBoolFields, &lazy[0]);
+            readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_BOOL_DEFAULTS_HEADER, H5::PredType::NATIVE_UINT8, this->numBoolFields, &boolDefaults[0]);
+            for(size_t i = 0; i < this->numBoolFields; ++i)
+            {
+                if(lazy[i])
                 {
-                    strDataset = keaImg->openDataSet( (bandPathBase + KEA_ATT_STRING_DATA) );
-                    strDataspace = strDataset.getSpace();
-                    
-                    int strNDims = strDataspace.getSimpleExtentNdims();
-                    
-                    if(strNDims != 2)
-                    {
-                        throw KEAIOException("The string datasets needs to have 2 dimensions.");
-                    }
-                    
-                    hsize_t *strDims = new hsize_t[strNDims];
-                    strDataspace.getSimpleExtentDims(strDims);
-                    
-                    if(attSize[0] > strDims[0])
-                    {
-                        throw KEAIOException("The number of features in string dataset is smaller than expected.");
-                    }
-                    
-                    if(att->numStringFields > strDims[1])
-                    {
-                        throw KEAIOException("The number of string fields is smaller than expected.");
-                    }
-                    delete[] strDims;
-                    
-                    stringVals = new KEAString[chunkSize*att->numStringFields];
-                    
-                    strFieldsOffset[0] = 0;
-                    strFieldsOffset[1] = 0;
-                    
-                    strFieldsCount[0] = chunkSize;
-                    strFieldsCount[1] = att->numStringFields;
-                    strDataspace.selectHyperslab( H5S_SELECT_SET, strFieldsCount, strFieldsOffset );
-                    
-                    strFieldsDimsRead[0] = chunkSize;
-                    strFieldsDimsRead[1] = att->numStringFields;
-                    strFieldsMemspace = H5::DataSpace( 2, strFieldsDimsRead );
-                    
-                    strFieldsOffset_out[0] = 0;
-                    strFieldsOffset_out[1] = 0;
-                    
-                    strFieldsCount_out[0] = chunkSize;
-                    strFieldsCount_out[1] = att->numStringFields;
-                    
-                    strFieldsMemspace.selectHyperslab( H5S_SELECT_SET, strFieldsCount_out, strFieldsOffset_out );
+                    keaATTFillBits(boolColumns[i], numRows, (boolDefaults[i] != 0));
                 }
-                
-                H5::DataSet neighboursDataset = keaImg->openDataSet( (bandPathBase + KEA_ATT_NEIGHBOURS_DATA) );
-                H5::DataSpace neighboursDataspace = neighboursDataset.getSpace();
-                
-                int neighboursNDims = neighboursDataspace.getSimpleExtentNdims();
-                if(neighboursNDims != 1)
+            }
+        }
+        
+        if(this->numIntFields > 0)
+        {
+            int64_t fill = 0;
+            H5::DataSet intDataset = keaImg->openDataSet(bandPathBase + KEA_ATT_INT_DATA);
+            intDataset.getCreatePlist().getFillValue(H5::PredType::NATIVE_INT64, &fill);
+            intDataset.close();
+            intDefaults.assign(this->numIntFields, fill);
+            std::vector<uint8_t> lazy(this->numIntFields, 0);
+            readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_INT_LAZY_HEADER, H5::PredType::NATIVE_UINT8, this->numIntFields, &lazy[0]);
+            readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_INT_DEFAULTS_HEADER, H5::PredType::NATIVE_INT64, this->numIntFields, &intDefaults[0]);
+            for(size_t i = 0; i < this->numIntFields; ++i)
+            {
+                if(lazy[i])
                 {
-                    throw KEAIOException("The neighbours datasets needs to have 1 dimension.");
+                    std::fill(intColumns[i].begin(), intColumns[i].end(), intDefaults[i]);
                 }
-                
-                /* Neighbours */
-                hsize_t *neighboursDims = new hsize_t[neighboursNDims];
-                neighboursDataspace.getSimpleExtentDims(neighboursDims);
-                if(attSize[0] > neighboursDims[0])
+            }
+        }
+        
+        if(this->numFloatFields > 0)
+        {
+            double fill = 0;
+            H5::DataSet floatDataset = keaImg->openDataSet(bandPathBase + KEA_ATT_FLOAT_DATA);
+            floatDataset.getCreatePlist().getFillValue(H5::PredType::NATIVE_DOUBLE, &fill);
+            floatDataset.close();
+            floatDefaults.assign(this->numFloatFields, fill);
+            std::vector<uint8_t> lazy(this->numFloatFields, 0);
+            readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_FLOAT_LAZY_HEADER, H5::PredType::NATIVE_UINT8, this->numFloatFields, &lazy[0]);
+            readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_FLOAT_DEFAULTS_HEADER, H5::PredType::NATIVE_DOUBLE, this->numFloatFields, &floatDefaults[0]);
+            for(size_t i = 0; i < this->numFloatFields; ++i)
+            {
+                if(lazy[i])
                 {
-                    throw KEAIOException("The number of features in neighbours dataset smaller than expected.");
+                    std::fill(floatColumns[i].begin(), floatColumns[i].end(), floatDefaults[i]);
                 }
-                delete[] neighboursDims;
-                
-                VarLenFieldHDF *neighbourVals = new VarLenFieldHDF[chunkSize];
-                H5::DataType intVarLenMemDT = H5::VarLenType(&H5::PredType::NATIVE_HSIZE);
-                hsize_t neighboursOffset[1];
-                neighboursOffset[0] = 0;
-                hsize_t neighboursCount[1];
-                neighboursCount[0] = chunkSize;
-                neighboursDataspace.selectHyperslab( H5S_SELECT_SET, neighboursCount, neighboursOffset );
-                
-                hsize_t neighboursDimsRead[1]; 
-                neighboursDimsRead[0] = chunkSize;
-                H5::DataSpace neighboursMemspace( 1, neighboursDimsRead );
-                
-                hsize_t neighboursOffset_out[1];
-                neighboursOffset_out[0] = 0;
-                hsize_t neighboursCount_out[1];
-                neighboursCount_out[0] = chunkSize;
-                neighboursMemspace.selectHyperslab( H5S_SELECT_SET, neighboursCount_out, neighboursOffset_out );
-                                
-                if(numOfBlocks > 0)
-                {                   
-                    for(size_t n = 0; n < numOfBlocks; ++n)
-                    {
-                        rowOff = (n*chunkSize);
-                        // Read data.
-                        neighboursOffset[0] = rowOff;
-                        neighboursDataspace.selectHyperslab( H5S_SELECT_SET, neighboursCount, neighboursOffset );
-                        neighboursDataset.read(neighbourVals, intVarLenMemDT, neighboursMemspace, neighboursDataspace);
-                        
-                        if(att->numBoolFields > 0)
-                        {
-                            boolFieldsOffset[0] = rowOff;
-                            boolDataspace.selectHyperslab( H5S_SELECT_SET, boolFieldsCount, boolFieldsOffset );
-                            boolDataset.read(boolVals, H5::PredType::NATIVE_INT, boolFieldsMemspace, boolDataspace);
-                        }
-                        
-                        if(att->numIntFields > 0)
-                        {
-                            intFieldsOffset[0] = rowOff;
-                            intDataspace.selectHyperslab( H5S_SELECT_SET, intFieldsCount, intFieldsOffset );
-                            intDataset.read(intVals, H5::PredType::NATIVE_INT64, intFieldsMemspace, intDataspace);
-                        }
-                        
-                        if(att->numFloatFields > 0)
-                        {
-                            floatFieldsOffset[0] = rowOff;
-                            floatDataspace.selectHyperslab( H5S_SELECT_SET, floatFieldsCount, floatFieldsOffset );
-                            floatDataset.read(floatVals, H5::PredType::NATIVE_DOUBLE, floatFieldsMemspace, floatDataspace);
-                        }
-                        
-                        if(att->numStringFields > 0)
-                        {
-                            strFieldsOffset[0] = rowOff;
-                            strDataspace.selectHyperslab( H5S_SELECT_SET, strFieldsCount, strFieldsOffset );
-                            strDataset.read(stringVals, *strTypeMem, strFieldsMemspace, strDataspace);
-                        }
-                        
-                        // Write data into KEAATTFeatures
-                        for(size_t i = 0; i < chunkSize; ++i)
-                        {
-                            feat = att->createKeaFeature();
-                            feat->fid = cFid++;
-                            
-                            if(att->numBoolFields > 0)
-                            {
-                                feat->boolFields->reserve(att->numBoolFields);
-                                for(hsize_t j = 0; j < att->numBoolFields; ++j)
-                                {
-                                    feat->boolFields->at(j) = boolVals[(i*att->numBoolFields)+j];
-                                }
-                            }
-                            
-                            if(att->numIntFields > 0)
-                            {
-                                feat->intFields->reserve(att->numIntFields);
-                                for(hsize_t j = 0; j < att->numIntFields; ++j)
-                                {
-                                    feat->intFields->at(j) = intVals[(i*att->numIntFields)+j];
-                                }
-                            }
-                            
-                            if(att->numFloatFields > 0)
-                            {
-                                feat->floatFields->reserve(att->numFloatFields);
-                                for(hsize_t j = 0; j < att->numFloatFields; ++j)
-                                {
-                                    feat->floatFields->at(j) = floatVals[(i*att->numFloatFields)+j];
-                                }
-                            }
-                            
-                            if(att->numStringFields > 0)
-                            {
-                                feat->strFields->reserve(att->numStringFields);
-                                for(hsize_t j = 0; j < att->numStringFields; ++j)
-                                {
-                                    feat->strFields->at(j) = std::string(stringVals[(i*att->numStringFields)+j].str);
-                                }
-                            }
-                            
-                            if(neighbourVals[i].length > 0)
-                            {
-                                feat->neighbours->reserve(neighbourVals[i].length);
-                                for(hsize_t n = 0; n < neighbourVals[i].length; ++n)
-                                {
-                                    feat->neighbours->push_back(((size_t*)neighbourVals[i].p)[n]);
-                                }
-                                delete[] ((size_t*)neighbourVals[i].p);
-                            }
-                                                        
-                            att->attRows->push_back(feat);
-                        }                        
-                    }
-                }
-                
-                if(remainRows > 0)
+            }
+        }
+        
+        if(this->numStringFields > 0)
+        {
+            H5::CompType *strTypeMem = KEAAttributeTable::createKeaStringCompTypeMem();
+            KEAString fill = KEAString();
+            fill.str = NULL;
+            H5::DataSet strDataset = keaImg->openDataSet(bandPathBase + KEA_ATT_STRING_DATA);
+            strDataset.getCreatePlist().getFillValue(*strTypeMem, &fill);
+            strDataset.close();
+            strDefaults.assign(this->numStringFields, strArena.add((fill.str != NULL)? std::string(fill.str) : std::string("")));
+            free(fill.str);
+            
+            std::vector<uint8_t> lazy(this->numStringFields, 0);
+            readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_STRING_LAZY_HEADER, H5::PredType::NATIVE_UINT8, this->numStringFields, &lazy[0]);
+            KEAString *defaults = new KEAString[this->numStringFields];
+            size_t numRead = readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_STRING_DEFAULTS_HEADER, *strTypeMem, this->numStringFields, defaults);
+            for(size_t i = 0; i < numRead; ++i)
+            {
+                strDefaults[i] = strArena.add((defaults[i].str != NULL)? std::string(defaults[i].str) : std::string(""));
+                if(lazy[i])
                 {
-                    rowOff = (numOfBlocks*chunkSize);
-                    // Read data.
-                    neighboursOffset[0] = rowOff;
-                    neighboursCount[0] = remainRows;
-                    neighboursDataspace.selectHyperslab( H5S_SELECT_SET, neighboursCount, neighboursOffset );
-                    
-                    neighboursDimsRead[0] = remainRows;
-                    neighboursMemspace = H5::DataSpace( 1, neighboursDimsRead );
-                    neighboursDataset.read(neighbourVals, intVarLenMemDT, neighboursMemspace, neighboursDataspace);
-                    
-                    if(att->numBoolFields > 0)
-                    {
-                        boolFieldsOffset[0] = rowOff;
-                        boolFieldsOffset[1] = 0;
-                        boolFieldsCount[0] = remainRows;
-                        boolFieldsCount[1] = att->numBoolFields;
-                        boolDataspace.selectHyperslab( H5S_SELECT_SET, boolFieldsCount, boolFieldsOffset );
-                        
-                        boolFieldsDimsRead[0] = remainRows;
-                        boolFieldsDimsRead[1] = att->numBoolFields;
-                        boolFieldsMemspace = H5::DataSpace( 2, boolFieldsDimsRead );
-                        
-                        boolFieldsOffset_out[0] = 0;
-                        boolFieldsOffset_out[1] = 0;
-                        boolFieldsCount_out[0] = remainRows;
-                        boolFieldsCount_out[1] = att->numBoolFields;
-                        boolFieldsMemspace.selectHyperslab( H5S_SELECT_SET, boolFieldsCount_out, boolFieldsOffset_out );
-                        
-                        boolDataset.read(boolVals, H5::PredType::NATIVE_INT, boolFieldsMemspace, boolDataspace);
-                    }
-                    
-                    if(att->numIntFields > 0)
-                    {
-                        intFieldsOffset[0] = rowOff;
-                        intFieldsOffset[1] = 0;
-                        intFieldsCount[0] = remainRows;
-                        intFieldsCount[1] = att->numIntFields;
-                        intDataspace.selectHyperslab( H5S_SELECT_SET, intFieldsCount, intFieldsOffset );
-                        
-                        intFieldsDimsRead[0] = remainRows;
-                        intFieldsDimsRead[1] = att->numIntFields;
-                        intFieldsMemspace = H5::DataSpace( 2, intFieldsDimsRead );
-                        
-                        intFieldsOffset_out[0] = 0;
-                        intFieldsOffset_out[1] = 0;
-                        intFieldsCount_out[0] = remainRows;
-                        intFieldsCount_out[1] = att->numIntFields;
-                        intFieldsMemspace.selectHyperslab( H5S_SELECT_SET, intFieldsCount_out, intFieldsOffset_out );
-
-                        intDataset.read(intVals, H5::PredType::NATIVE_INT64, intFieldsMemspace, intDataspace);
-                    }
-                    
-                    if(att->numFloatFields > 0)
-                    {
-                        floatFieldsOffset[0] = rowOff;
-                        floatFieldsOffset[1] = 0;
-                        floatFieldsCount[0] = remainRows;
-                        floatFieldsCount[1] = att->numFloatFields;
-                        floatDataspace.selectHyperslab( H5S_SELECT_SET, floatFieldsCount, floatFieldsOffset );
-                        
-                        floatFieldsDimsRead[0] = remainRows;
-                        floatFieldsDimsRead[1] = att->numFloatFields;
-                        floatFieldsMemspace = H5::DataSpace( 2, floatFieldsDimsRead );
-                        
-                        floatFieldsOffset_out[0] = 0;
-                        floatFieldsOffset_out[1] = 0;
-                        floatFieldsCount_out[0] = remainRows;
-                        floatFieldsCount_out[1] = att->numFloatFields;
-                        floatFieldsMemspace.selectHyperslab( H5S_SELECT_SET, floatFieldsCount_out, floatFieldsOffset_out );
-                        
-                        floatDataset.read(floatVals, H5::PredType::NATIVE_DOUBLE, floatFieldsMemspace, floatDataspace);
-                    }
-                    
-                    if(att->numStringFields > 0)
-                    {
-                        strFieldsOffset[0] = rowOff;
-                        strFieldsOffset[1] = 0;
-                        strFieldsCount[0] = remainRows;
-                        strFieldsCount[1] = att->numStringFields;
-                        strDataspace.selectHyperslab( H5S_SELECT_SET, strFieldsCount, strFieldsOffset );
-                        
-                        strFieldsDimsRead[0] = remainRows;
-                        strFieldsDimsRead[1] = att->numStringFields;
-                        strFieldsMemspace = H5::DataSpace( 2, strFieldsDimsRead );
-                        
-                        strFieldsOffset_out[0] = 0;
-                        strFieldsOffset_out[1] = 0;
-                        strFieldsCount_out[0] = remainRows;
-                        strFieldsCount_out[1] = att->numStringFields;
-                        strFieldsMemspace.selectHyperslab( H5S_SELECT_SET, strFieldsCount_out, strFieldsOffset_out );
-                        
-                        strDataset.read(stringVals, *strTypeMem, strFieldsMemspace, strDataspace);
-                    }
-                    
-                    // Write data into KEAATTFeatures
-                    for(size_t i = 0; i < remainRows; ++i)
-                    {
-                        feat = att->createKeaFeature();
-                        feat->fid = cFid++;
-                        
-                        if(att->numBoolFields > 0)
-                        {
-                            feat->boolFields->reserve(att->numBoolFields);
-                            for(hsize_t j = 0; j < att->numBoolFields; ++j)
-                            {
-                                feat->boolFields->at(j) = boolVals[(i*att->numBoolFields)+j];
-                            }
-                        }
-                        
-                        if(att->numIntFields > 0)
-                        {
-                            feat->intFields->reserve(att->numIntFields);
-                            for(hsize_t j = 0; j < att->numIntFields; ++j)
-                            {
-                                feat->intFields->at(j) = intVals[(i*att->numIntFields)+j];
-                            }
-                        }
-                        
-                        if(att->numFloatFields > 0)
-                        {
-                            feat->floatFields->reserve(att->numFloatFields);
-                            for(hsize_t j = 0; j < att->numFloatFields; ++j)
-                            {
-                                feat->floatFields->at(j) = floatVals[(i*att->numFloatFields)+j];
-                            }
-                        }
-                        
-                        if(att->numStringFields > 0)
-                        {
-                            feat->strFields->reserve(att->numStringFields);
-                            for(hsize_t j = 0; j < att->numStringFields; ++j)
-                            {
-                                feat->strFields->at(j) = std::string(stringVals[(i*att->numStringFields)+j].str);
-                            }
-                        }
-                        
-                        if(neighbourVals[i].length > 0)
-                        {
-                            feat->neighbours->reserve(neighbourVals[i].length);
-                            for(hsize_t n = 0; n < neighbourVals[i].length; ++n)
-                            {
-                                feat->neighbours->push_back(((size_t*)neighbourVals[i].p)[n]);
-                            }
-                            delete[] ((size_t*)neighbourVals[i].p);
-                        }
-                        
-                        att->attRows->push_back(feat);
-                    }    
+                    std::fill(strColumns[i].begin(), strColumns[i].end(), strDefaults[i]);
                 }
-                
-                boolDataset.close();
-                boolDataspace.close();
-                boolFieldsMemspace.close();
-                
-                intDataset.close();
-                intDataspace.close();
-                intFieldsMemspace.close();
-                
-                floatDataset.close();
-                floatDataspace.close();
-                floatFieldsMemspace.close();
-                
-                strDataset.close();
-                strDataspace.close();
-                strFieldsMemspace.close();
-                
-                neighboursDataset.close();
-                neighboursDataspace.close();
-                neighboursMemspace.close();
-                
-                delete[] neighbourVals;
-                
-                delete strTypeMem;
+                free(defaults[i].str);
             }
-            
-            delete[] attSize;
+            delete[] defaults;
+            delete strTypeMem;
         }
-        catch(H5::Exception &e)
+    }
+    
+    void KEAAttributeTableInMem::loadDictionaryEncodedColumns(H5::H5File *keaImg, const std::string &bandPathBase)
+    {
+        // DICTIONARY ENCODED STRING COLUMNS HOLD THEIR VALUES AS CODES INTO A
+        // SEPARATE DICTIONARY, A NEGATIVE CODE IS THE DEFAULT FOR THE COLUMN.
+        if(this->numStringFields == 0)
         {
-            throw KEAIOException(e.getDetailMsg());
+            return;
         }
-        catch (KEAATTException &e)
+        
+        std::vector<uint8_t> encoding(this->numStringFields, 0);
+        if(readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_STRING_ENCODING_HEADER, H5::PredType::NATIVE_UINT8, this->numStringFields, &encoding[0]) == 0)
         {
-            throw e;
+            return;
         }
-        catch (KEAIOException &e)
+        
+        H5::CompType *strTypeMem = KEAAttributeTable::createKeaStringCompTypeMem();
+        std::vector<std::string> defaults(this->numStringFields);
+        KEAString *defaultVals = new KEAString[this->numStringFields];
+        size_t numDefaults = readATTHeaderColumn(keaImg, bandPathBase + KEA_ATT_STRING_DEFAULTS_HEADER, *strTypeMem, this->numStringFields, defaultVals);
+        for(size_t i = 0; i < numDefaults; ++i)
         {
-            throw e;
+            if(defaultVals[i].str != NULL)
+            {
+                defaults[i] = std::string(defaultVals[i].str);
+            }
+            free(defaultVals[i].str);
         }
-        catch(std::exception &e)
+        delete[] defaultVals;
+        
+        for(size_t i = 0; i < this->numStringFields; ++i)
         {
-            throw KEAIOException(e.what());
+            if(encoding[i] != 1)
+            {
+                continue;
+            }
+            
+            // READ THE DICTIONARY
+            std::vector<const char*> dictionary;
+            H5::DataSet dictDataset = keaImg->openDataSet(bandPathBase + KEA_ATT_STRING_DICT_DATA + sizet2Str(i));
+            H5::DataSpace dictDataspace = dictDataset.getSpace();
+            hsize_t dictDims[1];
+            dictDataspace.getSimpleExtentDims(dictDims);
+            if(dictDims[0] > 0)
+            {
+                KEAString *stringVals = new KEAString[dictDims[0]];
+                H5::DataSpace dictMemspace = H5::DataSpace(1, dictDims);
+                dictDataset.read(stringVals, *strTypeMem, dictMemspace, dictDataspace);
+                dictionary.reserve(dictDims[0]);
+                for(hsize_t j = 0; j < dictDims[0]; ++j)
+                {
+                    dictionary.push_back(strArena.add(stringVals[j].str));
+                    free(stringVals[j].str);
+                }
+                delete[] stringVals;
+                dictMemspace.close();
+            }
+            dictDataspace.close();
+            dictDataset.close();
+            
+            // READ THE CODES AND DECODE THEM INTO THE ROWS
+            if(numRows > 0)
+            {
+                std::vector<int32_t> codes(numRows);
+                H5::DataSet codesDataset = keaImg->openDataSet(bandPathBase + KEA_ATT_STRING_CODES_DATA + sizet2Str(i));
+                H5::DataSpace codesDataspace = codesDataset.getSpace();
+                hsize_t codesOffset[1];
+                codesOffset[0] = 0;
+                hsize_t codesCount[1];
+                codesCount[0] = numRows;
+                codesDataspace.selectHyperslab(H5S_SELECT_SET, codesCount, codesOffset);
+                H5::DataSpace codesMemspace = H5::DataSpace(1, codesCount);
+                codesDataset.read(&codes[0], H5::PredType::NATIVE_INT32, codesMemspace, codesDataspace);
+                codesMemspace.close();
+                codesDataspace.close();
+                codesDataset.close();
+                
+                std::vector<const char*> &column = strColumns[i];
+                const char *defaultVal = strArena.add(defaults[i]);
+                for(size_t rowIdx = 0; rowIdx < numRows; ++rowIdx)
+                {
+                    int32_t code = codes[rowIdx];
+                    if((code >= 0) && (((size_t)code) < dictionary.size()))
+                    {
+                        column[rowIdx] = dictionary[code];
+                    }
+                    else
+                    {
+                        column[rowIdx] = defaultVal;
+                    }
+                }
+            }
         }
         
-        return att;
+        delete strTypeMem;
     }
     
     KEAAttributeTableInMem::~KEAAttributeTableInMem()
     {
-        for(std::vector<KEAATTFeature*>::iterator iterFeats = attRows->begin(); iterFeats != attRows->end(); ++iterFeats)
+        for(std::map<size_t, KEAATTFeature*>::iterator iterView = featureViews.begin(); iterView != featureViews.end(); ++iterView)
         {
-            this->deleteKeaFeature(*iterFeats);
+            this->deleteKeaFeature((*iterView).second);
         }
-        delete attRows;
     }
     
 }
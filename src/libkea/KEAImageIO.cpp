@@ -32,19 +32,517 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
 
 namespace kealib{
 
-    static void* kealibmalloc(size_t nSize, void* ignored)
+    static void* kealibmalloc(size_t nSize, void* /*ignored*/)
     {
         return malloc(nSize);
     }
 
-    static void kealibfree(void* ptr, void* ignored)
+    static void kealibfree(void* ptr, void* /*ignored*/)
     {
         free(ptr);
     }
 
+    template <typename T>
+    static void keaNoDataMask(const T *data, T noDataVal, uint8_t *mask, uint64_t xSize, uint64_t ySize, uint64_t xSizeData, uint64_t xSizeMask)
+    {
+        // NaN NEVER COMPARES EQUAL SO A NaN NO DATA VALUE MATCHES ANY NaN PIXEL
+        if(noDataVal != noDataVal)
+        {
+            for(uint64_t y = 0; y < ySize; ++y)
+            {
+                const T *row = &data[y * xSizeData];
+                uint8_t *maskRow = &mask[y * xSizeMask];
+                for(uint64_t x = 0; x < xSize; ++x)
+                {
+                    maskRow[x] = (row[x] != row[x]) ? 0 : 255;
+                }
+            }
+        }
+        else
+        {
+            for(uint64_t y = 0; y < ySize; ++y)
+            {
+                const T *row = &data[y * xSizeData];
+                uint8_t *maskRow = &mask[y * xSizeMask];
+                for(uint64_t x = 0; x < xSize; ++x)
+                {
+                    maskRow[x] = (row[x] == noDataVal) ? 0 : 255;
+                }
+            }
+        }
+    }
+
+    struct KEAStatsAccum
+    {
+        uint64_t count;
+        double min;
+        double max;
+        double mean;
+        double m2;
+    };
+    
+    struct KEAStatsTask
+    {
+        const double *data;
+        uint64_t numVals;
+        bool useNoData;
+        double noDataVal;
+        bool calcMoments;
+        bool keepBlocks;
+        KEAStatsAccum accum;
+        std::vector<KEAStatsAccum> blocks;
+        std::vector<uint64_t> histo;
+        double histoMin;
+        double binWidth;
+    };
+    
+    // LARGEST NUMBER OF ROWS A THEMATIC (ONE BIN PER VALUE) HISTOGRAM WILL BE GIVEN
+    static const uint64_t KEA_STATS_MAX_DIRECT_BINS = 16777216;
+    
+    // NUMBER OF PIXELS APPROXIMATE STATISTICS AIM TO SAMPLE
+    static const uint64_t KEA_STATS_APPROX_NUM_PXLS = 1048576;
+    
+    static void keaStatsReset(KEAStatsAccum *acc)
+    {
+        acc->count = 0;
+        acc->min = std::numeric_limits<double>::max();
+        acc->max = -std::numeric_limits<double>::max();
+        acc->mean = 0;
+        acc->m2 = 0;
+    }
+    
+    // COMBINE TWO SETS OF MOMENTS USING THE PAIRWISE UPDATE OF CHAN ET AL.
+    static void keaStatsMerge(KEAStatsAccum *acc, const KEAStatsAccum &other)
+    {
+        if(other.count == 0)
+        {
+            return;
+        }
+        if(acc->count == 0)
+        {
+            *acc = other;
+            return;
+        }
+        double numA = (double) acc->count;
+        double numB = (double) other.count;
+        double numAB = numA + numB;
+        double delta = other.mean - acc->mean;
+        acc->mean += delta * (numB / numAB);
+        acc->m2 += other.m2 + (delta * delta * ((numA * numB) / numAB));
+        acc->count += other.count;
+        if(other.min < acc->min)
+        {
+            acc->min = other.min;
+        }
+        if(other.max > acc->max)
+        {
+            acc->max = other.max;
+        }
+    }
+    
+    // NAN AND +/-INF ARE NEVER COUNTED: AN INFINITE MIN OR MAX WOULD MAKE THE
+    // MEAN, VARIANCE AND HISTOGRAM BIN WIDTH MEANINGLESS
+    static inline bool keaStatsSkip(double val, bool useNoData, double noDataVal)
+    {
+        return (!std::isfinite(val)) || (useNoData && (val == noDataVal));
+    }
+    
+    static inline size_t keaStatsBinIdx(double val, double histoMin, double binWidth, size_t numBins)
+    {
+        double binPos = (val - histoMin) / binWidth;
+        if(binPos < 0)
+        {
+            return 0;
+        }
+        // ALSO CATCHES A NAN POSITION, WHICH CAN'T BE CAST TO AN INTEGER
+        if(!(binPos < (double) numBins))
+        {
+            return numBins - 1;
+        }
+        return (size_t) binPos;
+    }
+    
+    static void keaStatsProcessBlock(KEAStatsTask *task)
+    {
+        const double *data = task->data;
+        const uint64_t numVals = task->numVals;
+        const bool useNoData = task->useNoData;
+        const double noDataVal = task->noDataVal;
+        
+        if(task->calcMoments)
+        {
+            // THE BLOCK IS IN CACHE SO TWO PASSES GIVE A STABLE BLOCK VARIANCE
+            // WHICH IS THEN MERGED INTO THE RUNNING TOTAL FOR THIS TASK
+            KEAStatsAccum blockAcc;
+            keaStatsReset(&blockAcc);
+            double sum = 0;
+            for(uint64_t i = 0; i < numVals; ++i)
+            {
+                double val = data[i];
+                if(keaStatsSkip(val, useNoData, noDataVal))
+                {
+                    continue;
+                }
+                ++blockAcc.count;
+                sum += val;
+                blockAcc.min = (val < blockAcc.min) ? val : blockAcc.min;
+                blockAcc.max = (val > blockAcc.max) ? val : blockAcc.max;
+            }
+            
+            if(blockAcc.count > 0)
+            {
+                blockAcc.mean = sum / ((double) blockAcc.count);
+                double m2 = 0;
+                for(uint64_t i = 0; i < numVals; ++i)
+                {
+                    double val = data[i];
+                    if(keaStatsSkip(val, useNoData, noDataVal))
+                    {
+                        continue;
+                    }
+                    double diff = val - blockAcc.mean;
+                    m2 += diff * diff;
+                }
+                blockAcc.m2 = m2;
+                keaStatsMerge(&task->accum, blockAcc);
+            }
+            
+            if(task->keepBlocks)
+            {
+                task->blocks.push_back(blockAcc);
+            }
+        }
+        
+        if(!task->histo.empty())
+        {
+            size_t numBins = task->histo.size();
+            uint64_t *histo = &task->histo[0];
+            for(uint64_t i = 0; i < numVals; ++i)
+            {
+                double val = data[i];
+                if(keaStatsSkip(val, useNoData, noDataVal))
+                {
+                    continue;
+                }
+                ++histo[keaStatsBinIdx(val, task->histoMin, task->binWidth, numBins)];
+            }
+        }
+    }
+    
+    struct KEAStatsSource
+    {
+        uint32_t overview; // 0 IS THE BAND ITSELF
+        uint64_t xSize;
+        uint64_t ySize;
+        uint32_t blockSize;
+        std::vector<uint64_t> blocks; // EMPTY MEANS EVERY BLOCK
+    };
+    
+    static size_t keaStatsReadBatch(KEAImageIO *io, uint32_t band, const KEAStatsSource &src, uint64_t firstBlock, size_t maxBlocks, double *buffer, uint64_t *numVals)
+    {
+        uint64_t xSize = src.xSize;
+        uint64_t ySize = src.ySize;
+        uint64_t blockSize = src.blockSize;
+        uint64_t numXBlocks = (xSize + blockSize - 1) / blockSize;
+        uint64_t numYBlocks = (ySize + blockSize - 1) / blockSize;
+        uint64_t numBlocks = src.blocks.empty() ? (numXBlocks * numYBlocks) : src.blocks.size();
+        uint64_t blockPxls = blockSize * blockSize;
+        
+        size_t numRead = 0;
+        for(uint64_t i = firstBlock; (i < numBlocks) && (numRead < maxBlocks); ++i)
+        {
+            uint64_t block = src.blocks.empty() ? i : src.blocks[i];
+            uint64_t xOff = (block % numXBlocks) * blockSize;
+            uint64_t yOff = (block / numXBlocks) * blockSize;
+            uint64_t xBlkSize = ((xSize - xOff) < blockSize) ? (xSize - xOff) : blockSize;
+            uint64_t yBlkSize = ((ySize - yOff) < blockSize) ? (ySize - yOff) : blockSize;
+            
+            if(src.overview == 0)
+            {
+                io->readImageBlock2Band(band, &buffer[numRead * blockPxls], xOff, yOff, xBlkSize, yBlkSize, xBlkSize, yBlkSize, kea_64float);
+            }
+            else
+            {
+                io->readFromOverview(band, src.overview, &buffer[numRead * blockPxls], xOff, yOff, xBlkSize, yBlkSize, xBlkSize, yBlkSize, kea_64float);
+            }
+            numVals[numRead] = xBlkSize * yBlkSize;
+            ++numRead;
+        }
+        return numRead;
+    }
+    
+    // BATCH OF BLOCKS SHARED BETWEEN THE READING THREAD AND THE WORKER POOL
+    struct KEAStatsQueue
+    {
+        std::mutex mutex;
+        std::condition_variable workReady;
+        std::condition_variable batchDone;
+        const double *data;
+        const uint64_t *numVals;
+        uint64_t blockPxls;
+        size_t numInBatch;
+        size_t nextInBatch;
+        size_t numDone;
+        bool stop;
+    };
+    
+    // EACH WORKER TAKES BLOCKS FROM THE CURRENT BATCH UNTIL TOLD TO STOP,
+    // ACCUMULATING THEM INTO ITS OWN TASK
+    static void keaStatsWorker(KEAStatsQueue *queue, KEAStatsTask *task)
+    {
+        std::unique_lock<std::mutex> lock(queue->mutex);
+        while(true)
+        {
+            while((!queue->stop) && (queue->nextInBatch >= queue->numInBatch))
+            {
+                queue->workReady.wait(lock);
+            }
+            if(queue->nextInBatch >= queue->numInBatch)
+            {
+                return;
+            }
+            
+            size_t i = queue->nextInBatch++;
+            task->data = &queue->data[i * queue->blockPxls];
+            task->numVals = queue->numVals[i];
+            lock.unlock();
+            keaStatsProcessBlock(task);
+            lock.lock();
+            
+            if(++queue->numDone == queue->numInBatch)
+            {
+                queue->batchDone.notify_all();
+            }
+        }
+    }
+    
+    // READS THE BAND ONE BATCH OF BLOCKS AT A TIME ON THIS THREAD WHILE THE
+    // PREVIOUS BATCH IS PROCESSED BY A POOL OF WORKERS (ONE PER TASK) STARTED
+    // ONCE FOR THE WHOLE SCAN.
+    static void keaStatsScan(KEAImageIO *io, uint32_t band, const KEAStatsSource &src, std::vector<KEAStatsTask> *tasks)
+    {
+        size_t numTasks = tasks->size();
+        uint64_t blockPxls = ((uint64_t) src.blockSize) * src.blockSize;
+        
+        std::vector<double> buffers[2];
+        std::vector<uint64_t> numVals[2];
+        for(int i = 0; i < 2; ++i)
+        {
+            buffers[i].resize(numTasks * blockPxls);
+            numVals[i].resize(numTasks);
+        }
+        
+        int current = 0;
+        uint64_t nextBlock = 0;
+        size_t numInBatch = keaStatsReadBatch(io, band, src, nextBlock, numTasks, &buffers[current][0], &numVals[current][0]);
+        nextBlock += numInBatch;
+        if(numInBatch == 0)
+        {
+            return;
+        }
+        
+        KEAStatsQueue queue;
+        queue.data = NULL;
+        queue.numVals = NULL;
+        queue.blockPxls = blockPxls;
+        queue.numInBatch = 0;
+        queue.nextInBatch = 0;
+        queue.numDone = 0;
+        queue.stop = false;
+        
+        std::vector<std::thread> workers;
+        try
+        {
+            for(size_t i = 0; i < numTasks; ++i)
+            {
+                workers.push_back(std::thread(keaStatsWorker, &queue, &(*tasks)[i]));
+            }
+            
+            while(numInBatch > 0)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(queue.mutex);
+                    queue.data = &buffers[current][0];
+                    queue.numVals = &numVals[current][0];
+                    queue.numInBatch = numInBatch;
+                    queue.nextInBatch = 0;
+                    queue.numDone = 0;
+                }
+                queue.workReady.notify_all();
+                
+                size_t numInNext = keaStatsReadBatch(io, band, src, nextBlock, numTasks, &buffers[1-current][0], &numVals[1-current][0]);
+                
+                {
+                    std::unique_lock<std::mutex> lock(queue.mutex);
+                    while(queue.numDone < queue.numInBatch)
+                    {
+                        queue.batchDone.wait(lock);
+                    }
+                }
+                
+                nextBlock += numInNext;
+                numInBatch = numInNext;
+                current = 1 - current;
+            }
+        }
+        catch(...)
+        {
+            // THE WORKERS FINISH ANY BATCH THEY HAVE STARTED BEFORE STOPPING
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.stop = true;
+            }
+            queue.workReady.notify_all();
+            for(size_t i = 0; i < workers.size(); ++i)
+            {
+                workers[i].join();
+            }
+            throw;
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.stop = true;
+        }
+        queue.workReady.notify_all();
+        for(size_t i = 0; i < workers.size(); ++i)
+        {
+            workers[i].join();
+        }
+    }
+    
+    // COLUMNS OF THE PER CHUNK STATISTICS DATASET
+    static const unsigned int KEA_CHUNK_STATS_NUM_COLS = 5;
+    enum KEAChunkStatsCol
+    {
+        kea_chunkstats_min = 0,
+        kea_chunkstats_max = 1,
+        kea_chunkstats_mean = 2,
+        kea_chunkstats_m2 = 3,
+        kea_chunkstats_count = 4
+    };
+    
+    // THE MEAN AND M2 ARE UPDATED ONE VALUE AT A TIME (WELFORD) SO THE BLOCKS
+    // MERGE WITH keaStatsMerge WITHOUT THE CANCELLATION OF A SUM OF SQUARES
+    static void keaChunkSummary(const double *data, uint64_t numVals, bool useNoData, double noDataVal, double *summary)
+    {
+        KEAStatsAccum acc;
+        keaStatsReset(&acc);
+        for(uint64_t i = 0; i < numVals; ++i)
+        {
+            double val = data[i];
+            if(keaStatsSkip(val, useNoData, noDataVal))
+            {
+                continue;
+            }
+            acc.min = (val < acc.min) ? val : acc.min;
+            acc.max = (val > acc.max) ? val : acc.max;
+            ++acc.count;
+            double delta = val - acc.mean;
+            acc.mean += delta / ((double) acc.count);
+            acc.m2 += delta * (val - acc.mean);
+        }
+        if(acc.count == 0)
+        {
+            acc.min = 0;
+            acc.max = 0;
+        }
+        summary[kea_chunkstats_min] = acc.min;
+        summary[kea_chunkstats_max] = acc.max;
+        summary[kea_chunkstats_mean] = acc.mean;
+        summary[kea_chunkstats_m2] = acc.m2;
+        summary[kea_chunkstats_count] = (double) acc.count;
+    }
+    
+    template <typename T>
+    static void keaCopyToDouble(const T *data, double *out, uint64_t xSize, uint64_t ySize, uint64_t xSizeData)
+    {
+        for(uint64_t y = 0; y < ySize; ++y)
+        {
+            const T *row = &data[y * xSizeData];
+            double *outRow = &out[y * xSize];
+            for(uint64_t x = 0; x < xSize; ++x)
+            {
+                outRow[x] = (double) row[x];
+            }
+        }
+    }
+    
+    static void keaCopyToDouble(const void *data, KEADataType dataType, double *out, uint64_t xSize, uint64_t ySize, uint64_t xSizeData)
+    {
+        switch(dataType)
+        {
+            case kea_8int:
+                keaCopyToDouble((const int8_t*)data, out, xSize, ySize, xSizeData);
+                break;
+            case kea_16int:
+                keaCopyToDouble((const int16_t*)data, out, xSize, ySize, xSizeData);
+                break;
+            case kea_32int:
+                keaCopyToDouble((const int32_t*)data, out, xSize, ySize, xSizeData);
+                break;
+            case kea_64int:
+                keaCopyToDouble((const int64_t*)data, out, xSize, ySize, xSizeData);
+                break;
+            case kea_8uint:
+                keaCopyToDouble((const uint8_t*)data, out, xSize, ySize, xSizeData);
+                break;
+            case kea_16uint:
+                keaCopyToDouble((const uint16_t*)data, out, xSize, ySize, xSizeData);
+                break;
+            case kea_32uint:
+                keaCopyToDouble((const uint32_t*)data, out, xSize, ySize, xSizeData);
+                break;
+            case kea_64uint:
+                keaCopyToDouble((const uint64_t*)data, out, xSize, ySize, xSizeData);
+                break;
+            case kea_32float:
+                keaCopyToDouble((const float*)data, out, xSize, ySize, xSizeData);
+                break;
+            case kea_64float:
+                keaCopyToDouble((const double*)data, out, xSize, ySize, xSizeData);
+                break;
+            default:
+                throw KEAIOException("The specified data type was not recognised.");
+        }
+    }
+    
+    static std::string keaStatsMetaName(const std::string &path)
+    {
+        // STRIP THE LEADING '/METADATA/' FROM THE FULL PATH
+        return path.substr(KEA_BANDNAME_METADATA.size() + 1);
+    }
+    
+// H5Dchunk_iter GIVES THE CHUNK OFFSETS IN ELEMENTS FROM 1.12.3 AND 1.14.0
+// (THE 1.13 DEVELOPMENT RELEASES GAVE THEM SCALED BY THE CHUNK SIZE)
+#if H5_VERSION_GE(1,14,0) || (H5_VERSION_GE(1,12,3) && !H5_VERSION_GE(1,13,0))
+#define KEA_HAVE_CHUNK_ITER 1
+    
+    struct KEABlockAllocation
+    {
+        std::vector<bool> *allocated;
+        uint64_t blockSize;
+        uint64_t numXBlocks;
+    };
+    
+    static int keaBlockAllocated(const hsize_t *offset, unsigned /*filterMask*/, haddr_t /*addr*/, hsize_t /*size*/, void *opData)
+    {
+        KEABlockAllocation *blocks = (KEABlockAllocation*) opData;
+        (*blocks->allocated)[((offset[0] / blocks->blockSize) * blocks->numXBlocks) + (offset[1] / blocks->blockSize)] = true;
+        return H5_ITER_CONT;
+    }
+#endif
+
     KEAImageIO::KEAImageIO()
     {
         this->fileOpen = false;
@@ -315,7 +813,13 @@ namespace kealib{
             catch ( H5::Exception &e) 
             {
                 throw KEAIOException("Could not write image data.");
-            }            
+            }
+            
+            // KEEP THE PER CHUNK STATISTICS IN STEP WITH THE DATA
+            if(this->chunkStatisticsCreated(band))
+            {
+                this->writeChunkStatistics(band, data, inDataType, xPxlOff, yPxlOff, xSizeOut, ySizeOut, xSizeBuf);
+            }
         }
         catch(KEAIOException &e)
         {
@@ -699,6 +1203,37 @@ namespace kealib{
             // GET NATIVE DATASET
             H5::DataType imgBandDT = convertDatatypeKeaToH5Native(inDataType);
             
+            // NO PHYSICAL MASK SO DERIVE ONE FROM THE NO DATA VALUE
+            if(!this->maskCreated(band))
+            {
+                uint64_t numPxls = xSizeIn * ySizeIn;
+                size_t outDTSize = imgBandDT.getSize();
+                uint8_t *maskVals = new uint8_t[numPxls * outDTSize];
+                try
+                {
+                    this->readNoDataMask(band, maskVals, xPxlOff, yPxlOff, xSizeIn, ySizeIn, xSizeIn);
+                    
+                    // CONVERT THE MASK IN PLACE TO THE REQUESTED TYPE AND COPY INTO THE BUFFER
+                    if(inDataType != kea_8uint)
+                    {
+                        H5::PredType::NATIVE_UINT8.convert(imgBandDT, numPxls, maskVals, NULL);
+                    }
+                    
+                    uint8_t *outData = (uint8_t*)data;
+                    for(uint64_t y = 0; y < ySizeIn; ++y)
+                    {
+                        memcpy(&outData[y * xSizeBuf * outDTSize], &maskVals[y * xSizeIn * outDTSize], xSizeIn * outDTSize);
+                    }
+                }
+                catch(...)
+                {
+                    delete[] maskVals;
+                    throw;
+                }
+                delete[] maskVals;
+                return;
+            }
+            
             // OPEN BAND DATASET AND READ IMAGE DATA
             try
             {
@@ -787,56 +1322,206 @@ namespace kealib{
         }
     }
     
-    bool KEAImageIO::maskCreated(uint32_t band)
+    void KEAImageIO::readImageBlockWithMask(uint32_t band, void *data, uint8_t *mask, uint64_t xPxlOff, uint64_t yPxlOff, uint64_t xSizeIn, uint64_t ySizeIn, uint64_t xSizeBuf, uint64_t ySizeBuf, KEADataType inDataType)
     {
         if(!this->fileOpen)
         {
             throw KEAIOException("Image was not open.");
         }
         
-        // CHECK PARAMETERS PROVIDED FIT WITHIN IMAGE
-        if(band == 0)
-        {
-            throw KEAIOException("KEA Image Bands start at 1.");
-        }
-        else if(band > this->numImgBands)
-        {
-            throw KEAIOException("Band is not present within image.");
-        }
-        
-        bool maskPresent = false;
-        std::string imageBandPath = KEA_DATASETNAME_BAND + uint2Str(band);
         try
         {
-            H5::Group imgBandGrp = this->keaImgFile->openGroup(imageBandPath);
-            hsize_t numItems = imgBandGrp.getNumObjs();
-            for(hsize_t i = 0; i < numItems; ++i)
+            // READ THE IMAGE DATA (THIS ALSO CHECKS THE BAND AND REGION)
+            this->readImageBlock2Band(band, data, xPxlOff, yPxlOff, xSizeIn, ySizeIn, xSizeBuf, ySizeBuf, inDataType);
+            
+            if(this->maskCreated(band))
             {
-                //std::cout << "Item: " << imgBandGrp.getObjnameByIdx(i) << std::endl;
-                if(imgBandGrp.getObjnameByIdx(i) == "MASK")
+                this->readImageBlock2BandMask(band, mask, xPxlOff, yPxlOff, xSizeIn, ySizeIn, xSizeBuf, ySizeBuf, kea_8uint);
+                return;
+            }
+            
+            // GET THE NO DATA VALUE IN THE TYPE OF THE BUFFER AND AS DOUBLE
+            uint64_t noDataVal = 0;
+            double noDataValDbl = 0;
+            bool noDataDefined = true;
+            try
+            {
+                this->getNoDataValue(band, &noDataVal, inDataType);
+                this->getNoDataValue(band, &noDataValDbl, kea_64float);
+            }
+            catch(KEAIOException &e)
+            {
+                noDataDefined = false;
+            }
+            
+            if(!noDataDefined)
+            {
+                for(uint64_t y = 0; y < ySizeIn; ++y)
                 {
-                    maskPresent = true;
-                    break;
+                    memset(&mask[y * xSizeBuf], 255, xSizeIn);
                 }
+                return;
+            }
+            
+            // IF THE NO DATA VALUE CANNOT BE REPRESENTED IN THE BUFFER TYPE THE
+            // BUFFER CANNOT BE USED SO FALL BACK TO THE BAND'S OWN DATA TYPE.
+            H5::DataType imgBandDT = convertDatatypeKeaToH5Native(inDataType);
+            double roundTrip = 0;
+            uint64_t roundTripBuf[1] = {noDataVal};
+            imgBandDT.convert(H5::PredType::NATIVE_DOUBLE, 1, roundTripBuf, NULL);
+            memcpy(&roundTrip, roundTripBuf, sizeof(double));
+            bool bothNaN = (roundTrip != roundTrip) && (noDataValDbl != noDataValDbl);
+            if((roundTrip != noDataValDbl) && !bothNaN)
+            {
+                this->readNoDataMask(band, mask, xPxlOff, yPxlOff, xSizeIn, ySizeIn, xSizeBuf);
+                return;
             }
-            imgBandGrp.close();
-            //H5::DataSet imgBandDataset = this->keaImgFile->openDataSet(imageBandPath+KEA_BANDNAME_MASK);
-            //imgBandDataset.close();
             
+            createNoDataMask(data, &noDataVal, inDataType, mask, xSizeIn, ySizeIn, xSizeBuf, xSizeBuf);
         }
-        catch (H5::Exception &e)
+        catch(KEAIOException &e)
         {
-            maskPresent = false;
+            throw e;
+        }
+        catch( H5::Exception &e )
+        {
+            throw KEAIOException(e.getCDetailMsg());
+        }
+        catch ( std::exception &e)
+        {
+            throw KEAIOException(e.what());
         }
-        
-        return maskPresent;
     }
     
-    
-    void KEAImageIO::setImageMetaData(std::string name, std::string value)
+    void KEAImageIO::readNoDataMask(uint32_t band, uint8_t *mask, uint64_t xPxlOff, uint64_t yPxlOff, uint64_t xSizeIn, uint64_t ySizeIn, uint64_t xSizeMask)
     {
-        if(!this->fileOpen)
-        {
+        KEADataType bandDataType = this->getImageBandDataType(band);
+        
+        uint64_t noDataVal = 0;
+        bool noDataDefined = true;
+        try
+        {
+            this->getNoDataValue(band, &noDataVal, bandDataType);
+        }
+        catch(KEAIOException &e)
+        {
+            noDataDefined = false;
+        }
+        
+        if(!noDataDefined)
+        {
+            // NO MASK AND NO NO DATA VALUE SO EVERY PIXEL IS VALID
+            for(uint64_t y = 0; y < ySizeIn; ++y)
+            {
+                memset(&mask[y * xSizeMask], 255, xSizeIn);
+            }
+            return;
+        }
+        
+        size_t bandDTSize = convertDatatypeKeaToH5Native(bandDataType).getSize();
+        uint8_t *bandData = new uint8_t[xSizeIn * ySizeIn * bandDTSize];
+        try
+        {
+            this->readImageBlock2Band(band, bandData, xPxlOff, yPxlOff, xSizeIn, ySizeIn, xSizeIn, ySizeIn, bandDataType);
+            createNoDataMask(bandData, &noDataVal, bandDataType, mask, xSizeIn, ySizeIn, xSizeIn, xSizeMask);
+        }
+        catch(...)
+        {
+            delete[] bandData;
+            throw;
+        }
+        delete[] bandData;
+    }
+    
+    void KEAImageIO::createNoDataMask(const void *data, const void *noDataVal, KEADataType dataType, uint8_t *mask, uint64_t xSize, uint64_t ySize, uint64_t xSizeData, uint64_t xSizeMask)
+    {
+        switch(dataType)
+        {
+            case kea_8int:
+                keaNoDataMask((const int8_t*)data, *((const int8_t*)noDataVal), mask, xSize, ySize, xSizeData, xSizeMask);
+                break;
+            case kea_16int:
+                keaNoDataMask((const int16_t*)data, *((const int16_t*)noDataVal), mask, xSize, ySize, xSizeData, xSizeMask);
+                break;
+            case kea_32int:
+                keaNoDataMask((const int32_t*)data, *((const int32_t*)noDataVal), mask, xSize, ySize, xSizeData, xSizeMask);
+                break;
+            case kea_64int:
+                keaNoDataMask((const int64_t*)data, *((const int64_t*)noDataVal), mask, xSize, ySize, xSizeData, xSizeMask);
+                break;
+            case kea_8uint:
+                keaNoDataMask((const uint8_t*)data, *((const uint8_t*)noDataVal), mask, xSize, ySize, xSizeData, xSizeMask);
+                break;
+            case kea_16uint:
+                keaNoDataMask((const uint16_t*)data, *((const uint16_t*)noDataVal), mask, xSize, ySize, xSizeData, xSizeMask);
+                break;
+            case kea_32uint:
+                keaNoDataMask((const uint32_t*)data, *((const uint32_t*)noDataVal), mask, xSize, ySize, xSizeData, xSizeMask);
+                break;
+            case kea_64uint:
+                keaNoDataMask((const uint64_t*)data, *((const uint64_t*)noDataVal), mask, xSize, ySize, xSizeData, xSizeMask);
+                break;
+            case kea_32float:
+                keaNoDataMask((const float*)data, *((const float*)noDataVal), mask, xSize, ySize, xSizeData, xSizeMask);
+                break;
+            case kea_64float:
+                keaNoDataMask((const double*)data, *((const double*)noDataVal), mask, xSize, ySize, xSizeData, xSizeMask);
+                break;
+            default:
+                throw KEAIOException("The specified data type was not recognised.");
+        }
+    }
+    
+    bool KEAImageIO::maskCreated(uint32_t band)
+    {
+        if(!this->fileOpen)
+        {
+            throw KEAIOException("Image was not open.");
+        }
+        
+        // CHECK PARAMETERS PROVIDED FIT WITHIN IMAGE
+        if(band == 0)
+        {
+            throw KEAIOException("KEA Image Bands start at 1.");
+        }
+        else if(band > this->numImgBands)
+        {
+            throw KEAIOException("Band is not present within image.");
+        }
+        
+        bool maskPresent = false;
+        std::string imageBandPath = KEA_DATASETNAME_BAND + uint2Str(band);
+        try
+        {
+            H5::Group imgBandGrp = this->keaImgFile->openGroup(imageBandPath);
+            hsize_t numItems = imgBandGrp.getNumObjs();
+            for(hsize_t i = 0; i < numItems; ++i)
+            {
+                //std::cout << "Item: " << imgBandGrp.getObjnameByIdx(i) << std::endl;
+                if(imgBandGrp.getObjnameByIdx(i) == "MASK")
+                {
+                    maskPresent = true;
+                    break;
+                }
+            }
+            imgBandGrp.close();
+            //H5::DataSet imgBandDataset = this->keaImgFile->openDataSet(imageBandPath+KEA_BANDNAME_MASK);
+            //imgBandDataset.close();
+            
+        }
+        catch (H5::Exception &e)
+        {
+            maskPresent = false;
+        }
+        
+        return maskPresent;
+    }
+    
+    
+    void KEAImageIO::setImageMetaData(std::string name, std::string value)
+    {
+        if(!this->fileOpen)
+        {
             throw KEAIOException("Image was not open.");
         }
         
@@ -1294,7 +1979,6 @@ namespace kealib{
         {    
             std::string noDataValPath = KEA_DATASETNAME_BAND + uint2Str(band) + KEA_BANDNAME_NO_DATA_VAL;
             H5::DataSet datasetImgNDV;
-            H5::Attribute noDataDefAttribute;
             
             try 
             {
@@ -1312,15 +1996,11 @@ namespace kealib{
                 datasetImgNDV = this->keaImgFile->createDataSet(noDataValPath, imgBandDT, dataspaceNDV);
             }
             
-            try
-            {
-                noDataDefAttribute = datasetImgNDV.openAttribute(KEA_NODATA_DEFINED);
-            }
-            catch (H5::Exception &e)
-            {
-                H5::DataSpace attr_dataspace = H5::DataSpace(H5S_SCALAR);
-                noDataDefAttribute = datasetImgNDV.createAttribute(KEA_NODATA_DEFINED, H5::PredType::STD_I8LE, attr_dataspace);
-            }
+            // H5::Attribute HAS NO COPY ASSIGNMENT SO OPEN OR CREATE IT IN ONE GO
+            H5::DataSpace attr_dataspace = H5::DataSpace(H5S_SCALAR);
+            H5::Attribute noDataDefAttribute = datasetImgNDV.attrExists(KEA_NODATA_DEFINED)?
+                        datasetImgNDV.openAttribute(KEA_NODATA_DEFINED) :
+                        datasetImgNDV.createAttribute(KEA_NODATA_DEFINED, H5::PredType::STD_I8LE, attr_dataspace);
             
             int val = 1;
             noDataDefAttribute.write(H5::PredType::NATIVE_INT, &val);
@@ -1330,6 +2010,10 @@ namespace kealib{
             datasetImgNDV.write( data, dataDT );
             datasetImgNDV.close();
             this->keaImgFile->flush(H5F_SCOPE_GLOBAL);
+            
+            // THE CHUNK STATISTICS EXCLUDE THE NO DATA VALUE SO ARE NOW OUT OF
+            // DATE, BUT REBUILDING THEM MEANS READING THE WHOLE BAND
+            this->setChunkStatisticsStale(band, true);
         } 
         catch ( H5::Exception &e) 
         {
@@ -1434,6 +2118,8 @@ namespace kealib{
             }
             
             datasetImgNDV.close();
+            
+            this->setChunkStatisticsStale(band, true);
         }
         catch ( H5::Exception &e)
         {
@@ -2739,6 +3425,1097 @@ namespace kealib{
         }
     }
     
+    KEABandStats KEAImageIO::computeBandStatistics(uint32_t band, bool approxOK, bool ignoreNoData, bool writeStats)
+    {
+        if(!this->fileOpen)
+        {
+            throw KEAIOException("Image was not open.");
+        }
+        
+        KEABandStats stats;
+        try
+        {
+            // CHECK PARAMETERS PROVIDED FIT WITHIN IMAGE
+            if(band == 0)
+            {
+                throw KEAIOException("KEA Image Bands start at 1.");
+            }
+            else if(band > this->numImgBands)
+            {
+                throw KEAIOException("Band is not present within image.");
+            }
+            
+            KEADataType dataType = this->getImageBandDataType(band);
+            bool thematic = (this->getImageBandLayerType(band) == kea_thematic);
+            
+            KEAStatsSource src;
+            src.overview = 0;
+            src.xSize = this->spatialInfoFile->xSize;
+            src.ySize = this->spatialInfoFile->ySize;
+            src.blockSize = this->getImageBlockSize(band);
+            stats.approximate = false;
+            stats.sampleFraction = 1;
+            
+            uint64_t bandPxls = src.xSize * src.ySize;
+            if(approxOK && (bandPxls > KEA_STATS_APPROX_NUM_PXLS))
+            {
+                // USE THE COARSEST OVERVIEW WHICH STILL HAS ENOUGH PIXELS
+                uint32_t numOverviews = this->getNumOfOverviews(band);
+                uint64_t ovPxls = 0;
+                for(uint32_t overview = 1; overview <= numOverviews; ++overview)
+                {
+                    uint64_t ovXSize = 0;
+                    uint64_t ovYSize = 0;
+                    this->getOverviewSize(band, overview, &ovXSize, &ovYSize);
+                    if(((ovXSize * ovYSize) >= KEA_STATS_APPROX_NUM_PXLS) && ((src.overview == 0) || ((ovXSize * ovYSize) < ovPxls)))
+                    {
+                        src.overview = overview;
+                        src.xSize = ovXSize;
+                        src.ySize = ovYSize;
+                        ovPxls = ovXSize * ovYSize;
+                    }
+                }
+                
+                if((src.overview > 0) && (ovPxls < bandPxls))
+                {
+                    src.blockSize = this->getOverviewBlockSize(band, src.overview);
+                    stats.sampleFraction = ((double) ovPxls) / ((double) bandPxls);
+                    stats.approximate = true;
+                }
+                else
+                {
+                    // NO SUITABLE OVERVIEW SO SPLIT THE BLOCKS INTO EQUAL STRATA AND
+                    // READ ONE (PSEUDO RANDOMLY CHOSEN BUT REPEATABLE) BLOCK FROM EACH
+                    src.overview = 0;
+                    src.xSize = this->spatialInfoFile->xSize;
+                    src.ySize = this->spatialInfoFile->ySize;
+                    uint64_t blockPxls = ((uint64_t) src.blockSize) * src.blockSize;
+                    uint64_t numBlocks = ((src.xSize + src.blockSize - 1) / src.blockSize) * ((src.ySize + src.blockSize - 1) / src.blockSize);
+                    uint64_t numSamples = (KEA_STATS_APPROX_NUM_PXLS + blockPxls - 1) / blockPxls;
+                    if(numSamples < numBlocks)
+                    {
+                        uint32_t seed = 12345;
+                        for(uint64_t i = 0; i < numSamples; ++i)
+                        {
+                            uint64_t stratumStart = (i * numBlocks) / numSamples;
+                            uint64_t stratumEnd = ((i + 1) * numBlocks) / numSamples;
+                            seed = (seed * 1103515245) + 12345;
+                            src.blocks.push_back(stratumStart + (((uint64_t) (seed >> 8)) % (stratumEnd - stratumStart)));
+                        }
+                        stats.sampleFraction = ((double) numSamples) / ((double) numBlocks);
+                        stats.approximate = true;
+                    }
+                }
+            }
+            
+            bool bandHasNoData = false;
+            double noDataVal = 0;
+            try
+            {
+                this->getNoDataValue(band, &noDataVal, kea_64float);
+                bandHasNoData = true;
+            }
+            catch(KEAIOException &e)
+            {
+                bandHasNoData = false;
+            }
+            bool useNoData = ignoreNoData && bandHasNoData;
+            
+            // SMALL INTEGER TYPES GET A COUNT PER VALUE IN THE SAME PASS AS THE
+            // MOMENTS SO THE HISTOGRAM DOES NOT NEED A SECOND PASS
+            size_t numDirect = 0;
+            double directMin = 0;
+            if(dataType == kea_8int)
+            {
+                numDirect = 256;
+                directMin = -128;
+            }
+            else if(dataType == kea_8uint)
+            {
+                numDirect = 256;
+            }
+            else if(dataType == kea_16int)
+            {
+                numDirect = 65536;
+                directMin = -32768;
+            }
+            else if(dataType == kea_16uint)
+            {
+                numDirect = 65536;
+            }
+            
+            unsigned int numThreads = std::thread::hardware_concurrency();
+            if(numThreads == 0)
+            {
+                numThreads = 1;
+            }
+            
+            std::vector<KEAStatsTask> tasks(numThreads);
+            for(std::vector<KEAStatsTask>::iterator iterTask = tasks.begin(); iterTask != tasks.end(); ++iterTask)
+            {
+                (*iterTask).useNoData = useNoData;
+                (*iterTask).noDataVal = noDataVal;
+                (*iterTask).calcMoments = true;
+                (*iterTask).keepBlocks = !src.blocks.empty();
+                keaStatsReset(&(*iterTask).accum);
+                (*iterTask).histo.assign(numDirect, 0);
+                (*iterTask).histoMin = directMin;
+                (*iterTask).binWidth = 1;
+            }
+            
+            // THE CHUNK STATISTICS GIVE THE MOMENTS WITHOUT READING THE IMAGE, LEAVING
+            // ONLY THE HISTOGRAM PASS. THEY ALWAYS EXCLUDE THE NO DATA VALUE SO CAN
+            // ONLY BE USED WHEN THE BAND HAS NONE OR IT IS BEING IGNORED ANYWAY.
+            KEAStatsAccum total;
+            keaStatsReset(&total);
+            bool momentsFromChunks = (!stats.approximate) && (ignoreNoData || !bandHasNoData) && this->chunkStatisticsCreated(band) && !this->chunkStatisticsStale(band);
+            if(momentsFromChunks)
+            {
+                KEABandStats chunkTotal = this->getBandStatisticsFromChunks(band);
+                total.count = chunkTotal.numValidPxls;
+                total.min = chunkTotal.min;
+                total.max = chunkTotal.max;
+                total.mean = chunkTotal.mean;
+                total.m2 = chunkTotal.stdDev * chunkTotal.stdDev * ((double) chunkTotal.numValidPxls);
+            }
+            
+            std::vector<uint64_t> directCounts(numDirect, 0);
+            std::vector<KEAStatsAccum> sampledBlocks;
+            if(!momentsFromChunks || (numDirect > 0))
+            {
+                for(std::vector<KEAStatsTask>::iterator iterTask = tasks.begin(); iterTask != tasks.end(); ++iterTask)
+                {
+                    (*iterTask).calcMoments = !momentsFromChunks;
+                }
+                
+                keaStatsScan(this, band, src, &tasks);
+                
+                for(std::vector<KEAStatsTask>::iterator iterTask = tasks.begin(); iterTask != tasks.end(); ++iterTask)
+                {
+                    keaStatsMerge(&total, (*iterTask).accum);
+                    sampledBlocks.insert(sampledBlocks.end(), (*iterTask).blocks.begin(), (*iterTask).blocks.end());
+                    for(size_t i = 0; i < numDirect; ++i)
+                    {
+                        directCounts[i] += (*iterTask).histo[i];
+                    }
+                }
+            }
+            
+            if(total.count == 0)
+            {
+                throw KEAIOException("The image band does not contain any valid pixels.");
+            }
+            
+            stats.min = total.min;
+            stats.max = total.max;
+            stats.mean = total.mean;
+            stats.stdDev = sqrt(total.m2 / ((double) total.count));
+            stats.numValidPxls = total.count;
+            
+            // THE SAMPLED BLOCKS ARE CLUSTERS OF (USUALLY CORRELATED) PIXELS SO THE
+            // STANDARD ERROR OF THE MEAN COMES FROM THE SPREAD OF THE BLOCK TOTALS
+            // AROUND THE RATIO ESTIMATE, WITH THE FINITE POPULATION CORRECTION. IT
+            // IS ZERO WHEN EVERY PIXEL WAS USED AND NOT KNOWN (NaN) FOR AN OVERVIEW.
+            stats.meanStdError = 0;
+            if(stats.approximate && src.blocks.empty())
+            {
+                stats.meanStdError = std::numeric_limits<double>::quiet_NaN();
+            }
+            else if(stats.approximate)
+            {
+                double numBlks = (double) sampledBlocks.size();
+                double meanBlkCount = ((double) total.count) / numBlks;
+                double sumSqResid = 0;
+                for(std::vector<KEAStatsAccum>::iterator iterBlk = sampledBlocks.begin(); iterBlk != sampledBlocks.end(); ++iterBlk)
+                {
+                    double resid = ((double) (*iterBlk).count) * ((*iterBlk).mean - total.mean);
+                    sumSqResid += resid * resid;
+                }
+                stats.meanStdError = std::numeric_limits<double>::quiet_NaN();
+                if(numBlks > 1)
+                {
+                    double varTotals = sumSqResid / (numBlks - 1);
+                    stats.meanStdError = sqrt(((1.0 - stats.sampleFraction) * varTotals) / numBlks) / meanBlkCount;
+                }
+            }
+            
+            // THEMATIC INTEGER LAYERS GET ONE BIN PER VALUE (MATCHING THE ROWS OF THE
+            // ATTRIBUTE TABLE), 8 BIT LAYERS 256 DIRECT BINS AND EVERYTHING ELSE 256
+            // LINEAR BINS BETWEEN THE MINIMUM AND MAXIMUM.
+            bool integerType = (dataType != kea_32float) && (dataType != kea_64float);
+            bool thematicHisto = thematic && integerType && (total.min >= 0) && (total.max < KEA_STATS_MAX_DIRECT_BINS);
+            size_t numBins = 256;
+            if(thematicHisto)
+            {
+                numBins = ((size_t) total.max) + 1;
+                stats.histoMin = 0;
+                stats.histoMax = total.max;
+                stats.histoBinFunction = "direct";
+            }
+            else if(dataType == kea_8uint)
+            {
+                stats.histoMin = 0;
+                stats.histoMax = 255;
+                stats.histoBinFunction = "direct";
+            }
+            else if(total.min == total.max)
+            {
+                stats.histoMin = total.min - 0.5;
+                stats.histoMax = total.max + 0.5;
+                stats.histoBinFunction = "linear";
+            }
+            else
+            {
+                stats.histoMin = total.min;
+                stats.histoMax = total.max;
+                stats.histoBinFunction = "linear";
+            }
+            double binWidth = 1;
+            if(stats.histoBinFunction == "linear")
+            {
+                binWidth = (stats.histoMax - stats.histoMin) / ((double) numBins);
+            }
+            stats.histogram.assign(numBins, 0);
+            
+            if(numDirect > 0)
+            {
+                // REBIN THE COUNTS PER VALUE
+                for(size_t i = 0; i < numDirect; ++i)
+                {
+                    if(directCounts[i] > 0)
+                    {
+                        stats.histogram[keaStatsBinIdx(directMin + ((double) i), stats.histoMin, binWidth, numBins)] += directCounts[i];
+                    }
+                }
+            }
+            else
+            {
+                // SECOND PASS NOW THE RANGE OF THE BINS IS KNOWN
+                for(std::vector<KEAStatsTask>::iterator iterTask = tasks.begin(); iterTask != tasks.end(); ++iterTask)
+                {
+                    (*iterTask).calcMoments = false;
+                    (*iterTask).histo.assign(numBins, 0);
+                    (*iterTask).histoMin = stats.histoMin;
+                    (*iterTask).binWidth = binWidth;
+                }
+                
+                keaStatsScan(this, band, src, &tasks);
+                
+                for(std::vector<KEAStatsTask>::iterator iterTask = tasks.begin(); iterTask != tasks.end(); ++iterTask)
+                {
+                    for(size_t i = 0; i < numBins; ++i)
+                    {
+                        stats.histogram[i] += (*iterTask).histo[i];
+                    }
+                }
+            }
+            
+            size_t modeBin = 0;
+            for(size_t i = 1; i < numBins; ++i)
+            {
+                if(stats.histogram[i] > stats.histogram[modeBin])
+                {
+                    modeBin = i;
+                }
+            }
+            if(stats.histoBinFunction == "direct")
+            {
+                stats.mode = stats.histoMin + ((double) modeBin);
+            }
+            else
+            {
+                stats.mode = stats.histoMin + ((((double) modeBin) + 0.5) * binWidth);
+            }
+            
+            // AN APPROXIMATE RESULT IS ONLY RETURNED, AS ITS SAMPLE COUNTS WOULD REPLACE
+            // THE FULL COUNTS IN THE ATTRIBUTE TABLE (AND THE FILE MAY BE READ ONLY)
+            if(writeStats && !stats.approximate)
+            {
+                // WRITE THE STATISTICS TO THE BAND METADATA
+                this->setImageBandMetaData(band, keaStatsMetaName(KEA_BANDNAME_METADATA_MIN), double2Str(stats.min));
+                this->setImageBandMetaData(band, keaStatsMetaName(KEA_BANDNAME_METADATA_MAX), double2Str(stats.max));
+                this->setImageBandMetaData(band, keaStatsMetaName(KEA_BANDNAME_METADATA_MEAN), double2Str(stats.mean));
+                this->setImageBandMetaData(band, keaStatsMetaName(KEA_BANDNAME_METADATA_STDDEV), double2Str(stats.stdDev));
+                this->setImageBandMetaData(band, keaStatsMetaName(KEA_BANDNAME_METADATA_MODE), double2Str(stats.mode));
+                this->setImageBandMetaData(band, keaStatsMetaName(KEA_BANDNAME_METADATA_HISTOMIN), double2Str(stats.histoMin));
+                this->setImageBandMetaData(band, keaStatsMetaName(KEA_BANDNAME_METADATA_HISTOMAX), double2Str(stats.histoMax));
+                this->setImageBandMetaData(band, keaStatsMetaName(KEA_BANDNAME_METADATA_HISTONUMBINS), sizet2Str(numBins));
+                this->setImageBandMetaData(band, keaStatsMetaName(KEA_BANDNAME_METADATA_HISTOBINFUNCTION), stats.histoBinFunction);
+                
+                // ONLY CLEAR A FLAG LEFT BY AN EARLIER APPROXIMATE RUN
+                std::vector<std::string> metaNames = this->getImageBandMetaDataNames(band);
+                if(std::find(metaNames.begin(), metaNames.end(), keaStatsMetaName(KEA_BANDNAME_METADATA_APPROXIMATE)) != metaNames.end())
+                {
+                    this->setImageBandMetaData(band, keaStatsMetaName(KEA_BANDNAME_METADATA_APPROXIMATE), "NO");
+                }
+                
+                // A THEMATIC ATTRIBUTE TABLE IS INDEXED BY PIXEL VALUE SO ONLY GIVE IT
+                // A HISTOGRAM WHEN THERE IS ONE BIN PER VALUE
+                if(!thematic || thematicHisto)
+                {
+                    this->writeHistogramToAttributeTable(band, stats.histogram);
+                }
+            }
+        }
+        catch(KEAIOException &e)
+        {
+            throw e;
+        }
+        catch(KEAATTException &e)
+        {
+            throw e;
+        }
+        catch( H5::Exception &e )
+        {
+            throw KEAIOException(e.getCDetailMsg());
+        }
+        catch ( std::exception &e)
+        {
+            throw KEAIOException(e.what());
+        }
+        
+        return stats;
+    }
+    
+    void KEAImageIO::createChunkStatistics(uint32_t band, uint32_t deflate)
+    {
+        if(!this->fileOpen)
+        {
+            throw KEAIOException("Image was not open.");
+        }
+        
+        try
+        {
+            // CHECK PARAMETERS PROVIDED FIT WITHIN IMAGE
+            if(band == 0)
+            {
+                throw KEAIOException("KEA Image Bands start at 1.");
+            }
+            else if(band > this->numImgBands)
+            {
+                throw KEAIOException("Band is not present within image.");
+            }
+            
+            if(!this->chunkStatisticsCreated(band))
+            {
+                uint64_t blockSize = this->getImageBlockSize(band);
+                uint64_t numXBlocks = (this->spatialInfoFile->xSize + blockSize - 1) / blockSize;
+                uint64_t numYBlocks = (this->spatialInfoFile->ySize + blockSize - 1) / blockSize;
+                
+                // ONE ROW PER IMAGE BLOCK (ROW MAJOR) HOLDING MIN, MAX, MEAN, M2 AND COUNT
+                hsize_t dims[2] = { numXBlocks * numYBlocks, KEA_CHUNK_STATS_NUM_COLS };
+                hsize_t dimsChunk[2] = { (dims[0] < 1024) ? dims[0] : 1024, KEA_CHUNK_STATS_NUM_COLS };
+                H5::DSetCreatPropList creationDSPList;
+                creationDSPList.setChunk(2, dimsChunk);
+                creationDSPList.setShuffle();
+                creationDSPList.setDeflate(deflate);
+                
+                std::string chunkStatsPath = KEA_DATASETNAME_BAND + uint2Str(band) + KEA_BANDNAME_CHUNK_STATS;
+                H5::DataSpace chunkStatsDataSpace(2, dims);
+                H5::DataSet chunkStatsDataset = this->keaImgFile->createDataSet(chunkStatsPath, H5::PredType::IEEE_F64LE, chunkStatsDataSpace, creationDSPList);
+                chunkStatsDataset.close();
+                chunkStatsDataSpace.close();
+            }
+            
+            // (RE)BUILD THE STATISTICS FROM THE CURRENT DATA
+            this->updateChunkStatistics(band, 0, 0, this->spatialInfoFile->xSize, this->spatialInfoFile->ySize);
+        }
+        catch(KEAIOException &e)
+        {
+            throw e;
+        }
+        catch( H5::Exception &e )
+        {
+            throw KEAIOException("Could not create the chunk statistics.");
+        }
+        catch ( std::exception &e)
+        {
+            throw KEAIOException(e.what());
+        }
+    }
+    
+    bool KEAImageIO::chunkStatisticsCreated(uint32_t band)
+    {
+        if(!this->fileOpen)
+        {
+            throw KEAIOException("Image was not open.");
+        }
+        
+        // CHECK PARAMETERS PROVIDED FIT WITHIN IMAGE
+        if(band == 0)
+        {
+            throw KEAIOException("KEA Image Bands start at 1.");
+        }
+        else if(band > this->numImgBands)
+        {
+            throw KEAIOException("Band is not present within image.");
+        }
+        
+        std::string chunkStatsPath = KEA_DATASETNAME_BAND + uint2Str(band) + KEA_BANDNAME_CHUNK_STATS;
+        return H5Lexists(this->keaImgFile->getId(), chunkStatsPath.c_str(), H5P_DEFAULT) > 0;
+    }
+    
+    bool KEAImageIO::chunkStatisticsStale(uint32_t band)
+    {
+        if(!this->chunkStatisticsCreated(band))
+        {
+            return false;
+        }
+        
+        int stale = 0;
+        try
+        {
+            std::string chunkStatsPath = KEA_DATASETNAME_BAND + uint2Str(band) + KEA_BANDNAME_CHUNK_STATS;
+            H5::DataSet chunkStatsDataset = this->keaImgFile->openDataSet(chunkStatsPath);
+            if(chunkStatsDataset.attrExists(KEA_CHUNK_STATS_STALE))
+            {
+                H5::Attribute staleAttribute = chunkStatsDataset.openAttribute(KEA_CHUNK_STATS_STALE);
+                staleAttribute.read(H5::PredType::NATIVE_INT, &stale);
+                staleAttribute.close();
+            }
+            chunkStatsDataset.close();
+        }
+        catch( H5::Exception &e )
+        {
+            throw KEAIOException("Could not read whether the chunk statistics are stale.");
+        }
+        return (stale != 0);
+    }
+    
+    void KEAImageIO::setChunkStatisticsStale(uint32_t band, bool stale)
+    {
+        if(!this->chunkStatisticsCreated(band))
+        {
+            return;
+        }
+        
+        try
+        {
+            std::string chunkStatsPath = KEA_DATASETNAME_BAND + uint2Str(band) + KEA_BANDNAME_CHUNK_STATS;
+            H5::DataSet chunkStatsDataset = this->keaImgFile->openDataSet(chunkStatsPath);
+            H5::DataSpace attr_dataspace = H5::DataSpace(H5S_SCALAR);
+            H5::Attribute staleAttribute = chunkStatsDataset.attrExists(KEA_CHUNK_STATS_STALE)?
+                        chunkStatsDataset.openAttribute(KEA_CHUNK_STATS_STALE) :
+                        chunkStatsDataset.createAttribute(KEA_CHUNK_STATS_STALE, H5::PredType::STD_I8LE, attr_dataspace);
+            int val = stale ? 1 : 0;
+            staleAttribute.write(H5::PredType::NATIVE_INT, &val);
+            staleAttribute.close();
+            chunkStatsDataset.close();
+        }
+        catch( H5::Exception &e )
+        {
+            throw KEAIOException("Could not mark whether the chunk statistics are stale.");
+        }
+    }
+    
+    void KEAImageIO::updateChunkStatistics(uint32_t band, uint64_t xPxlOff, uint64_t yPxlOff, uint64_t xSize, uint64_t ySize)
+    {
+        if(!this->fileOpen)
+        {
+            throw KEAIOException("Image was not open.");
+        }
+        
+        try
+        {
+            if(!this->chunkStatisticsCreated(band))
+            {
+                throw KEAIOException("Chunk statistics have not been created for the band.");
+            }
+            
+            this->writeChunkStatistics(band, NULL, kea_undefined, xPxlOff, yPxlOff, xSize, ySize, xSize);
+            if((xPxlOff == 0) && (yPxlOff == 0) && (xSize == this->spatialInfoFile->xSize) && (ySize == this->spatialInfoFile->ySize))
+            {
+                this->setChunkStatisticsStale(band, false);
+            }
+            this->keaImgFile->flush(H5F_SCOPE_GLOBAL);
+        }
+        catch(KEAIOException &e)
+        {
+            throw e;
+        }
+        catch( H5::Exception &e )
+        {
+            throw KEAIOException("Could not update the chunk statistics.");
+        }
+        catch ( std::exception &e)
+        {
+            throw KEAIOException(e.what());
+        }
+    }
+    
+    void KEAImageIO::writeChunkStatistics(uint32_t band, const void *data, KEADataType dataType, uint64_t xPxlOff, uint64_t yPxlOff, uint64_t xSize, uint64_t ySize, uint64_t xSizeData)
+    {
+        double *blockData = NULL;
+        double *summaries = NULL;
+        try
+        {
+            if((xSize == 0) || (ySize == 0))
+            {
+                return;
+            }
+            
+            uint64_t imgXSize = this->spatialInfoFile->xSize;
+            uint64_t imgYSize = this->spatialInfoFile->ySize;
+            if(((xPxlOff + xSize) > imgXSize) || ((yPxlOff + ySize) > imgYSize))
+            {
+                throw KEAIOException("Region is not within the image.");
+            }
+            
+            bool useNoData = false;
+            double noDataVal = 0;
+            try
+            {
+                this->getNoDataValue(band, &noDataVal, kea_64float);
+                useNoData = true;
+            }
+            catch(KEAIOException &e)
+            {
+                useNoData = false;
+            }
+            
+            // THE CALLER'S VALUES ARE ONLY THOSE STORED WHEN HDF5 DOES NOT HAVE TO
+            // CONVERT THEM (OR CONVERTS THEM TO DOUBLES ANYWAY)
+            KEADataType bandDataType = this->getImageBandDataType(band);
+            if((data != NULL) && (dataType != bandDataType) && (bandDataType != kea_64float))
+            {
+                data = NULL;
+            }
+            
+            uint64_t blockSize = this->getImageBlockSize(band);
+            uint64_t numXBlocks = (imgXSize + blockSize - 1) / blockSize;
+            uint64_t startXBlock = xPxlOff / blockSize;
+            uint64_t endXBlock = (xPxlOff + xSize - 1) / blockSize;
+            uint64_t startYBlock = yPxlOff / blockSize;
+            uint64_t endYBlock = (yPxlOff + ySize - 1) / blockSize;
+            uint64_t numBlocksInRow = endXBlock - startXBlock + 1;
+            size_t dataPxlSize = (data != NULL) ? convertDatatypeKeaToH5Native(dataType).getSize() : 0;
+            
+            blockData = new double[blockSize * blockSize];
+            summaries = new double[numBlocksInRow * KEA_CHUNK_STATS_NUM_COLS];
+            
+            std::string chunkStatsPath = KEA_DATASETNAME_BAND + uint2Str(band) + KEA_BANDNAME_CHUNK_STATS;
+            H5::DataSet chunkStatsDataset = this->keaImgFile->openDataSet(chunkStatsPath);
+            H5::DataSpace chunkStatsDataspace = chunkStatsDataset.getSpace();
+            hsize_t memDims[2] = { numBlocksInRow, KEA_CHUNK_STATS_NUM_COLS };
+            H5::DataSpace memDataspace(2, memDims);
+            
+            // BLOCKS THE REGION COVERS ARE SUMMARISED FROM THE CALLER'S BUFFER; THE
+            // REST ARE RE-READ IN FULL AS PIXELS OUTSIDE THE REGION STILL CONTRIBUTE
+            for(uint64_t yBlock = startYBlock; yBlock <= endYBlock; ++yBlock)
+            {
+                uint64_t yOff = yBlock * blockSize;
+                uint64_t yBlkSize = ((imgYSize - yOff) < blockSize) ? (imgYSize - yOff) : blockSize;
+                bool yCovered = (yOff >= yPxlOff) && ((yOff + yBlkSize) <= (yPxlOff + ySize));
+                for(uint64_t xBlock = startXBlock; xBlock <= endXBlock; ++xBlock)
+                {
+                    uint64_t xOff = xBlock * blockSize;
+                    uint64_t xBlkSize = ((imgXSize - xOff) < blockSize) ? (imgXSize - xOff) : blockSize;
+                    bool xCovered = (xOff >= xPxlOff) && ((xOff + xBlkSize) <= (xPxlOff + xSize));
+                    if((data != NULL) && xCovered && yCovered)
+                    {
+                        const uint8_t *blockStart = ((const uint8_t*) data) + ((((yOff - yPxlOff) * xSizeData) + (xOff - xPxlOff)) * dataPxlSize);
+                        keaCopyToDouble(blockStart, dataType, blockData, xBlkSize, yBlkSize, xSizeData);
+                    }
+                    else
+                    {
+                        this->readImageBlock2Band(band, blockData, xOff, yOff, xBlkSize, yBlkSize, xBlkSize, yBlkSize, kea_64float);
+                    }
+                    keaChunkSummary(blockData, xBlkSize * yBlkSize, useNoData, noDataVal, &summaries[(xBlock - startXBlock) * KEA_CHUNK_STATS_NUM_COLS]);
+                }
+                
+                hsize_t fileOffset[2] = { (yBlock * numXBlocks) + startXBlock, 0 };
+                chunkStatsDataspace.selectHyperslab(H5S_SELECT_SET, memDims, fileOffset);
+                chunkStatsDataset.write(summaries, H5::PredType::NATIVE_DOUBLE, memDataspace, chunkStatsDataspace);
+            }
+            
+            memDataspace.close();
+            chunkStatsDataspace.close();
+            chunkStatsDataset.close();
+        }
+        catch(KEAIOException &e)
+        {
+            delete[] blockData;
+            delete[] summaries;
+            throw e;
+        }
+        catch( H5::Exception &e )
+        {
+            delete[] blockData;
+            delete[] summaries;
+            throw KEAIOException("Could not update the chunk statistics.");
+        }
+        catch ( std::exception &e)
+        {
+            delete[] blockData;
+            delete[] summaries;
+            throw KEAIOException(e.what());
+        }
+        delete[] blockData;
+        delete[] summaries;
+    }
+    
+    void KEAImageIO::getChunkStatistics(uint32_t band, uint64_t xPxlOff, uint64_t yPxlOff, uint64_t xSize, uint64_t ySize, std::vector<KEAChunkStats> *chunkStats)
+    {
+        if(!this->fileOpen)
+        {
+            throw KEAIOException("Image was not open.");
+        }
+        
+        try
+        {
+            if(!this->chunkStatisticsCreated(band))
+            {
+                throw KEAIOException("Chunk statistics have not been created for the band.");
+            }
+            if(this->chunkStatisticsStale(band))
+            {
+                throw KEAIOException("The chunk statistics are stale since the no data value changed; update them for the whole band.");
+            }
+            
+            chunkStats->clear();
+            if((xSize == 0) || (ySize == 0))
+            {
+                return;
+            }
+            
+            uint64_t imgXSize = this->spatialInfoFile->xSize;
+            uint64_t imgYSize = this->spatialInfoFile->ySize;
+            if(((xPxlOff + xSize) > imgXSize) || ((yPxlOff + ySize) > imgYSize))
+            {
+                throw KEAIOException("Region is not within the image.");
+            }
+            
+            uint64_t blockSize = this->getImageBlockSize(band);
+            uint64_t numXBlocks = (imgXSize + blockSize - 1) / blockSize;
+            uint64_t startXBlock = xPxlOff / blockSize;
+            uint64_t endXBlock = (xPxlOff + xSize - 1) / blockSize;
+            uint64_t startYBlock = yPxlOff / blockSize;
+            uint64_t endYBlock = (yPxlOff + ySize - 1) / blockSize;
+            uint64_t numBlocksInRow = endXBlock - startXBlock + 1;
+            
+            std::vector<double> summaries(numBlocksInRow * KEA_CHUNK_STATS_NUM_COLS);
+            chunkStats->reserve(numBlocksInRow * (endYBlock - startYBlock + 1));
+            
+            std::string chunkStatsPath = KEA_DATASETNAME_BAND + uint2Str(band) + KEA_BANDNAME_CHUNK_STATS;
+            H5::DataSet chunkStatsDataset = this->keaImgFile->openDataSet(chunkStatsPath);
+            H5::DataSpace chunkStatsDataspace = chunkStatsDataset.getSpace();
+            hsize_t memDims[2] = { numBlocksInRow, KEA_CHUNK_STATS_NUM_COLS };
+            H5::DataSpace memDataspace(2, memDims);
+            
+            for(uint64_t yBlock = startYBlock; yBlock <= endYBlock; ++yBlock)
+            {
+                hsize_t fileOffset[2] = { (yBlock * numXBlocks) + startXBlock, 0 };
+                chunkStatsDataspace.selectHyperslab(H5S_SELECT_SET, memDims, fileOffset);
+                chunkStatsDataset.read(&summaries[0], H5::PredType::NATIVE_DOUBLE, memDataspace, chunkStatsDataspace);
+                
+                for(uint64_t i = 0; i < numBlocksInRow; ++i)
+                {
+                    const double *summary = &summaries[i * KEA_CHUNK_STATS_NUM_COLS];
+                    KEAChunkStats blockStats;
+                    blockStats.xBlock = startXBlock + i;
+                    blockStats.yBlock = yBlock;
+                    blockStats.min = summary[kea_chunkstats_min];
+                    blockStats.max = summary[kea_chunkstats_max];
+                    blockStats.mean = summary[kea_chunkstats_mean];
+                    blockStats.m2 = summary[kea_chunkstats_m2];
+                    blockStats.count = (uint64_t) summary[kea_chunkstats_count];
+                    chunkStats->push_back(blockStats);
+                }
+            }
+            
+            memDataspace.close();
+            chunkStatsDataspace.close();
+            chunkStatsDataset.close();
+        }
+        catch(KEAIOException &e)
+        {
+            throw e;
+        }
+        catch( H5::Exception &e )
+        {
+            throw KEAIOException("Could not read the chunk statistics.");
+        }
+        catch ( std::exception &e)
+        {
+            throw KEAIOException(e.what());
+        }
+    }
+    
+    KEABandStats KEAImageIO::getBandStatisticsFromChunks(uint32_t band)
+    {
+        std::vector<KEAChunkStats> chunkStats;
+        this->getChunkStatistics(band, 0, 0, this->spatialInfoFile->xSize, this->spatialInfoFile->ySize, &chunkStats);
+        
+        // MERGE THE BLOCK SUMMARIES
+        KEAStatsAccum total;
+        keaStatsReset(&total);
+        for(std::vector<KEAChunkStats>::iterator iterChunk = chunkStats.begin(); iterChunk != chunkStats.end(); ++iterChunk)
+        {
+            if((*iterChunk).count == 0)
+            {
+                continue;
+            }
+            KEAStatsAccum blockAcc;
+            blockAcc.count = (*iterChunk).count;
+            blockAcc.min = (*iterChunk).min;
+            blockAcc.max = (*iterChunk).max;
+            blockAcc.mean = (*iterChunk).mean;
+            blockAcc.m2 = (*iterChunk).m2;
+            keaStatsMerge(&total, blockAcc);
+        }
+        
+        if(total.count == 0)
+        {
+            throw KEAIOException("The image band does not contain any valid pixels.");
+        }
+        
+        KEABandStats stats;
+        stats.min = total.min;
+        stats.max = total.max;
+        stats.mean = total.mean;
+        stats.stdDev = sqrt(total.m2 / ((double) total.count));
+        stats.mode = 0;
+        stats.numValidPxls = total.count;
+        stats.histoMin = 0;
+        stats.histoMax = 0;
+        stats.histoBinFunction = "";
+        stats.approximate = false;
+        stats.sampleFraction = 1;
+        stats.meanStdError = 0;
+        return stats;
+    }
+    
+    bool KEAImageIO::isBlockEmpty(uint32_t band, uint64_t xBlock, uint64_t yBlock)
+    {
+        if(!this->fileOpen)
+        {
+            throw KEAIOException("Image was not open.");
+        }
+        
+        bool empty = false;
+        try
+        {
+            // CHECK PARAMETERS PROVIDED FIT WITHIN IMAGE
+            if(band == 0)
+            {
+                throw KEAIOException("KEA Image Bands start at 1.");
+            }
+            else if(band > this->numImgBands)
+            {
+                throw KEAIOException("Band is not present within image.");
+            }
+            
+            uint64_t blockSize = this->getImageBlockSize(band);
+            uint64_t numXBlocks = (this->spatialInfoFile->xSize + blockSize - 1) / blockSize;
+            uint64_t numYBlocks = (this->spatialInfoFile->ySize + blockSize - 1) / blockSize;
+            if((xBlock >= numXBlocks) || (yBlock >= numYBlocks))
+            {
+                throw KEAIOException("Block is not within the image.");
+            }
+            
+#if H5_VERSION_GE(1,10,5)
+            // A CHUNK WHICH HAS NEVER BEEN WRITTEN HAS NO ADDRESS IN THE FILE
+            std::string imageBandPath = KEA_DATASETNAME_BAND + uint2Str(band);
+            H5::DataSet imgBandDataset = this->keaImgFile->openDataSet( imageBandPath + KEA_BANDNAME_DATA );
+            hsize_t chunkOffset[2] = { yBlock * blockSize, xBlock * blockSize };
+            unsigned filterMask = 0;
+            haddr_t chunkAddr = HADDR_UNDEF;
+            hsize_t chunkSize = 0;
+            if(H5Dget_chunk_info_by_coord(imgBandDataset.getId(), chunkOffset, &filterMask, &chunkAddr, &chunkSize) < 0)
+            {
+                throw KEAIOException("Could not get the chunk information for the block.");
+            }
+            empty = (chunkAddr == HADDR_UNDEF);
+            imgBandDataset.close();
+#endif
+            
+            // A WRITTEN BLOCK WITHOUT ANY VALID PIXELS IS ALSO EMPTY
+            if(!empty && this->chunkStatisticsCreated(band) && !this->chunkStatisticsStale(band))
+            {
+                std::vector<KEAChunkStats> chunkStats;
+                this->getChunkStatistics(band, xBlock * blockSize, yBlock * blockSize, 1, 1, &chunkStats);
+                empty = (chunkStats.size() == 1) && (chunkStats[0].count == 0);
+            }
+        }
+        catch(KEAIOException &e)
+        {
+            throw e;
+        }
+        catch( H5::Exception &e )
+        {
+            throw KEAIOException(e.getCDetailMsg());
+        }
+        catch ( std::exception &e)
+        {
+            throw KEAIOException(e.what());
+        }
+        
+        return empty;
+    }
+    
+    void KEAImageIO::getBlockAllocationMap(uint32_t band, std::vector<bool> *allocated)
+    {
+        if(!this->fileOpen)
+        {
+            throw KEAIOException("Image was not open.");
+        }
+        
+        try
+        {
+            // CHECK PARAMETERS PROVIDED FIT WITHIN IMAGE
+            if(band == 0)
+            {
+                throw KEAIOException("KEA Image Bands start at 1.");
+            }
+            else if(band > this->numImgBands)
+            {
+                throw KEAIOException("Band is not present within image.");
+            }
+            
+            uint64_t blockSize = this->getImageBlockSize(band);
+            uint64_t numXBlocks = (this->spatialInfoFile->xSize + blockSize - 1) / blockSize;
+            uint64_t numYBlocks = (this->spatialInfoFile->ySize + blockSize - 1) / blockSize;
+            
+#if H5_VERSION_GE(1,10,5)
+            allocated->assign(numXBlocks * numYBlocks, false);
+            
+            // ONLY THE ALLOCATED CHUNKS ARE LISTED BY HDF5
+            std::string imageBandPath = KEA_DATASETNAME_BAND + uint2Str(band);
+            H5::DataSet imgBandDataset = this->keaImgFile->openDataSet( imageBandPath + KEA_BANDNAME_DATA );
+#ifdef KEA_HAVE_CHUNK_ITER
+            // ONE PASS OVER THE CHUNK INDEX, H5Dget_chunk_info LOOKS EACH CHUNK UP FROM THE START
+            KEABlockAllocation blocks;
+            blocks.allocated = allocated;
+            blocks.blockSize = blockSize;
+            blocks.numXBlocks = numXBlocks;
+            if(H5Dchunk_iter(imgBandDataset.getId(), H5P_DEFAULT, keaBlockAllocated, &blocks) < 0)
+            {
+                throw KEAIOException("Could not iterate over the chunks allocated.");
+            }
+#else
+            H5::DataSpace imgBandDataspace = imgBandDataset.getSpace();
+            hsize_t numChunks = 0;
+            if(H5Dget_num_chunks(imgBandDataset.getId(), imgBandDataspace.getId(), &numChunks) < 0)
+            {
+                throw KEAIOException("Could not get the number of chunks allocated.");
+            }
+            for(hsize_t i = 0; i < numChunks; ++i)
+            {
+                hsize_t chunkOffset[2] = { 0, 0 };
+                unsigned filterMask = 0;
+                haddr_t chunkAddr = HADDR_UNDEF;
+                hsize_t chunkSize = 0;
+                if(H5Dget_chunk_info(imgBandDataset.getId(), imgBandDataspace.getId(), i, chunkOffset, &filterMask, &chunkAddr, &chunkSize) < 0)
+                {
+                    throw KEAIOException("Could not get the chunk information.");
+                }
+                (*allocated)[((chunkOffset[0] / blockSize) * numXBlocks) + (chunkOffset[1] / blockSize)] = true;
+            }
+            imgBandDataspace.close();
+#endif
+            imgBandDataset.close();
+#else
+            // WITHOUT THE CHUNK QUERY FUNCTIONS EVERY BLOCK HAS TO BE ASSUMED TO HAVE DATA
+            allocated->assign(numXBlocks * numYBlocks, true);
+#endif
+        }
+        catch(KEAIOException &e)
+        {
+            throw e;
+        }
+        catch( H5::Exception &e )
+        {
+            throw KEAIOException(e.getCDetailMsg());
+        }
+        catch ( std::exception &e)
+        {
+            throw KEAIOException(e.what());
+        }
+    }
+    
+    void KEAImageIO::getEmptyBlocks(uint32_t band, uint64_t xBlockOff, uint64_t yBlockOff, uint64_t xNumBlocks, uint64_t yNumBlocks, std::vector<bool> *empty)
+    {
+        if(!this->fileOpen)
+        {
+            throw KEAIOException("Image was not open.");
+        }
+        
+        try
+        {
+            // CHECK PARAMETERS PROVIDED FIT WITHIN IMAGE
+            if(band == 0)
+            {
+                throw KEAIOException("KEA Image Bands start at 1.");
+            }
+            else if(band > this->numImgBands)
+            {
+                throw KEAIOException("Band is not present within image.");
+            }
+            
+            uint64_t blockSize = this->getImageBlockSize(band);
+            uint64_t numXBlocks = (this->spatialInfoFile->xSize + blockSize - 1) / blockSize;
+            uint64_t numYBlocks = (this->spatialInfoFile->ySize + blockSize - 1) / blockSize;
+            if(((xBlockOff + xNumBlocks) > numXBlocks) || ((yBlockOff + yNumBlocks) > numYBlocks))
+            {
+                throw KEAIOException("Blocks are not within the image.");
+            }
+            
+            empty->assign(xNumBlocks * yNumBlocks, false);
+            if((xNumBlocks == 0) || (yNumBlocks == 0))
+            {
+                return;
+            }
+            
+            // THE DATASETS ARE EACH READ ONCE FOR THE WHOLE WINDOW
+            std::vector<bool> allocated;
+            this->getBlockAllocationMap(band, &allocated);
+            std::vector<KEAChunkStats> chunkStats;
+            if(this->chunkStatisticsCreated(band) && !this->chunkStatisticsStale(band))
+            {
+                uint64_t xPxlOff = xBlockOff * blockSize;
+                uint64_t yPxlOff = yBlockOff * blockSize;
+                uint64_t xSize = std::min(xNumBlocks * blockSize, this->spatialInfoFile->xSize - xPxlOff);
+                uint64_t ySize = std::min(yNumBlocks * blockSize, this->spatialInfoFile->ySize - yPxlOff);
+                this->getChunkStatistics(band, xPxlOff, yPxlOff, xSize, ySize, &chunkStats);
+            }
+            
+            for(uint64_t y = 0; y < yNumBlocks; ++y)
+            {
+                for(uint64_t x = 0; x < xNumBlocks; ++x)
+                {
+                    size_t idx = (y * xNumBlocks) + x;
+                    bool blockEmpty = !allocated[((yBlockOff + y) * numXBlocks) + xBlockOff + x];
+                    if(!blockEmpty && !chunkStats.empty())
+                    {
+                        blockEmpty = (chunkStats[idx].count == 0);
+                    }
+                    (*empty)[idx] = blockEmpty;
+                }
+            }
+        }
+        catch(KEAIOException &e)
+        {
+            throw e;
+        }
+        catch( H5::Exception &e )
+        {
+            throw KEAIOException(e.getCDetailMsg());
+        }
+        catch ( std::exception &e)
+        {
+            throw KEAIOException(e.what());
+        }
+    }
+    
+    double KEAImageIO::getStatsPercentile(const KEABandStats &stats, double percentile)
+    {
+        if((percentile < 0) || (percentile > 100))
+        {
+            throw KEAIOException("The percentile must be between 0 and 100.");
+        }
+        if(stats.histogram.empty())
+        {
+            throw KEAIOException("The statistics do not contain a histogram.");
+        }
+        
+        uint64_t total = 0;
+        for(std::vector<uint64_t>::const_iterator iterBins = stats.histogram.begin(); iterBins != stats.histogram.end(); ++iterBins)
+        {
+            total += *iterBins;
+        }
+        if(total == 0)
+        {
+            throw KEAIOException("The histogram is empty.");
+        }
+        
+        // DIRECT BINS ARE CENTRED ON THEIR VALUE, LINEAR BINS START AT THEIR LOWER EDGE
+        size_t numBins = stats.histogram.size();
+        double binWidth = 1;
+        double firstEdge = stats.histoMin - 0.5;
+        if(stats.histoBinFunction != "direct")
+        {
+            binWidth = (stats.histoMax - stats.histoMin) / ((double) numBins);
+            firstEdge = stats.histoMin;
+        }
+        
+        // INTERPOLATE LINEARLY WITHIN THE BIN HOLDING THE TARGET COUNT
+        double target = (percentile / 100.0) * ((double) total);
+        double cumulative = 0;
+        for(size_t i = 0; i < numBins; ++i)
+        {
+            double binCount = (double) stats.histogram[i];
+            if((binCount > 0) && ((cumulative + binCount) >= target))
+            {
+                double fraction = (target - cumulative) / binCount;
+                return firstEdge + ((((double) i) + fraction) * binWidth);
+            }
+            cumulative += binCount;
+        }
+        return firstEdge + (((double) numBins) * binWidth);
+    }
+    
+    void KEAImageIO::writeHistogramToAttributeTable(uint32_t band, const std::vector<uint64_t> &histogram)
+    {
+        KEAAttributeTable *att = this->getAttributeTable(kea_att_file, band);
+        try
+        {
+            // USE AN EXISTING PIXEL COUNT COLUMN IF THERE IS ONE
+            std::string histoField = "";
+            std::vector<std::string> fieldNames = att->getFieldNames();
+            for(std::vector<std::string>::iterator iterNames = fieldNames.begin(); iterNames != fieldNames.end(); ++iterNames)
+            {
+                if(att->getField(*iterNames).usage == KEA_ATT_HISTOGRAM_USAGE)
+                {
+                    histoField = *iterNames;
+                    break;
+                }
+            }
+            if(histoField == "")
+            {
+                histoField = KEA_ATT_HISTOGRAM_FIELD;
+                att->addAttFloatField(histoField, 0, KEA_ATT_HISTOGRAM_USAGE);
+            }
+            
+            if(att->getSize() < histogram.size())
+            {
+                att->addRows(histogram.size() - att->getSize());
+            }
+            
+            // ROWS BEYOND THE LAST BIN ARE RESET TO ZERO
+            size_t numRows = att->getSize();
+            KEAATTField field = att->getField(histoField);
+            if(field.dataType == kea_att_float)
+            {
+                std::vector<double> vals(numRows, 0);
+                for(size_t i = 0; i < histogram.size(); ++i)
+                {
+                    vals[i] = (double) histogram[i];
+                }
+                att->setFloatFields(0, numRows, field.idx, &vals[0]);
+            }
+            else if(field.dataType == kea_att_int)
+            {
+                std::vector<int64_t> vals(numRows, 0);
+                for(size_t i = 0; i < histogram.size(); ++i)
+                {
+                    vals[i] = (int64_t) histogram[i];
+                }
+                att->setIntFields(0, numRows, field.idx, &vals[0]);
+            }
+            else
+            {
+                throw KEAATTException("The histogram column \'" + histoField + "\' is not numeric.");
+            }
+        }
+        catch(...)
+        {
+            KEAAttributeTable::destroyAttributeTable(att);
+            throw;
+        }
+        KEAAttributeTable::destroyAttributeTable(att);
+        this->keaImgFile->flush(H5F_SCOPE_GLOBAL);
+    }
+    
     KEAAttributeTable* KEAImageIO::getAttributeTable(KEAATTType type, uint32_t band)
     {
         KEAAttributeTable *att = NULL;
@@ -3297,7 +5074,7 @@ namespace kealib{
         return h5Datatype;
     }
 
-    void KEAImageIO::addImageBandToFile(H5::H5File *keaImgH5File, const KEADataType dataType, const uint32_t xSize,   const uint32_t ySize, const uint32_t bandIndex, std::string bandDescrip, const uint32_t imageBlockSize, const uint32_t attBlockSize,  const uint32_t deflate)
+    void KEAImageIO::addImageBandToFile(H5::H5File *keaImgH5File, const KEADataType dataType, const uint32_t xSize,   const uint32_t ySize, const uint32_t bandIndex, std::string bandDescrip, const uint32_t imageBlockSize, const uint32_t /*attBlockSize*/,  const uint32_t deflate)
     {
         int initFillVal = 0;
 
@@ -0,0 +1,223 @@
+/*
+ *  KEAStringArena.cpp
+ *  LibKEA
+ *
+ *  Copyright 2026 LibKEA. All rights reserved.
+ *
+ *  This file is part of LibKEA.
+ *
+ *  Permission is hereby granted, free of charge, to any person 
+ *  obtaining a copy of this software and associated documentation 
+ *  files (the "Software"), to deal in the Software without restriction, 
+ *  including without limitation the rights to use, copy, modify, 
+ *  merge, publish, distribute, sublicense, and/or sell copies of the 
+ *  Software, and to permit persons to whom the Software is furnished 
+ *  to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be 
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR 
+ *  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+ *  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "libkea/KEAStringArena.h"
+#include <string.h>
+#include <algorithm>
+
+namespace kealib{
+    
+    static const char keaEmptyString[1] = {'\0'};
+    
+    static inline uint64_t keaStringArenaHash(const char *str, size_t len)
+    {
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ULL;
+        for(size_t i = 0; i < len; ++i)
+        {
+            hash ^= (unsigned char)str[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+    
+    KEAStringArena::KEAStringArena(size_t blockSize)
+    {
+        this->blockSize = std::max(blockSize, KEA_STRING_ARENA_INTERN_MAX + 1);
+        this->blockPos = NULL;
+        this->blockRemaining = 0;
+        this->allocatedBytes = 0;
+        this->usedBytes = 0;
+        this->numInterned = 0;
+    }
+    
+    const char* KEAStringArena::add(const char *str, size_t len)
+    {
+        if(len == 0)
+        {
+            return keaEmptyString;
+        }
+        
+        if(len > KEA_STRING_ARENA_INTERN_MAX)
+        {
+            char *copy = this->allocate(len + 1);
+            memcpy(copy, str, len);
+            copy[len] = '\0';
+            return copy;
+        }
+        
+        // LOOK FOR AN EXISTING COPY (LINEAR PROBING, THE TABLE IS AT MOST HALF FULL)
+        if(((this->numInterned + 1) * 2) > this->internTable.size())
+        {
+            this->growInternTable();
+        }
+        uint64_t hash = keaStringArenaHash(str, len);
+        size_t mask = this->internTable.size() - 1;
+        size_t slot = hash & mask;
+        while(this->internTable[slot] != NULL)
+        {
+            if((this->internHashes[slot] == hash) && (strncmp(this->internTable[slot], str, len) == 0) && (this->internTable[slot][len] == '\0'))
+            {
+                return this->internTable[slot];
+            }
+            slot = (slot + 1) & mask;
+        }
+        
+        char *copy = this->allocate(len + 1);
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+        this->internTable[slot] = copy;
+        this->internHashes[slot] = hash;
+        ++this->numInterned;
+        return copy;
+    }
+    
+    const char* KEAStringArena::add(const char *str)
+    {
+        if(str == NULL)
+        {
+            return keaEmptyString;
+        }
+        return this->add(str, strlen(str));
+    }
+    
+    const char* KEAStringArena::add(const std::string &str)
+    {
+        return this->add(str.c_str(), str.size());
+    }
+    
+    const char* KEAStringArena::empty()
+    {
+        return keaEmptyString;
+    }
+    
+    char* KEAStringArena::allocate(size_t size)
+    {
+        this->usedBytes += size;
+        
+        // LARGE STRINGS GET A BLOCK OF THEIR OWN SO THE CURRENT BLOCK IS NOT WASTED
+        if(size > (this->blockSize / 4))
+        {
+            char *block = new char[size];
+            this->blocks.push_back(block);
+            this->allocatedBytes += size;
+            return block;
+        }
+        
+        if(size > this->blockRemaining)
+        {
+            this->blockPos = new char[this->blockSize];
+            this->blocks.push_back(this->blockPos);
+            this->blockRemaining = this->blockSize;
+            this->allocatedBytes += this->blockSize;
+        }
+        char *ptr = this->blockPos;
+        this->blockPos += size;
+        this->blockRemaining -= size;
+        return ptr;
+    }
+    
+    void KEAStringArena::growInternTable()
+    {
+        size_t newSize = std::max(this->internTable.size() * 2, (size_t)1024);
+        std::vector<const char*> newTable(newSize, (const char*)NULL);
+        std::vector<uint64_t> newHashes(newSize, 0);
+        size_t mask = newSize - 1;
+        for(size_t i = 0; i < this->internTable.size(); ++i)
+        {
+            if(this->internTable[i] != NULL)
+            {
+                size_t slot = this->internHashes[i] & mask;
+                while(newTable[slot] != NULL)
+                {
+                    slot = (slot + 1) & mask;
+                }
+                newTable[slot] = this->internTable[i];
+                newHashes[slot] = this->internHashes[i];
+            }
+        }
+        this->internTable.swap(newTable);
+        this->internHashes.swap(newHashes);
+    }
+    
+    size_t KEAStringArena::getNumBlocks() const
+    {
+        return this->blocks.size();
+    }
+    
+    size_t KEAStringArena::getAllocatedBytes() const
+    {
+        return this->allocatedBytes;
+    }
+    
+    size_t KEAStringArena::getUsedBytes() const
+    {
+        return this->usedBytes;
+    }
+    
+    size_t KEAStringArena::getNumInterned() const
+    {
+        return this->numInterned;
+    }
+    
+    void KEAStringArena::clear()
+    {
+        for(std::vector<char*>::iterator iterBlock = this->blocks.begin(); iterBlock != this->blocks.end(); ++iterBlock)
+        {
+            delete[] (*iterBlock);
+        }
+        this->blocks.clear();
+        this->blockPos = NULL;
+        this->blockRemaining = 0;
+        this->allocatedBytes = 0;
+        this->usedBytes = 0;
+        this->internTable.clear();
+        this->internHashes.clear();
+        this->numInterned = 0;
+    }
+    
+    void KEAStringArena::swap(KEAStringArena &other)
+    {
+        std::swap(this->blockSize, other.blockSize);
+        this->blocks.swap(other.blocks);
+        std::swap(this->blockPos, other.blockPos);
+        std::swap(this->blockRemaining, other.blockRemaining);
+        std::swap(this->allocatedBytes, other.allocatedBytes);
+        std::swap(this->usedBytes, other.usedBytes);
+        this->internTable.swap(other.internTable);
+        this->internHashes.swap(other.internHashes);
+        std::swap(this->numInterned, other.numInterned);
+    }
+    
+    KEAStringArena::~KEAStringArena()
+    {
+        this->clear();
+    }
+    
+}
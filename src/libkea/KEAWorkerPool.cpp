@@ -0,0 +1,138 @@
+/*
+ *  KEAWorkerPool.cpp
+ *  LibKEA
+ *
+ *  Copyright 2026 LibKEA. All rights reserved.
+ *
+ *  This file is part of LibKEA.
+ *
+ *  Permission is hereby granted, free of charge, to any person 
+ *  obtaining a copy of this software and associated documentation 
+ *  files (the "Software"), to deal in the Software without restriction, 
+ *  including without limitation the rights to use, copy, modify, 
+ *  merge, publish, distribute, sublicense, and/or sell copies of the 
+ *  Software, and to permit persons to whom the Software is furnished 
+ *  to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be 
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR 
+ *  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF 
+ *  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION 
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "libkea/KEAWorkerPool.h"
+
+namespace kealib{
+    
+    KEAWorkerPool::KEAWorkerPool(size_t numThreads)
+    {
+        // ONE WORKER PER CORE UNLESS TOLD OTHERWISE
+        if(numThreads == 0)
+        {
+            numThreads = std::thread::hardware_concurrency();
+        }
+        if(numThreads == 0)
+        {
+            numThreads = 1;
+        }
+        this->numRunning = 0;
+        this->stop = false;
+        for(size_t i = 0; i < numThreads; ++i)
+        {
+            this->workers.push_back(std::thread(KEAWorkerPool::runWorker, this));
+        }
+    }
+    
+    size_t KEAWorkerPool::getNumThreads() const
+    {
+        return this->workers.size();
+    }
+    
+    void KEAWorkerPool::submit(KEAWorkerJob job, void *arg)
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->jobs.push_back(std::pair<KEAWorkerJob, void*>(job, arg));
+        }
+        this->jobReady.notify_one();
+    }
+    
+    void KEAWorkerPool::wait()
+    {
+        std::exception_ptr jobError;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            while((!this->jobs.empty()) || (this->numRunning > 0))
+            {
+                this->jobsDone.wait(lock);
+            }
+            jobError = this->error;
+            this->error = std::exception_ptr();
+        }
+        if(jobError)
+        {
+            std::rethrow_exception(jobError);
+        }
+    }
+    
+    void KEAWorkerPool::runWorker(KEAWorkerPool *pool)
+    {
+        std::unique_lock<std::mutex> lock(pool->mutex);
+        while(true)
+        {
+            while((!pool->stop) && pool->jobs.empty())
+            {
+                pool->jobReady.wait(lock);
+            }
+            if(pool->stop)
+            {
+                return;
+            }
+            
+            std::pair<KEAWorkerJob, void*> job = pool->jobs.front();
+            pool->jobs.pop_front();
+            ++pool->numRunning;
+            lock.unlock();
+            try
+            {
+                job.first(job.second);
+                lock.lock();
+            }
+            catch(...)
+            {
+                lock.lock();
+                if(!pool->error)
+                {
+                    pool->error = std::current_exception();
+                }
+            }
+            
+            if((--pool->numRunning == 0) && pool->jobs.empty())
+            {
+                pool->jobsDone.notify_all();
+            }
+        }
+    }
+    
+    KEAWorkerPool::~KEAWorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->jobs.clear();
+            this->stop = true;
+        }
+        this->jobReady.notify_all();
+        for(size_t i = 0; i < this->workers.size(); ++i)
+        {
+            this->workers[i].join();
+        }
+    }
+    
+}
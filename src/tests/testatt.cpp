@@ -0,0 +1,1499 @@
+/*
+ *  testatt.cpp
+ *  LibKEA
+ *
+ *  Copyright 2012 LibKEA. All rights reserved.
+ *
+ *  This file is part of LibKEA.
+ *
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without restriction,
+ *  including without limitation the rights to use, copy, modify,
+ *  merge, publish, distribute, sublicense, and/or sell copies of the
+ *  Software, and to permit persons to whom the Software is furnished
+ *  to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ *  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ *  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "libkea/KEAImageIO.h"
+#include "libkea/KEAAttributeTableAppender.h"
+
+static int numFailed = 0;
+
+#define CHECK(cond) \
+    if(!(cond)) \
+    { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        ++numFailed; \
+    }
+
+#define ATT_IMG_SIZE 10
+
+static kealib::KEAImageIO* createTestImage(const char *fileName)
+{
+    kealib::KEAImageIO *io = new kealib::KEAImageIO();
+    H5::H5File *h5file = kealib::KEAImageIO::createKEAImage(fileName,
+                    kealib::kea_32uint, ATT_IMG_SIZE, ATT_IMG_SIZE, 1);
+    io->openKEAImageHeader(h5file);
+    io->setImageBandLayerType(1, kealib::kea_thematic);
+    return io;
+}
+
+static kealib::KEAImageIO* openTestImage(const char *fileName)
+{
+    kealib::KEAImageIO *io = new kealib::KEAImageIO();
+    io->openKEAImageHeader(kealib::KEAImageIO::openKeaH5RW(fileName));
+    return io;
+}
+
+static void checkDefaults(const kealib::KEAAttributeTable *att, size_t fid)
+{
+    CHECK(att->getBoolField(fid, "flag") == true);
+    CHECK(att->getIntField(fid, "first") == 0);
+    CHECK(att->getIntField(fid, "seven") == 7);
+    CHECK(att->getFloatField(fid, "half") == 2.5);
+    CHECK(att->getStringField(fid, "label") == "none");
+}
+
+static void testLazyDefaults()
+{
+    kealib::KEAImageIO *io = createTestImage("testatt_defaults.kea");
+    kealib::KEAAttributeTable *att = io->getAttributeTable(kealib::kea_att_file, 1);
+    att->addRows(100);
+    att->addAttBoolField("empty", false);
+    att->addAttBoolField("flag", true);
+    att->addAttIntField("first", 0);
+    att->addAttIntField("seven", 7);
+    att->addAttFloatField("zero", 0);
+    att->addAttFloatField("half", 2.5);
+    att->addAttStringField("name", "");
+    att->addAttStringField("label", "none");
+    checkDefaults(att, 50);
+    
+    // A WRITE MATERIALISES EACH COLUMN, ROWS ADDED AFTER STILL TAKE THE DEFAULT
+    att->setBoolField(5, "flag", false);
+    att->setIntField(5, "seven", 3);
+    att->setFloatField(5, "half", 1.5);
+    att->setStringField(5, "label", "five");
+    att->addRows(50);
+    CHECK(att->getSize() == 150);
+    CHECK(att->getIntField(5, "seven") == 3);
+    CHECK(att->getStringField(5, "label") == "five");
+    checkDefaults(att, 50);
+    checkDefaults(att, 120);
+    CHECK(att->getBoolField(120, "empty") == false);
+    CHECK(att->getStringField(120, "name") == "");
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    io->close();
+    delete io;
+    
+    // THE SAME FOR THE IN MEMORY TABLE, AND ONCE IT HAS BEEN WRITTEN BACK
+    io = openTestImage("testatt_defaults.kea");
+    att = io->getAttributeTable(kealib::kea_att_mem, 1);
+    checkDefaults(att, 120);
+    att->addRows(10);
+    CHECK(att->getSize() == 160);
+    checkDefaults(att, 155);
+    CHECK(att->getIntField(5, "seven") == 3);
+    io->setAttributeTable(att, 1);
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    
+    att = io->getAttributeTable(kealib::kea_att_file, 1);
+    att->addRows(10);
+    checkDefaults(att, 165);
+    CHECK(att->getIntField(5, "seven") == 3);
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    io->close();
+    delete io;
+}
+
+static void testDictionaryEncoding()
+{
+    const char *classes[3] = {"water", "forest", "urban"};
+    kealib::KEAImageIO *io = createTestImage("testatt_dict.kea");
+    kealib::KEAAttributeTable *att = io->getAttributeTable(kealib::kea_att_file, 1);
+    kealib::KEAAttributeTableFile *fileAtt = static_cast<kealib::KEAAttributeTableFile*>(att);
+    att->addRows(100);
+    att->addAttStringField("class", "");
+    size_t colIdx = att->getFieldIndex("class");
+    std::vector<std::string> vals(90);
+    for(size_t i = 0; i < vals.size(); ++i)
+    {
+        vals[i] = classes[i % 3];
+    }
+    att->setStringFields(0, vals.size(), colIdx, &vals);
+    
+    // THE VALUES READ BACK THE SAME ONCE THEY ARE HELD AS CODES
+    fileAtt->dictionaryEncodeStringField(colIdx);
+    CHECK(fileAtt->isStringFieldDictionaryEncoded(colIdx));
+    std::vector<std::string> encoded;
+    att->getStringFields(0, 100, colIdx, &encoded);
+    CHECK(std::equal(vals.begin(), vals.end(), encoded.begin()));
+    CHECK(encoded[95] == "");
+    std::vector<std::string> dictionary;
+    fileAtt->getStringFieldDictionary(colIdx, &dictionary);
+    CHECK(dictionary.size() <= 4);
+    std::vector<int32_t> codes(6);
+    fileAtt->getStringFieldCodes(0, 6, colIdx, &codes[0]);
+    CHECK((codes[0] == codes[3]) && (codes[1] == codes[4]) && (codes[2] == codes[5]));
+    CHECK((codes[0] != codes[1]) && (codes[1] != codes[2]) && (codes[0] != codes[2]));
+    CHECK(dictionary[codes[1]] == "forest");
+    
+    // A NEW VALUE IS ADDED TO THE DICTIONARY AND NEW ROWS TAKE THE DEFAULT
+    att->setStringField(95, colIdx, "ice");
+    std::vector<std::string> grown;
+    fileAtt->getStringFieldDictionary(colIdx, &grown);
+    CHECK(grown.size() == (dictionary.size() + 1));
+    att->addRows(10);
+    CHECK(att->getStringField(95, colIdx) == "ice");
+    CHECK(att->getStringField(105, colIdx) == "");
+    CHECK(att->getStringField(4, colIdx) == "forest");
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    io->close();
+    delete io;
+    
+    // THE ENCODING IS KEPT IN THE FILE AND DECODED BY THE IN MEMORY TABLE,
+    // WHICH WRITES THE COLUMN BACK PLAIN
+    io = openTestImage("testatt_dict.kea");
+    att = io->getAttributeTable(kealib::kea_att_file, 1);
+    fileAtt = static_cast<kealib::KEAAttributeTableFile*>(att);
+    CHECK(fileAtt->isStringFieldDictionaryEncoded(colIdx));
+    CHECK(att->getStringField(95, colIdx) == "ice");
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    kealib::KEAAttributeTable *memAtt = io->getAttributeTable(kealib::kea_att_mem, 1);
+    CHECK(memAtt->getStringField(2, colIdx) == "urban");
+    CHECK(memAtt->getStringField(95, colIdx) == "ice");
+    CHECK(memAtt->getStringField(105, colIdx) == "");
+    io->setAttributeTable(memAtt, 1);
+    kealib::KEAAttributeTable::destroyAttributeTable(memAtt);
+    att = io->getAttributeTable(kealib::kea_att_file, 1);
+    fileAtt = static_cast<kealib::KEAAttributeTableFile*>(att);
+    CHECK(!fileAtt->isStringFieldDictionaryEncoded(colIdx));
+    CHECK(att->getStringField(2, colIdx) == "urban");
+    CHECK(att->getStringField(95, colIdx) == "ice");
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    io->close();
+    delete io;
+}
+
+#define SELECT_ROWS 60
+#define SELECT_START 5
+#define SELECT_LEN 40
+
+static void testColumnSelection()
+{
+    // A WRITTEN AND A LAZY COLUMN OF EACH TYPE AND A DICTIONARY ENCODED ONE
+    const char *classes[3] = {"water", "forest", "urban"};
+    kealib::KEAImageIO *io = createTestImage("testatt_select.kea");
+    kealib::KEAAttributeTable *att = io->getAttributeTable(kealib::kea_att_file, 1);
+    att->addRows(SELECT_ROWS);
+    att->addAttBoolField("flag", false);
+    att->addAttBoolField("lazyflag", true);
+    att->addAttIntField("id", 0);
+    att->addAttIntField("seven", 7);
+    att->addAttIntField("square", 0);
+    att->addAttFloatField("area", 0);
+    att->addAttFloatField("half", 2.5);
+    att->addAttStringField("name", "");
+    att->addAttStringField("label", "none");
+    att->addAttStringField("class", "");
+    std::vector<std::string> names(SELECT_ROWS);
+    std::vector<std::string> classVals(SELECT_ROWS);
+    for(size_t i = 0; i < SELECT_ROWS; ++i)
+    {
+        att->setBoolField(i, "flag", (i % 3) == 0);
+        att->setIntField(i, "id", (int64_t) i);
+        att->setIntField(i, "square", (int64_t) (i * i));
+        att->setFloatField(i, "area", i * 0.5);
+        names[i] = "row" + std::to_string(i);
+        classVals[i] = classes[i % 3];
+    }
+    att->setStringFields(0, SELECT_ROWS, att->getFieldIndex("name"), &names);
+    att->setStringFields(0, SELECT_ROWS, att->getFieldIndex("class"), &classVals);
+    static_cast<kealib::KEAAttributeTableFile*>(att)->dictionaryEncodeStringField(att->getFieldIndex("class"));
+    
+    // UNSORTED, WITH REPEATS, READ AS SEPARATE COLUMNS AND AS A ROW MAJOR BLOCK
+    std::vector<size_t> boolCols;
+    boolCols.push_back(att->getFieldIndex("lazyflag"));
+    boolCols.push_back(att->getFieldIndex("flag"));
+    boolCols.push_back(att->getFieldIndex("lazyflag"));
+    std::vector<bool*> boolBuffers;
+    bool *boolBlockPtr = new bool[SELECT_LEN * boolCols.size()];
+    for(size_t c = 0; c < boolCols.size(); ++c)
+    {
+        boolBuffers.push_back(new bool[SELECT_LEN]);
+    }
+    att->getBoolColumns(SELECT_START, SELECT_LEN, boolCols, &boolBuffers[0]);
+    att->getBoolBlock(SELECT_START, SELECT_LEN, boolCols, boolBlockPtr);
+    bool boolMatches = true;
+    bool *boolVals = new bool[SELECT_LEN];
+    for(size_t c = 0; c < boolCols.size(); ++c)
+    {
+        att->getBoolFields(SELECT_START, SELECT_LEN, boolCols[c], boolVals);
+        for(size_t n = 0; n < SELECT_LEN; ++n)
+        {
+            boolMatches = boolMatches && (boolBuffers[c][n] == boolVals[n]) && (boolBlockPtr[(n * boolCols.size()) + c] == boolVals[n]);
+        }
+        delete[] boolBuffers[c];
+    }
+    CHECK(boolMatches);
+    CHECK(boolBlockPtr[0] && !boolBlockPtr[1] && boolBlockPtr[4]);
+    delete[] boolVals;
+    delete[] boolBlockPtr;
+    
+    std::vector<size_t> intCols;
+    intCols.push_back(att->getFieldIndex("square"));
+    intCols.push_back(att->getFieldIndex("id"));
+    intCols.push_back(att->getFieldIndex("seven"));
+    intCols.push_back(att->getFieldIndex("square"));
+    std::vector<std::vector<int64_t> > intBuffers(intCols.size(), std::vector<int64_t>(SELECT_LEN));
+    std::vector<int64_t*> intPtrs;
+    for(size_t c = 0; c < intCols.size(); ++c)
+    {
+        intPtrs.push_back(&intBuffers[c][0]);
+    }
+    std::vector<int64_t> intBlock(SELECT_LEN * intCols.size());
+    att->getIntColumns(SELECT_START, SELECT_LEN, intCols, &intPtrs[0]);
+    att->getIntBlock(SELECT_START, SELECT_LEN, intCols, &intBlock[0]);
+    bool intMatches = true;
+    std::vector<int64_t> intVals(SELECT_LEN);
+    for(size_t c = 0; c < intCols.size(); ++c)
+    {
+        att->getIntFields(SELECT_START, SELECT_LEN, intCols[c], &intVals[0]);
+        for(size_t n = 0; n < SELECT_LEN; ++n)
+        {
+            intMatches = intMatches && (intBuffers[c][n] == intVals[n]) && (intBlock[(n * intCols.size()) + c] == intVals[n]);
+        }
+    }
+    CHECK(intMatches);
+    CHECK((intBlock[0] == 25) && (intBlock[1] == 5) && (intBlock[2] == 7) && (intBlock[3] == 25));
+    
+    std::vector<size_t> floatCols;
+    floatCols.push_back(att->getFieldIndex("half"));
+    floatCols.push_back(att->getFieldIndex("area"));
+    floatCols.push_back(att->getFieldIndex("half"));
+    std::vector<std::vector<double> > floatBuffers(floatCols.size(), std::vector<double>(SELECT_LEN));
+    std::vector<double*> floatPtrs;
+    for(size_t c = 0; c < floatCols.size(); ++c)
+    {
+        floatPtrs.push_back(&floatBuffers[c][0]);
+    }
+    std::vector<double> floatBlock(SELECT_LEN * floatCols.size());
+    att->getFloatColumns(SELECT_START, SELECT_LEN, floatCols, &floatPtrs[0]);
+    att->getFloatBlock(SELECT_START, SELECT_LEN, floatCols, &floatBlock[0]);
+    bool floatMatches = true;
+    std::vector<double> floatVals(SELECT_LEN);
+    for(size_t c = 0; c < floatCols.size(); ++c)
+    {
+        att->getFloatFields(SELECT_START, SELECT_LEN, floatCols[c], &floatVals[0]);
+        for(size_t n = 0; n < SELECT_LEN; ++n)
+        {
+            floatMatches = floatMatches && (floatBuffers[c][n] == floatVals[n]) && (floatBlock[(n * floatCols.size()) + c] == floatVals[n]);
+        }
+    }
+    CHECK(floatMatches);
+    CHECK((floatBlock[0] == 2.5) && (floatBlock[1] == 2.5));
+    
+    std::vector<size_t> strCols;
+    strCols.push_back(att->getFieldIndex("class"));
+    strCols.push_back(att->getFieldIndex("label"));
+    strCols.push_back(att->getFieldIndex("name"));
+    strCols.push_back(att->getFieldIndex("class"));
+    std::vector<std::vector<std::string> > strBuffers(strCols.size());
+    std::vector<std::vector<std::string>*> strPtrs;
+    for(size_t c = 0; c < strCols.size(); ++c)
+    {
+        strPtrs.push_back(&strBuffers[c]);
+    }
+    std::vector<std::string> strBlock;
+    att->getStringColumns(SELECT_START, SELECT_LEN, strCols, &strPtrs[0]);
+    att->getStringBlock(SELECT_START, SELECT_LEN, strCols, &strBlock);
+    bool strMatches = (strBlock.size() == (SELECT_LEN * strCols.size()));
+    std::vector<std::string> strVals;
+    for(size_t c = 0; strMatches && (c < strCols.size()); ++c)
+    {
+        att->getStringFields(SELECT_START, SELECT_LEN, strCols[c], &strVals);
+        strMatches = (strBuffers[c] == strVals);
+        for(size_t n = 0; n < SELECT_LEN; ++n)
+        {
+            strMatches = strMatches && (strBlock[(n * strCols.size()) + c] == strVals[n]);
+        }
+    }
+    CHECK(strMatches);
+    CHECK((strBlock[0] == "urban") && (strBlock[1] == "none") && (strBlock[2] == "row5") && (strBlock[3] == "urban"));
+    
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    io->close();
+    delete io;
+}
+
+// THE SLOTS OF THE ARROW ARRAYS BUILT BY THE TEST ARE ON THE STACK
+static void keaTestReleaseArray(ArrowArray *array)
+{
+    array->release = NULL;
+}
+
+static void keaTestReleaseSchema(ArrowSchema *schema)
+{
+    schema->release = NULL;
+}
+
+static void testArrowRoundTrip()
+{
+    kealib::KEAImageIO *io = createTestImage("testatt_arrow.kea");
+    kealib::KEAAttributeTable *att = io->getAttributeTable(kealib::kea_att_file, 1);
+    att->addRows(50);
+    att->addAttBoolField("flag", false);
+    att->addAttIntField("count", 0);
+    att->addAttFloatField("area", 0);
+    att->addAttStringField("name", "");
+    for(size_t i = 0; i < 50; ++i)
+    {
+        att->setBoolField(i, "flag", (i % 3) == 0);
+        att->setIntField(i, "count", (int64_t)i * 1000000000);
+        att->setFloatField(i, "area", i + 0.25);
+        att->setStringField(i, "name", std::string(i % 5, 'n') + std::to_string(i));
+    }
+
+    std::vector<std::string> columns;
+    columns.push_back("name");
+    columns.push_back("count");
+    columns.push_back("flag");
+    columns.push_back("area");
+    ArrowArray array;
+    ArrowSchema schema;
+    att->exportColumnsArrow(10, 20, columns, &array, &schema);
+    CHECK(std::string(schema.format) == "+s");
+    CHECK((array.length == 20) && (array.n_children == 4) && (schema.n_children == 4));
+    CHECK(std::string(schema.children[0]->format) == "U");
+    CHECK(std::string(schema.children[1]->format) == "l");
+    CHECK(std::string(schema.children[2]->format) == "b");
+    CHECK(std::string(schema.children[3]->format) == "g");
+    CHECK(std::string(schema.children[1]->name) == "count");
+    const int64_t *counts = (const int64_t*) array.children[1]->buffers[1];
+    CHECK(counts[5] == 15000000000LL);
+    const uint8_t *flags = (const uint8_t*) array.children[2]->buffers[1];
+    CHECK(((flags[0] >> 2) & 1) == 1);
+    CHECK(((flags[0] >> 3) & 1) == 0);
+    const int64_t *offsets = (const int64_t*) array.children[0]->buffers[1];
+    const char *strData = (const char*) array.children[0]->buffers[2];
+    CHECK(std::string(strData + offsets[3], offsets[4] - offsets[3]) == "nnn13");
+
+    // IMPORTING INTO A NEW TABLE CREATES THE COLUMNS AND COPIES THE VALUES
+    kealib::KEAAttributeTable *memAtt = new kealib::KEAAttributeTableInMem();
+    memAtt->addRows(25);
+    memAtt->importColumnsArrow(5, &array, &schema);
+    CHECK(memAtt->getIntField(5, "count") == 10000000000LL);
+    CHECK(memAtt->getIntField(24, "count") == 29000000000LL);
+    CHECK(memAtt->getBoolField(7, "flag") == true);
+    CHECK(memAtt->getBoolField(8, "flag") == false);
+    CHECK(memAtt->getFloatField(20, "area") == 25.25);
+    CHECK(memAtt->getStringField(9, "name") == "nnnn14");
+    CHECK(memAtt->getStringField(4, "name") == "");
+    array.release(&array);
+    schema.release(&schema);
+    CHECK((array.release == NULL) && (schema.release == NULL));
+    kealib::KEAAttributeTable::destroyAttributeTable(memAtt);
+
+    // A SINGLE SLICED INT32 COLUMN WITH NULLS WRITES ZERO FOR THE NULLS
+    int32_t vals[6] = {-1, 11, 12, 13, 14, 15};
+    uint8_t validity = 0x3B;  // SLOT 2 (VALUE 12) IS NULL
+    const void *buffers[2] = {&validity, vals};
+    ArrowArray colArray;
+    memset(&colArray, 0, sizeof(colArray));
+    colArray.length = 5;
+    colArray.null_count = 1;
+    colArray.offset = 1;
+    colArray.n_buffers = 2;
+    colArray.buffers = buffers;
+    colArray.release = keaTestReleaseArray;
+    ArrowSchema colSchema;
+    memset(&colSchema, 0, sizeof(colSchema));
+    colSchema.format = "i";
+    colSchema.name = "count";
+    colSchema.release = keaTestReleaseSchema;
+    att->importColumnsArrow(40, &colArray, &colSchema);
+    CHECK(att->getIntField(40, "count") == 11);
+    CHECK(att->getIntField(41, "count") == 0);
+    CHECK(att->getIntField(44, "count") == 15);
+    CHECK(att->getIntField(45, "count") == 45000000000LL);
+
+    colSchema.format = "U";
+    bool thrown = false;
+    try
+    {
+        att->importColumnsArrow(40, &colArray, &colSchema);
+    }
+    catch(kealib::KEAATTException &e)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    io->close();
+    delete io;
+}
+
+#define PRED_ROWS 300
+
+static void fillPredicateTable(kealib::KEAAttributeTable *att)
+{
+    att->addRows(PRED_ROWS);
+    att->addAttIntField("value", 0);
+    att->addAttFloatField("score", 0);
+    att->addAttBoolField("keep", false);
+    att->addAttStringField("name", "");
+    for(size_t i = 0; i < PRED_ROWS; ++i)
+    {
+        att->setIntField(i, "value", (int64_t)(i % 17));
+        att->setFloatField(i, "score", ((i % 50) == 0)? NAN : i * 0.5);
+        att->setBoolField(i, "keep", (i % 2) == 0);
+    }
+}
+
+static void checkPredicates(const kealib::KEAAttributeTable *att)
+{
+    // (value >= 5) AND (value < 10) AND (score != 20) AND (keep == 1)
+    std::vector<kealib::KEAATTPredicate> predicates(4);
+    predicates[0].name = "value";
+    predicates[0].op = kealib::kea_att_ge;
+    predicates[0].value = 5;
+    predicates[1].name = "value";
+    predicates[1].op = kealib::kea_att_lt;
+    predicates[1].value = 10;
+    predicates[2].name = "score";
+    predicates[2].op = kealib::kea_att_ne;
+    predicates[2].value = 20;
+    predicates[3].name = "keep";
+    predicates[3].op = kealib::kea_att_eq;
+    predicates[3].value = 1;
+    std::vector<bool> expected(PRED_ROWS, false);
+    std::vector<size_t> expectedIds;
+    for(size_t i = 0; i < PRED_ROWS; ++i)
+    {
+        size_t value = i % 17;
+        if((value >= 5) && (value < 10) && (i != 40) && ((i % 2) == 0))
+        {
+            expected[i] = true;
+            expectedIds.push_back(i);
+        }
+    }
+    std::vector<bool> selection;
+    att->selectRows(predicates, &selection);
+    CHECK(selection == expected);
+    std::vector<size_t> fids;
+    att->selectRowIds(predicates, &fids);
+    CHECK(fids == expectedIds);
+    
+    // A NaN ONLY MATCHES !=
+    std::vector<kealib::KEAATTPredicate> nanPredicates(1);
+    nanPredicates[0].name = "score";
+    nanPredicates[0].op = kealib::kea_att_lt;
+    nanPredicates[0].value = 1e9;
+    att->selectRowIds(nanPredicates, &fids);
+    CHECK(fids.size() == (PRED_ROWS - (PRED_ROWS / 50)));
+    CHECK(std::find(fids.begin(), fids.end(), (size_t)100) == fids.end());
+    
+    nanPredicates[0].name = "name";
+    bool thrown = false;
+    try
+    {
+        att->selectRowIds(nanPredicates, &fids);
+    }
+    catch(kealib::KEAATTException &e)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+static void testPredicates()
+{
+    // A SMALL CHUNK SIZE SO THE FILE TABLE IS SCANNED IN SEVERAL BLOCKS
+    kealib::KEAImageIO *io = createTestImage("testatt_pred.kea");
+    kealib::KEAAttributeTable *att = new kealib::KEAAttributeTableInMem();
+    fillPredicateTable(att);
+    checkPredicates(att);
+    io->setAttributeTable(att, 1, 16);
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    att = io->getAttributeTable(kealib::kea_att_file, 1);
+    checkPredicates(att);
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    io->close();
+    delete io;
+}
+
+#define ZONE_ROWS 500
+#define ZONE_CHUNK 100
+
+static void testZoneMaps()
+{
+    kealib::KEAImageIO *io = createTestImage("testatt_zones.kea");
+    kealib::KEAAttributeTable *att = new kealib::KEAAttributeTableInMem();
+    att->addRows(ZONE_ROWS);
+    att->addAttIntField("height", 0);
+    att->addAttFloatField("slope", 0);
+    size_t intIdx = att->getFieldIndex("height");
+    size_t floatIdx = att->getFieldIndex("slope");
+    std::vector<int64_t> heights(ZONE_ROWS);
+    std::vector<double> slopes(ZONE_ROWS);
+    for(size_t i = 0; i < ZONE_ROWS; ++i)
+    {
+        heights[i] = (int64_t)i;
+        slopes[i] = (i == 250)? NAN : (double)i / 10;
+    }
+    att->setIntFields(0, ZONE_ROWS, intIdx, &heights[0]);
+    att->setFloatFields(0, ZONE_ROWS, floatIdx, &slopes[0]);
+    io->setAttributeTable(att, 1, ZONE_CHUNK);
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    att = io->getAttributeTable(kealib::kea_att_file, 1);
+    kealib::KEAAttributeTableFile *fileAtt = static_cast<kealib::KEAAttributeTableFile*>(att);
+    
+    // ONE {MIN, MAX} PER CHUNK, THE NaN IS COUNTED NOT USED
+    fileAtt->buildZoneMap("height");
+    fileAtt->buildZoneMap("slope");
+    CHECK(fileAtt->hasZoneMap("height") && fileAtt->hasZoneMap("slope"));
+    std::vector<int64_t> mins, maxs;
+    fileAtt->getIntZoneMap(intIdx, &mins, &maxs);
+    CHECK((mins.size() == (ZONE_ROWS / ZONE_CHUNK)) && (maxs.size() == mins.size()));
+    CHECK((mins[2] == 200) && (maxs[2] == 299));
+    std::vector<double> floatMins, floatMaxs;
+    std::vector<uint64_t> nanCounts;
+    fileAtt->getFloatZoneMap(floatIdx, &floatMins, &floatMaxs, &nanCounts);
+    CHECK((floatMins[2] == 20) && (floatMaxs[2] == 29.9));
+    CHECK((nanCounts[2] == 1) && (nanCounts[3] == 0));
+    
+    // A WRITE OUTSIDE A CHUNK'S RANGE WIDENS IT SO THE ROW IS STILL FOUND
+    std::vector<kealib::KEAATTPredicate> predicates(1);
+    predicates[0].name = "height";
+    predicates[0].op = kealib::kea_att_ge;
+    predicates[0].value = 1000;
+    std::vector<size_t> fids;
+    att->selectRowIds(predicates, &fids);
+    CHECK(fids.empty());
+    att->setIntField(42, "height", 5000);
+    fileAtt->getIntZoneMap(intIdx, &mins, &maxs);
+    CHECK((mins[0] == 0) && (maxs[0] == 5000));
+    att->selectRowIds(predicates, &fids);
+    CHECK((fids.size() == 1) && (fids[0] == 42));
+    predicates[0].name = "slope";
+    predicates[0].op = kealib::kea_att_ne;
+    predicates[0].value = 0;
+    att->selectRowIds(predicates, &fids);
+    CHECK((fids.size() == (ZONE_ROWS - 1)) && (fids[0] == 1));
+    
+    // ROWS ADDED AFTER THE BUILD ARE COVERED BY NEW CHUNKS
+    att->addRows(ZONE_CHUNK);
+    att->setIntField(ZONE_ROWS + 10, "height", -7);
+    predicates[0].name = "height";
+    predicates[0].op = kealib::kea_att_lt;
+    predicates[0].value = 0;
+    att->selectRowIds(predicates, &fids);
+    CHECK((fids.size() == 1) && (fids[0] == (ZONE_ROWS + 10)));
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    io->close();
+    delete io;
+    
+    // THE ZONE MAPS ARE SAVED WITH THE TABLE
+    io = openTestImage("testatt_zones.kea");
+    att = io->getAttributeTable(kealib::kea_att_file, 1);
+    fileAtt = static_cast<kealib::KEAAttributeTableFile*>(att);
+    CHECK(fileAtt->hasZoneMap("height"));
+    fileAtt->getIntZoneMap(intIdx, &mins, &maxs);
+    CHECK((mins.size() == ((ZONE_ROWS / ZONE_CHUNK) + 1)) && (maxs[0] == 5000) && (mins[5] == -7));
+    att->selectRowIds(predicates, &fids);
+    CHECK((fids.size() == 1) && (fids[0] == (ZONE_ROWS + 10)));
+    fileAtt->dropZoneMap("height");
+    CHECK(!fileAtt->hasZoneMap("height"));
+    att->selectRowIds(predicates, &fids);
+    CHECK(fids.size() == 1);
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    io->close();
+    delete io;
+}
+
+// CHECKS THE INDEXED LOOKUPS AGAINST A SCAN OF THE VALUES
+static void checkIntLookup(const kealib::KEAAttributeTable *att, const std::string &name, int64_t lower, int64_t upper)
+{
+    std::vector<size_t> expected;
+    for(size_t i = 0; i < att->getSize(); ++i)
+    {
+        int64_t value = att->getIntField(i, name);
+        if((value >= lower) && (value <= upper))
+        {
+            expected.push_back(i);
+        }
+    }
+    std::vector<size_t> fids;
+    att->findIntRowsInRange(name, lower, upper, &fids);
+    std::sort(fids.begin(), fids.end());
+    CHECK(fids == expected);
+    if(lower == upper)
+    {
+        att->findIntRows(name, lower, &fids);
+        std::sort(fids.begin(), fids.end());
+        CHECK(fids == expected);
+    }
+}
+
+static void checkStringLookup(const kealib::KEAAttributeTable *att, const std::string &name, const std::string &value)
+{
+    std::vector<size_t> expected;
+    for(size_t i = 0; i < att->getSize(); ++i)
+    {
+        if(att->getStringField(i, name) == value)
+        {
+            expected.push_back(i);
+        }
+    }
+    std::vector<size_t> fids;
+    att->findStringRows(name, value, &fids);
+    std::sort(fids.begin(), fids.end());
+    CHECK(fids == expected);
+}
+
+#define INDEX_ROWS 200
+
+static void testIndexes()
+{
+    kealib::KEAImageIO *io = createTestImage("testatt_index.kea");
+    kealib::KEAAttributeTable *att = io->getAttributeTable(kealib::kea_att_file, 1);
+    att->addRows(INDEX_ROWS);
+    att->addAttIntField("zone", 0);
+    att->addAttIntField("height", 0);
+    att->addAttFloatField("depth", 0);
+    att->addAttStringField("owner", "");
+    for(size_t i = 0; i < INDEX_ROWS; ++i)
+    {
+        att->setIntField(i, "zone", (int64_t)(i % 10));
+        att->setIntField(i, "height", (int64_t)(INDEX_ROWS - i));
+        att->setFloatField(i, "depth", i * 0.5);
+        att->setStringField(i, "owner", "o" + std::to_string(i % 7));
+    }
+    att->createIndex("zone", kealib::kea_att_index_hash);
+    att->createIndex("height", kealib::kea_att_index_sorted);
+    att->createIndex("depth", kealib::kea_att_index_sorted);
+    att->createIndex("owner", kealib::kea_att_index_hash);
+    CHECK(att->hasIndex("zone") && att->hasIndex("height") && att->hasIndex("owner"));
+    checkIntLookup(att, "zone", 3, 3);
+    checkIntLookup(att, "zone", 2, 4);
+    checkIntLookup(att, "height", 150, 150);
+    checkIntLookup(att, "height", 20, 61);
+    checkStringLookup(att, "owner", "o3");
+    std::vector<size_t> fids;
+    att->findFloatRows("depth", 10.0, &fids);
+    CHECK((fids.size() == 1) && (fids[0] == 20));
+    att->findFloatRowsInRange("depth", 10.0, 12.0, &fids);
+    CHECK((fids.size() == 5) && (fids[0] == 20) && (fids[4] == 24));
+    
+    // WRITES AND NEW ROWS ARE SEEN BY THE NEXT LOOKUP, WHICH SCANS UNTIL THE INDEX IS REBUILT
+    CHECK(!att->isIndexStale("zone") && !att->isIndexStale("height"));
+    att->setIntField(5, "zone", 3);
+    att->setIntField(6, "height", 150);
+    att->setStringField(8, "owner", "o3");
+    att->setFloatField(21, "depth", 10.0);
+    checkIntLookup(att, "zone", 3, 3);
+    checkIntLookup(att, "height", 150, 150);
+    checkStringLookup(att, "owner", "o3");
+    att->findFloatRows("depth", 10.0, &fids);
+    CHECK((fids.size() == 2) && (fids[1] == 21));
+    CHECK(att->isIndexStale("zone") && att->isIndexStale("height") && att->isIndexStale("depth"));
+    att->rebuildIndex("height");
+    att->rebuildIndex("depth");
+    CHECK(!att->isIndexStale("height") && !att->isIndexStale("depth"));
+    checkIntLookup(att, "height", 150, 150);
+    att->findFloatRows("depth", 10.0, &fids);
+    CHECK((fids.size() == 2) && (fids[1] == 21));
+    std::vector<int64_t> zones(INDEX_ROWS / 2, 9);
+    att->setIntFields(0, zones.size(), att->getFieldIndex("zone"), &zones[0]);
+    att->addRows(10);
+    checkIntLookup(att, "zone", 9, 9);
+    checkIntLookup(att, "zone", 0, 0);
+    checkStringLookup(att, "owner", "");
+    CHECK(att->isIndexStale("zone") && att->isIndexStale("height"));
+    att->rebuildIndex("zone");
+    CHECK(!att->isIndexStale("zone"));
+    checkIntLookup(att, "zone", 9, 9);
+    checkIntLookup(att, "zone", 0, 0);
+    bool thrown = false;
+    try
+    {
+        att->rebuildIndex("area");
+    }
+    catch(kealib::KEAATTException &e)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    io->close();
+    delete io;
+    
+    // THE INDEXES ARE SAVED WITH THE TABLE, STALE OR NOT
+    io = openTestImage("testatt_index.kea");
+    att = io->getAttributeTable(kealib::kea_att_file, 1);
+    CHECK(att->hasIndex("zone") && att->hasIndex("height") && att->hasIndex("owner"));
+    CHECK(!att->isIndexStale("zone") && att->isIndexStale("height") && att->isIndexStale("owner"));
+    checkIntLookup(att, "zone", 9, 9);
+    checkIntLookup(att, "height", 150, 150);
+    CHECK(att->isIndexStale("height"));
+    checkStringLookup(att, "owner", "o3");
+    att->setIntField(INDEX_ROWS + 5, "height", 150);
+    checkIntLookup(att, "height", 150, 150);
+    att->dropIndex("height");
+    CHECK(!att->hasIndex("height"));
+    checkIntLookup(att, "height", 150, 150);
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    
+    // AND THE SAME FOR THE IN MEMORY TABLE
+    att = io->getAttributeTable(kealib::kea_att_mem, 1);
+    att->createIndex("height", kealib::kea_att_index_sorted);
+    checkIntLookup(att, "height", 100, 160);
+    att->setIntField(0, "height", 120);
+    att->addRows(5);
+    checkIntLookup(att, "height", 100, 160);
+    checkIntLookup(att, "height", 0, 0);
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    io->close();
+    delete io;
+}
+
+#define AGG_ROWS 1000
+#define AGG_CLASSES 4
+
+static void checkAggregate(const kealib::KEAAttributeTable *att)
+{
+    std::vector<kealib::KEAATTAggregate> aggregates(7);
+    aggregates[0].name = "";
+    aggregates[0].op = kealib::kea_att_agg_count;
+    aggregates[1].name = "area";
+    aggregates[1].op = kealib::kea_att_agg_sum;
+    aggregates[2].name = "area";
+    aggregates[2].op = kealib::kea_att_agg_min;
+    aggregates[3].name = "area";
+    aggregates[3].op = kealib::kea_att_agg_max;
+    aggregates[4].name = "length";
+    aggregates[4].op = kealib::kea_att_agg_count;
+    aggregates[5].name = "length";
+    aggregates[5].op = kealib::kea_att_agg_mean;
+    aggregates[6].name = "length";
+    aggregates[6].op = kealib::kea_att_agg_stddev;
+    
+    // THE EXPECTED VALUES FROM A SINGLE PASS OVER THE ROWS
+    std::vector<int64_t> rows(AGG_CLASSES, 0), sums(AGG_CLASSES, 0), lengthCounts(AGG_CLASSES, 0);
+    std::vector<int64_t> mins(AGG_CLASSES, AGG_ROWS), maxs(AGG_CLASSES, -1);
+    std::vector<double> lengthSums(AGG_CLASSES, 0), lengthSqSums(AGG_CLASSES, 0);
+    for(size_t i = 0; i < AGG_ROWS; ++i)
+    {
+        size_t c = i % AGG_CLASSES;
+        ++rows[c];
+        sums[c] += (int64_t)i;
+        mins[c] = std::min(mins[c], (int64_t)i);
+        maxs[c] = std::max(maxs[c], (int64_t)i);
+        if((i % 100) != 7)
+        {
+            ++lengthCounts[c];
+            lengthSums[c] += i * 0.5;
+            lengthSqSums[c] += (i * 0.5) * (i * 0.5);
+        }
+    }
+    
+    kealib::KEAAttributeTable *out = att->aggregate("class", aggregates);
+    CHECK(out->getSize() == AGG_CLASSES);
+    for(size_t c = 0; c < AGG_CLASSES; ++c)
+    {
+        double mean = lengthSums[c] / lengthCounts[c];
+        double stddev = sqrt((lengthSqSums[c] - (lengthCounts[c] * mean * mean)) / (lengthCounts[c] - 1));
+        CHECK(out->getIntField(c, "class") == (int64_t)c);
+        CHECK(out->getIntField(c, "count") == rows[c]);
+        CHECK(out->getIntField(c, "area_sum") == sums[c]);
+        CHECK(out->getIntField(c, "area_min") == mins[c]);
+        CHECK(out->getIntField(c, "area_max") == maxs[c]);
+        CHECK(out->getIntField(c, "length_count") == lengthCounts[c]);
+        CHECK(fabs(out->getFloatField(c, "length_mean") - mean) < 1e-9);
+        CHECK(fabs(out->getFloatField(c, "length_stddev") - stddev) < 1e-6);
+    }
+    kealib::KEAAttributeTable::destroyAttributeTable(out);
+    
+    // STRING AND BOOL GROUPS COME OUT IN ORDER
+    aggregates.resize(2);
+    out = att->aggregate("name", aggregates);
+    CHECK(out->getSize() == AGG_CLASSES);
+    CHECK(out->getStringField(0, "name") == "c0");
+    CHECK(out->getStringField(3, "name") == "c3");
+    CHECK(out->getIntField(2, "area_sum") == sums[2]);
+    kealib::KEAAttributeTable::destroyAttributeTable(out);
+    out = att->aggregate("even", aggregates);
+    CHECK(out->getSize() == 2);
+    CHECK((out->getBoolField(0, "even") == false) && (out->getBoolField(1, "even") == true));
+    CHECK(out->getIntField(1, "area_sum") == (sums[0] + sums[2]));
+    CHECK(out->getIntField(0, "count") == (rows[1] + rows[3]));
+    kealib::KEAAttributeTable::destroyAttributeTable(out);
+    
+    bool thrown = false;
+    try
+    {
+        out = att->aggregate("length", aggregates);
+    }
+    catch(kealib::KEAATTException &e)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+static void testAggregate()
+{
+    kealib::KEAImageIO *io = createTestImage("testatt_agg.kea");
+    kealib::KEAAttributeTable *att = new kealib::KEAAttributeTableInMem();
+    att->addRows(AGG_ROWS);
+    att->addAttIntField("class", 0);
+    att->addAttStringField("name", "");
+    att->addAttBoolField("even", false);
+    att->addAttIntField("area", 0);
+    att->addAttFloatField("length", 0);
+    for(size_t i = 0; i < AGG_ROWS; ++i)
+    {
+        att->setIntField(i, "class", (int64_t)(i % AGG_CLASSES));
+        att->setStringField(i, "name", "c" + std::to_string(i % AGG_CLASSES));
+        att->setBoolField(i, "even", (i % 2) == 0);
+        att->setIntField(i, "area", (int64_t)i);
+        att->setFloatField(i, "length", ((i % 100) == 7)? NAN : i * 0.5);
+    }
+    checkAggregate(att);
+    
+    // A FLOAT SUM KEEPS WHAT IS LOST ADDING SMALL VALUES TO LARGE ONES
+    kealib::KEAAttributeTable *sumAtt = new kealib::KEAAttributeTableInMem();
+    sumAtt->addRows(3);
+    sumAtt->addAttIntField("class", 0);
+    sumAtt->addAttFloatField("length", 0);
+    sumAtt->setFloatField(0, "length", 1e16);
+    sumAtt->setFloatField(1, "length", 1.0);
+    sumAtt->setFloatField(2, "length", -1e16);
+    std::vector<kealib::KEAATTAggregate> sums(1);
+    sums[0].name = "length";
+    sums[0].op = kealib::kea_att_agg_sum;
+    kealib::KEAAttributeTable *sumOut = sumAtt->aggregate("class", sums);
+    CHECK((sumOut->getSize() == 1) && (sumOut->getFloatField(0, "length_sum") == 1.0));
+    kealib::KEAAttributeTable::destroyAttributeTable(sumOut);
+    kealib::KEAAttributeTable::destroyAttributeTable(sumAtt);
+    
+    // THE FILE TABLE IS STREAMED IN MANY SMALL BATCHES
+    io->setAttributeTable(att, 1, 16);
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    att = io->getAttributeTable(kealib::kea_att_file, 1);
+    checkAggregate(att);
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    io->close();
+    delete io;
+}
+
+#define GRID_SIZE 10
+#define GRID_ROWS (GRID_SIZE * GRID_SIZE)
+
+// THE 4-CONNECTED NEIGHBOURS OF A ROW OF A GRID, IN ROW ORDER
+static void getGridNeighbours(size_t fid, std::vector<size_t> *neighbours)
+{
+    size_t x = fid % GRID_SIZE;
+    size_t y = fid / GRID_SIZE;
+    neighbours->clear();
+    if(y > 0)
+    {
+        neighbours->push_back(fid - GRID_SIZE);
+    }
+    if(x > 0)
+    {
+        neighbours->push_back(fid - 1);
+    }
+    if(x < (GRID_SIZE - 1))
+    {
+        neighbours->push_back(fid + 1);
+    }
+    if(y < (GRID_SIZE - 1))
+    {
+        neighbours->push_back(fid + GRID_SIZE);
+    }
+}
+
+static void setGridNeighbours(kealib::KEAAttributeTable *att, size_t startfid, size_t len)
+{
+    std::vector<std::vector<size_t>* > neighbours;
+    for(size_t i = 0; i < len; ++i)
+    {
+        neighbours.push_back(new std::vector<size_t>());
+        getGridNeighbours(startfid + i, neighbours.back());
+    }
+    att->setNeighbours(startfid, len, &neighbours);
+    for(size_t i = 0; i < len; ++i)
+    {
+        delete neighbours[i];
+    }
+}
+
+static void setGridNeighboursCSR(kealib::KEAAttributeTable *att, size_t startfid, size_t len)
+{
+    // THE OFFSETS NEED NOT START AT 0
+    std::vector<size_t> offsets(1, 3);
+    std::vector<size_t> indices(3, 0);
+    std::vector<size_t> rowNeighbours;
+    for(size_t i = 0; i < len; ++i)
+    {
+        getGridNeighbours(startfid + i, &rowNeighbours);
+        indices.insert(indices.end(), rowNeighbours.begin(), rowNeighbours.end());
+        offsets.push_back(indices.size());
+    }
+    att->setNeighboursCSR(startfid, len, &offsets[0], &indices[0]);
+}
+
+static bool checkGridNeighbours(const kealib::KEAAttributeTable *att, size_t startfid, size_t len)
+{
+    bool match = true;
+    std::vector<size_t> offsets, indices, expected;
+    att->getNeighboursCSR(startfid, len, &offsets, &indices);
+    match = match && (offsets.size() == (len + 1)) && (offsets[0] == 0);
+    std::vector<std::vector<size_t>* > neighbours;
+    att->getNeighbours(startfid, len, &neighbours);
+    match = match && (neighbours.size() == len);
+    for(size_t i = 0; match && (i < len); ++i)
+    {
+        getGridNeighbours(startfid + i, &expected);
+        match = (std::vector<size_t>(indices.begin() + offsets[i], indices.begin() + offsets[i+1]) == expected);
+        match = match && (*neighbours[i] == expected);
+    }
+    for(size_t i = 0; i < neighbours.size(); ++i)
+    {
+        delete neighbours[i];
+    }
+    return match;
+}
+
+static void testNeighboursCSR()
+{
+    kealib::KEAImageIO *io = createTestImage("testatt_csr.kea");
+    kealib::KEAAttributeTable *att = io->getAttributeTable(kealib::kea_att_file, 1);
+    kealib::KEAAttributeTableFile *fileAtt = static_cast<kealib::KEAAttributeTableFile*>(att);
+    att->addRows(GRID_ROWS);
+    CHECK(fileAtt->getNeighboursLayout() == kealib::kea_att_neighbours_varlen);
+    setGridNeighbours(att, 0, GRID_ROWS / 2);
+    setGridNeighboursCSR(att, GRID_ROWS / 2, GRID_ROWS / 2);
+    CHECK(checkGridNeighbours(att, 0, GRID_ROWS));
+    
+    // CONVERTING KEEPS THE GRAPH, A ROW WHICH CHANGES SIZE SHIFTS THE ROWS AFTER
+    fileAtt->setNeighboursLayout(kealib::kea_att_neighbours_csr);
+    CHECK(fileAtt->getNeighboursLayout() == kealib::kea_att_neighbours_csr);
+    CHECK(checkGridNeighbours(att, 0, GRID_ROWS));
+    CHECK(checkGridNeighbours(att, 37, 11));
+    std::vector<size_t> offsets(2, 0);
+    offsets[1] = 1;
+    size_t single = 15;
+    att->setNeighboursCSR(5, 1, &offsets[0], &single);
+    std::vector<size_t> indices;
+    att->getNeighboursCSR(5, 1, &offsets, &indices);
+    CHECK((indices.size() == 1) && (indices[0] == 15));
+    CHECK(checkGridNeighbours(att, 0, 5));
+    CHECK(checkGridNeighbours(att, 6, GRID_ROWS - 6));
+    setGridNeighbours(att, 5, 1);
+    
+    // ROWS WRITTEN ONE AT A TIME WITH A NEW LENGTH ARE HELD IN MEMORY, AND
+    // READ FROM THERE, UNTIL THEY ARE MERGED IN ONE PASS
+    for(size_t fid = 20; fid < 30; ++fid)
+    {
+        std::vector<size_t> rowOffsets(2, 0);
+        rowOffsets[1] = 1;
+        att->setNeighboursCSR(fid, 1, &rowOffsets[0], &fid);
+    }
+    att->getNeighboursCSR(19, 12, &offsets, &indices);
+    CHECK(((offsets[11] - offsets[1]) == 10) && (indices[offsets[1]] == 20) && (indices[offsets[10]] == 29));
+    CHECK(checkGridNeighbours(att, 30, GRID_ROWS - 30));
+    fileAtt->flushNeighbourEdits();
+    att->getNeighboursCSR(19, 12, &offsets, &indices);
+    CHECK(((offsets[11] - offsets[1]) == 10) && (indices[offsets[1]] == 20) && (indices[offsets[10]] == 29));
+    CHECK(checkGridNeighbours(att, 0, 20) && checkGridNeighbours(att, 30, GRID_ROWS - 30));
+    // PUT BACK A ROW AT A TIME, THE DESTRUCTOR MERGES THEM
+    for(size_t fid = 20; fid < 30; ++fid)
+    {
+        setGridNeighbours(att, fid, 1);
+    }
+    CHECK(checkGridNeighbours(att, 0, GRID_ROWS));
+    att->addRows(5);
+    att->getNeighboursCSR(GRID_ROWS, 5, &offsets, &indices);
+    CHECK((offsets.size() == 6) && (offsets[5] == 0) && indices.empty());
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    io->close();
+    delete io;
+    
+    // THE LAYOUT IS KEPT IN THE FILE AND CAN BE CONVERTED BACK
+    io = openTestImage("testatt_csr.kea");
+    att = io->getAttributeTable(kealib::kea_att_file, 1);
+    fileAtt = static_cast<kealib::KEAAttributeTableFile*>(att);
+    CHECK(fileAtt->getNeighboursLayout() == kealib::kea_att_neighbours_csr);
+    CHECK(checkGridNeighbours(att, 0, GRID_ROWS));
+    fileAtt->setNeighboursLayout(kealib::kea_att_neighbours_varlen);
+    CHECK(fileAtt->getNeighboursLayout() == kealib::kea_att_neighbours_varlen);
+    CHECK(checkGridNeighbours(att, 0, GRID_ROWS));
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    io->close();
+    delete io;
+}
+
+static void testInMemNeighbours()
+{
+    kealib::KEAImageIO *io = createTestImage("testatt_memcsr.kea");
+    kealib::KEAAttributeTableInMem *memAtt = new kealib::KEAAttributeTableInMem();
+    kealib::KEAAttributeTable *att = memAtt;
+    att->addRows(GRID_ROWS);
+    setGridNeighboursCSR(att, 0, GRID_ROWS);
+    CHECK(checkGridNeighbours(att, 0, GRID_ROWS));
+    
+    // SINGLE ROW EDITS ARE SEEN BY BOTH THE ROW AND THE RANGE READS
+    size_t numNeighbours = 0;
+    const size_t *rowNeighbours = memAtt->getRowNeighbours(11, &numNeighbours);
+    CHECK((numNeighbours == 4) && (rowNeighbours[0] == 1) && (rowNeighbours[3] == 21));
+    size_t edited[2] = {2, 40};
+    memAtt->setRowNeighbours(11, edited, 2);
+    memAtt->setRowNeighbours(12, NULL, 0);
+    rowNeighbours = memAtt->getRowNeighbours(11, &numNeighbours);
+    CHECK((numNeighbours == 2) && (rowNeighbours[1] == 40));
+    std::vector<size_t> offsets, indices;
+    att->getNeighboursCSR(10, 4, &offsets, &indices);
+    CHECK((offsets[1] - offsets[0]) == 3);
+    CHECK(((offsets[2] - offsets[1]) == 2) && (indices[offsets[1]] == 2));
+    CHECK(offsets[3] == offsets[2]);
+    CHECK(checkGridNeighbours(att, 0, 11));
+    CHECK(checkGridNeighbours(att, 13, GRID_ROWS - 13));
+    setGridNeighbours(att, 11, 2);
+    CHECK(checkGridNeighbours(att, 0, GRID_ROWS));
+    att->addRows(3);
+    memAtt->getRowNeighbours(GRID_ROWS + 1, &numNeighbours);
+    CHECK(numNeighbours == 0);
+    
+    // EXPORTED IN EITHER LAYOUT AND READ BACK IN THE LAYOUT OF THE FILE
+    memAtt->setNeighboursLayout(kealib::kea_att_neighbours_csr);
+    io->setAttributeTable(att, 1);
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    att = io->getAttributeTable(kealib::kea_att_file, 1);
+    CHECK(static_cast<kealib::KEAAttributeTableFile*>(att)->getNeighboursLayout() == kealib::kea_att_neighbours_csr);
+    CHECK(checkGridNeighbours(att, 0, GRID_ROWS));
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    att = io->getAttributeTable(kealib::kea_att_mem, 1);
+    memAtt = static_cast<kealib::KEAAttributeTableInMem*>(att);
+    CHECK(memAtt->getNeighboursLayout() == kealib::kea_att_neighbours_csr);
+    CHECK(att->getSize() == (GRID_ROWS + 3));
+    CHECK(checkGridNeighbours(att, 0, GRID_ROWS));
+    memAtt->setNeighboursLayout(kealib::kea_att_neighbours_varlen);
+    io->setAttributeTable(att, 1);
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    att = io->getAttributeTable(kealib::kea_att_file, 1);
+    CHECK(static_cast<kealib::KEAAttributeTableFile*>(att)->getNeighboursLayout() == kealib::kea_att_neighbours_varlen);
+    CHECK(checkGridNeighbours(att, 0, GRID_ROWS));
+    att->getNeighboursCSR(GRID_ROWS, 3, &offsets, &indices);
+    CHECK(indices.empty());
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    io->close();
+    delete io;
+}
+
+// MERGES ADJACENT REGIONS BY THE DIFFERENCE OF THEIR MEAN VALUES
+class KEATestMeanCriterion : public kealib::KEAATTMergeCriterion
+{
+public:
+    KEATestMeanCriterion(const std::vector<double> &values): means(values), sizes(values.size(), 1)
+    {
+    }
+    double cost(size_t region1, size_t region2) const
+    {
+        return fabs(means[region1] - means[region2]);
+    }
+    void merge(size_t region1, size_t region2)
+    {
+        means[region1] = ((means[region1] * sizes[region1]) + (means[region2] * sizes[region2])) / (sizes[region1] + sizes[region2]);
+        sizes[region1] += sizes[region2];
+    }
+private:
+    std::vector<double> means;
+    std::vector<size_t> sizes;
+};
+
+static void checkGraph(const kealib::KEAAttributeTable *att)
+{
+    // LAND IN THE COLUMNS EITHER SIDE OF A TWO COLUMN CHANNEL
+    std::vector<kealib::KEAATTPredicate> predicates(1);
+    predicates[0].name = "land";
+    predicates[0].op = kealib::kea_att_eq;
+    predicates[0].value = 1;
+    std::vector<size_t> labels;
+    CHECK(att->findComponents(predicates, &labels) == 2);
+    CHECK(labels.size() == GRID_ROWS);
+    CHECK((labels[0] == 0) && (labels[93] == 0) && (labels[6] == 1) && (labels[99] == 1));
+    CHECK((labels[4] == kealib::KEA_ATT_NO_LABEL) && (labels[55] == kealib::KEA_ATT_NO_LABEL));
+    std::vector<kealib::KEAATTPredicate> noPredicates;
+    CHECK(att->findComponents(noPredicates, &labels) == 1);
+    
+    // EACH ROW IS LABELLED BY THE NEAREST SEED, THE FIRST ON A TIE
+    std::vector<size_t> seeds;
+    seeds.push_back(0);
+    seeds.push_back(GRID_ROWS - 1);
+    CHECK(att->growRegions(seeds, noPredicates, 0, &labels) == GRID_ROWS);
+    bool nearest = true;
+    for(size_t i = 0; i < GRID_ROWS; ++i)
+    {
+        size_t dist = (i % GRID_SIZE) + (i / GRID_SIZE);
+        nearest = nearest && (labels[i] == ((dist <= (GRID_SIZE - 1))? 0 : 1));
+    }
+    CHECK(nearest);
+    CHECK(att->growRegions(seeds, noPredicates, 2, &labels) == 12);
+    CHECK((labels[20] == 0) && (labels[11] == 0) && (labels[30] == kealib::KEA_ATT_NO_LABEL));
+    CHECK((labels[79] == 1) && (labels[97] == 1) && (labels[88] == 1));
+    seeds[1] = GRID_SIZE - 1;
+    CHECK(att->growRegions(seeds, predicates, 0, &labels) == 80);
+    CHECK((labels[90] == 0) && (labels[96] == 1) && (labels[45] == kealib::KEA_ATT_NO_LABEL));
+    
+    // THE TWO HALVES OF THE GRID MERGE INTO A REGION EACH
+    std::vector<double> values(GRID_ROWS);
+    for(size_t i = 0; i < GRID_ROWS; ++i)
+    {
+        values[i] = (((i % GRID_SIZE) < (GRID_SIZE / 2))? 1.0 : 5.0) + 0.01 * (i / GRID_SIZE);
+    }
+    KEATestMeanCriterion criterion(values);
+    CHECK(att->mergeRegions(&criterion, 1.0, &labels) == 2);
+    bool halves = true;
+    for(size_t i = 0; i < GRID_ROWS; ++i)
+    {
+        halves = halves && (labels[i] == (((i % GRID_SIZE) < (GRID_SIZE / 2))? 0 : 1));
+    }
+    CHECK(halves);
+    
+    // BELOW THE STEP BETWEEN ROWS ONLY THE HALF OF EACH ROW MERGES
+    KEATestMeanCriterion strict(values);
+    CHECK(att->mergeRegions(&strict, 0.005, &labels) == (2 * GRID_SIZE));
+    CHECK((labels[34] == 6) && (labels[35] == 7) && (labels[99] == 19));
+}
+
+static void testGraph()
+{
+    kealib::KEAImageIO *io = createTestImage("testatt_graph.kea");
+    kealib::KEAAttributeTable *att = new kealib::KEAAttributeTableInMem();
+    att->addRows(GRID_ROWS);
+    att->addAttIntField("land", 1);
+    for(size_t y = 0; y < GRID_SIZE; ++y)
+    {
+        att->setIntField((y * GRID_SIZE) + 4, "land", 0);
+        att->setIntField((y * GRID_SIZE) + 5, "land", 0);
+    }
+    setGridNeighbours(att, 0, GRID_ROWS);
+    
+    // A NEIGHBOUR OUTSIDE THE TABLE IS IGNORED
+    std::vector<std::vector<size_t>* > neighbours(1, new std::vector<size_t>());
+    getGridNeighbours(GRID_ROWS - 1, neighbours[0]);
+    neighbours[0]->push_back(GRID_ROWS * 10);
+    att->setNeighbours(GRID_ROWS - 1, 1, &neighbours);
+    delete neighbours[0];
+    checkGraph(att);
+    
+    // THE FILE TABLE IS STREAMED IN SMALL BATCHES
+    io->setAttributeTable(att, 1, 8);
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    att = io->getAttributeTable(kealib::kea_att_file, 1);
+    checkGraph(att);
+    static_cast<kealib::KEAAttributeTableFile*>(att)->setNeighboursLayout(kealib::kea_att_neighbours_csr);
+    checkGraph(att);
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    io->close();
+    delete io;
+}
+
+#define APPEND_CHUNK 16
+#define APPEND_START 10
+#define APPEND_ROWS 100
+
+static void testAppender()
+{
+    kealib::KEAImageIO *io = createTestImage("testatt_append.kea");
+    kealib::KEAAttributeTable *att = new kealib::KEAAttributeTableInMem();
+    att->addRows(APPEND_START);
+    att->addAttBoolField("flag", true);
+    att->addAttIntField("id", -1);
+    att->addAttFloatField("area", 0.5);
+    att->addAttStringField("name", "none");
+    io->setAttributeTable(att, 1, APPEND_CHUNK);
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    att = io->getAttributeTable(kealib::kea_att_file, 1);
+    kealib::KEAAttributeTableFile *fileAtt = static_cast<kealib::KEAAttributeTableFile*>(att);
+    size_t boolIdx = att->getFieldIndex("flag");
+    size_t intIdx = att->getFieldIndex("id");
+    size_t floatIdx = att->getFieldIndex("area");
+    size_t strIdx = att->getFieldIndex("name");
+    fileAtt->buildZoneMap("id");
+    
+    // ROWS ARE WRITTEN A WHOLE NUMBER OF CHUNKS AT A TIME, EVERY OTHER ROW
+    // IS LEFT WITH THE DEFAULTS, EACH ROW IS A NEIGHBOUR OF THE ROW BEFORE
+    kealib::KEAAttributeTableAppender *appender = new kealib::KEAAttributeTableAppender(fileAtt);
+    bool thrown = false;
+    try
+    {
+        appender->setIntField(intIdx, 1);
+    }
+    catch(kealib::KEAATTException &e)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+    bool aligned = true;
+    for(size_t i = 0; i < (APPEND_ROWS / 2); ++i)
+    {
+        size_t fid = appender->appendRow();
+        CHECK(fid == (APPEND_START + i));
+        if((i % 2) == 0)
+        {
+            appender->setBoolField(boolIdx, false);
+            appender->setIntField(intIdx, (int64_t)fid);
+            appender->setFloatField(floatIdx, fid * 2.0);
+            appender->setStringField(strIdx, "row" + std::to_string(fid));
+        }
+        appender->setNeighbours(std::vector<size_t>(1, fid - 1));
+        aligned = aligned && ((att->getSize() == APPEND_START) || ((att->getSize() % APPEND_CHUNK) == 0));
+        aligned = aligned && (appender->getNumBuffered() <= APPEND_CHUNK);
+    }
+    CHECK(aligned);
+    CHECK(appender->getSize() == (APPEND_START + (APPEND_ROWS / 2)));
+    CHECK(att->getSize() < appender->getSize());
+    thrown = false;
+    try
+    {
+        appender->setIntField(intIdx + 5, 1);
+    }
+    catch(kealib::KEAATTException &e)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+    
+    // A COLUMN ADDED PART WAY THROUGH IS PICKED UP BY THE NEXT ROW
+    att->addAttIntField("extra", 3);
+    size_t extraIdx = att->getFieldIndex("extra");
+    for(size_t i = (APPEND_ROWS / 2); i < APPEND_ROWS; ++i)
+    {
+        size_t fid = appender->appendRow();
+        appender->setIntField(intIdx, (int64_t)fid);
+        if(i == (APPEND_ROWS - 1))
+        {
+            appender->setIntField(extraIdx, 42);
+        }
+    }
+    appender->flush();
+    CHECK(appender->getNumBuffered() == 0);
+    CHECK(att->getSize() == (APPEND_START + APPEND_ROWS));
+    delete appender;
+    
+    CHECK(att->getIntField(5, "id") == -1);
+    CHECK((att->getBoolField(12, "flag") == false) && (att->getBoolField(13, "flag") == true));
+    CHECK((att->getIntField(12, "id") == 12) && (att->getIntField(13, "id") == -1));
+    CHECK((att->getFloatField(12, "area") == 24.0) && (att->getFloatField(13, "area") == 0.5));
+    CHECK((att->getStringField(12, "name") == "row12") && (att->getStringField(13, "name") == "none"));
+    CHECK((att->getIntField(70, "id") == 70) && (att->getStringField(70, "name") == "none"));
+    CHECK((att->getIntField(30, "extra") == 3) && (att->getIntField(70, "extra") == 3));
+    CHECK(att->getIntField(APPEND_START + APPEND_ROWS - 1, "extra") == 42);
+    std::vector<size_t> offsets, indices;
+    att->getNeighboursCSR(APPEND_START, APPEND_ROWS, &offsets, &indices);
+    CHECK((offsets[1] == 1) && (indices[0] == (APPEND_START - 1)));
+    CHECK((offsets[(APPEND_ROWS / 2)] == (APPEND_ROWS / 2)) && (offsets[APPEND_ROWS] == (APPEND_ROWS / 2)));
+    CHECK(indices[(APPEND_ROWS / 2) - 1] == (APPEND_START + (APPEND_ROWS / 2) - 2));
+    
+    // THE DESTRUCTOR WRITES ANY ROWS NOT FLUSHED
+    appender = new kealib::KEAAttributeTableAppender(fileAtt);
+    appender->appendRow();
+    appender->setStringField(strIdx, "last");
+    delete appender;
+    CHECK(att->getSize() == (APPEND_START + APPEND_ROWS + 1));
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    io->close();
+    delete io;
+    
+    io = openTestImage("testatt_append.kea");
+    att = io->getAttributeTable(kealib::kea_att_file, 1);
+    CHECK(att->getSize() == (APPEND_START + APPEND_ROWS + 1));
+    CHECK(att->getStringField(APPEND_START + APPEND_ROWS, "name") == "last");
+    CHECK(att->getIntField(APPEND_START + APPEND_ROWS, "id") == -1);
+    CHECK(att->getIntField(12, "id") == 12);
+    
+    // THE ZONES OF THE APPENDED CHUNKS COME FROM THE VALUES WRITTEN AND THE
+    // ROWS RESERVED ARE PICKED UP FROM THE SIZE OF THE DATASETS
+    fileAtt = static_cast<kealib::KEAAttributeTableFile*>(att);
+    std::vector<int64_t> mins, maxs, ids(att->getSize());
+    fileAtt->getIntZoneMap(intIdx, &mins, &maxs);
+    att->getIntFields(0, att->getSize(), intIdx, &ids[0]);
+    bool zonesMatch = (mins.size() == ((att->getSize() + APPEND_CHUNK - 1) / APPEND_CHUNK));
+    for(size_t c = 0; zonesMatch && (c < mins.size()); ++c)
+    {
+        std::vector<int64_t>::iterator chunkBegin = ids.begin() + (c * APPEND_CHUNK);
+        std::vector<int64_t>::iterator chunkEnd = ids.begin() + std::min((c + 1) * APPEND_CHUNK, ids.size());
+        zonesMatch = (mins[c] == *std::min_element(chunkBegin, chunkEnd)) && (maxs[c] == *std::max_element(chunkBegin, chunkEnd));
+    }
+    CHECK(zonesMatch);
+    CHECK((fileAtt->getReservedRows() > att->getSize()) && ((fileAtt->getReservedRows() % APPEND_CHUNK) == 0));
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    att = io->getAttributeTable(kealib::kea_att_mem, 1);
+    att->getNeighboursCSR(APPEND_START, 2, &offsets, &indices);
+    CHECK((indices.size() == 2) && (indices[0] == (APPEND_START - 1)) && (indices[1] == APPEND_START));
+    att->getNeighboursCSR(APPEND_START + APPEND_ROWS - 2, 3, &offsets, &indices);
+    CHECK(indices.empty());
+    kealib::KEAAttributeTable::destroyAttributeTable(att);
+    io->close();
+    delete io;
+}
+
+// GIVES THE TEST ACCESS TO THE ARENA HOLDING THE STRINGS AND THE ROW VIEWS
+class KEATestTableInMem : public kealib::KEAAttributeTableInMem
+{
+public:
+    size_t getArenaUsedBytes() const
+    {
+        return strArena.getUsedBytes();
+    }
+    size_t getNumFeatureViews() const
+    {
+        return featureViews.size();
+    }
+};
+
+#define VIEW_ROWS 3000
+
+static void testFeatureViews()
+{
+    // CHANGES MADE THROUGH THE VIEWS REACH THE COLUMNS WHETHER THE VIEW IS
+    // STILL KEPT OR HAS BEEN DROPPED, AND ONLY SO MANY VIEWS ARE KEPT
+    KEATestTableInMem att;
+    static_cast<kealib::KEAAttributeTable&>(att).addAttIntField("id", -1);
+    att.addRows(VIEW_ROWS);
+    for(size_t i = 0; i < VIEW_ROWS; ++i)
+    {
+        att.getFeature(i)->intFields->at(0) = (int64_t)i;
+    }
+    CHECK((att.getNumFeatureViews() > 0) && (att.getNumFeatureViews() < VIEW_ROWS));
+    std::vector<int64_t> ids(VIEW_ROWS);
+    att.getIntFields(0, VIEW_ROWS, 0, &ids[0]);
+    bool match = true;
+    for(size_t i = 0; i < VIEW_ROWS; ++i)
+    {
+        match = match && (ids[i] == (int64_t)i);
+    }
+    CHECK(match);
+    att.setIntField(VIEW_ROWS - 1, (size_t)0, 7);
+    CHECK(att.getFeature(VIEW_ROWS - 1)->intFields->at(0) == 7);
+}
+
+#define ARENA_ROWS 1000
+
+static void testStringArena()
+{
+    kealib::KEAStringArena arena(1024);
+    const char *a = arena.add("interned");
+    CHECK(arena.add(std::string("interned")) == a);
+    std::string longStr(100, 'x');
+    const char *b = arena.add(longStr);
+    CHECK(std::string(b) == longStr);
+    CHECK(arena.getUsedBytes() == 9 + 101);
+    kealib::KEAStringArena other;
+    other.swap(arena);
+    CHECK(arena.getUsedBytes() == 0);
+    CHECK(other.getUsedBytes() == 9 + 101);
+    CHECK(other.add("interned") == a);
+    
+    // REPLACED STRINGS ARE DROPPED ONCE THEY ARE OVER HALF THE ARENA AND
+    // A LONG DEFAULT SHARED BY THE ROWS IS STILL STORED ONCE
+    KEATestTableInMem att;
+    std::string longDefault(200, 'd');
+    static_cast<kealib::KEAAttributeTable&>(att).addAttStringField("name", longDefault);
+    att.addRows(ARENA_ROWS);
+    std::vector<std::string> vals(ARENA_ROWS / 2);
+    for(int pass = 0; pass < 100; ++pass)
+    {
+        for(size_t i = 0; i < vals.size(); ++i)
+        {
+            vals[i] = std::string(100, 'a' + (pass % 26)) + std::to_string(i);
+        }
+        att.setStringFields(0, vals.size(), 0, &vals);
+        att.setStringField(ARENA_ROWS - 1, "name", std::string(150, 'z') + std::to_string(pass));
+    }
+    // ~100 BYTES FOR EACH OF 500 ROWS OVER 100 PASSES IS ~5MB WITHOUT COMPACTION
+    CHECK(att.getArenaUsedBytes() < (3 * kealib::KEA_STRING_ARENA_BLOCK_SIZE));
+    CHECK(att.getStringField(10, (size_t)0) == vals[10]);
+    CHECK(att.getStringField(ARENA_ROWS / 2, (size_t)0) == longDefault);
+    CHECK(att.getStringField(ARENA_ROWS - 2, (size_t)0) == longDefault);
+    CHECK(att.getStringField(ARENA_ROWS - 1, (size_t)0) == std::string(150, 'z') + "99");
+    att.addRows(1);
+    CHECK(att.getStringField(ARENA_ROWS, (size_t)0) == longDefault);
+    
+    // THE EXPORTED STRING TABLE HAS NO FILL VALUE SO ROWS ADDED TO IT IN THE
+    // FILE HOLD NULL REFERENCES, WHICH READ AS ""
+    kealib::KEAAttributeTable *exportAtt = new kealib::KEAAttributeTableInMem();
+    exportAtt->addAttStringField("name", "");
+    exportAtt->addRows(10);
+    exportAtt->setStringField(3, "name", "three");
+    kealib::KEAImageIO *io = createTestImage("testatt_arena.kea");
+    io->setAttributeTable(exportAtt, 1, 4);
+    kealib::KEAAttributeTable::destroyAttributeTable(exportAtt);
+    kealib::KEAAttributeTable *fileAtt = io->getAttributeTable(kealib::kea_att_file, 1);
+    fileAtt->addRows(10);
+    std::vector<std::string> names;
+    fileAtt->getStringFields(0, 20, 0, &names);
+    CHECK((names.size() == 20) && (names[3] == "three") && (names[4] == "") && (names[15] == ""));
+    CHECK(fileAtt->getStringField(19, "name") == "");
+    kealib::KEAAttributeTable::destroyAttributeTable(fileAtt);
+    io->close();
+    delete io;
+}
+
+int main()
+{
+    try
+    {
+        testLazyDefaults();
+        testDictionaryEncoding();
+        testColumnSelection();
+        testArrowRoundTrip();
+        testPredicates();
+        testZoneMaps();
+        testIndexes();
+        testAggregate();
+        testNeighboursCSR();
+        testInMemNeighbours();
+        testGraph();
+        testAppender();
+        testStringArena();
+        testFeatureViews();
+    }
+    catch(kealib::KEAException &e)
+    {
+        fprintf(stderr, "Exception raised: %s\n", e.what());
+        return 1;
+    }
+
+    if(numFailed > 0)
+    {
+        fprintf(stderr, "%d checks failed\n", numFailed);
+        return 1;
+    }
+    printf("Success\n");
+
+    return 0;
+}
@@ -0,0 +1,569 @@
+/*
+ *  testimageio.cpp
+ *  LibKEA
+ *
+ *  Copyright 2012 LibKEA. All rights reserved.
+ *
+ *  This file is part of LibKEA.
+ *
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without restriction,
+ *  including without limitation the rights to use, copy, modify,
+ *  merge, publish, distribute, sublicense, and/or sell copies of the
+ *  Software, and to permit persons to whom the Software is furnished
+ *  to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ *  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ *  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ *  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "libkea/KEAImageIO.h"
+
+static int numFailed = 0;
+
+#define CHECK(cond) \
+    if(!(cond)) \
+    { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        ++numFailed; \
+    }
+
+static bool closeTo(double a, double b)
+{
+    return fabs(a - b) <= (1e-9 * (fabs(a) + fabs(b) + 1));
+}
+
+static bool sameStats(const kealib::KEABandStats &a, const kealib::KEABandStats &b)
+{
+    return closeTo(a.min, b.min) && closeTo(a.max, b.max) && closeTo(a.mean, b.mean)
+        && closeTo(a.stdDev, b.stdDev) && (a.numValidPxls == b.numValidPxls);
+}
+
+#define MASK_XSIZE 50
+#define MASK_YSIZE 40
+
+static void testNoDataMask()
+{
+    kealib::KEAImageIO io;
+    H5::H5File *h5file = kealib::KEAImageIO::createKEAImage("testimageio_mask.kea",
+                    kealib::kea_16int, MASK_XSIZE, MASK_YSIZE, 1);
+    io.openKEAImageHeader(h5file);
+
+    std::vector<int16_t> data(MASK_XSIZE * MASK_YSIZE);
+    for(size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = (int16_t) (i % 5);
+    }
+    io.writeImageBlock2Band(1, &data[0], 0, 0, MASK_XSIZE, MASK_YSIZE,
+                MASK_XSIZE, MASK_YSIZE, kealib::kea_16int);
+
+    // WITHOUT A NO DATA VALUE EVERY PIXEL IS VALID
+    std::vector<uint8_t> mask(MASK_XSIZE * MASK_YSIZE, 0);
+    io.readImageBlock2BandMask(1, &mask[0], 0, 0, MASK_XSIZE, MASK_YSIZE,
+                MASK_XSIZE, MASK_YSIZE, kealib::kea_8uint);
+    bool allValid = true;
+    for(size_t i = 0; i < mask.size(); ++i)
+    {
+        allValid = allValid && (mask[i] == 255);
+    }
+    CHECK(allValid);
+    CHECK(!io.maskCreated(1));
+
+    // THE VIRTUAL MASK IS 0 WHERE THE DATA EQUALS THE NO DATA VALUE
+    int16_t noData = 3;
+    io.setNoDataValue(1, &noData, kealib::kea_16int);
+    io.readImageBlock2BandMask(1, &mask[0], 0, 0, MASK_XSIZE, MASK_YSIZE,
+                MASK_XSIZE, MASK_YSIZE, kealib::kea_8uint);
+    bool maskMatches = true;
+    for(size_t i = 0; i < mask.size(); ++i)
+    {
+        maskMatches = maskMatches && (mask[i] == ((data[i] == noData) ? 0 : 255));
+    }
+    CHECK(maskMatches);
+
+    // A PADDED WINDOW READ WITH THE DATA, IN A WIDER BUFFER TYPE AND IN A BUFFER
+    // TYPE THE NO DATA VALUE CANNOT BE HELD IN (FALLING BACK TO THE BAND TYPE)
+    const uint64_t xOff = 7;
+    const uint64_t yOff = 5;
+    const uint64_t xSize = 20;
+    const uint64_t ySize = 10;
+    const uint64_t xSizeBuf = 24;
+    std::vector<double> windowData(xSizeBuf * ySize, 0);
+    std::vector<uint8_t> windowMask(xSizeBuf * ySize, 1);
+    io.readImageBlockWithMask(1, &windowData[0], &windowMask[0], xOff, yOff, xSize, ySize,
+                xSizeBuf, ySize, kealib::kea_64float);
+    std::vector<uint8_t> byteData(xSizeBuf * ySize, 0);
+    std::vector<uint8_t> byteMask(xSizeBuf * ySize, 1);
+    noData = -1;
+    io.setNoDataValue(1, &noData, kealib::kea_16int);
+    io.readImageBlockWithMask(1, &byteData[0], &byteMask[0], xOff, yOff, xSize, ySize,
+                xSizeBuf, ySize, kealib::kea_8uint);
+    bool windowMatches = true;
+    for(uint64_t y = 0; y < ySize; ++y)
+    {
+        for(uint64_t x = 0; x < xSize; ++x)
+        {
+            int16_t val = data[((y + yOff) * MASK_XSIZE) + x + xOff];
+            windowMatches = windowMatches && (windowData[(y * xSizeBuf) + x] == val);
+            windowMatches = windowMatches && (windowMask[(y * xSizeBuf) + x] == ((val == 3) ? 0 : 255));
+            windowMatches = windowMatches && (byteMask[(y * xSizeBuf) + x] == 255);
+        }
+        // THE PADDING IS LEFT ALONE
+        windowMatches = windowMatches && (windowMask[(y * xSizeBuf) + xSize] == 1);
+    }
+    CHECK(windowMatches);
+
+    // A REAL MASK TAKES OVER FROM THE NO DATA VALUE
+    io.createMask(1);
+    CHECK(io.maskCreated(1));
+    std::vector<uint8_t> maskIn(MASK_XSIZE * MASK_YSIZE, 255);
+    maskIn[0] = 0;
+    io.writeImageBlock2BandMask(1, &maskIn[0], 0, 0, MASK_XSIZE, MASK_YSIZE,
+                MASK_XSIZE, MASK_YSIZE, kealib::kea_8uint);
+    std::vector<int16_t> maskedData(MASK_XSIZE * MASK_YSIZE);
+    io.readImageBlockWithMask(1, &maskedData[0], &mask[0], 0, 0, MASK_XSIZE, MASK_YSIZE,
+                MASK_XSIZE, MASK_YSIZE, kealib::kea_16int);
+    CHECK(mask == maskIn);
+    CHECK(maskedData == data);
+
+    io.close();
+}
+
+static void testBandStatistics()
+{
+    kealib::KEAImageIO io;
+    H5::H5File *h5file = kealib::KEAImageIO::createKEAImage("testimageio_bandstats.kea",
+                    kealib::kea_8uint, MASK_XSIZE, MASK_YSIZE, 1);
+    io.openKEAImageHeader(h5file);
+    io.setImageBandLayerType(1, kealib::kea_thematic);
+
+    std::vector<uint8_t> data(MASK_XSIZE * MASK_YSIZE);
+    std::vector<uint64_t> counts(10, 0);
+    double sum = 0;
+    for(size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = (uint8_t) ((i * 7) % 10);
+        ++counts[data[i]];
+        sum += data[i];
+    }
+    io.writeImageBlock2Band(1, &data[0], 0, 0, MASK_XSIZE, MASK_YSIZE,
+                MASK_XSIZE, MASK_YSIZE, kealib::kea_8uint);
+    double mean = sum / ((double) data.size());
+    double sumSqDiff = 0;
+    for(size_t i = 0; i < data.size(); ++i)
+    {
+        sumSqDiff += (data[i] - mean) * (data[i] - mean);
+    }
+
+    kealib::KEABandStats stats = io.computeBandStatistics(1);
+    CHECK(stats.min == 0);
+    CHECK(stats.max == 9);
+    CHECK(closeTo(stats.mean, mean));
+    CHECK(closeTo(stats.stdDev, sqrt(sumSqDiff / ((double) data.size()))));
+    CHECK(stats.numValidPxls == data.size());
+    CHECK(stats.histoBinFunction == "direct");
+    CHECK(stats.histogram == counts);
+
+    // A THEMATIC HISTOGRAM HAS ONE ATTRIBUTE TABLE ROW PER VALUE
+    kealib::KEAAttributeTable *rat = io.getAttributeTable(kealib::kea_att_file, 1);
+    CHECK(rat->getSize() == counts.size());
+    std::vector<double> histo(rat->getSize());
+    rat->getFloatFields(0, histo.size(), rat->getFieldIndex(kealib::KEA_ATT_HISTOGRAM_FIELD), &histo[0]);
+    bool histoMatches = true;
+    for(size_t i = 0; i < histo.size(); ++i)
+    {
+        histoMatches = histoMatches && (histo[i] == (double) counts[i]);
+    }
+    CHECK(histoMatches);
+    CHECK(io.getImageBandMetaData(1, "STATISTICS_HISTONUMBINS") == "10");
+    double median = kealib::KEAImageIO::getStatsPercentile(stats, 50);
+    CHECK((median >= 4) && (median <= 5));
+    delete rat;
+
+    io.close();
+}
+
+static void testNonFiniteStatistics()
+{
+    kealib::KEAImageIO io;
+    H5::H5File *h5file = kealib::KEAImageIO::createKEAImage("testimageio_nonfinite.kea",
+                    kealib::kea_32float, MASK_XSIZE, MASK_YSIZE, 1);
+    io.openKEAImageHeader(h5file);
+
+    // +/-INF AND NAN PIXELS ARE LEFT OUT OF THE STATISTICS AND HISTOGRAM
+    std::vector<float> data(MASK_XSIZE * MASK_YSIZE);
+    uint64_t numFinite = 0;
+    double sum = 0;
+    for(size_t i = 0; i < data.size(); ++i)
+    {
+        if((i % 10) == 0)
+        {
+            data[i] = INFINITY;
+        }
+        else if((i % 10) == 1)
+        {
+            data[i] = -INFINITY;
+        }
+        else if((i % 10) == 2)
+        {
+            data[i] = NAN;
+        }
+        else
+        {
+            data[i] = (float) (i % 100);
+            sum += data[i];
+            ++numFinite;
+        }
+    }
+    io.writeImageBlock2Band(1, &data[0], 0, 0, MASK_XSIZE, MASK_YSIZE,
+                MASK_XSIZE, MASK_YSIZE, kealib::kea_32float);
+
+    kealib::KEABandStats stats = io.computeBandStatistics(1);
+    CHECK(stats.min == 3);
+    CHECK(stats.max == 99);
+    CHECK(closeTo(stats.mean, sum / ((double) numFinite)));
+    CHECK(stats.numValidPxls == numFinite);
+    uint64_t histoTotal = 0;
+    for(size_t i = 0; i < stats.histogram.size(); ++i)
+    {
+        histoTotal += stats.histogram[i];
+    }
+    CHECK(histoTotal == numFinite);
+    CHECK(sameStats(stats, io.computeBandStatistics(1, true)));
+
+    // THE CHUNK SUMMARIES SKIP THEM TOO
+    io.createChunkStatistics(1);
+    CHECK(sameStats(stats, io.getBandStatisticsFromChunks(1)));
+
+    io.close();
+}
+
+// 600 x 500 FLOAT BAND WITH EVERY SEVENTH PIXEL SET TO THE NO DATA VALUE
+#define STATS_XSIZE 600
+#define STATS_YSIZE 500
+#define STATS_NODATA -9999.0
+
+static void testChunkStatistics()
+{
+    kealib::KEAImageIO io;
+    H5::H5File *h5file = kealib::KEAImageIO::createKEAImage("testimageio_stats.kea",
+                    kealib::kea_32float, STATS_XSIZE, STATS_YSIZE, 1);
+    io.openKEAImageHeader(h5file);
+
+    std::vector<float> data(STATS_XSIZE * STATS_YSIZE);
+    uint64_t numNoData = 0;
+    for(size_t i = 0; i < data.size(); ++i)
+    {
+        if((i % 7) == 0)
+        {
+            data[i] = STATS_NODATA;
+            ++numNoData;
+        }
+        else
+        {
+            data[i] = (float) (i % 1000);
+        }
+    }
+    io.writeImageBlock2Band(1, &data[0], 0, 0, STATS_XSIZE, STATS_YSIZE,
+                STATS_XSIZE, STATS_YSIZE, kealib::kea_32float);
+    double noData = STATS_NODATA;
+    io.setNoDataValue(1, &noData, kealib::kea_64float);
+
+    // EVERY PIXEL IS READ
+    kealib::KEABandStats withNoDataScan = io.computeBandStatistics(1, false, false);
+    kealib::KEABandStats ignoreNoDataScan = io.computeBandStatistics(1, false, true);
+    CHECK(withNoDataScan.min == STATS_NODATA);
+    CHECK(withNoDataScan.numValidPxls == (uint64_t) (STATS_XSIZE * STATS_YSIZE));
+    CHECK(ignoreNoDataScan.min == 0);
+    CHECK(ignoreNoDataScan.numValidPxls == ((STATS_XSIZE * STATS_YSIZE) - numNoData));
+
+    // THE MOMENTS NOW COME FROM THE CHUNK SUMMARIES WHERE THEY CAN
+    io.createChunkStatistics(1);
+    kealib::KEABandStats withNoDataChunks = io.computeBandStatistics(1, false, false);
+    kealib::KEABandStats ignoreNoDataChunks = io.computeBandStatistics(1, false, true);
+    CHECK(sameStats(withNoDataScan, withNoDataChunks));
+    CHECK(sameStats(ignoreNoDataScan, ignoreNoDataChunks));
+    CHECK(withNoDataScan.histogram == withNoDataChunks.histogram);
+    CHECK(ignoreNoDataScan.histogram == ignoreNoDataChunks.histogram);
+    CHECK(sameStats(ignoreNoDataScan, io.getBandStatisticsFromChunks(1)));
+
+    // CHANGING THE NO DATA VALUE ONLY MARKS THEM STALE, SO THEY AREN'T USED
+    // UNTIL THE WHOLE BAND IS UPDATED
+    CHECK(!io.chunkStatisticsStale(1));
+    noData = 0;
+    io.setNoDataValue(1, &noData, kealib::kea_64float);
+    CHECK(io.chunkStatisticsStale(1));
+    bool threw = false;
+    try
+    {
+        io.getBandStatisticsFromChunks(1);
+    }
+    catch(kealib::KEAIOException &e)
+    {
+        threw = true;
+    }
+    CHECK(threw);
+    kealib::KEABandStats newNoDataScan = io.computeBandStatistics(1, false, true);
+    CHECK(newNoDataScan.min == STATS_NODATA);
+    io.updateChunkStatistics(1, 0, 0, 100, 100);
+    CHECK(io.chunkStatisticsStale(1));
+    io.updateChunkStatistics(1, 0, 0, STATS_XSIZE, STATS_YSIZE);
+    CHECK(!io.chunkStatisticsStale(1));
+    CHECK(sameStats(newNoDataScan, io.getBandStatisticsFromChunks(1)));
+
+    io.close();
+}
+
+static void testChunkStatisticsPrecision()
+{
+    // A SMALL SPREAD ABOUT A LARGE OFFSET, WHERE A SUM OF SQUARES LOSES THE VARIANCE
+    kealib::KEAImageIO io;
+    H5::H5File *h5file = kealib::KEAImageIO::createKEAImage("testimageio_chunkprec.kea",
+                    kealib::kea_64float, STATS_XSIZE, STATS_YSIZE, 1);
+    io.openKEAImageHeader(h5file);
+    std::vector<double> data(STATS_XSIZE * STATS_YSIZE);
+    for(size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = 1e9 + (double) (i % 3);
+    }
+    io.writeImageBlock2Band(1, &data[0], 0, 0, STATS_XSIZE, STATS_YSIZE,
+                STATS_XSIZE, STATS_YSIZE, kealib::kea_64float);
+    io.createChunkStatistics(1);
+    kealib::KEABandStats stats = io.getBandStatisticsFromChunks(1);
+    CHECK(fabs(stats.mean - (1e9 + 1)) < 1e-4);
+    CHECK(fabs(stats.stdDev - sqrt(2.0 / 3.0)) < 1e-6);
+    io.close();
+}
+
+static void testChunkStatisticsOnWrite()
+{
+    kealib::KEAImageIO io;
+    H5::H5File *h5file = kealib::KEAImageIO::createKEAImage("testimageio_chunkwrite.kea",
+                    kealib::kea_32float, STATS_XSIZE, STATS_YSIZE, 1);
+    io.openKEAImageHeader(h5file);
+    double noData = STATS_NODATA;
+    io.setNoDataValue(1, &noData, kealib::kea_64float);
+    io.createChunkStatistics(1);
+
+    // WRITE BLOCK BY BLOCK, SO EACH BLOCK IS SUMMARISED FROM THE BUFFER
+    uint64_t blockSize = io.getImageBlockSize(1);
+    std::vector<float> block(blockSize * blockSize);
+    for(uint64_t yOff = 0; yOff < STATS_YSIZE; yOff += blockSize)
+    {
+        for(uint64_t xOff = 0; xOff < STATS_XSIZE; xOff += blockSize)
+        {
+            uint64_t xBlkSize = ((STATS_XSIZE - xOff) < blockSize) ? (STATS_XSIZE - xOff) : blockSize;
+            uint64_t yBlkSize = ((STATS_YSIZE - yOff) < blockSize) ? (STATS_YSIZE - yOff) : blockSize;
+            for(size_t i = 0; i < (xBlkSize * yBlkSize); ++i)
+            {
+                block[i] = ((i % 11) == 0) ? STATS_NODATA : (float) ((xOff + yOff + i) % 500);
+            }
+            io.writeImageBlock2Band(1, &block[0], xOff, yOff, xBlkSize, yBlkSize,
+                        xBlkSize, yBlkSize, kealib::kea_32float);
+        }
+    }
+
+    // A REGION ACROSS BLOCK EDGES FROM A PADDED BUFFER OF ANOTHER TYPE
+    std::vector<double> region(120 * 100, 1000.5);
+    io.writeImageBlock2Band(1, &region[0], 200, 200, 110, 100, 120, 100, kealib::kea_64float);
+    // A WHOLE BLOCK FROM A BUFFER OF ANOTHER TYPE
+    std::vector<int32_t> intBlock(blockSize * blockSize, -3);
+    io.writeImageBlock2Band(1, &intBlock[0], 0, 0, blockSize, blockSize,
+                blockSize, blockSize, kealib::kea_32int);
+
+    std::vector<kealib::KEAChunkStats> onWrite;
+    io.getChunkStatistics(1, 0, 0, STATS_XSIZE, STATS_YSIZE, &onWrite);
+    io.updateChunkStatistics(1, 0, 0, STATS_XSIZE, STATS_YSIZE);
+    std::vector<kealib::KEAChunkStats> rebuilt;
+    io.getChunkStatistics(1, 0, 0, STATS_XSIZE, STATS_YSIZE, &rebuilt);
+    CHECK(onWrite.size() == rebuilt.size());
+    for(size_t i = 0; (i < onWrite.size()) && (i < rebuilt.size()); ++i)
+    {
+        CHECK(onWrite[i].count == rebuilt[i].count);
+        CHECK(onWrite[i].min == rebuilt[i].min);
+        CHECK(onWrite[i].max == rebuilt[i].max);
+        CHECK(closeTo(onWrite[i].mean, rebuilt[i].mean));
+        CHECK(closeTo(onWrite[i].m2, rebuilt[i].m2));
+    }
+    CHECK(rebuilt[0].min == -3);
+
+    io.close();
+}
+
+static void testEmptyBlocks()
+{
+    kealib::KEAImageIO io;
+    H5::H5File *h5file = kealib::KEAImageIO::createKEAImage("testimageio_empty.kea",
+                    kealib::kea_32float, STATS_XSIZE, STATS_YSIZE, 1);
+    io.openKEAImageHeader(h5file);
+    double noData = STATS_NODATA;
+    io.setNoDataValue(1, &noData, kealib::kea_64float);
+
+    // THE FIRST BLOCK HAS DATA, THE SECOND ONLY NO DATA AND THE REST ARE NOT WRITTEN
+    uint64_t blockSize = io.getImageBlockSize(1);
+    uint64_t numXBlocks = (STATS_XSIZE + blockSize - 1) / blockSize;
+    uint64_t numYBlocks = (STATS_YSIZE + blockSize - 1) / blockSize;
+    CHECK((numXBlocks > 2) && (numYBlocks > 1));
+    std::vector<float> block(blockSize * blockSize, 1.5);
+    io.writeImageBlock2Band(1, &block[0], 0, 0, blockSize, blockSize,
+                blockSize, blockSize, kealib::kea_32float);
+    std::fill(block.begin(), block.end(), (float) STATS_NODATA);
+    io.writeImageBlock2Band(1, &block[0], blockSize, 0, blockSize, blockSize,
+                blockSize, blockSize, kealib::kea_32float);
+
+    std::vector<bool> allocated;
+    io.getBlockAllocationMap(1, &allocated);
+    CHECK(allocated.size() == (numXBlocks * numYBlocks));
+    CHECK(allocated[0] && allocated[1]);
+    CHECK(std::count(allocated.begin(), allocated.end(), true) == 2);
+
+    // WITHOUT CHUNK STATISTICS A WRITTEN BLOCK ISN'T KNOWN TO BE ALL NO DATA
+    CHECK(!io.isBlockEmpty(1, 0, 0));
+    CHECK(!io.isBlockEmpty(1, 1, 0));
+    CHECK(io.isBlockEmpty(1, 2, 0) && io.isBlockEmpty(1, 0, 1));
+    std::vector<bool> empty;
+    io.getEmptyBlocks(1, 0, 0, 3, 2, &empty);
+    CHECK((empty.size() == 6) && !empty[0] && !empty[1] && empty[2] && empty[3]);
+
+    io.createChunkStatistics(1);
+    CHECK(!io.isBlockEmpty(1, 0, 0));
+    CHECK(io.isBlockEmpty(1, 1, 0));
+    CHECK(io.isBlockEmpty(1, 2, 0));
+    io.getEmptyBlocks(1, 1, 0, 2, 2, &empty);
+    CHECK((empty.size() == 4) && (std::count(empty.begin(), empty.end(), true) == 4));
+    io.getEmptyBlocks(1, 0, 0, 2, 1, &empty);
+    CHECK((empty.size() == 2) && !empty[0] && empty[1]);
+
+    bool threw = false;
+    try
+    {
+        io.getEmptyBlocks(1, numXBlocks - 1, 0, 2, 1, &empty);
+    }
+    catch(kealib::KEAIOException &e)
+    {
+        threw = true;
+    }
+    CHECK(threw);
+
+    io.close();
+}
+
+// LARGE ENOUGH (AND WITHOUT OVERVIEWS) FOR APPROXIMATE STATISTICS TO SAMPLE BLOCKS
+#define APPROX_XSIZE 1280
+#define APPROX_YSIZE 1280
+
+static void testApproxStatistics()
+{
+    kealib::KEAImageIO io;
+    H5::H5File *h5file = kealib::KEAImageIO::createKEAImage("testimageio_approx.kea",
+                    kealib::kea_32float, APPROX_XSIZE, APPROX_YSIZE, 1);
+    io.openKEAImageHeader(h5file);
+
+    // EACH BLOCK IS CLOSE TO A CONSTANT SO THE PIXELS WITHIN A BLOCK ARE STRONGLY
+    // CORRELATED AND THE SAMPLE IS WORTH FAR FEWER THAN ITS PIXEL COUNT
+    uint32_t blockSize = io.getImageBlockSize(1);
+    uint64_t numXBlocks = (APPROX_XSIZE + blockSize - 1) / blockSize;
+    std::vector<float> data(APPROX_XSIZE * APPROX_YSIZE);
+    for(uint64_t y = 0; y < APPROX_YSIZE; ++y)
+    {
+        for(uint64_t x = 0; x < APPROX_XSIZE; ++x)
+        {
+            uint64_t block = ((y / blockSize) * numXBlocks) + (x / blockSize);
+            data[(y * APPROX_XSIZE) + x] = (float) (((block * 37) % 100) + ((x + y) % 3));
+        }
+    }
+    io.writeImageBlock2Band(1, &data[0], 0, 0, APPROX_XSIZE, APPROX_YSIZE,
+                APPROX_XSIZE, APPROX_YSIZE, kealib::kea_32float);
+
+    kealib::KEABandStats exact = io.computeBandStatistics(1, false, true);
+    kealib::KEABandStats approx = io.computeBandStatistics(1, true, true);
+    CHECK(!exact.approximate);
+    CHECK(exact.meanStdError == 0);
+    CHECK(approx.approximate);
+    CHECK(approx.sampleFraction < 1);
+    CHECK(approx.numValidPxls < exact.numValidPxls);
+
+    // A PIXEL BASED ERROR WOULD BE FAR SMALLER THAN THE BLOCK TO BLOCK SPREAD
+    double pixelStdError = (approx.stdDev / sqrt((double) approx.numValidPxls)) * sqrt(1.0 - approx.sampleFraction);
+    CHECK(approx.meanStdError == approx.meanStdError);
+    CHECK(approx.meanStdError > (10 * pixelStdError));
+    CHECK(fabs(approx.mean - exact.mean) < (4 * approx.meanStdError));
+
+    // AN OVERVIEW IS NOT A RANDOM SAMPLE SO GIVES NO STANDARD ERROR
+    io.createOverview(1, 1, APPROX_XSIZE - 128, APPROX_YSIZE - 128);
+    io.writeToOverview(1, 1, &data[0], 0, 0, APPROX_XSIZE - 128, APPROX_YSIZE - 128,
+                APPROX_XSIZE - 128, APPROX_YSIZE - 128, kealib::kea_32float);
+    kealib::KEABandStats overview = io.computeBandStatistics(1, true, true);
+    CHECK(overview.approximate);
+    CHECK(overview.numValidPxls == (uint64_t) ((APPROX_XSIZE - 128) * (APPROX_YSIZE - 128)));
+    CHECK(overview.meanStdError != overview.meanStdError);
+
+    // ONLY THE EXACT RUN WROTE ITS HISTOGRAM AND METADATA
+    kealib::KEAAttributeTable *rat = io.getAttributeTable(kealib::kea_att_file, 1);
+    size_t histoIdx = rat->getFieldIndex(kealib::KEA_ATT_HISTOGRAM_FIELD);
+    std::vector<double> histo(rat->getSize());
+    rat->getFloatFields(0, histo.size(), histoIdx, &histo[0]);
+    double histoTotal = 0;
+    for(size_t i = 0; i < histo.size(); ++i)
+    {
+        histoTotal += histo[i];
+    }
+    CHECK(histoTotal == (double) exact.numValidPxls);
+    CHECK(closeTo(atof(io.getImageBandMetaData(1, "STATISTICS_MEAN").c_str()), exact.mean));
+    delete rat;
+    io.close();
+
+    // NOTHING IS WRITTEN FOR AN APPROXIMATE RESULT OR WHEN ONLY COMPUTING THEM
+    // SO BOTH WORK ON A READ ONLY FILE
+    h5file = kealib::KEAImageIO::openKeaH5RDOnly("testimageio_approx.kea");
+    io.openKEAImageHeader(h5file);
+    kealib::KEABandStats approxRDOnly = io.computeBandStatistics(1, true, true);
+    kealib::KEABandStats exactRDOnly = io.computeBandStatistics(1, false, true, false);
+    CHECK(approxRDOnly.approximate);
+    CHECK(sameStats(exact, exactRDOnly));
+    io.close();
+}
+
+int main()
+{
+    try
+    {
+        testNoDataMask();
+        testBandStatistics();
+        testNonFiniteStatistics();
+        testChunkStatistics();
+        testChunkStatisticsOnWrite();
+        testChunkStatisticsPrecision();
+        testEmptyBlocks();
+        testApproxStatistics();
+    }
+    catch(kealib::KEAException &e)
+    {
+        fprintf(stderr, "Exception raised: %s\n", e.what());
+        return 1;
+    }
+
+    if(numFailed > 0)
+    {
+        fprintf(stderr, "%d checks failed\n", numFailed);
+        return 1;
+    }
+    printf("Success\n");
+
+    return 0;
+}